@@ -0,0 +1,26 @@
+#!/bin/bash
+# CShell Project - Benchmark of pipelines between builtins
+# Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+# Date: 2025-03-17
+#
+# Compare the throughput of `cat FILE | cat | cat > /dev/null` when builtins are
+# fused on threads (default), forked with kernel pipes (--no-fusion) and run one
+# after another through an in-memory file (--buffered-pipes).
+#
+# Usage: bench/pipeline_fusion.sh [SIZE_MB]
+
+SIZE_MB=${1:-256}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+gcc "$ROOT"/main.c "$ROOT"/src/*.c -I"$ROOT"/includes -O2 -pthread -o "$TMP/program.exe" || exit 1
+head -c $((SIZE_MB * 1024 * 1024)) /dev/zero | tr '\0' 'a' > "$TMP/input.txt"
+
+for mode in "" "--no-fusion" "--buffered-pipes"; do
+    start=$(date +%s.%N)
+    printf 'cat %s | cat | cat > /dev/null\nexit\n' "$TMP/input.txt" | "$TMP/program.exe" $mode > /dev/null
+    end=$(date +%s.%N)
+    awk -v mode="${mode:-fused}" -v size="$SIZE_MB" -v start="$start" -v end="$end" \
+        'BEGIN { t = end - start; printf "%-18s %8.3f s %10.1f MB/s\n", mode, t, size / t }'
+done
@@ -0,0 +1,124 @@
+// CShell Project - Bump-pointer arena allocator
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Default size of a chunk of an arena
+#define ARENA_CHUNK_SIZE 65536
+// Every allocation is aligned on this size
+#define ARENA_ALIGNMENT 16
+
+typedef struct arena_chunk {
+    // Next chunk, kept after a reset to be reused
+    struct arena_chunk *next;
+    // Number of bytes of data
+    size_t size;
+    // Data of the chunk
+    _Alignas(ARENA_ALIGNMENT) char data[];
+} arena_chunk_t;
+
+typedef struct {
+    // Size of new chunks, 0 for ARENA_CHUNK_SIZE
+    size_t chunk_size;
+    // Every chunk of the arena, and the chunk being filled
+    arena_chunk_t *first;
+    arena_chunk_t *current;
+    // Number of bytes used in the current chunk
+    size_t used;
+    // Statistics since the last reset
+    size_t allocations;
+    size_t bytes;
+    // Statistics since the creation
+    size_t chunks;
+    size_t peak;
+} arena_t;
+
+typedef struct {
+    arena_chunk_t *chunk;
+    size_t used;
+} arena_mark_t;
+
+// Arena owning every allocation made while running a command line (tokens, arguments, expansions)
+extern arena_t LINE_ARENA;
+
+/**
+ * @brief Initialize an empty arena, no memory is allocated before the first allocation.
+ * @param arena The arena.
+ * @param chunk_size Size of chunks, 0 for ARENA_CHUNK_SIZE.
+ */
+void arena_init(arena_t *const arena, const size_t chunk_size);
+
+/**
+ * @brief Allocate memory inside an arena, it is freed all at once by arena_reset or arena_rewind.
+ * @param arena The arena.
+ * @param size Number of bytes.
+ * @return The memory aligned on ARENA_ALIGNMENT, NULL if malloc error.
+ */
+void *arena_alloc(arena_t *const arena, const size_t size);
+
+/**
+ * @brief Make an allocation of an arena bigger, in place if it is the last one.
+ * @param arena The arena.
+ * @param ptr The allocation, NULL to allocate.
+ * @param old_size Current size of the allocation.
+ * @param new_size New size of the allocation.
+ * @return The allocation, NULL if malloc error.
+ */
+void *arena_realloc(arena_t *const arena, void *const ptr, const size_t old_size, const size_t new_size);
+
+/**
+ * @brief Copy a string inside an arena.
+ * @param arena The arena.
+ * @param str The string.
+ * @param size Maximum number of characters to copy.
+ * @return The copy, NULL if malloc error.
+ */
+char *arena_strndup(arena_t *const arena, const char *const str, const size_t size);
+
+/**
+ * @brief Copy a string inside an arena.
+ * @param arena The arena.
+ * @param str The string.
+ * @return The copy, NULL if malloc error.
+ */
+char *arena_strdup(arena_t *const arena, const char *const str);
+
+/**
+ * @brief Remember the current position of an arena.
+ * @param arena The arena.
+ * @return The position.
+ */
+arena_mark_t arena_mark(const arena_t *const arena);
+
+/**
+ * @brief Free every allocation made after a position, in O(1).
+ * @param arena The arena.
+ * @param mark The position got by arena_mark.
+ */
+void arena_rewind(arena_t *const arena, const arena_mark_t mark);
+
+/**
+ * @brief Free every allocation of an arena in O(1), chunks are kept to be reused.
+ * @param arena The arena.
+ */
+void arena_reset(arena_t *const arena);
+
+/**
+ * @brief Give every chunk of an arena back to the system.
+ * @param arena The arena.
+ */
+void arena_destroy(arena_t *const arena);
+
+/**
+ * @brief Add a chunk after the current one of an arena.
+ * @param arena The arena.
+ * @param size Minimum number of bytes of the chunk.
+ * @return The chunk, NULL if malloc error.
+ */
+arena_chunk_t *_arena_add_chunk(arena_t *const arena, const size_t size);
+
+#endif
@@ -0,0 +1,148 @@
+// CShell Project - Arithmetic expansion and new let command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_ARITH_H
+#define COMMAND_ARITH_H
+
+#include "arena.h"
+
+// Number of compiled expressions kept in the cache (power of 2)
+#define ARITH_CACHE_SIZE 128
+// Size of chunks of the arena of each compiled expression
+#define ARITH_ARENA_CHUNK_SIZE 512
+// Maximum nesting of variables whose value is itself an expression
+#define ARITH_MAX_NESTING 16
+
+typedef enum {
+    // Push value
+    ARITH_PUSH,
+    // Push the value of variable name
+    ARITH_LOAD,
+    // Pop a value, store it in variable name (combined with binary for op=), push the result
+    ARITH_STORE,
+    // Add value to variable name, push the new value (pre) or the old one (post)
+    ARITH_PRE_INCREMENT,
+    ARITH_POST_INCREMENT,
+    // Unary operators on the top of the stack
+    ARITH_NEGATE,
+    ARITH_NOT,
+    ARITH_BIT_NOT,
+    // Replace the top of the stack with 0 or 1
+    ARITH_BOOL,
+    ARITH_POP,
+    // Jump to instruction value, the conditional jumps pop the top of the stack
+    ARITH_JUMP,
+    ARITH_JUMP_FALSE,
+    ARITH_JUMP_TRUE,
+    // Binary operators, pop two values and push the result
+    ARITH_MUL,
+    ARITH_DIV,
+    ARITH_MOD,
+    ARITH_ADD,
+    ARITH_SUB,
+    ARITH_SHL,
+    ARITH_SHR,
+    ARITH_LT,
+    ARITH_LE,
+    ARITH_GT,
+    ARITH_GE,
+    ARITH_EQ,
+    ARITH_NE,
+    ARITH_BIT_AND,
+    ARITH_BIT_XOR,
+    ARITH_BIT_OR,
+    ARITH_POW,
+    // No operation, plain = for ARITH_STORE
+    ARITH_NOP,
+} arith_op_t;
+
+typedef struct {
+    arith_op_t op;
+    // Operator of op= for ARITH_STORE
+    arith_op_t binary;
+    // Number to push, target of jumps, step of increments
+    long long value;
+    // Variable of ARITH_LOAD, ARITH_STORE and increments
+    const char *name;
+} arith_instr_t;
+
+typedef struct {
+    // Arena owning the text, the names and the instructions
+    arena_t arena;
+    // Expression, key of the cache
+    char *text;
+    unsigned long hash;
+    // Instructions run on a stack of values, never deeper than depth
+    arith_instr_t *code;
+    int count;
+    int depth;
+} arith_expr_t;
+
+typedef struct {
+    // Current position in the expression
+    const char *ptr;
+    // Instructions being compiled (malloc'd), copied in the arena at the end
+    arith_instr_t *code;
+    int count;
+    int capacity;
+    // Depth of the stack after the last instruction, and its maximum
+    int depth;
+    int max_depth;
+    // Arena owning the names
+    arena_t *arena;
+    // Set on a syntax error
+    int error;
+} arith_compiler_t;
+
+/**
+ * @brief Evaluate an arithmetic expression on 64-bit integers, e.g. "i += 2 * (j - 1)".
+ * The expression is compiled once and kept in a cache, variables are read and written at each evaluation.
+ * @param expression The expression, already expanded ($NAME and $(...) replaced).
+ * @param result Reference to store the value of the expression.
+ * @return 0 if evaluated, -1 if syntax error or division by 0 (reported on stderr).
+ */
+int arith_evaluate(const char *const expression, long long *const result);
+
+/**
+ * @brief Remove every compiled expression from the cache.
+ */
+void arith_cache_clear();
+
+/**
+ * @brief Get the compiled form of an expression, from the cache or by compiling it.
+ * @param expression The expression.
+ * @return The compiled expression owned by the cache, NULL if syntax error (reported on stderr) or malloc error.
+ */
+arith_expr_t *_arith_compile(const char *const expression);
+
+/**
+ * @brief Run a compiled expression.
+ * @param expr The compiled expression.
+ * @param result Reference to store the value.
+ * @param nesting Number of variables being evaluated as expressions around this one.
+ * @return 0 if evaluated, -1 if error (reported on stderr).
+ */
+int _arith_run(const arith_expr_t *const expr, long long *const result, const int nesting);
+
+/**
+ * @brief Parse an expression with the lowest priority: comma separated assignments.
+ * @param compiler The compiler.
+ */
+void _arith_parse_comma(arith_compiler_t *const compiler);
+
+/**
+ * @brief Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void _let_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of let, evaluate each argument as an arithmetic expression.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the last expression is not 0, 1 if it is 0 or if error.
+ */
+int our_let(const int argc, const char *const *const argv);
+
+#endif
@@ -0,0 +1,62 @@
+// CShell Project - Registry of builtin commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef BUILTIN_H
+#define BUILTIN_H
+
+// The builtin may run on a thread of the shell inside a fused pipeline
+// (it prints through sink_*, reads through source_read and has no global state)
+#define BUILTIN_FUSABLE 1
+// The builtin reads its stdin, the executor does not plug stdin for other builtins
+#define BUILTIN_READS_STDIN 2
+// The builtin always runs inside a forked copy of the shell, never on the shell itself nor on a thread
+// (it changes the state of the process, or may not return)
+#define BUILTIN_NEEDS_FORK 4
+
+// Function of a builtin command
+typedef int (*builtin_t)(const int argc, const char *const *const argv);
+
+typedef struct {
+    // Name of the command
+    const char *name;
+    // Function to call
+    builtin_t function;
+    // BUILTIN_* flags
+    int flags;
+} builtin_entry_t;
+
+/**
+ * @brief Register a builtin command, to use once in the source file of the command.
+ * Entries are gathered by the linker inside the cshell_builtins section.
+ * @param name The name of the command.
+ * @param function The function of the command.
+ * @param flags The BUILTIN_* flags of the command.
+ */
+#define REGISTER_BUILTIN(name, function, flags) \
+    static const builtin_entry_t _builtin_entry_##function \
+    __attribute__((used, section("cshell_builtins"), aligned(sizeof(void *)))) = { name, function, flags }
+
+/**
+ * @brief Compute the hash of a command name (_hash_string) mixed with a seed.
+ * @param name The command name.
+ * @param seed The seed of the hash.
+ * @return The hash of the name.
+ */
+unsigned int _builtin_hash(const char *name, const unsigned int seed);
+
+/**
+ * @brief Build the perfect hash table of every registered builtin, called once through pthread_once.
+ * A seed is searched so that no two builtins share a slot, the shell aborts if two builtins have the same name.
+ * The table stays NULL if malloc error, no command is then a builtin.
+ */
+void _builtin_build_table();
+
+/**
+ * @brief Find a builtin by its name, with a single string comparison.
+ * @param name The command name.
+ * @return The builtin entry, NULL if it is not a builtin.
+ */
+const builtin_entry_t *builtin_lookup(const char *const name);
+
+#endif
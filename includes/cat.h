@@ -19,6 +19,13 @@ void _cat_print_usage(const char *const program_name);
  */
 int _cat_parse_arguments(const int argc, const char *const *const argv);
 
+/**
+ * @brief Copy a file to the output by blocks.
+ * @param fd The file descriptor to read, -1 to read the input of the command.
+ * @return 0 if everything was copied, 1 on read/write error.
+ */
+int _cat_copy(const int fd);
+
 /**
  * @brief Main function of the program.
  * @param argc The number of arguments.
@@ -19,6 +19,13 @@ void _cd_print_usage(const char *const program_name);
  */
 int _cd_parse_arguments(const int argc, const char *const *const argv);
 
+/**
+ * @brief Change the working directory of the shell: the one of the process, or CWD_FD inside an embedding context.
+ * @param path The directory, relative to the current one.
+ * @return 0 if success, -1 if error (errno is set).
+ */
+int _cd_change_directory(const char *const path);
+
 /**
  * @brief Main function of the program.
  * @param argc The number of arguments.
@@ -5,6 +5,8 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// Version of the shell, cached scripts of other versions are not used
+#define CSHELL_VERSION "1.0.0"
 // Maximum length of an environment variable name
 #define MAX_ENV_NAME_LENGTH 256
 // Maximum length of a line for command
@@ -15,13 +17,60 @@
 extern char COMMAND[MAX_LINE_LENGTH];
 // History size
 #define HISTORY_SIZE 50
-// History array
-extern char HISTORY[HISTORY_SIZE][MAX_LINE_LENGTH];
+// History array, the one of the context while an embedding context runs a line
+extern char (*HISTORY)[MAX_LINE_LENGTH];
 // current working directory
 extern char CWD[MAX_PATH_LENGTH];
 // previous working directory
 extern char PWD[MAX_PATH_LENGTH];
+// Directory relative paths are resolved from, AT_FDCWD for the one of the process (see cshell.h)
+extern int CWD_FD;
 // current user name
 extern char USER[MAX_ENV_NAME_LENGTH];
+// Set by exit, the shell leaves after the current command
+extern int SHELL_EXIT;
+// Set when the shell runs inside another program (see cshell.h), exit ends the line instead of the process
+extern int EMBEDDED;
+// Set when SHELL_TRACE names a file, spans of the shell are written to it (see trace.h)
+extern int TRACE_ENABLED;
+// Number of file descriptors of the shell (0 to 9) which may differ from the ones of the process
+#define SHELL_FDS_COUNT 10
+// File descriptor of the process behind each one of the shell, -1 if closed: only an embedding context
+// changes them instead of the ones of the process, they are the ones of the process (n at n) otherwise
+extern int SHELL_FDS[SHELL_FDS_COUNT];
+// Maximum number of stages in a pipeline
+#define MAX_PIPELINE_STAGES 64
+// Maximum number of <(...) and >(...) open at the same time
+#define MAX_PROCESS_SUBSTITUTIONS 64
+// Size of kernel pipes between pipeline stages (0 keeps the kernel default)
+extern int PIPE_SIZE;
+// Run pipelines sequentially through an in-memory file instead of kernel pipes
+extern int PIPE_BUFFERED;
+// Run adjacent builtins of a pipeline on threads of the shell instead of processes
+extern int PIPE_FUSION;
+// Exit codes of each stage of the last pipeline
+extern int PIPE_STATUS[MAX_PIPELINE_STAGES];
+// Number of stages of the last pipeline
+extern int PIPE_STATUS_COUNT;
+// Return code of the last command, pipeline or compound command, expanded by $?
+extern int LAST_RETURN_CODE;
+// Maximum length of the value of $? and $PIPE_STATUS
+#define SPECIAL_VARIABLE_LENGTH (MAX_PIPELINE_STAGES * 12)
+
+// Set when the shell reads commands from a terminal, job control is enabled
+extern int INTERACTIVE;
+// Maximum number of background jobs running at the same time (0 for no limit)
+extern int MAX_JOBS;
+
+// File of the home directory sourced by interactive shells at startup
+#define RC_FILE_NAME ".cshellrc"
+// Keep the syntax trees of sourced files on disk, the next shells do not parse them again
+extern int SOURCE_CACHE;
+
+// Number of for, while and until loops running
+extern int LOOP_DEPTH;
+// Number of loops left by break, or by continue before the next iteration, 0 if none
+extern int LOOP_BREAK;
+extern int LOOP_CONTINUE;
 
 #endif
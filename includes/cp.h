@@ -5,36 +5,50 @@
 #ifndef COMMAND_CP_H
 #define COMMAND_CP_H
 
+typedef struct {
+    // -v, print debug messages
+    int debug;
+    // Space indentation for folders
+    int space;
+    // -a, allow secret files/folders
+    int hidden;
+    // --buffer, number of bytes to read/write files at once
+    int buffer_size;
+} cp_options_t;
+
 /**
  * @brief Concatenates a folder path with a file/folder name.
  * @param path The parent folder path.
  * @param name The file/folder name.
+ * @param options The options of the command.
  * @return The path to file/folder, NULL if malloc error.
  * @note This function handles missing of '/' at the end of path.
  * @warning It does not check if its return is an existing file/folder.
  */
-char *_cp_path_file_concat(const char *path, const char *name);
+char *_cp_path_file_concat(const char *path, const char *name, const cp_options_t *const options);
 
 /**
  * @brief Copy a file from one path to another.
  * It uses `copy_file_range` from _GNU_SOURCE to copy the file.
  * @param input_path The input path from where to read the file.
  * @param output_path The output path where to write the file.
+ * @param options The options of the command.
  * @return 0 if the file was copied successfully, 1 if input file does not exist, 2 if output file already exists.
  * @note This function handles permissions.
  */
-int _cp_copy_file(const char *input_path, const char *output_path);
+int _cp_copy_file(const char *input_path, const char *output_path, const cp_options_t *const options);
 
 /**
  * @brief Copy a file from one path to another.
  * @param input_dir The input path from where to read the folder.
  * @param output_dir The output path where to write the folder.
+ * @param options The options of the command, its indentation grows inside sub-folders.
  * @return 0 if the folder was copied successfully, 1 if input folder does not exist, 2 if malloc error.
  * @note This function handles permissions.
  * @warning It does not handle the case where the output file already exists.
  * @warning It does not check if the input file exists.
  */
-int _cp_copy_dir(const char *input_dir, const char *output_dir);
+int _cp_copy_dir(const char *input_dir, const char *output_dir, cp_options_t *const options);
 
 /**
  * @brief Print the usage of the program.
@@ -46,9 +60,10 @@ void _cp_print_usage(const char *const program_name);
  * @brief Parse the arguments of the program.
  * @param argc The number of arguments.
  * @param argv The arguments.
+ * @param options The options to fill.
  * @return 0 if arguments are good, -1 if -h or --help used.
  */
-int _cp_parse_arguments(const int argc, const char *const *const argv);
+int _cp_parse_arguments(const int argc, const char *const *const argv, cp_options_t *const options);
 
 /**
  * @brief Main function of the program.
@@ -0,0 +1,71 @@
+// CShell Project - Library to run command lines inside another program (libcshell)
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef CSHELL_H
+#define CSHELL_H
+
+#include <stddef.h>
+
+// Functions of the library, the only symbols exported by libcshell.so built with -fvisibility=hidden
+#define CSHELL_API __attribute__((visibility("default")))
+
+// Context of a shell: its variables, resolved commands, jobs, $? and $PIPE_STATUS, working directory and previous one (cd -)
+typedef struct cshell_s cshell_t;
+
+/**
+ * @brief Create a shell context, starting with the environment and working directory of the process.
+ * @return The context, to give to cshell_free, NULL if malloc error or if the working directory can not be opened.
+ */
+CSHELL_API cshell_t *cshell_new();
+
+/**
+ * @brief Run a command line (or several separated by new lines) inside a context, like cshell -c.
+ * Variables, exports, cd and background jobs stay in the context for the next lines, exit only ends the line.
+ * Contexts share no state: lines of every context run one at a time, each one with the state of its own context.
+ * The file descriptors, working directory and environ of the process are never changed, other threads
+ * of the program keep them: commands get the given file descriptors and the directory of the context at their start.
+ * @param shell The context.
+ * @param line The command line.
+ * @param in_fd The file descriptor read as stdin by the line, -1 to keep the one of the process.
+ * @param out_fd The file descriptor written as stdout by the line, -1 to keep the one of the process.
+ * @param err_fd The file descriptor written as stderr by the line, -1 to keep the one of the process.
+ * @return The return code of the last command, 2 if syntax error.
+ * @note Other file descriptors of the process are closed for the line, 3 to 9 are free for its redirections.
+ */
+CSHELL_API int cshell_eval(cshell_t *const shell, const char *const line, const int in_fd, const int out_fd, const int err_fd);
+
+/**
+ * @brief Free a context, its variables and its jobs.
+ * @param shell The context, may be NULL.
+ * @note Background jobs still running are not waited, they are left to the program.
+ */
+CSHELL_API void cshell_free(cshell_t *const shell);
+
+/**
+ * @brief Exchange two memory areas of the same size.
+ * @param a The first area.
+ * @param b The second area.
+ * @param size The size of both areas.
+ */
+void _cshell_swap(void *const a, void *const b, const size_t size);
+
+/**
+ * @brief Exchange the state of a context ($?, $PIPE_STATUS, directories, history) with the globals of the shell.
+ * @param shell The context.
+ */
+void _cshell_exchange(cshell_t *const shell);
+
+/**
+ * @brief Make the tables and state of a context the ones of the shell, before running one of its lines.
+ * @param shell The context.
+ */
+void _cshell_enter(cshell_t *const shell);
+
+/**
+ * @brief Give the tables and state back to a context after one of its lines.
+ * @param shell The context.
+ */
+void _cshell_leave(cshell_t *const shell);
+
+#endif
@@ -0,0 +1,33 @@
+// CShell Project - New echo command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_ECHO_H
+#define COMMAND_ECHO_H
+
+/**
+ * @brief Parse the options of the program, -n, -e and -E (possibly grouped).
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param newline Reference to store 0 if -n is used, 1 otherwise.
+ * @param escapes Reference to store 1 if -e is used (and not cancelled by a later -E), 0 otherwise.
+ * @return Index of the first argument to print.
+ */
+int _echo_parse_arguments(const int argc, const char *const *const argv, int *const newline, int *const escapes);
+
+/**
+ * @brief Write a string, interpreting backslash escapes (\n, \t, \0nnn, \xHH, ...).
+ * @param str The string to write.
+ * @return 1 if \c was found and the output must stop, 0 otherwise.
+ */
+int _echo_write_escaped(const char *const str);
+
+/**
+ * @brief Main function of the program.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_echo(const int argc, const char *const *const argv);
+
+#endif
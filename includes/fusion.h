@@ -0,0 +1,50 @@
+// CShell Project - Fused pipelines of builtins running on threads
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef FUSION_H
+#define FUSION_H
+
+#include "ring.h"
+#include "builtin.h"
+#include "redirect.h"
+#include "timing.h"
+
+typedef struct {
+    // Arguments of the stage and its redirections, only files opened on stdin and stdout
+    int argc;
+    char **argv;
+    const fd_actions_t *redirects;
+    // Builtin to run
+    builtin_t builtin;
+    // Input of the stage, ring buffer if previous stage is fused, file descriptor otherwise (-1 for stdin)
+    ring_t *in_ring;
+    int in_fd;
+    // Output of the stage, ring buffer if next stage is fused, file descriptor otherwise (-1 for stdout)
+    ring_t *out_ring;
+    int out_fd;
+    // Return code of the builtin
+    int return_code;
+    // Measures of the stage, NULL unless the pipeline is run by time
+    timing_stage_t *timing;
+} fused_stage_t;
+
+/**
+ * @brief Get the builtin of a pipeline stage if it can run on a thread inside the shell.
+ * @param argc The number of arguments of the stage.
+ * @param argv The arguments of the stage.
+ * @param redirects The redirections of the stage.
+ * @return The builtin, NULL if the stage has to run in its own process.
+ * @note Only builtins registered with BUILTIN_FUSABLE can be fused, with files on stdin and stdout as only redirections.
+ */
+builtin_t get_fusable_builtin(const int argc, char **const argv, const fd_actions_t *const redirects);
+
+/**
+ * @brief Run a fused stage, used as thread entry point.
+ * @param arg The fused_stage_t to run.
+ * @return NULL.
+ * @note The file descriptors of the stage are closed and its ring buffers are closed at the end.
+ */
+void *run_fused_stage(void *arg);
+
+#endif
@@ -0,0 +1,203 @@
+// CShell Project - Pathname expansion with compiled patterns
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+// Not named glob.h, which would hide the <glob.h> of the system
+
+#ifndef GLOBBING_H
+#define GLOBBING_H
+
+#include "config.h"
+#include "arena.h"
+#include <stddef.h>
+
+// Size of chunks of the arena of an expansion
+#define GLOB_ARENA_CHUNK_SIZE 4096
+// Size of the buffer given to getdents64
+#define GLOB_DENTS_BUFFER_SIZE 32768
+// Characters escaped by a backslash to be matched as is
+#define GLOB_SPECIAL_CHARACTERS "*?[]\\"
+
+typedef enum {
+    // Characters of text, length of them
+    GLOB_LITERAL,
+    // ? any single character
+    GLOB_ANY,
+    // * any run of characters, maybe empty
+    GLOB_STAR,
+    // [...] a character of set (or not of set if negated)
+    GLOB_CLASS,
+} glob_op_t;
+
+typedef struct {
+    glob_op_t op;
+    const char *text;
+    int length;
+    // 256 bits, one per character of a class
+    unsigned char *set;
+    int negated;
+} glob_instr_t;
+
+typedef struct {
+    // Unescaped text of a component without wildcards, which is opened without listing its directory
+    const char *text;
+    int literal;
+    // ** alone as a component, matching any number of directories
+    int recursive;
+    // Instructions of a component with wildcards
+    glob_instr_t *code;
+    int count;
+} glob_component_t;
+
+/**
+ * @brief Function called on each path found.
+ * @param path The path.
+ * @param length The length of the path.
+ * @param data The data given to glob_expand.
+ * @return 0 to go on, -1 to stop the expansion.
+ */
+typedef int (*glob_callback_t)(const char *const path, const size_t length, void *const data);
+
+typedef struct {
+    // Arena owning the components and the listings of directories
+    arena_t arena;
+    // Components of the pattern between /
+    glob_component_t *components;
+    int count;
+    // Set if the pattern ends with /, only directories are found
+    int directories;
+    // Receiver of the paths found, and their number
+    glob_callback_t callback;
+    void *data;
+    int matches;
+    // Paths found, given to the callback once all found and sorted, inside their own arena
+    arena_t results;
+    char **paths;
+    int paths_capacity;
+    // Path of the directory being walked
+    char path[MAX_PATH_LENGTH];
+    size_t length;
+    // Set when the callback stopped the expansion
+    int stopped;
+    // Buffer of getdents64, shared by every directory (read entirely before going down)
+    char dents[GLOB_DENTS_BUFFER_SIZE];
+} glob_walker_t;
+
+typedef struct {
+    const char *name;
+    // d_type given by getdents64, DT_UNKNOWN if the file system gives none
+    unsigned char type;
+} glob_entry_t;
+
+/**
+ * @brief Check if a word has wildcards (*, ? or [...]) not escaped by a backslash.
+ * @param pattern The word.
+ * @return 1 if the word is a pattern, 0 otherwise.
+ */
+int glob_has_magic(const char *const pattern);
+
+/**
+ * @brief Find the paths matching a pattern, ** matches any number of directories.
+ * Each component is compiled once, directories are read with getdents64 relative to the fd of their parent,
+ * and components without wildcards are opened directly, without reading their parent.
+ * Files starting with a . are only matched by a component starting with a literal dot.
+ * @param pattern The pattern, a backslash escapes the next character.
+ * @param callback The function called on each path, once every path is found, in sorted order of the full paths.
+ * @param data The data given to the callback.
+ * @return Number of paths found, -1 if malloc error or stopped by the callback.
+ */
+int glob_expand(const char *const pattern, const glob_callback_t callback, void *const data);
+
+/**
+ * @brief Remove the backslashes escaping characters of a pattern, in place.
+ * @param pattern The pattern.
+ * @return Length of the unescaped pattern.
+ */
+size_t glob_unescape(char *const pattern);
+
+/**
+ * @brief Compile a component of a pattern, from its start to the next / or the end.
+ * @param arena The arena owning the component.
+ * @param start The start of the component.
+ * @param end The end of the component.
+ * @param component Reference to the component to fill.
+ * @return 0 if compiled, -1 if malloc error.
+ */
+int _glob_compile(arena_t *const arena, const char *const start, const char *const end, glob_component_t *const component);
+
+/**
+ * @brief Parse a [...] class of a pattern.
+ * @param ptr Pointer after the [.
+ * @param set The 256 bits of the set to fill.
+ * @param negated Reference to store 1 if the class starts with ! or ^.
+ * @return Pointer after the closing ], NULL if there is none (the [ is then a literal).
+ */
+const char *_glob_parse_class(const char *ptr, unsigned char *const set, int *const negated);
+
+/**
+ * @brief Check if a name matches a compiled component, backtracking only to the last *.
+ * @param component The component.
+ * @param name The name.
+ * @return 1 if the name matches, 0 otherwise.
+ */
+int _glob_match(const glob_component_t *const component, const char *const name);
+
+/**
+ * @brief Compare two paths, for qsort.
+ * @param a The first path.
+ * @param b The second path.
+ * @return Negative, 0 or positive as strcmp.
+ */
+int _glob_compare(const void *const a, const void *const b);
+
+/**
+ * @brief Read the entries of a directory matching a component, in the order of the directory.
+ * @param walker The walker, its arena owns the entries.
+ * @param fd The directory.
+ * @param component The component, NULL for every entry not starting with a dot.
+ * @param count Reference to store the number of entries.
+ * @return The entries, NULL if none or if error.
+ */
+glob_entry_t *_glob_list(glob_walker_t *const walker, const int fd, const glob_component_t *const component, int *const count);
+
+/**
+ * @brief Check if an entry of a directory is a directory.
+ * @param fd The directory.
+ * @param entry The entry.
+ * @param follow 1 to follow symbolic links.
+ * @return 1 if it is a directory, 0 otherwise.
+ */
+int _glob_is_directory(const int fd, const glob_entry_t *const entry, const int follow);
+
+/**
+ * @brief Append a name to the path of the walker, after a /.
+ * @param walker The walker.
+ * @param name The name.
+ * @return The length of the path before, to give to _glob_restore, -1 if the path would be too long.
+ */
+long _glob_append(glob_walker_t *const walker, const char *const name);
+
+/**
+ * @brief Cut the path of the walker back to a length.
+ * @param walker The walker.
+ * @param length The length returned by _glob_append.
+ */
+void _glob_restore(glob_walker_t *const walker, const size_t length);
+
+/**
+ * @brief Keep a path found, to give it to the callback once sorted with the others.
+ * @param walker The walker, its path is the one found.
+ * @return 0 to go on, -1 if malloc error.
+ */
+int _glob_emit(glob_walker_t *const walker);
+
+/**
+ * @brief Find the paths matching the components from index inside a directory.
+ * @param walker The walker, its path is the one of the directory.
+ * @param fd The directory.
+ * @param index The index of the first component to match.
+ * @return 0 to go on, -1 if stopped.
+ */
+int _glob_walk(glob_walker_t *const walker, const int fd, const int index);
+
+#endif
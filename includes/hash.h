@@ -0,0 +1,121 @@
+// CShell Project - New hash command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_HASH_H
+#define COMMAND_HASH_H
+
+#include <time.h>
+
+// Initial number of slots of the table of resolved commands
+#define HASH_INITIAL_CAPACITY 64
+
+typedef struct {
+    // Name of the command, NULL for an empty slot
+    char *name;
+    // Resolved path of the command
+    char *path;
+    // Modification time of the directory containing the command when it was resolved
+    struct timespec dir_mtime;
+    // Number of times the command was looked up
+    int hits;
+} hash_entry_t;
+
+typedef struct {
+    // Table of resolved commands (open addressing with linear probing)
+    hash_entry_t *entries;
+    // Number of slots of the table (power of 2)
+    int capacity;
+    // Number of used slots of the table
+    int count;
+} hash_table_t;
+
+/**
+ * @brief Compute the hash of a command name (FNV-1a).
+ * @param name The command name.
+ * @return The hash of the name.
+ */
+unsigned long _hash_string(const char *name);
+
+/**
+ * @brief Find the slot of a command name inside the table.
+ * @param name The command name.
+ * @return Index of the slot holding the name, or of the empty slot where to add it.
+ */
+int _hash_find_slot(const char *const name);
+
+/**
+ * @brief Add or replace a resolved command inside the table.
+ * @param name The command name.
+ * @param path The resolved path.
+ * @param dir_mtime Modification time of the directory containing the command.
+ * @return The entry, NULL if malloc error.
+ */
+hash_entry_t *_hash_insert(const char *const name, const char *const path, const struct timespec dir_mtime);
+
+/**
+ * @brief Remove a command from the table.
+ * @param name The command name.
+ * @return 0 if it was removed, 1 if it was not in the table.
+ */
+int _hash_remove(const char *const name);
+
+/**
+ * @brief Get modification time of the directory containing a file.
+ * @param path The path of the file.
+ * @param mtime Reference to the modification time for return.
+ * @return 0 if the directory exists, -1 otherwise or if its path is too long.
+ */
+int _hash_dir_mtime(const char *const path, struct timespec *const mtime);
+
+/**
+ * @brief Walk PATH to find an executable file.
+ * @param name The command name.
+ * @param path Buffer for the resolved path, at least MAX_PATH_LENGTH bytes.
+ * @return 0 if found, -1 otherwise.
+ */
+int _hash_search_path(const char *const name, char *const path);
+
+/**
+ * @brief Resolve a command name to the path of its executable, through the table.
+ * @param name The command name.
+ * @return Path of the executable, NULL if not found.
+ * @note Names with a '/' are not resolved and are returned as is.
+ * @note An entry is resolved again if its directory was modified since.
+ * @warning The returned path is valid until the next change of the table.
+ */
+const char *hash_lookup(const char *const name);
+
+/**
+ * @brief Forget every resolved command (e.g. when PATH changes).
+ */
+void hash_clear();
+
+/**
+ * @brief Make a table the resolved commands of the shell, e.g. the commands of an embedding context.
+ * @param table The table, zeroed before its first use, NULL for the commands of the shell itself.
+ * @return The table used before.
+ */
+hash_table_t *hash_use(hash_table_t *const table);
+
+/**
+ * @brief Forget every resolved command of a table.
+ * @param table The table, left empty.
+ */
+void hash_table_free(hash_table_t *const table);
+
+/**
+ * @brief Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void _hash_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of the program.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_hash(const int argc, const char *const *const argv);
+
+#endif
@@ -0,0 +1,224 @@
+// CShell Project - New jobs, wait, fg and bg commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_JOBS_H
+#define COMMAND_JOBS_H
+
+#include "config.h"
+#include "timing.h"
+#include <sys/types.h>
+
+// Return codes of processes of dropped jobs kept for wait pid, in a non-interactive shell
+#define JOBS_DONE_KEPT 256
+
+typedef enum {
+    JOB_RUNNING,
+    JOB_STOPPED,
+    JOB_DONE,
+} job_state_t;
+
+typedef struct {
+    // Number of the job (%id), 0 for a free slot
+    int id;
+    // Process group of the job
+    pid_t pgid;
+    // Processes of the job and their return codes
+    pid_t pids[MAX_PIPELINE_STAGES];
+    int codes[MAX_PIPELINE_STAGES];
+    int finished[MAX_PIPELINE_STAGES];
+    int count;
+    // State of the whole job
+    job_state_t state;
+    // Set once the user was told about the current state
+    int notified;
+    // Command line of the job
+    char *command;
+} job_t;
+
+typedef struct {
+    // Table of jobs, the job n is at index n - 1
+    job_t **jobs;
+    // Number of slots of the table
+    int capacity;
+    // Current (%+) and previous (%-) jobs
+    int current;
+    int previous;
+    // Processes of dropped jobs and their return codes, the oldest ones are overwritten
+    pid_t done_pids[JOBS_DONE_KEPT];
+    int done_codes[JOBS_DONE_KEPT];
+    int done_next;
+} jobs_table_t;
+
+/**
+ * @brief Initialize job control: SIGCHLD is delivered through a signalfd and, in an interactive shell,
+ * the shell takes its own process group and ignores job control signals.
+ * @param interactive 1 if the shell reads commands from a terminal.
+ */
+void jobs_init(const int interactive);
+
+/**
+ * @brief Prepare a forked child of the shell: process group, default signals and signal mask,
+ * and inside an embedding context the file descriptors and working directory of the context.
+ * @param pgid Process group to join, 0 to create a new one, -1 to keep the one of the shell.
+ */
+void jobs_child_setup(const pid_t pgid);
+
+/**
+ * @brief Join every stage of a pipeline to build its command line.
+ * @param count The number of stages.
+ * @param argcs The number of arguments of each stage.
+ * @param argvs The arguments of each stage.
+ * @return The command line, to free.
+ */
+char *jobs_command_string(const int count, int *const argcs, char ***const argvs);
+
+/**
+ * @brief Make a table the jobs of the shell, e.g. the jobs of an embedding context.
+ * @param table The table, zeroed before its first use, NULL for the jobs of the shell itself.
+ * @return The table used before.
+ */
+jobs_table_t *jobs_use(jobs_table_t *const table);
+
+/**
+ * @brief Reap the finished processes of a table and free its jobs.
+ * @param table The table, left empty.
+ * @note Processes still running are not waited, they are left to the parent process.
+ */
+void jobs_table_free(jobs_table_t *const table);
+
+/**
+ * @brief Add a job to the table.
+ * @param pgid Process group of the job.
+ * @param pids Processes of the job.
+ * @param count Number of processes.
+ * @param command Command line of the job, owned by the table.
+ * @param state State of the job.
+ * @return Number of the job, -1 if malloc error.
+ */
+int jobs_add(const pid_t pgid, const pid_t *const pids, const int count, char *const command, const job_state_t state);
+
+/**
+ * @brief Number of background jobs still running.
+ * @return The number of running jobs.
+ */
+int jobs_running_count();
+
+/**
+ * @brief Reap every finished or stopped child without blocking, only if SIGCHLD was received.
+ * Inside another program (EMBEDDED), only the processes of jobs are reaped.
+ */
+void jobs_reap();
+
+/**
+ * @brief Block until a child of a job changes of state.
+ * @return 0 if a child changed, -1 if there is no child anymore.
+ */
+int jobs_wait_any();
+
+/**
+ * @brief Wait for the unfinished processes of jobs only, the children of an embedding program are left to it.
+ * @param options WNOHANG to reap without blocking, 0 to block until the first process changes of state.
+ * @return 0 if a process changed (or WNOHANG), -1 if there is no process of a job to wait for.
+ */
+int _jobs_wait_known(const int options);
+
+/**
+ * @brief Reap children and print jobs that finished or stopped since last call, finished jobs are removed.
+ * In a non-interactive shell, nothing is printed and finished jobs are dropped, wait pid still gets their code.
+ */
+void jobs_notify();
+
+/**
+ * @brief Drop every finished job from the table, keeping the return codes of its processes for wait pid.
+ */
+void _jobs_drop_done();
+
+/**
+ * @brief Find the return code of a process of a dropped job.
+ * @param pid The process.
+ * @param code Reference to the return code for return.
+ * @return 1 if found, 0 otherwise.
+ */
+int _jobs_done_code(const pid_t pid, int *const code);
+
+/**
+ * @brief Wait until a file descriptor is readable, reaping children meanwhile.
+ * @param fd The file descriptor to wait for.
+ */
+void jobs_poll_input(const int fd);
+
+/**
+ * @brief Give the terminal to a foreground pipeline and wait for its processes.
+ * A pipeline stopped (e.g. Ctrl-Z) is added to the table as a stopped job.
+ * @param pgid Process group of the pipeline.
+ * @param pids Processes of the pipeline, -1 for stages without process.
+ * @param codes Return codes of each process for return, 128 + signal if stopped.
+ * @param count Number of processes.
+ * @param stages The number of stages, to build the command line of a stopped pipeline.
+ * @param argcs The number of arguments of each stage, NULL to not allow stopping.
+ * @param argvs The arguments of each stage.
+ * @param timings Measures of each process, filled as soon as it ends, NULL if the pipeline is not timed.
+ * @return 0 if every process finished, 1 if the pipeline was stopped.
+ */
+int jobs_wait_foreground(const pid_t pgid, const pid_t *const pids, int *const codes, const int count, const int stages, int *const argcs, char ***const argvs, timing_stage_t *const timings);
+
+/**
+ * @brief Find a job from a job spec (%n, %%, %+, %-, or a pid).
+ * @param spec The job spec, NULL for the current job.
+ * @return The job, NULL if not found.
+ */
+job_t *_jobs_find(const char *const spec);
+
+/**
+ * @brief Remove a job from the table.
+ * @param job The job to remove.
+ */
+void _jobs_remove(job_t *const job);
+
+/**
+ * @brief Print a job.
+ * @param job The job to print.
+ * @param with_pids 1 to print the processes of the job.
+ */
+void _jobs_print(const job_t *const job, const int with_pids);
+
+/**
+ * @brief Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void _jobs_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of the jobs command, list jobs.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_jobs(const int argc, const char *const *const argv);
+
+/**
+ * @brief Main function of the wait command, wait for jobs to finish.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return Return code of the last job waited for, 127 if unknown.
+ */
+int our_wait(const int argc, const char *const *const argv);
+
+/**
+ * @brief Main function of the fg command, continue a job in foreground.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return Return code of the job.
+ */
+int our_fg(const int argc, const char *const *const argv);
+
+/**
+ * @brief Main function of the bg command, continue a stopped job in background.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_bg(const int argc, const char *const *const argv);
+
+#endif
@@ -0,0 +1,39 @@
+// CShell Project - New break and continue commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_LOOP_H
+#define COMMAND_LOOP_H
+
+/**
+ * @brief Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void _loop_print_usage(const char *const program_name);
+
+/**
+ * @brief Parse the arguments of the program.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param levels Reference to store the number of loops to leave, clipped to the number of running loops.
+ * @return 0 if arguments are good, -1 if -h or --help used or outside of a loop, 1 if error.
+ */
+int _loop_parse_arguments(const int argc, const char *const *const argv, int *const levels);
+
+/**
+ * @brief Main function of break, leave the innermost loops.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_break(const int argc, const char *const *const argv);
+
+/**
+ * @brief Main function of continue, go on with the next iteration of a loop.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_continue(const int argc, const char *const *const argv);
+
+#endif
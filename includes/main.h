@@ -6,32 +6,103 @@
 #define MAIN_H
 
 #include "config.h"
+#include "arena.h"
+#include "arith.h"
 #include "terminal.h"
+#include "builtin.h"
+#include "ring.h"
+#include "sink.h"
+#include "fusion.h"
+#include "globbing.h"
 #include "cat.h"
 #include "cd.h"
 #include "chmod.h"
 #include "chown.h"
 #include "cp.h"
+#include "echo.h"
+#include "exit.h"
+#include "hash.h"
+#include "jobs.h"
+#include "parser.h"
+#include "reader.h"
+#include "history.h"
+#include "loop.h"
 #include "ls.h"
 #include "mkdir.h"
 #include "mv.h"
+#include "printf.h"
+#include "pwd_cmd.h"
+#include "read.h"
+#include "redirect.h"
 #include "rm.h"
+#include "server.h"
+#include "source.h"
+#include "stats.h"
+#include "test.h"
+#include "timing.h"
+#include "trace.h"
 #include "touch.h"
+#include "true.h"
+#include "variables.h"
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef enum {
+    // A single field, e.g. assignments and redirections
+    EXPAND_WORD,
+    // Unquoted expansions are split into fields, which are patterns
+    EXPAND_FIELDS,
+    // Body of a here-document: quotes are characters, only $ and backslashes are special
+    EXPAND_HEREDOC,
+} expand_mode_t;
+
+typedef struct {
+    // Array of fields ended by NULL inside LINE_ARENA, with its number of fields and allocated size
+    char ***fields;
+    int *count;
+    int *capacity;
+} field_list_t;
 
 /**
  * @brief Load content of a file as a string.
  * @param fd Id of in-memory file to load.
- * @return Content load from the file.
+ * @param size Reference to the size of the content for return.
+ * @return Read-only view of the content of the file, NULL on error.
+ * @note The content is memory-mapped (not copied) and must be released with unload_memfd_string.
+ * @warning The file is grown by one byte to hold the final '\0'.
+ */
+char *load_memfd_to_string(const int fd, size_t *const size);
+
+/**
+ * @brief Release a string returned by load_memfd_to_string.
+ * @param content The string to release.
+ * @param size The size returned by load_memfd_to_string.
  */
-char *load_memfd_to_string(const int fd);
+void unload_memfd_string(char *const content, const size_t size);
 
 /**
  * @brief Clone a file inside a in-memory file.
+ * It uses `copy_file_range` (or `sendfile` as fallback) to copy inside the kernel.
  * @param src The id of file to copy.
  * @return Id of in-memory file that as copied content of src.
  */
 int clone_memfd(const int src);
 
+/**
+ * @brief Convert a status returned by wait into a shell return code.
+ * @param status The status filled by wait/waitpid.
+ * @return Exit code of the process, 128 + signal number if it was killed by a signal.
+ */
+int status_to_code(const int status);
+
+/**
+ * @brief Set a shell variable, e.g. the variable of a for loop.
+ * @param name The name of the variable.
+ * @param value The value of the variable.
+ * @return 0 if the variable was set, -1 otherwise.
+ */
+int set_variable(const char *const name, const char *const value);
+
 /**
  * @brief Create an environement variable if syntax allow.
  * @param arg The argument to parse.
@@ -39,32 +110,389 @@ int clone_memfd(const int src);
  */
 int setting_envvar(const char *const arg);
 
+/**
+ * @brief Check if an argument has the syntax of an environment variable definition (NAME=value).
+ * @param arg The argument to check.
+ * @return 1 if it is a definition, 0 otherwise.
+ */
+int is_envvar_definition(const char *const arg);
+
+/**
+ * @brief Check if a command is run inside the shell.
+ * @param name The name of the command.
+ * @return 1 if it is a builtin or an environment variable definition, 0 otherwise.
+ */
+int is_builtin(const char *const name);
+
+/**
+ * @brief Start an external command without waiting for it.
+ * It uses `posix_spawn` and falls back to fork/execvp only for files without shebang.
+ * The command is resolved through hash_lookup, an unknown command is reported without spawning.
+ * @param argv The arguments of the command, ended by NULL.
+ * @param redirects The redirections of the command, applied by the child after fd_in and fd_out.
+ * @param fd_in File descriptor for stdin, -1 to keep stdin.
+ * @param fd_out File descriptor for stdout, -1 to keep stdout.
+ * @param pgid Process group to join, 0 to lead a new one, -1 to stay in the group of the shell.
+ * @return Pid of the command, -1 if it can not be started (errno is set).
+ */
+pid_t spawn_process(const char **const argv, const fd_actions_t *const redirects, const int fd_in, const int fd_out, const pid_t pgid);
+
+/**
+ * @brief Spawn an external command as a foreground job and wait for it to finish or stop.
+ * @param argv The arguments of the command, ended by NULL.
+ * @param redirects The redirections of the command, applied by the child after fd_in and fd_out.
+ * @param fd_in File descriptor for stdin, -1 to keep stdin.
+ * @param fd_out File descriptor for stdout, -1 to keep stdout.
+ * @return Return code of the command, 127 if not found, 126 if it can not be run.
+ */
+int spawn_command(const char **const argv, const fd_actions_t *const redirects, const int fd_in, const int fd_out);
+
 /**
  * @brief Call the appropriate function with the arguments.
  * @param argc The number of arguments.
- * @param argv The arguments.
+ * @param argv The arguments, ended by NULL.
+ * @param redirects The redirections of the command, builtins get them through saved and restored file descriptors only if not empty.
  * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
  * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
  * @param is_piped 1 if the command is piped, 0 otherwise.
  * @return 0 if the program ran successfully.
  */
-int call_command(int argc, char **argv, int *const use_pipe, const int pipe_used, const int is_piped);
+int call_command(int argc, char **argv, const fd_actions_t *const redirects, int *const use_pipe, const int pipe_used, const int is_piped);
 
 /**
- * @brief Parse arguments to call every commands in right order.
- * @param argc The number of arguments.
- * @param argv The arguments.
- * @return 0 if the program ran successfully.
+ * @brief Run every stage of a pipeline at the same time, connected by kernel pipes.
+ * @param count The number of stages.
+ * @param argcs The number of arguments of each stage.
+ * @param argvs The arguments of each stage, the text of the command for compound stages.
+ * @param redirects The redirections of each stage, empty for compound stages.
+ * @param stages The nodes of each stage, compound stages run inside a forked copy of the shell.
+ * @param background 1 to add the pipeline to the jobs instead of waiting for it.
+ * @param timing Measures to fill for each stage, NULL if the pipeline is not run by time.
+ * @return Return code of the last stage, 0 for a background job.
+ * @note Return codes of every stage are stored in PIPE_STATUS.
+ * @note Adjacent fusable builtins run on threads of the shell, connected by ring buffers (see PIPE_FUSION).
+ * @note Processes of the pipeline share a process group, which gets the terminal while in foreground.
+ */
+int run_pipeline(const int count, int *const argcs, char ***const argvs, const fd_actions_t *const redirects, node_t *const *const stages, const int background, timing_t *const timing);
+
+/**
+ * @brief Append characters to a growing string.
+ * @param buffer Reference to the string inside LINE_ARENA, reallocated if needed.
+ * @param length Reference to the length of the string.
+ * @param capacity Reference to the allocated size of the string.
+ * @param str The characters to append.
+ * @param size The number of characters to append.
+ * @return 0 if the characters were appended, -1 if malloc error.
+ */
+int append_string(char **const buffer, int *const length, int *const capacity, const char *const str, const int size);
+
+/**
+ * @brief Run a command line and append its output to a string, without trailing new lines.
+ * @param command The command line inside $(...).
+ * @param buffer Reference to the string, reallocated if needed.
+ * @param length Reference to the length of the string.
+ * @param capacity Reference to the allocated size of the string.
+ * @return 0 if the output was appended, -1 otherwise.
+ */
+int substitute_command(const char *const command, char **const buffer, int *const length, int *const capacity);
+
+/**
+ * @brief Start a command of <(...) or >(...) at the same time as the command using it, and append the path of its pipe to a string.
+ * @param command The command line inside the parenthesis.
+ * @param is_input 1 for <(...) whose output is read, 0 for >(...) whose input is written.
+ * @param buffer Reference to the string inside LINE_ARENA, reallocated if needed.
+ * @param length Reference to the length of the string.
+ * @param capacity Reference to the allocated size of the string.
+ * @return 0 if the path was appended, -1 otherwise.
+ * @note The end of the pipe kept by the shell is /dev/fd/N, inherited by commands until close_substitutions.
+ */
+int substitute_process(const char *const command, const int is_input, char **const buffer, int *const length, int *const capacity);
+
+/**
+ * @brief Close the pipes of the latest process substitutions and reap their finished commands.
+ * @param count The number of substitutions to keep open.
  */
-int parse_commands(int argc, char **argv);
+void close_substitutions(const int count);
 
 /**
- * @brief Parse the line to get it as argc and argv.
- * @param line The line to parse.
+ * @brief Check if a $(( starts an arithmetic expansion.
+ * @param ptr Pointer on the $ of $((.
+ * @return 1 if the substitution ends with )), 0 otherwise.
+ */
+int is_arithmetic(const char *const ptr);
+
+/**
+ * @brief Evaluate an arithmetic expression of $((...)) and append its value to a string.
+ * @param expression The text between $(( and )).
+ * @param size The length of the text.
+ * @param buffer Reference to the string inside LINE_ARENA, reallocated if needed.
+ * @param length Reference to the length of the string.
+ * @param capacity Reference to the allocated size of the string.
+ * @return 0 if the value was appended, -1 if error in the expression or malloc error.
+ */
+int expand_arithmetic(const char *const expression, const int size, char **const buffer, int *const length, int *const capacity);
+
+/**
+ * @brief Append a copy of a field to an array of strings ended by NULL.
+ * @param fields Reference to the array inside LINE_ARENA, reallocated if needed.
+ * @param count Reference to the number of fields.
+ * @param capacity Reference to the allocated number of fields.
+ * @param field The characters of the field.
+ * @param size The number of characters of the field.
+ * @return 0 if the field was appended, -1 if malloc error.
+ */
+int push_field(char ***const fields, int *const count, int *const capacity, const char *const field, const int size);
+
+/**
+ * @brief Append characters to a growing pattern, with a backslash before each special character of patterns.
+ * @param buffer Reference to the string inside LINE_ARENA, reallocated if needed.
+ * @param length Reference to the length of the string.
+ * @param capacity Reference to the allocated size of the string.
+ * @param str The characters to append.
+ * @param size The number of characters to append.
+ * @return 0 if the characters were appended, -1 if malloc error.
+ */
+int append_escaped(char **const buffer, int *const length, int *const capacity, const char *const str, const int size);
+
+/**
+ * @brief Append a path found by glob_expand to a list of fields.
+ * @param path The path.
+ * @param length The length of the path.
+ * @param data The field_list_t of the fields.
+ * @return 0 if the path was appended, -1 if malloc error.
+ */
+int push_glob_match(const char *const path, const size_t length, void *const data);
+
+/**
+ * @brief Append a field which is a pattern: the paths matching it, or the field without escapes if none match.
+ * @param fields Reference to the array inside LINE_ARENA, reallocated if needed.
+ * @param count Reference to the number of fields.
+ * @param capacity Reference to the allocated number of fields.
+ * @param pattern The pattern, ended by '\0' after size characters.
+ * @param size The number of characters of the pattern.
+ * @return 0 if the fields were appended, -1 if malloc error.
+ */
+int push_pattern(char ***const fields, int *const count, int *const capacity, const char *const pattern, const int size);
+
+/**
+ * @brief Append the value of an expansion to the current field, splitting it on spaces if fields is given.
+ * @param buffer Reference to the current field inside LINE_ARENA.
+ * @param length Reference to the length of the current field.
+ * @param capacity Reference to the allocated size of the current field.
+ * @param has_field Reference to the flag telling the current field exists even if empty (quotes), reset on each split.
+ * @param value The value of the expansion.
+ * @param size The length of the value.
+ * @param fields Reference to the array of fields, NULL to not split the value.
+ * @param count Reference to the number of fields.
+ * @param fields_capacity Reference to the allocated number of fields.
+ * @return 0 if the value was appended, -1 if malloc error.
+ */
+int append_expansion(char **const buffer, int *const length, int *const capacity, int *const has_field, const char *const value, const int size, char ***const fields, int *const count, int *const fields_capacity);
+
+/**
+ * @brief Get the value of a special variable of the shell: ? (return code of the last command) or PIPE_STATUS (return codes of the stages of the last pipeline, separated by spaces).
+ * @param name The name of the variable.
+ * @param value Buffer to store the value, of SPECIAL_VARIABLE_LENGTH characters.
+ * @return value, or NULL if the name is not a special variable.
+ */
+const char *get_special_variable(const char *const name, char *const value);
+
+/**
+ * @brief Expand a raw word of a syntax tree into fields: quotes, escapes, $((...)), $(...), <(...), >(...), $?, $NAME and ${NAME}.
+ * @param word The raw word.
+ * @param mode EXPAND_FIELDS to split unquoted expansions on spaces (the word may give no field) and replace patterns with matching paths, a single field otherwise.
+ * @param fields Reference to the array of fields inside LINE_ARENA, reallocated if needed.
+ * @param count Reference to the number of fields.
+ * @param fields_capacity Reference to the allocated number of fields.
+ * @return 0 if the word was expanded, -1 if malloc error.
+ */
+int expand_fields(const char *const word, const expand_mode_t mode, char ***const fields, int *const count, int *const fields_capacity);
+
+/**
+ * @brief Expand a raw word of a syntax tree as a single string (see expand_fields).
+ * @param word The raw word.
+ * @return The expanded word inside LINE_ARENA, NULL if malloc error.
+ */
+char *expand_word(const char *const word);
+
+/**
+ * @brief Write the body of a here-document or the word of a here-string into a sealed memfd.
+ * @param redirect The redirection, a here-document or a here-string.
+ * @return The memfd at offset 0, -1 if error.
+ */
+int open_here_document(const redirect_t *const redirect);
+
+/**
+ * @brief Expand the redirections of a node into actions on file descriptors.
+ * @param node The node.
+ * @param redirects Reference to store the actions inside LINE_ARENA, to give to redirect_close even if error.
+ * @return 0 if expanded, -1 if error (reported on stderr).
+ */
+int expand_redirects(const node_t *const node, fd_actions_t *const redirects);
+
+/**
+ * @brief Expand the words and redirections of a command node as argc, argv and actions on file descriptors.
+ * Unquoted expansions are split on spaces, except in assignments.
+ * @param node The command node.
  * @param argc Reference to the number of arguments for return.
- * @param argv Reference to the arguments for return.
+ * @param redirects Reference to store the actions of the redirections, to give to redirect_close once the command started.
+ * @return The arguments ended by NULL inside LINE_ARENA, NULL if error.
  */
-void parse_line(const char *const line, int *const argc, char ***const argv);
+char **expand_command(const node_t *const node, int *const argc, fd_actions_t *const redirects);
+
+/**
+ * @brief Give the text of a compound command as arguments, to show it in the jobs table.
+ * @param node The compound command node.
+ * @param argc Reference to the number of arguments for return.
+ * @return The arguments ended by NULL inside LINE_ARENA, NULL if malloc error.
+ */
+char **describe_compound(const node_t *const node, int *const argc);
+
+/**
+ * @brief Expand and run a pipeline or a simple command node.
+ * @param node The pipeline or command node.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @param background 1 to run the pipeline as a background job.
+ * @return Return code of the last stage.
+ * @note A pipeline of one stage runs inside the shell with call_command, unless in background.
+ */
+int execute_pipeline(const node_t *const node, int *const use_pipe, const int pipe_used, const int background);
+
+/**
+ * @brief Run a node as a background job, lists other than pipelines run inside a forked copy of the shell.
+ * @param node The node to run.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return 0 if the job was started.
+ */
+int execute_background(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Run the body of the first if or elif whose condition succeeds, or the body of else.
+ * @param node The if node.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return Return code of the body run, 0 if none.
+ */
+int execute_if(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Check if a loop stops after an iteration, consuming one level of break or continue.
+ * @param return_code Return code of the iteration.
+ * @return 1 if the loop stops, 0 if it goes on.
+ */
+int loop_should_stop(const int return_code);
+
+/**
+ * @brief Run a while or until loop.
+ * @param node The while or until node.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return Return code of the last iteration of the body, 0 if none.
+ */
+int execute_while(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Run a for loop, its items are expanded once before the first iteration.
+ * @param node The for node.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return Return code of the last iteration of the body, 0 if none.
+ */
+int execute_for(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Run the body of the first case item with a pattern matching the subject (see fnmatch).
+ * @param node The case node.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return Return code of the body run, 0 if none.
+ */
+int execute_case(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Run a ( list ) inside a forked copy of the shell, as a foreground job.
+ * @param node The subshell node.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return Return code of the list.
+ */
+int execute_subshell(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Run a pipeline (or any command) and print the time and resources it used, with a line per stage of a pipeline.
+ * @param node The time node.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return Return code of the command.
+ */
+int execute_time(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Run a compound command with its redirections, applied inside the shell and restored after.
+ * @param node The compound command node.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return Return code of the compound command.
+ */
+int execute_compound(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Run a syntax tree.
+ * @param node The root of the tree.
+ * @param use_pipe If last command piped its stdout and we have to take it (if no stdin redirection).
+ * @param pipe_used Id of in-memory file containing stdout of previous command if it was piped.
+ * @return Return code of the last command run.
+ */
+int execute_node(const node_t *const node, int *const use_pipe, const int pipe_used);
+
+/**
+ * @brief Run a syntax tree, e.g. of a line or of a sourced file, and free what its commands allocated.
+ * @param root The root of the tree.
+ * @return Return code of the last command run.
+ */
+int execute_tree(const node_t *const root);
+
+/**
+ * @brief Compile a command line (or take it from the cache of plans) and run it.
+ * @param line The command line.
+ * @return Return code of the last command run, 2 if syntax error.
+ */
+int execute_line(const char *const line);
+
+/**
+ * @brief Run a command line, print debug information and free its memory.
+ * @param line The command line.
+ * @return Return code of the last command run.
+ */
+int run_line(const char *const line);
+
+/**
+ * @brief Join a line to the previous lines of an incomplete command.
+ * @param pending Reference to the previous lines (malloc'd, freed and set to NULL if error), NULL for the first line.
+ * @param length Reference to the length of the previous lines.
+ * @param capacity Reference to the allocated size of the previous lines.
+ * @param line The line to append after a new line.
+ * @return 0 if the line was appended, -1 if malloc error.
+ */
+int append_line(char **const pending, size_t *const length, size_t *const capacity, const char *const line);
+
+/**
+ * @brief Check if a line ends a here-document.
+ * @param delimiter The delimiter of the here-document, without quotes.
+ * @param line The line, maybe starting with tabs.
+ * @return 1 if the line is the delimiter, 0 otherwise.
+ */
+int is_heredoc_delimiter(const char *const delimiter, const char *line);
+
+/**
+ * @brief Run every line of a script without prompt.
+ * @param fd File descriptor of the script.
+ * @param shared 1 if the script is stdin, which commands may read too.
+ * @return Return code of the last command run.
+ */
+int run_script(const int fd, const int shared);
 
 /**
  * @brief Print the usage of the program.
@@ -79,6 +507,11 @@ void print_usage(const char *const program_name);
  */
 void parse_arguments(const int argc, const char *const *const argv);
 
+/**
+ * @brief Source the startup file: ~/.cshellrc for an interactive shell, the file named by CSHELL_ENV otherwise.
+ */
+void source_startup_file();
+
 /**
  * @brief Print a message for when you log in.
  */
@@ -0,0 +1,297 @@
+// CShell Project - Tokenizer, parser and cache of compiled command lines
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "arena.h"
+#include <stddef.h>
+
+// Number of compiled command lines kept in the cache
+#define PLAN_CACHE_SIZE 128
+// Number of buckets of the cache (power of 2)
+#define PLAN_CACHE_BUCKETS 256
+// Size of chunks of the arena of each plan
+#define PLAN_ARENA_CHUNK_SIZE 1024
+
+typedef enum {
+    TOKEN_WORD,
+    TOKEN_PIPE,
+    TOKEN_AND,
+    TOKEN_OR,
+    TOKEN_SEMI,
+    TOKEN_DSEMI,
+    TOKEN_BACKGROUND,
+    // Redirections: < > >> <> <& >&, &> and &>> (stdout and stderr)
+    TOKEN_INPUT,
+    TOKEN_OUTPUT,
+    TOKEN_APPEND,
+    TOKEN_READ_WRITE,
+    TOKEN_DUP_INPUT,
+    TOKEN_DUP_OUTPUT,
+    TOKEN_OUTPUT_ALL,
+    TOKEN_APPEND_ALL,
+    // << and <<- (leading tabs removed), the text is the body read after the end of the line
+    TOKEN_HEREDOC,
+    TOKEN_HEREDOC_TABS,
+    TOKEN_HERESTRING,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN,
+    TOKEN_END,
+} token_type_t;
+
+typedef struct {
+    token_type_t type;
+    // Raw text of a word (quotes and $ are expanded at execution), NULL for operators
+    char *text;
+    // File descriptor written just before a redirection (2 of 2>), -1 if none
+    int fd;
+} token_t;
+
+typedef enum {
+    // Simple command: words and redirections
+    NODE_COMMAND,
+    // Commands connected by |
+    NODE_PIPELINE,
+    // Left && right, left || right
+    NODE_AND,
+    NODE_OR,
+    // Lists separated by ; (or new lines)
+    NODE_SEQUENCE,
+    // List ended by &
+    NODE_BACKGROUND,
+    // if: pairs of condition and body for if and each elif, then the body of else if any
+    NODE_IF,
+    // while and until: condition and body
+    NODE_WHILE,
+    NODE_UNTIL,
+    // for: variable in name, raw items in words, body as only child
+    NODE_FOR,
+    // case: raw subject in name, items as children
+    NODE_CASE,
+    // Item of a case: raw patterns in words, body as only child
+    NODE_CASE_ITEM,
+    // ( list ) run in a copy of the shell
+    NODE_SUBSHELL,
+    // time pipeline: the pipeline as only child, measured while it runs
+    NODE_TIME,
+} node_type_t;
+
+typedef enum {
+    // n< file, n> file, n>> file, n<> file
+    REDIRECT_INPUT,
+    REDIRECT_OUTPUT,
+    REDIRECT_APPEND,
+    REDIRECT_READ_WRITE,
+    // n<&m and n>&m (copy of m), n<&- and n>&- (closed)
+    REDIRECT_DUPLICATE,
+    // <<EOF body, with $ expansions and escapes
+    REDIRECT_HEREDOC,
+    // <<'EOF' body, as is
+    REDIRECT_HEREDOC_LITERAL,
+    // <<< word, followed by a new line
+    REDIRECT_HERESTRING,
+} redirect_type_t;
+
+typedef struct {
+    redirect_type_t type;
+    // File descriptor redirected
+    int fd;
+    // Raw file, raw file descriptor to copy, raw body of a here-document or raw word of a here-string
+    char *word;
+} redirect_t;
+
+typedef struct node_s {
+    node_type_t type;
+    // Raw words of a command, expanded at each execution (items of for, patterns of a case item)
+    int argc;
+    char **words;
+    // Variable of for, raw subject of case, NULL otherwise
+    char *name;
+    // Redirections in the order they are written, applied one after the other
+    int redirect_count;
+    redirect_t *redirects;
+    // Sub-nodes: stages of a pipeline, operands of && || ; &, conditions and bodies of compound commands
+    int count;
+    struct node_s **children;
+} node_t;
+
+typedef struct {
+    // Arena owning the tree
+    arena_t *arena;
+    const token_t *tokens;
+    // Position of the current token
+    int i;
+    // Set when the tokens end in the middle of a command
+    int incomplete;
+    // Set when a syntax error has been reported
+    int failed;
+} parser_t;
+
+typedef struct plan_s {
+    // Arena owning the line and the tree
+    arena_t arena;
+    // Unexpanded command line, key of the cache
+    char *line;
+    unsigned long hash;
+    // Syntax tree of the line, NULL for an empty line
+    node_t *root;
+    // Number of users of the plan, a plan in use is never evicted
+    int refs;
+    // Chaining inside a bucket
+    struct plan_s *bucket_next;
+    // Least recently used list, head is the most recent
+    struct plan_s *lru_prev;
+    struct plan_s *lru_next;
+} plan_t;
+
+typedef struct {
+    // Buckets of the cache, plans with the same hash are chained
+    plan_t *buckets[PLAN_CACHE_BUCKETS];
+    // Least recently used list of the cache
+    plan_t *lru_head;
+    plan_t *lru_tail;
+    // Number of plans in the cache
+    int count;
+} plan_cache_t;
+
+/**
+ * @brief Split a command line into typed tokens.
+ * Operators are recognized even without spaces around them, quotes, escapes and $(...) stay inside words.
+ * @param arena The arena owning the tokens.
+ * @param line The command line.
+ * @param count Reference to store the number of tokens, without the final TOKEN_END.
+ * @param incomplete Reference to store 1 if the line ends inside quotes, $(...), after a backslash or before the end of a here-document, 0 otherwise.
+ * @return The tokens ended by TOKEN_END, NULL if malloc error.
+ * @note Bodies of here-documents are read after the new line ending the line of their <<, and skipped.
+ */
+token_t *lex_line(arena_t *const arena, const char *const line, int *const count, int *const incomplete);
+
+/**
+ * @brief Find the delimiter of the first here-document a command line ends inside.
+ * @param line The command line.
+ * @return The delimiter without quotes, to free, NULL if none or if malloc error.
+ */
+char *lex_heredoc_delimiter(const char *const line);
+
+/**
+ * @brief Find the end of a command or process substitution.
+ * @param ptr Pointer on the $ of $(...), or on the < or > of <(...) and >(...).
+ * @return Pointer after the matching parenthesis, or on the end of the string if there is none.
+ */
+const char *lex_skip_substitution(const char *ptr);
+
+/**
+ * @brief Build the syntax tree of tokens.
+ * @param arena The arena owning the tree.
+ * @param tokens The tokens ended by TOKEN_END.
+ * @param root Reference to store the tree, NULL for an empty line.
+ * @param incomplete Reference to store 1 if the tokens end in the middle of a command (not reported), 0 otherwise, may be NULL.
+ * @return 0 if the tokens are valid, -1 if syntax error (reported on stderr unless incomplete) or malloc error.
+ */
+int parse_tokens(arena_t *const arena, const token_t *const tokens, node_t **const root, int *const incomplete);
+
+/**
+ * @brief Write back a syntax tree as a command line, e.g. for the jobs table.
+ * @param node The root of the tree.
+ * @return The command line, to free, NULL if malloc error.
+ */
+char *node_to_string(const node_t *const node);
+
+/**
+ * @brief Get the compiled plan of a command line, from the cache or by lexing and parsing it.
+ * @param line The command line.
+ * @param incomplete Reference to store 1 if the line ends in the middle of a command and may go on with the next line, may be NULL.
+ * @return The plan, to give back with plan_release, NULL if syntax error or incomplete line.
+ */
+plan_t *plan_acquire(const char *const line, int *const incomplete);
+
+/**
+ * @brief Check if a command line can run, compiling it into the cache.
+ * @param line The command line.
+ * @return 0 if the line is complete, 1 if it ends in the middle of a command, -1 if syntax error (reported on stderr).
+ */
+int plan_check(const char *const line);
+
+/**
+ * @brief Give back a plan got by plan_acquire.
+ * @param plan The plan.
+ */
+void plan_release(plan_t *const plan);
+
+/**
+ * @brief Remove every plan not in use from the cache.
+ */
+void plan_cache_clear();
+
+/**
+ * @brief Make a cache the plans of the shell, e.g. the plans of an embedding context.
+ * @param cache The cache, zeroed before its first use, NULL for the plans of the shell itself.
+ * @return The cache used before.
+ */
+plan_cache_t *plan_use(plan_cache_t *const cache);
+
+/**
+ * @brief Free every plan of a cache which is not in use, plans of a running line stay.
+ * @param cache The cache.
+ */
+void plan_cache_free(plan_cache_t *const cache);
+
+/**
+ * @brief Read a word from a command line.
+ * @param arena The arena owning the word.
+ * @param ptr Reference to the position in the line, moved after the word.
+ * @param incomplete Reference set to 1 if the word ends inside quotes or $(...).
+ * @return The raw word, NULL if malloc error.
+ */
+char *_lex_word(arena_t *const arena, const char **const ptr, int *const incomplete);
+
+/**
+ * @brief Copy a word without its quotes and backslashes, e.g. a delimiter of here-document.
+ * @param arena The arena owning the copy.
+ * @param word The word.
+ * @return The copy, NULL if malloc error.
+ */
+char *_lex_unquote(arena_t *const arena, const char *const word);
+
+/**
+ * @brief Read the bodies of the here-documents of a line, which start after its new line.
+ * @param arena The arena owning the bodies.
+ * @param tokens The tokens.
+ * @param first The index of the first token of the line.
+ * @param last The index after the last token of the line.
+ * @param ptr Reference to the position after the new line, moved after the last delimiter.
+ * @param incomplete Reference set to 1 if a delimiter is missing.
+ * @return 0 if read, -1 if malloc error.
+ */
+int _lex_heredocs(arena_t *const arena, token_t *const tokens, const int first, const int last, const char **const ptr, int *const incomplete);
+
+/**
+ * @brief Report a syntax error on the current token, or mark the tokens as incomplete if it is the end.
+ * @param parser The parser.
+ */
+void _parse_error(parser_t *const parser);
+
+/**
+ * @brief Parse commands separated by ; & or new lines.
+ * @param parser The parser.
+ * @param terminators Reserved words ending the list (NULL-terminated), NULL if none.
+ * @return The node of the list, NULL if syntax error or malloc error.
+ */
+node_t *_parse_list(parser_t *const parser, const char *const *const terminators);
+
+/**
+ * @brief Parse a compound command (if, while, until, for, case or subshell) if the current token starts one.
+ * @param parser The parser.
+ * @return The node of the command, NULL if not a compound command or if error (parser->failed or parser->incomplete set).
+ */
+node_t *_parse_compound(parser_t *const parser);
+
+/**
+ * @brief Remove a plan from the cache and free it.
+ * @param plan The plan.
+ */
+void _plan_evict(plan_t *const plan);
+
+#endif
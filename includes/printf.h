@@ -0,0 +1,56 @@
+// CShell Project - New printf command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_PRINTF_H
+#define COMMAND_PRINTF_H
+
+/**
+ * @brief Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void _printf_print_usage(const char *const program_name);
+
+/**
+ * @brief Decode a backslash escape.
+ * @param ptr Reference to the position after the backslash, moved after the escape.
+ * @param out Buffer of 2 characters to store the decoded characters.
+ * @param is_argument 1 inside an argument of %b (octal is \0nnn), 0 inside the format (octal is \nnn).
+ * @return Number of characters stored, -1 for \c which stops the output.
+ */
+int _printf_escape(const char **const ptr, char *const out, const int is_argument);
+
+/**
+ * @brief Convert an argument of a numeric conversion, 'c gives the code of c.
+ * @param arg The argument, NULL or empty for 0.
+ * @param return_code Reference set to 1 if the argument is not a number.
+ * @return The number.
+ */
+long long _printf_number(const char *const arg, int *const return_code);
+
+/**
+ * @brief Format a single conversion and write it in the output of the current thread.
+ * @param spec The conversion, same as printf.
+ */
+void _printf_emit(const char *const spec, ...);
+
+/**
+ * @brief Print the format once.
+ * @param format The format.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param next Reference to the index of the next argument to convert.
+ * @param return_code Reference set to 1 if an argument or the format is invalid.
+ * @return 1 if the output must stop (\c or invalid format), 0 otherwise.
+ */
+int _printf_format(const char *const format, const int argc, const char *const *const argv, int *const next, int *const return_code);
+
+/**
+ * @brief Main function of the program.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully, 1 if an argument is invalid.
+ */
+int our_printf(const int argc, const char *const *const argv);
+
+#endif
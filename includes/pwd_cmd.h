@@ -0,0 +1,39 @@
+// CShell Project - New pwd command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+// Not named pwd.h, it would hide <pwd.h> of the system
+#ifndef COMMAND_PWD_H
+#define COMMAND_PWD_H
+
+/**
+ * @brief Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void _pwd_print_usage(const char *const program_name);
+
+/**
+ * @brief Parse the arguments of the program.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param physical Reference to store 1 if -P is used, 0 otherwise.
+ * @return 0 if arguments are good, -1 if -h or --help used, 1 if error.
+ */
+int _pwd_parse_arguments(const int argc, const char *const *const argv, int *const physical);
+
+/**
+ * @brief Get the physical path of the working directory of the shell, asking the kernel.
+ * @param buffer Buffer for the path, at least MAX_PATH_LENGTH bytes.
+ * @return 0 if success, -1 if error (errno is set).
+ */
+int pwd_physical(char *const buffer);
+
+/**
+ * @brief Main function of the program.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_pwd(const int argc, const char *const *const argv);
+
+#endif
@@ -0,0 +1,91 @@
+// CShell Project - New read command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_READ_H
+#define COMMAND_READ_H
+
+#include <stddef.h>
+
+// Size of the blocks read from regular files, the offset goes back to just after the line
+#define READ_BLOCK_SIZE 4096
+// Separators of fields when IFS is not set
+#define READ_DEFAULT_IFS " \t\n"
+
+typedef struct {
+    // Characters read, without the delimiter, always ended by '\0'
+    char *text;
+    size_t length;
+    size_t capacity;
+} read_line_t;
+
+/**
+ * @brief Append characters to a line, growing its buffer.
+ * @param line The line.
+ * @param data The characters.
+ * @param size The number of characters.
+ * @return 0 if appended, -1 if malloc error.
+ */
+int _read_append(read_line_t *const line, const char *const data, const size_t size);
+
+/**
+ * @brief Check if the line ends with a backslash which is not itself escaped.
+ * @param line The line.
+ * @return 1 if the last character is escaped, 0 otherwise.
+ */
+int _read_ends_escaped(const read_line_t *const line);
+
+/**
+ * @brief Read a line from a regular file (or memfd) by blocks, then seek back to just after the delimiter.
+ * @param fd The file descriptor.
+ * @param delimiter The character ending the line.
+ * @param raw 0 if a backslash escapes the delimiter.
+ * @param line The line to fill.
+ * @return 1 if the delimiter was found, 0 at end of file, -1 if error.
+ */
+int _read_blocks(const int fd, const char delimiter, const int raw, read_line_t *const line);
+
+/**
+ * @brief Read a line one byte at a time, for pipes and terminals which cannot seek back.
+ * @param fd The file descriptor.
+ * @param delimiter The character ending the line.
+ * @param raw 0 if a backslash escapes the delimiter.
+ * @param line The line to fill.
+ * @return 1 if the delimiter was found, 0 at end of file, -1 if error.
+ */
+int _read_bytes(const int fd, const char delimiter, const int raw, read_line_t *const line);
+
+/**
+ * @brief Check if a character is a separator of IFS which is also a space, tab or newline (runs of them are one separator).
+ * @param c The character.
+ * @param ifs The separators.
+ * @return 1 if it is a blank separator, 0 otherwise.
+ */
+int _read_is_blank(const char c, const char *const ifs);
+
+/**
+ * @brief Split a line on the characters of IFS and set the variables, the last one gets the rest of the line.
+ * Without variables, the whole line is set to REPLY, without splitting nor trimming.
+ * @param line The line, ended by '\0', edited in place.
+ * @param raw 0 if a backslash makes the next character literal.
+ * @param names The names of the variables.
+ * @param count The number of variables, maybe 0.
+ * @return 0 if every variable was set, 1 otherwise.
+ */
+int _read_assign(char *const line, const int raw, const char *const *const names, const int count);
+
+/**
+ * @brief Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void _read_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of read, read a line of stdin into variables.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if a full line was read, 1 at end of file or if error, 2 if wrong usage.
+ */
+int our_read(const int argc, const char *const *const argv);
+
+#endif
@@ -0,0 +1,66 @@
+// CShell Project - Buffered line reader for scripts
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef READER_H
+#define READER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Size of each read of a script
+#define READER_BLOCK_SIZE 65536
+
+typedef struct {
+    // File descriptor of the script
+    int fd;
+    // Data read and not consumed yet is buffer[start..end[
+    char *buffer;
+    size_t start;
+    size_t end;
+    size_t capacity;
+    // Set once read returned 0
+    int eof;
+    // Set when fd is a regular file shared with commands (stdin), it is read with pread, see reader_sync_before
+    int seekable;
+    // Offset in the file matching buffer[end]
+    off_t offset;
+} reader_t;
+
+/**
+ * @brief Initialize a reader on a file descriptor.
+ * @param reader The reader.
+ * @param fd The file descriptor to read.
+ * @param shared 1 if commands may read the same file descriptor (stdin), to keep its offset right.
+ * @return 0 if the reader is ready, -1 if malloc error.
+ */
+int reader_init(reader_t *const reader, const int fd, const int shared);
+
+/**
+ * @brief Read the next line, with large reads instead of one read per character.
+ * @param reader The reader.
+ * @param length Reference to store the length of the line, NULL if not needed.
+ * @return The line without its new line, valid until the next call, NULL at the end of the file.
+ */
+char *reader_next_line(reader_t *const reader, size_t *const length);
+
+/**
+ * @brief Before running a command, put the offset of a shared file descriptor right after the consumed lines,
+ * so a command reading stdin gets the rest of the script like with an unbuffered shell.
+ * @param reader The reader.
+ */
+void reader_sync_before(reader_t *const reader);
+
+/**
+ * @brief After running a command, drop buffered data if the command moved the offset of the shared file descriptor.
+ * @param reader The reader.
+ */
+void reader_sync_after(reader_t *const reader);
+
+/**
+ * @brief Free the buffer of a reader, the file descriptor is not closed.
+ * @param reader The reader.
+ */
+void reader_free(reader_t *const reader);
+
+#endif
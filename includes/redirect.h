@@ -0,0 +1,125 @@
+// CShell Project - File descriptor actions of redirections
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef REDIRECT_H
+#define REDIRECT_H
+
+#include <spawn.h>
+
+// Lowest file descriptor used to save the ones replaced by redirections of commands run inside the shell
+#define REDIRECT_SAVED_FD_MIN 10
+// Marks a file descriptor not saved by an action (an earlier action of the list saved it)
+#define REDIRECT_NOT_SAVED -2
+
+typedef enum {
+    // Open path with flags on fd
+    FD_ACTION_OPEN,
+    // Make fd a copy of source
+    FD_ACTION_DUP,
+    // Close fd
+    FD_ACTION_CLOSE,
+} fd_action_type_t;
+
+typedef struct {
+    fd_action_type_t type;
+    // File descriptor changed by the action
+    int fd;
+    // File and open flags of FD_ACTION_OPEN
+    const char *path;
+    int flags;
+    // File descriptor copied by FD_ACTION_DUP
+    int source;
+    // Set when source belongs to the action (memfd of a here-document), closed by redirect_close
+    int owned;
+    // Set when source is a file descriptor of the process opened by the shell, not one of SHELL_FDS
+    int internal;
+} fd_action_t;
+
+typedef struct {
+    // Actions in the order of the redirections, inside LINE_ARENA
+    fd_action_t *actions;
+    int count;
+} fd_actions_t;
+
+/**
+ * @brief Check if an action of a list changes a file descriptor.
+ * @param actions The actions.
+ * @param fd The file descriptor.
+ * @return 1 if the file descriptor is redirected, 0 otherwise.
+ */
+int redirect_targets(const fd_actions_t *const actions, const int fd);
+
+/**
+ * @brief Check if a list only opens files on stdin and stdout, the redirections a fused stage can do on its own.
+ * @param actions The actions.
+ * @return 1 if every action opens a file on stdin or stdout, 0 otherwise.
+ */
+int redirect_is_simple(const fd_actions_t *const actions);
+
+/**
+ * @brief Add the actions to the file actions of posix_spawn, they are done by the child only.
+ * @param actions The actions.
+ * @param file_actions The file actions of posix_spawn.
+ */
+void redirect_spawn_actions(const fd_actions_t *const actions, posix_spawn_file_actions_t *const file_actions);
+
+/**
+ * @brief Add the file descriptors of the shell which are not the ones of the process to the file actions of posix_spawn.
+ * @param file_actions The file actions of posix_spawn, done before the pipes and redirections of the command.
+ */
+void redirect_spawn_shell_fds(posix_spawn_file_actions_t *const file_actions);
+
+/**
+ * @brief Make the file descriptors of the shell the ones of the process, inside a child forked by an embedding context.
+ */
+void redirect_install_shell_fds();
+
+/**
+ * @brief Move a file descriptor opened by the shell above SHELL_FDS inside an embedding context,
+ * so putting SHELL_FDS in place in a child never overwrites it.
+ * @param fd The file descriptor, closed if moved, may be -1.
+ * @return The file descriptor to use, -1 if error.
+ */
+int redirect_shell_fd(const int fd);
+
+/**
+ * @brief Do the actions on the file descriptors of the current process, reporting errors on stderr.
+ * Inside an embedding context with saved given, they are done on SHELL_FDS instead (see _redirect_apply_shell).
+ * @param actions The actions.
+ * @param saved Array of actions->count file descriptors to save the ones replaced, to give to redirect_restore,
+ * NULL inside a child which never goes back.
+ * @return 0 if every action was done, -1 if error (the actions done are still saved).
+ */
+int redirect_apply(const fd_actions_t *const actions, int *const saved);
+
+/**
+ * @brief Put back the file descriptors replaced by redirect_apply, in reverse order.
+ * @param actions The actions.
+ * @param saved The file descriptors saved by redirect_apply, closed, may be NULL.
+ */
+void redirect_restore(const fd_actions_t *const actions, const int *const saved);
+
+/**
+ * @brief Do the actions on SHELL_FDS, the file descriptors of the process are left to the embedding program:
+ * files are opened from CWD_FD and every new file descriptor is a copy at or above SHELL_FDS_COUNT.
+ * @param actions The actions.
+ * @param saved Array of actions->count previous values of SHELL_FDS, REDIRECT_NOT_SAVED after the first action on one.
+ * @return 0 if every action was done, -1 if error (the actions done are still saved).
+ */
+int _redirect_apply_shell(const fd_actions_t *const actions, int *const saved);
+
+/**
+ * @brief Put back the values of SHELL_FDS replaced by _redirect_apply_shell, closing the copies it made.
+ * @param actions The actions.
+ * @param saved The values saved by _redirect_apply_shell.
+ */
+void _redirect_restore_shell(const fd_actions_t *const actions, const int *const saved);
+
+/**
+ * @brief Close the file descriptors belonging to the actions, once the command started.
+ * @param actions The actions.
+ */
+void redirect_close(const fd_actions_t *const actions);
+
+#endif
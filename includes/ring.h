@@ -0,0 +1,85 @@
+// CShell Project - Single-producer/single-consumer ring buffer
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef RING_H
+#define RING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Number of blocks inside a ring buffer
+#define RING_BLOCKS 8
+// Size of each block of a ring buffer
+#define RING_BLOCK_SIZE 65536
+
+typedef struct ring {
+    // Data of every block, RING_BLOCKS * RING_BLOCK_SIZE bytes
+    char *blocks;
+    // Number of bytes used in each published block
+    size_t lengths[RING_BLOCKS];
+    // Number of blocks published by the producer
+    atomic_size_t head;
+    // Number of blocks released by the consumer
+    atomic_size_t tail;
+    // Set when the producer will not publish anymore
+    atomic_int writer_closed;
+    // Set when the consumer will not read anymore
+    atomic_int reader_closed;
+} ring_t;
+
+/**
+ * @brief Allocate a new empty ring buffer.
+ * @return The ring buffer, NULL if malloc error.
+ */
+ring_t *ring_create();
+
+/**
+ * @brief Free a ring buffer.
+ * @param ring The ring buffer to free.
+ * @warning Both sides must be done with the ring buffer.
+ */
+void ring_destroy(ring_t *const ring);
+
+/**
+ * @brief Wait for a free block to fill (producer side).
+ * @param ring The ring buffer.
+ * @return The block to fill with at most RING_BLOCK_SIZE bytes, NULL if the consumer is closed.
+ */
+char *ring_acquire(ring_t *const ring);
+
+/**
+ * @brief Publish the block given by ring_acquire to the consumer (producer side).
+ * @param ring The ring buffer.
+ * @param length Number of bytes written in the block.
+ */
+void ring_publish(ring_t *const ring, const size_t length);
+
+/**
+ * @brief Wait for the next published block (consumer side).
+ * @param ring The ring buffer.
+ * @param length Reference to the number of bytes in the block for return.
+ * @return The block to read, NULL if the producer is closed and every block was read.
+ * @note The block stays valid until ring_release is called.
+ */
+const char *ring_peek(ring_t *const ring, size_t *const length);
+
+/**
+ * @brief Give back the block given by ring_peek to the producer (consumer side).
+ * @param ring The ring buffer.
+ */
+void ring_release(ring_t *const ring);
+
+/**
+ * @brief Tell the consumer that nothing more will be published.
+ * @param ring The ring buffer.
+ */
+void ring_close_writer(ring_t *const ring);
+
+/**
+ * @brief Tell the producer that nothing more will be read.
+ * @param ring The ring buffer.
+ */
+void ring_close_reader(ring_t *const ring);
+
+#endif
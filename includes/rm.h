@@ -5,6 +5,15 @@
 #ifndef COMMAND_RM_H
 #define COMMAND_RM_H
 
+typedef struct {
+    // -r, remove directories and their contents
+    int recursive;
+    // -v, print each removed file
+    int verbose;
+    // -f, ignore errors
+    int force;
+} rm_options_t;
+
 /**
  * @brief Print the usage of the program.
  * @param program_name The name of the program.
@@ -15,9 +24,10 @@ void _rm_print_usage(const char *const program_name);
  * @brief Parse the arguments of the program.
  * @param argc The number of arguments.
  * @param argv The arguments.
+ * @param options The options to fill.
  * @return 0 if arguments are good, -1 if -h or --help used.
  */
-int _rm_parse_arguments(const int argc, const char *const *const argv);
+int _rm_parse_arguments(const int argc, const char *const *const argv, rm_options_t *const options);
 
 /**
  * @brief Check if path refer to a directory.
@@ -29,9 +39,10 @@ int _rm_is_directory(const char *path);
 /**
  * @brief Remove a directory recursively.
  * @param path The path to directory to remove.
+ * @param options The options of the command.
  * @return 0 if the operation was successful, -1 otherwise.
  */
-int _rm_remove_recursively(const char *path);
+int _rm_remove_recursively(const char *path, const rm_options_t *const options);
 
 /**
  * @brief Main function of the program.
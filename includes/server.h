@@ -0,0 +1,69 @@
+// CShell Project - Shell server on a Unix socket, and its client
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+
+// Version of the protocol, requests of another version are refused
+#define SERVER_PROTOCOL_VERSION 1
+// Number of connections waiting to be accepted
+#define SERVER_BACKLOG 128
+// Maximum length of the command line of a request
+#define SERVER_MAX_LINE_LENGTH (1 << 20)
+
+// Request of a client, sent with its stdin, stdout and stderr (SCM_RIGHTS),
+// followed by its working directory and the command line (without '\0')
+// The answer is the return code of the line as an int
+typedef struct {
+    unsigned int version;
+    unsigned int cwd_length;
+    unsigned int line_length;
+} server_request_t;
+
+/**
+ * @brief Listen on a Unix socket and run the command line of each request inside a forked copy of the shell,
+ * which already did its startup (environment, startup file, caches), with the file descriptors of the client.
+ * @param path The path of the socket, an old socket at this path is replaced.
+ * @return 1 if the socket can not be created, it does not return otherwise.
+ */
+int server_run(const char *const path);
+
+/**
+ * @brief Send a command line to a server with stdin, stdout, stderr and the working directory of the process,
+ * then wait for its return code.
+ * @param path The path of the socket of the server.
+ * @param line The command line.
+ * @return The return code of the line, 1 if the server can not be reached or closed the connection.
+ */
+int server_connect(const char *const path, const char *const line);
+
+/**
+ * @brief Read exactly size bytes, retrying after interruptions and short reads.
+ * @param fd The file descriptor.
+ * @param buffer The buffer.
+ * @param size The number of bytes.
+ * @return 0 if every byte was read, -1 if error or end of file.
+ */
+int _server_read_all(const int fd, void *const buffer, const size_t size);
+
+/**
+ * @brief Write exactly size bytes, retrying after interruptions and short writes, without SIGPIPE.
+ * @param fd The socket.
+ * @param buffer The bytes.
+ * @param size The number of bytes.
+ * @return 0 if every byte was written, -1 if error.
+ */
+int _server_write_all(const int fd, const void *const buffer, const size_t size);
+
+/**
+ * @brief Handle a request inside a worker: receive it, take the working directory and file descriptors of the client,
+ * run the line and answer its return code.
+ * @param client The connection of the client.
+ * @return The return code of the line, 1 if the request is invalid.
+ */
+int _server_serve(const int client);
+
+#endif
@@ -0,0 +1,171 @@
+// CShell Project - Output sinks and input sources of commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef SINK_H
+#define SINK_H
+
+#include "ring.h"
+#include <stddef.h>
+#include <stdarg.h>
+#include <sys/types.h>
+
+// Size of the buffer of a sink writing in a file descriptor
+#define SINK_BUFFER_SIZE 65536
+
+typedef enum {
+    SINK_FD,
+    SINK_RING,
+} sink_type_t;
+
+typedef struct {
+    sink_type_t type;
+    // File descriptor to write in (SINK_FD)
+    int fd;
+    // Ring buffer to publish in (SINK_RING)
+    ring_t *ring;
+    // Buffer or block of the ring being filled
+    char *block;
+    // Number of bytes used in the block
+    size_t length;
+    // Set after a failed write, every next write fails
+    int failed;
+} sink_t;
+
+typedef enum {
+    SOURCE_FD,
+    SOURCE_RING,
+} source_type_t;
+
+typedef struct {
+    source_type_t type;
+    // File descriptor to read from (SOURCE_FD)
+    int fd;
+    // Ring buffer to read from (SOURCE_RING)
+    ring_t *ring;
+    // Block of the ring being read
+    const char *block;
+    // Number of bytes in the block
+    size_t length;
+    // Number of bytes already read in the block
+    size_t offset;
+} source_t;
+
+// Output of builtins on the current thread, NULL for stdout (SHELL_FDS[1])
+extern __thread sink_t *SINK_OUT;
+// Input of builtins on the current thread, NULL for stdin (SHELL_FDS[0])
+extern __thread source_t *SOURCE_IN;
+
+/**
+ * @brief Initialize a sink writing in a file descriptor through a buffer.
+ * @param sink The sink to initialize.
+ * @param fd The file descriptor to write in.
+ * @return 0 if the sink is ready, -1 if malloc error.
+ */
+int sink_init_fd(sink_t *const sink, const int fd);
+
+/**
+ * @brief Initialize a sink publishing blocks in a ring buffer.
+ * @param sink The sink to initialize.
+ * @param ring The ring buffer to publish in.
+ */
+void sink_init_ring(sink_t *const sink, ring_t *const ring);
+
+/**
+ * @brief Flush a sink and release it, a ring buffer is closed for its consumer.
+ * @param sink The sink to close.
+ * @warning The file descriptor is not closed.
+ */
+void sink_close(sink_t *const sink);
+
+/**
+ * @brief Write bytes in the output of the current thread.
+ * @param buffer The bytes to write.
+ * @param length The number of bytes to write.
+ * @return The number of bytes written, -1 if the output is closed or broken.
+ */
+ssize_t sink_write(const char *const buffer, const size_t length);
+
+/**
+ * @brief Print formatted string in the output of the current thread.
+ * @param format The format, same as printf.
+ * @return The number of bytes written, -1 if the output is closed or broken.
+ */
+int sink_printf(const char *const format, ...);
+
+/**
+ * @brief Write a character in the output of the current thread.
+ * @param c The character to write.
+ * @return The character written, EOF if the output is closed or broken.
+ */
+int sink_putc(const int c);
+
+/**
+ * @brief Flush the output of the current thread.
+ * @return 0 if everything was written, -1 otherwise.
+ */
+int sink_flush();
+
+/**
+ * @brief Print formatted string in the error output of the shell, stderr or the one given by an embedding context.
+ * @param format The format, same as printf.
+ * @return The number of bytes written, -1 if the output is closed or broken.
+ */
+int sink_error(const char *const format, ...);
+
+/**
+ * @brief Print a message and the text of errno in the error output of the shell, same as perror.
+ * @param message The message, NULL or empty for the text only.
+ */
+void sink_perror(const char *const message);
+
+/**
+ * @brief Write a whole buffer in a file descriptor.
+ * @param fd The file descriptor.
+ * @param buffer The bytes to write.
+ * @param length The number of bytes to write.
+ * @return The number of bytes written, -1 if error.
+ */
+ssize_t _sink_write_fd(const int fd, const char *const buffer, const size_t length);
+
+/**
+ * @brief Format a string in a local buffer, or in the heap if it is too small.
+ * @param local The local buffer.
+ * @param size The size of the local buffer.
+ * @param length Reference to the length of the string for return.
+ * @param format The format, same as printf.
+ * @param args The arguments of the format.
+ * @return The local buffer or a heap one to free, NULL if error.
+ */
+char *_sink_format(char *const local, const size_t size, int *const length, const char *const format, va_list args);
+
+/**
+ * @brief Initialize a source reading from a file descriptor.
+ * @param source The source to initialize.
+ * @param fd The file descriptor to read from.
+ */
+void source_init_fd(source_t *const source, const int fd);
+
+/**
+ * @brief Initialize a source reading blocks from a ring buffer.
+ * @param source The source to initialize.
+ * @param ring The ring buffer to read from.
+ */
+void source_init_ring(source_t *const source, ring_t *const ring);
+
+/**
+ * @brief Release a source, a ring buffer is closed for its producer.
+ * @param source The source to close.
+ * @warning The file descriptor is not closed.
+ */
+void source_close(source_t *const source);
+
+/**
+ * @brief Read bytes from the input of the current thread.
+ * @param buffer The buffer to fill.
+ * @param length The size of the buffer.
+ * @return The number of bytes read, 0 at end of input, -1 on error.
+ */
+ssize_t source_read(char *const buffer, const size_t length);
+
+#endif
@@ -0,0 +1,159 @@
+// CShell Project - New source and . commands, with a cache of compiled scripts on disk
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_SOURCE_H
+#define COMMAND_SOURCE_H
+
+#include "parser.h"
+#include <stddef.h>
+#include <sys/stat.h>
+
+// Size of chunks of the arena of a script parsed from its text
+#define SOURCE_ARENA_CHUNK_SIZE 16384
+// Maximum number of files sourced inside each other
+#define SOURCE_MAX_DEPTH 64
+// Directory of the cache, inside $XDG_CACHE_HOME or else $HOME/.cache
+#define SOURCE_CACHE_DIRECTORY "cshell"
+// Format of cached files, to change with the layout of the syntax tree
+#define SOURCE_CACHE_FORMAT 3
+#define SOURCE_CACHE_MAGIC "CSHPLAN"
+
+// Header of a cached file, followed by the path of the script (padded to 8 bytes),
+// the image of the syntax tree, then the offsets of the pointers inside the image
+typedef struct {
+    char magic[8];
+    // CSHELL_VERSION of the shell which wrote the file
+    char version[16];
+    unsigned int format;
+    unsigned int node_size;
+    // Size and modification time of the script
+    long long size;
+    long long mtime_sec;
+    long long mtime_nsec;
+    unsigned long long path_length;
+    unsigned long long image_size;
+    unsigned long long relocation_count;
+    // Offset of the root inside the image plus 1, 0 for an empty script
+    unsigned long long root;
+} source_cache_header_t;
+
+typedef struct {
+    // Image of the syntax tree, pointers are offsets inside it
+    char *data;
+    size_t size;
+    size_t capacity;
+    // Offsets of the pointers inside the image, turned back into addresses when loaded
+    size_t *relocations;
+    size_t count;
+    size_t relocations_capacity;
+    // Set after a malloc error
+    int failed;
+} source_image_t;
+
+/**
+ * @brief Run the commands of a file inside the current shell, their variables stay set after.
+ * The syntax tree of the file is cached on disk, keyed by its path, size, modification time and the version of the shell,
+ * the next shells map it in memory instead of lexing and parsing the file again.
+ * @param path The path of the file.
+ * @return The return code of the last command, 1 if the file can not be read, 2 if syntax error.
+ */
+int source_file(const char *const path);
+
+/**
+ * @brief Find the cached file of a script, creating the directory of the cache.
+ * @param real_path The absolute path of the script.
+ * @param cache_path The buffer of MAX_PATH_LENGTH characters to store the path of the cached file.
+ * @return 0 if found, -1 if there is no directory for the cache.
+ */
+int _source_cache_path(const char *const real_path, char *const cache_path);
+
+/**
+ * @brief Map a cached file in memory and turn its offsets back into pointers.
+ * @param cache_path The path of the cached file.
+ * @param real_path The absolute path of the script.
+ * @param st The status of the script.
+ * @param map Reference to store the mapping, to give to munmap.
+ * @param map_size Reference to store the size of the mapping.
+ * @param root Reference to store the syntax tree, NULL for an empty script.
+ * @return 0 if loaded, -1 if the cached file is missing, outdated or corrupted.
+ */
+int _source_load(const char *const cache_path, const char *const real_path, const struct stat *const st, void **const map, size_t *const map_size, node_t **const root);
+
+/**
+ * @brief Write the syntax tree of a script to its cached file, through a temporary file renamed at the end.
+ * @param cache_path The path of the cached file.
+ * @param real_path The absolute path of the script.
+ * @param st The status of the script.
+ * @param root The syntax tree, NULL for an empty script.
+ * @return 0 if written, -1 if error (the cache is only skipped).
+ */
+int _source_store(const char *const cache_path, const char *const real_path, const struct stat *const st, const node_t *const root);
+
+/**
+ * @brief Add bytes at the end of an image, aligned on 8 bytes.
+ * @param image The image.
+ * @param data The bytes, NULL for zeros.
+ * @param size The number of bytes.
+ * @return The offset of the bytes, 0 if malloc error (image->failed set).
+ */
+size_t _source_put(source_image_t *const image, const void *const data, const size_t size);
+
+/**
+ * @brief Store a pointer inside an image and remember its place to turn it back into an address.
+ * @param image The image.
+ * @param at The offset of the pointer.
+ * @param target The offset it points to.
+ */
+void _source_set_pointer(source_image_t *const image, const size_t at, const size_t target);
+
+/**
+ * @brief Add a string to an image and store a pointer to it.
+ * @param image The image.
+ * @param at The offset of the pointer, left to 0 (NULL) if str is NULL.
+ * @param str The string.
+ */
+void _source_put_string(source_image_t *const image, const size_t at, const char *const str);
+
+/**
+ * @brief Add a node and every node below it to an image.
+ * @param image The image.
+ * @param node The node.
+ * @return The offset of the node.
+ */
+size_t _source_put_node(source_image_t *const image, const node_t *const node);
+
+/**
+ * @brief Read a script and build its syntax tree.
+ * @param fd The script.
+ * @param path The path of the script, for errors.
+ * @param size The size of the script.
+ * @param arena The arena owning the tree.
+ * @param root Reference to store the tree, NULL for an empty script.
+ * @return 0 if parsed, 1 if the file can not be read, 2 if syntax error.
+ */
+int _source_parse(const int fd, const char *const path, const size_t size, arena_t *const arena, node_t **const root);
+
+/**
+ * @brief Print the usage of source and ..
+ * @param program_name The name of the program.
+ */
+void _source_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of source, run the commands of a file inside the current shell.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return The return code of the last command of the file.
+ */
+int our_source(const int argc, const char *const *const argv);
+
+/**
+ * @brief Main function of ., the same as source.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return The return code of the last command of the file.
+ */
+int our_dot(const int argc, const char *const *const argv);
+
+#endif
@@ -0,0 +1,100 @@
+// CShell Project - Counters of the work done by the shell, and new shellstats command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_STATS_H
+#define COMMAND_STATS_H
+
+typedef enum {
+    // Command lines run, and their plans found in the cache or lexed and parsed
+    STAT_LINES,
+    STAT_PLAN_HITS,
+    STAT_PLAN_MISSES,
+    // Arena allocations made to lex and parse lines
+    STAT_PARSE_ALLOCATIONS,
+    // Copies of the shell forked, external commands started, threads of fused pipelines
+    STAT_FORKS,
+    STAT_EXECS,
+    STAT_THREADS,
+    // Bytes copied by clone_memfd between commands of buffered pipelines
+    STAT_MEMFD_BYTES,
+    // Prompt and line drawn again by the terminal
+    STAT_TERMINAL_REDRAWS,
+    // Builtins run, inside the shell or on threads
+    STAT_BUILTIN_CALLS,
+    // read and write system calls of builtins (sink and source), bytes they wrote and read
+    STAT_BUILTIN_SYSCALLS,
+    STAT_BUILTIN_BYTES_WRITTEN,
+    STAT_BUILTIN_BYTES_READ,
+    // Files copied by cp and their bytes, files and directories removed by rm
+    STAT_FILES_COPIED,
+    STAT_BYTES_COPIED,
+    STAT_FILES_REMOVED,
+    // Number of counters
+    STAT_COUNT,
+} stat_t;
+
+typedef struct stats_block_s {
+    // Counters of a thread, only written by it
+    unsigned long long counters[STAT_COUNT];
+    // Next block of a running thread
+    struct stats_block_s *next;
+} stats_block_t;
+
+/**
+ * @brief Add to a counter of the current thread, without lock: threads have their own counters, summed when read.
+ * @param stat The counter.
+ * @param value The value to add.
+ */
+void stats_add(const stat_t stat, const unsigned long long value);
+
+/**
+ * @brief Get the value of a counter since the last reset, for every thread of the shell.
+ * @param stat The counter.
+ * @return The value.
+ */
+unsigned long long stats_get(const stat_t stat);
+
+/**
+ * @brief Start every counter again from 0.
+ */
+void stats_reset();
+
+/**
+ * @brief Create the key of the blocks of threads, called once.
+ */
+void _stats_create_key();
+
+/**
+ * @brief Create the block of counters of the current thread.
+ * @return The block, NULL if malloc error (the counts of the thread are lost).
+ */
+stats_block_t *_stats_register();
+
+/**
+ * @brief Add the counters of a thread which ended to the retired ones and free its block, destructor of the thread key.
+ * @param block The block of the thread.
+ */
+void _stats_retire(void *block);
+
+/**
+ * @brief Sum the counters of every thread, including the ones which ended, without the values at the last reset.
+ * @param totals Array of STAT_COUNT values to fill.
+ */
+void _stats_sum(unsigned long long *const totals);
+
+/**
+ * @brief Print the usage of shellstats.
+ * @param program_name The name of the program.
+ */
+void _stats_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of shellstats, print the counters of the shell.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if success, 2 if wrong arguments.
+ */
+int our_shellstats(const int argc, const char *const *const argv);
+
+#endif
@@ -10,6 +10,17 @@
  */
 void enable_raw_mode();
 
+/**
+ * @brief Restores the terminal settings saved by enable_raw_mode, for foreground jobs.
+ */
+void disable_raw_mode();
+
+/**
+ * @brief Show "> " instead of the full prompt, while reading the next line of an incomplete command.
+ * @param enabled 1 to show "> ", 0 to show the full prompt.
+ */
+void terminal_continue_line(const int enabled);
+
 /**
  * @brief Display terminal and get stdin for command
  * @return 1 if the character read is '\n', 0 otherwise.
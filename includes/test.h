@@ -0,0 +1,99 @@
+// CShell Project - New test and [ commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_TEST_H
+#define COMMAND_TEST_H
+
+/**
+ * @brief Check if an argument is a unary operator (-f, -d, -z, ...).
+ * @param op The argument.
+ * @return 1 if it is a unary operator, 0 otherwise.
+ */
+int _test_is_unary(const char *const op);
+
+/**
+ * @brief Check if an argument is a binary operator (=, !=, -eq, -nt, ...).
+ * @param op The argument.
+ * @return 1 if it is a binary operator, 0 otherwise.
+ */
+int _test_is_binary(const char *const op);
+
+/**
+ * @brief Evaluate a unary test, file tests use a single statx (or faccessat for -r, -w and -x).
+ * @param op The letter of the operator.
+ * @param arg The operand.
+ * @return 0 if true, 1 if false.
+ */
+int _test_unary(const char op, const char *const arg);
+
+/**
+ * @brief Convert an operand of an integer comparison.
+ * @param arg The operand.
+ * @param value Reference to store the integer.
+ * @return 0 if the operand is an integer, -1 otherwise (reported on stderr).
+ */
+int _test_integer(const char *const arg, long long *const value);
+
+/**
+ * @brief Evaluate a binary test.
+ * @param left The left operand.
+ * @param op The operator.
+ * @param right The right operand.
+ * @return 0 if true, 1 if false, 2 if error.
+ */
+int _test_binary(const char *const left, const char *const op, const char *const right);
+
+/**
+ * @brief Evaluate ( expression ), a unary test, a binary test or a single string.
+ * @param argv The arguments of the expression.
+ * @param count The number of arguments.
+ * @param i Reference to the current argument, moved after the primary.
+ * @return 0 if true, 1 if false, 2 if error.
+ */
+int _test_primary(const char *const *const argv, const int count, int *const i);
+
+/**
+ * @brief Evaluate ! expression.
+ * @param argv The arguments of the expression.
+ * @param count The number of arguments.
+ * @param i Reference to the current argument.
+ * @return 0 if true, 1 if false, 2 if error.
+ */
+int _test_not(const char *const *const argv, const int count, int *const i);
+
+/**
+ * @brief Evaluate expression -a expression.
+ * @param argv The arguments of the expression.
+ * @param count The number of arguments.
+ * @param i Reference to the current argument.
+ * @return 0 if true, 1 if false, 2 if error.
+ */
+int _test_and(const char *const *const argv, const int count, int *const i);
+
+/**
+ * @brief Evaluate expression -o expression, the lowest priority.
+ * @param argv The arguments of the expression.
+ * @param count The number of arguments.
+ * @param i Reference to the current argument.
+ * @return 0 if true, 1 if false, 2 if error.
+ */
+int _test_or(const char *const *const argv, const int count, int *const i);
+
+/**
+ * @brief Main function of test.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the expression is true, 1 if it is false, 2 if error.
+ */
+int our_test(const int argc, const char *const *const argv);
+
+/**
+ * @brief Main function of [, same as test with a closing ].
+ * @param argc The number of arguments.
+ * @param argv The arguments, ended by ].
+ * @return 0 if the expression is true, 1 if it is false, 2 if error.
+ */
+int our_bracket(const int argc, const char *const *const argv);
+
+#endif
@@ -0,0 +1,115 @@
+// CShell Project - Measures of the time keyword: wall clock time and resources of pipelines and of their stages
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "config.h"
+#include <time.h>
+#include <sys/resource.h>
+
+// Maximum length of the command printed for a stage
+#define TIMING_LABEL_LENGTH 40
+
+typedef struct {
+    // Set once the stage ended and was measured
+    int measured;
+    // Set when the stage ran inside the shell (fused thread or buffered pipeline), its memory is the one of the shell
+    int in_shell;
+    // Wall clock time at the end of the stage, stages start with the pipeline
+    struct timespec end;
+    // Resources used by the stage only (its process and the children it waited), maximum resident size included
+    struct rusage usage;
+    // Command of the stage
+    char label[TIMING_LABEL_LENGTH];
+} timing_stage_t;
+
+typedef struct {
+    // Wall clock time of the start and end
+    struct timespec start;
+    struct timespec end;
+    // Resources of the shell and of its waited children at start, then used between start and end
+    struct rusage usage;
+    // Stages of the pipeline measured, 0 if time runs a compound command
+    int count;
+    timing_stage_t stages[MAX_PIPELINE_STAGES];
+} timing_t;
+
+/**
+ * @brief Start measuring, the next pipeline run takes the measures with timing_take to fill its stages.
+ * @param timing The measures, zeroed.
+ * @param pipeline 1 if time runs a pipeline (or a simple command), 0 for a compound command.
+ */
+void timing_start(timing_t *const timing, const int pipeline);
+
+/**
+ * @brief Take the measures waiting for their pipeline, the pipelines run inside it do not get them.
+ * @return The measures, NULL if no pipeline is run by time.
+ */
+timing_t *timing_take();
+
+/**
+ * @brief Stop measuring: resources used since timing_start by the shell and every child it waited meanwhile.
+ * @param timing The measures.
+ */
+void timing_stop(timing_t *const timing);
+
+/**
+ * @brief Set the command printed for a stage.
+ * @param stage The stage.
+ * @param argc The number of arguments of the stage.
+ * @param argv The arguments of the stage.
+ */
+void timing_label(timing_stage_t *const stage, const int argc, char *const *const argv);
+
+/**
+ * @brief Measure the end of a stage run by a process, with the resources given by wait4.
+ * @param stage The stage.
+ * @param usage The resources of the process.
+ */
+void timing_end_process(timing_stage_t *const stage, const struct rusage *const usage);
+
+/**
+ * @brief Measure the end of a stage run by a thread of the shell.
+ * @param stage The stage.
+ * @param before The resources of the thread (RUSAGE_THREAD) when the stage started.
+ */
+void timing_end_thread(timing_stage_t *const stage, const struct rusage *const before);
+
+/**
+ * @brief Measure the end of a stage run by the shell itself, with the processes it waited.
+ * @param stage The stage.
+ * @param before The resources given by _timing_sample when the stage started.
+ */
+void timing_end_shell(timing_stage_t *const stage, const struct rusage *const before);
+
+/**
+ * @brief Print the measures on stderr, with a line per stage for a pipeline of several stages.
+ * @param timing The measures.
+ */
+void timing_print(const timing_t *const timing);
+
+/**
+ * @brief Get the resources used by the shell and every child it waited, the maximum resident size being the biggest.
+ * @param usage Reference to store the resources.
+ */
+void _timing_sample(struct rusage *const usage);
+
+/**
+ * @brief Subtract resources, the maximum resident size is the one of after.
+ * @param result Reference to store after - before.
+ * @param after The resources at the end.
+ * @param before The resources at the start.
+ */
+void _timing_subtract(struct rusage *const result, const struct rusage *const after, const struct rusage *const before);
+
+/**
+ * @brief Get the number of seconds between two times.
+ * @param start The first time.
+ * @param end The second time.
+ * @return The number of seconds.
+ */
+double _timing_seconds(const struct timespec *const start, const struct timespec *const end);
+
+#endif
@@ -0,0 +1,101 @@
+// CShell Project - Timeline of the shell written as Chrome trace events (SHELL_TRACE=path), viewable in Perfetto
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "config.h"
+#include <stddef.h>
+
+// Events kept by a thread before it writes them to the trace file
+#define TRACE_BUFFER_EVENTS 1024
+// Maximum length of the detail of an event (command, path...)
+#define TRACE_DETAIL_LENGTH 64
+// The trace file is moved at or above this descriptor, out of the way of redirections
+#define TRACE_FD_MIN 100
+// Size of the text written at once to the trace file
+#define TRACE_CHUNK_SIZE 16384
+
+// Begin and end a span of the timeline, a single branch when tracing is off
+#define TRACE_BEGIN(name, detail) do { if (__builtin_expect(TRACE_ENABLED, 0)) trace_event('B', name, detail); } while (0)
+#define TRACE_END(name)           do { if (__builtin_expect(TRACE_ENABLED, 0)) trace_event('E', name, NULL); } while (0)
+
+typedef struct {
+    // Name of the span, a string literal
+    const char *name;
+    // 'B' for begin, 'E' for end
+    char phase;
+    // CLOCK_MONOTONIC time in nanoseconds, the same clock for every process
+    long long time;
+    // Argument of the span, empty if none
+    char detail[TRACE_DETAIL_LENGTH];
+} trace_event_t;
+
+typedef struct {
+    // Process and thread of the events
+    int pid;
+    int tid;
+    // Events not written yet, only touched by their thread
+    int count;
+    trace_event_t events[TRACE_BUFFER_EVENTS];
+} trace_buffer_t;
+
+/**
+ * @brief Start tracing into a file, every process and thread of the shell appends its events to it.
+ * @param path The path of the trace file, truncated.
+ * @return 0 if success, -1 if the file cannot be opened.
+ */
+int trace_open(const char *const path);
+
+/**
+ * @brief Add an event to the buffer of the current thread, without lock, use TRACE_BEGIN and TRACE_END.
+ * @param phase 'B' to begin a span, 'E' to end the last one.
+ * @param name The name of the span, a string literal.
+ * @param detail The argument of the span (truncated), NULL if none.
+ */
+void trace_event(const char phase, const char *const name, const char *const detail);
+
+/**
+ * @brief Write the events of the current thread to the trace file, before exiting or replacing the process.
+ */
+void trace_flush();
+
+/**
+ * @brief Create the key of the buffers of threads, called once.
+ */
+void _trace_create_key();
+
+/**
+ * @brief Create the buffer of the current thread.
+ * @return The buffer, NULL if malloc error (the events of the thread are lost).
+ */
+trace_buffer_t *_trace_register();
+
+/**
+ * @brief Write the events of a buffer to the trace file and empty it.
+ * @param buffer The buffer.
+ */
+void _trace_write_buffer(trace_buffer_t *const buffer);
+
+/**
+ * @brief Write the events of a thread which ended and free its buffer, destructor of the thread key.
+ * @param buffer The buffer of the thread.
+ */
+void _trace_release(void *buffer);
+
+/**
+ * @brief Drop the events copied from the parent in a forked copy of the shell, they are written by the parent.
+ */
+void _trace_forked();
+
+/**
+ * @brief Copy a string escaped for a JSON string.
+ * @param destination The buffer to fill, always terminated.
+ * @param size The size of the buffer.
+ * @param source The string to escape.
+ * @return The length written.
+ */
+size_t _trace_escape(char *const destination, const size_t size, const char *const source);
+
+#endif
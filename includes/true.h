@@ -0,0 +1,24 @@
+// CShell Project - New true and false commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_TRUE_H
+#define COMMAND_TRUE_H
+
+/**
+ * @brief Main function of true, do nothing successfully.
+ * @param argc The number of arguments.
+ * @param argv The arguments, ignored.
+ * @return 0.
+ */
+int our_true(const int argc, const char *const *const argv);
+
+/**
+ * @brief Main function of false, do nothing unsuccessfully.
+ * @param argc The number of arguments.
+ * @param argv The arguments, ignored.
+ * @return 1.
+ */
+int our_false(const int argc, const char *const *const argv);
+
+#endif
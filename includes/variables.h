@@ -0,0 +1,189 @@
+// CShell Project - Shell variables and new export, unset and readonly commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+#ifndef COMMAND_VARIABLES_H
+#define COMMAND_VARIABLES_H
+
+#include "arena.h"
+#include <stddef.h>
+
+// Initial number of slots of the table of variables
+#define VAR_INITIAL_CAPACITY 128
+// Size of chunks of the arena of the environment given to commands
+#define VAR_ENV_ARENA_CHUNK_SIZE 8192
+
+// Flags of a variable
+#define VAR_EXPORTED 1
+#define VAR_READONLY 2
+
+typedef struct {
+    // Name of the variable, allocated once and kept after unset, NULL for an empty slot
+    char *name;
+    unsigned long hash;
+    // Value of the variable, NULL if unset, its buffer is reused by the next assignments
+    char *value;
+    size_t capacity;
+    // VAR_EXPORTED and VAR_READONLY
+    int flags;
+} var_entry_t;
+
+typedef struct {
+    // Table of variables (open addressing with linear probing), entries are never removed
+    var_entry_t *entries;
+    // Number of slots of the table (power of 2)
+    int capacity;
+    // Number of used slots of the table
+    int count;
+    // Environment given to commands, built inside its arena when an exported variable changed
+    arena_t env_arena;
+    char **env;
+    int env_dirty;
+} var_table_t;
+
+/**
+ * @brief Fill the table in use with the environment of the process, every variable of it is exported.
+ */
+void var_init();
+
+/**
+ * @brief Make a table the variables of the shell, e.g. the variables of an embedding context.
+ * @param table The table, zeroed with env_dirty set before its var_init, NULL for the variables of the shell itself.
+ * @return The table used before.
+ * @note Inside another program (EMBEDDED), environ is left to it and var_environ only gives the environment to commands.
+ */
+var_table_t *var_use(var_table_t *const table);
+
+/**
+ * @brief Free every variable of a table which is not in use.
+ * @param table The table, left empty.
+ */
+void var_table_free(var_table_t *const table);
+
+/**
+ * @brief Get the value of a variable.
+ * @param name The name of the variable.
+ * @return The value, valid until the next change of the variable, NULL if unset.
+ */
+const char *var_get(const char *const name);
+
+/**
+ * @brief Set the value of a variable, a new variable is local to the shell until exported.
+ * @param name The name of the variable.
+ * @param value The value.
+ * @return 0 if set, -1 if the variable is readonly (reported on stderr) or malloc error.
+ */
+int var_set(const char *const name, const char *const value);
+
+/**
+ * @brief Unset a variable, it is removed from the environment of commands.
+ * @param name The name of the variable.
+ * @return 0 if unset (or never set), -1 if the variable is readonly (reported on stderr).
+ */
+int var_unset(const char *const name);
+
+/**
+ * @brief Add flags to a variable, created unset if it does not exist.
+ * @param name The name of the variable.
+ * @param flags VAR_EXPORTED and/or VAR_READONLY.
+ * @return 0 if done, -1 if malloc error.
+ */
+int var_add_flags(const char *const name, const int flags);
+
+/**
+ * @brief Check if a string is a valid name of variable: a letter or _, then letters, digits or _.
+ * @param name The string.
+ * @param length The number of characters to check.
+ * @return 1 if valid, 0 otherwise.
+ */
+int var_is_name(const char *const name, const size_t length);
+
+/**
+ * @brief Get the environment given to commands: the exported variables as NAME=value.
+ * It is only built again when an exported variable changed, and becomes environ of the shell (not inside another program).
+ * @return The environment ended by NULL.
+ */
+char **var_environ();
+
+/**
+ * @brief Find the slot of a name inside the table.
+ * @param name The name.
+ * @param hash The hash of the name.
+ * @return Index of the slot holding the name, or of the empty slot where to add it.
+ */
+int _var_find_slot(const char *const name, const unsigned long hash);
+
+/**
+ * @brief Get the entry of a variable, created unset if it does not exist.
+ * @param name The name of the variable.
+ * @return The entry, NULL if malloc error.
+ */
+var_entry_t *_var_entry(const char *const name);
+
+/**
+ * @brief Compare two entries by name, for qsort.
+ * @param a The first entry.
+ * @param b The second entry.
+ * @return Negative, 0 or positive as strcmp.
+ */
+int _var_compare(const void *const a, const void *const b);
+
+/**
+ * @brief Print every variable with a flag, sorted by name, as commands to set them again.
+ * @param command The command to print before each variable (export or readonly).
+ * @param flag The flag of the variables to print.
+ */
+void _var_print(const char *const command, const int flag);
+
+/**
+ * @brief Set flags to variables given as NAME or NAME=value, the common part of export and readonly.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param flag The flag to set.
+ * @return 0 if every variable was set, 1 otherwise.
+ */
+int _var_set_flag_command(const int argc, const char *const *const argv, const int flag);
+
+/**
+ * @brief Print the usage of export.
+ * @param program_name The name of the program.
+ */
+void _export_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of export, export variables to the environment of commands.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_export(const int argc, const char *const *const argv);
+
+/**
+ * @brief Print the usage of readonly.
+ * @param program_name The name of the program.
+ */
+void _readonly_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of readonly, forbid any change of variables.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if the program ran successfully.
+ */
+int our_readonly(const int argc, const char *const *const argv);
+
+/**
+ * @brief Print the usage of unset.
+ * @param program_name The name of the program.
+ */
+void _unset_print_usage(const char *const program_name);
+
+/**
+ * @brief Main function of unset, remove variables.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return 0 if every variable was unset, 1 otherwise.
+ */
+int our_unset(const int argc, const char *const *const argv);
+
+#endif
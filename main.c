@@ -11,57 +11,95 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <pwd.h>
 #include <ctype.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fnmatch.h>
 
 
 // Debug flag to print debug messages
 static int DEBUG = 0;
+// Flag set inside a forked pipeline stage of a simple command, external commands replace the process instead of forking again
+static int IS_STAGE_CHILD = 0;
+// Command line given with -c, NULL if none
+static const char *COMMAND_STRING = NULL;
+// Script file given as argument, NULL to read stdin
+static const char *SCRIPT_PATH = NULL;
+// Set by --norc, no startup file is sourced
+static int NO_RC = 0;
+// Socket given with --server to serve requests on, or with --connect to send COMMAND_STRING to, NULL if none
+static const char *SERVER_PATH = NULL;
+static const char *CONNECT_PATH = NULL;
+// Ends of pipes of <(...) and >(...) kept by the shell, inherited by commands as /dev/fd/N
+static int SUBSTITUTION_FDS[MAX_PROCESS_SUBSTITUTIONS];
+static pid_t SUBSTITUTION_PIDS[MAX_PROCESS_SUBSTITUTIONS];
+static int SUBSTITUTION_COUNT = 0;
 
 
 /**
- * @see fstat, sizeof, malloc, lseek, read
+ * @see fstat, ftruncate, mmap
  */
-char *load_memfd_to_string(const int fd) {
+char *load_memfd_to_string(const int fd, size_t *const size) {
     struct stat st;
+    *size = 0;
     if (fstat(fd, &st) == -1) return NULL;
 
-    // Allocate memory for the content of the file
-    const off_t size = st.st_size;
-    char *const content = malloc((size + 1) * sizeof(char));
-    if (!content) return NULL;
+    // Grow the file by one byte so the mapping always ends with a '\0'
+    *size = st.st_size;
+    if (ftruncate(fd, st.st_size + 1) == -1) return NULL;
 
-    lseek(fd, 0, SEEK_SET);  // go back to start of file for reading
-    read(fd, content, size);
+    // Map the content of the file instead of reading it into a buffer
+    char *const content = mmap(NULL, *size + 1, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (content == MAP_FAILED) return NULL;
 
-    content[size] = '\0';  // null-terminate the string
     return content;
 }
 
 
 /**
- * @see memfd_create, fstat, sizeof, malloc, lseek, read, write, free
+ * @see munmap
+ */
+void unload_memfd_string(char *const content, const size_t size) {
+    if (content) munmap(content, size + 1);
+}
+
+
+/**
+ * @see redirect_shell_fd, memfd_create, fstat, copy_file_range, sendfile, stats_add, lseek, sink_error
  */
 int clone_memfd(const int src) {
     // Create a new memfd file
-    const int dst = memfd_create("cloned_memfd", 0);
+    const int dst = redirect_shell_fd(memfd_create("cloned_memfd", MFD_CLOEXEC));
     if (dst == -1) return -1;
 
     struct stat st;
     if (fstat(src, &st) == -1) return dst;
 
-    // Allocate memory to copy in a buffer
-    const off_t size = st.st_size;
-    char *const content = malloc((size + 1) * sizeof(char));
-    if (!content) return dst;
+    // Copy the content of the source memfd inside the kernel, without any buffer in userspace
+    // the offset of src is given explicitly so its file position is not moved
+    TRACE_BEGIN("clone_memfd", NULL);
+    off_t offset = 0;
+    ssize_t copied;
+    while (offset < st.st_size) {
+        copied = copy_file_range(src, &offset, dst, NULL, st.st_size - offset, 0);
+        if (copied <= 0) break;
+    }
 
-    // Copy the content of the source memfd to the buffer and then to the new memfd
-    lseek(src, 0, SEEK_SET);
-    read(src, content, size);
-    write(dst, content, size);
+    // Finish with sendfile if copy_file_range is not supported for these files
+    while (offset < st.st_size) {
+        copied = sendfile(dst, src, &offset, st.st_size - offset);
+        if (copied <= 0) break;
+    }
+    TRACE_END("clone_memfd");
 
-    free(content);
+    stats_add(STAT_MEMFD_BYTES, offset);
+    if (offset < st.st_size) sink_error("clone_memfd: only %ld of %ld bytes copied\n", (long)offset, (long)st.st_size);
 
     // Go back to the start of each file
     lseek(src, 0, SEEK_SET);
@@ -72,7 +110,26 @@ int clone_memfd(const int src) {
 
 
 /**
- * @see isalnum, sizeof, malloc, realloc, setenv, free
+ * @see WIFEXITED, WEXITSTATUS, WIFSIGNALED, WTERMSIG
+ */
+int status_to_code(const int status) {
+    if (WIFEXITED(status))   return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return status;
+}
+
+
+/**
+ * @see var_set
+ */
+int set_variable(const char *const name, const char *const value) {
+    // The variable stays local to the shell unless it is exported
+    return var_set(name, value);
+}
+
+
+/**
+ * @see isalnum, set_variable
  */
 int setting_envvar(const char *const arg) {
     // Copy the pointer to not edit it outside
@@ -85,387 +142,1498 @@ int setting_envvar(const char *const arg) {
     if (*ptr != '=') return 0;
     ptr++;
 
-    // Copy the value for the environment variable
-    int len = 0;
-    int val_capacity = 10;
-    char *val = malloc(val_capacity * sizeof(char));
-    while (*ptr) {
-        // Reallocate memory if needed
-        while (len >= val_capacity - 1) {
-            val_capacity *= 2;
-            val = realloc(val, val_capacity * sizeof(char));
+    // Set the environment variable, the value is the rest of the argument
+    set_variable(var, ptr);
+
+    return 1;
+}
+
+
+/**
+ * @see isalnum
+ */
+int is_envvar_definition(const char *const arg) {
+    const char *ptr = arg;
+    while (*ptr && (isalnum(*ptr) || *ptr == '_')) ptr++;
+    return *ptr == '=' && ptr != arg;
+}
+
+
+/**
+ * @see builtin_lookup, is_envvar_definition
+ */
+int is_builtin(const char *const name) {
+    return builtin_lookup(name) != NULL || is_envvar_definition(name);
+}
+
+
+/**
+ * @see posix_spawn_file_actions_init, posix_spawn_file_actions_addfchdir_np, redirect_spawn_shell_fds, posix_spawn_file_actions_adddup2, redirect_spawn_actions, hash_lookup, sink_error, posix_spawnattr_init, posix_spawnattr_setsigmask, posix_spawnattr_setsigdefault, posix_spawnattr_setpgroup, posix_spawnattr_setflags, posix_spawn, posix_spawnattr_destroy, posix_spawn_file_actions_destroy, fflush, fork, jobs_child_setup, dup2, redirect_apply, var_environ, exit, execvp, sink_perror, stats_add
+ */
+pid_t spawn_process(const char **const argv, const fd_actions_t *const redirects, const int fd_in, const int fd_out, const pid_t pgid) {
+    // Redirections are applied by the child only, after the pipes, the shell file descriptors are never touched
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    // Inside another program, the child starts from the directory and file descriptors of the context
+    if (CWD_FD != AT_FDCWD) posix_spawn_file_actions_addfchdir_np(&actions, CWD_FD);
+    if (EMBEDDED) redirect_spawn_shell_fds(&actions);
+    if (fd_in != -1)  posix_spawn_file_actions_adddup2(&actions, fd_in, STDIN_FILENO);
+    if (fd_out != -1) posix_spawn_file_actions_adddup2(&actions, fd_out, STDOUT_FILENO);
+    redirect_spawn_actions(redirects, &actions);
+
+    // Resolve the command before spawning anything, unknown commands never cost a process
+    const char *const path = hash_lookup(argv[0]);
+    if (path == NULL) {
+        posix_spawn_file_actions_destroy(&actions);
+        sink_error("%s: command not found\n", argv[0]);
+        errno = ENOENT;
+        return -1;
+    }
+
+    // The child gets default signals and an empty mask, and joins the process group of its job
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGQUIT);
+    sigaddset(&mask, SIGTSTP);
+    sigaddset(&mask, SIGTTIN);
+    sigaddset(&mask, SIGTTOU);
+    sigaddset(&mask, SIGPIPE);
+    sigaddset(&mask, SIGCHLD);
+    posix_spawnattr_setsigdefault(&attr, &mask);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    if (INTERACTIVE && pgid != -1) {
+        posix_spawnattr_setpgroup(&attr, pgid);
+        flags |= POSIX_SPAWN_SETPGROUP;
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    // posix_spawn uses vfork semantics, page tables of the shell are not copied
+    fflush(stdout);
+    pid_t pid;
+    TRACE_BEGIN("posix_spawn", path);
+    int error = posix_spawn(&pid, path, &actions, &attr, (char *const *)argv, var_environ());
+    TRACE_END("posix_spawn");
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    // execvp runs files without shebang with /bin/sh, posix_spawn does not, fork only in this case
+    if (error == ENOEXEC) {
+        TRACE_BEGIN("fork", path);
+        pid = fork();
+        if (pid != 0) TRACE_END("fork");
+        if (pid > 0) stats_add(STAT_FORKS, 1);
+        if (pid == 0) {
+            jobs_child_setup(pgid);
+
+            if (fd_in != -1)  dup2(fd_in, STDIN_FILENO);
+            if (fd_out != -1) dup2(fd_out, STDOUT_FILENO);
+            if (redirect_apply(redirects, NULL) == -1) exit(1);
+
+            var_environ();
+            execvp(path, (char **)argv);
+            sink_perror("execvp");
+            exit(126);
         }
-        val[len++] = *ptr++;
+        error = pid == -1 ? errno : 0;
+        if (pid > 0 && INTERACTIVE && pgid != -1) setpgid(pid, pgid ? pgid : pid);
     }
-    val[len] = '\0';
 
-    // Set the environment variable
-    setenv(var, val, 1);
+    if (error) {
+        errno = error;
+        sink_perror(argv[0]);
+        errno = error;
+        return -1;
+    }
 
-    // free memory
-    free(val);
+    stats_add(STAT_EXECS, 1);
+    return pid;
+}
 
-    return 1;
+
+/**
+ * @see spawn_process, jobs_wait_foreground
+ */
+int spawn_command(const char **const argv, const fd_actions_t *const redirects, const int fd_in, const int fd_out) {
+    const pid_t pid = spawn_process(argv, redirects, fd_in, fd_out, 0);
+    if (pid == -1) return errno == ENOENT ? 127 : 126;
+
+    // The command is its own job, it gets the terminal and can be stopped
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+    char **stage_argv = (char **)argv;
+    int code = 1;
+    jobs_wait_foreground(pid, &pid, &code, 1, 1, &argc, &stage_argv, NULL);
+    return code;
 }
 
 
 /**
- * @see strcmp, sizeof, malloc, dup, open, clone_memfd, dup2, close, ftruncate, lseek, setting_envvar, free, printf, fflush, exit, our_*, fork, execvp, perror, wait
+ * @see builtin_lookup, is_envvar_definition, redirect_targets, clone_memfd, ftruncate, lseek, spawn_command, close, fork, jobs_child_setup, setpgid, jobs_wait_foreground, arena_alloc, fflush, redirect_apply, setting_envvar, var_environ, trace_flush, execvp, sink_perror, exit, redirect_restore, redirect_close, printf
  */
-int call_command(int argc, char **argv, int *const use_pipe, const int pipe_used, const int is_piped) {
-    int end = 0;
-    const char *input_file = NULL;
-    const char *output_file = NULL;
+int call_command(int argc, char **argv, const fd_actions_t *const redirects, int *const use_pipe, const int pipe_used, const int is_piped) {
+    // Spawn external commands directly with their redirections
+    TRACE_BEGIN("call_command", argc > 0 ? argv[0] : NULL);
+    const builtin_entry_t *const builtin = argc > 0 ? builtin_lookup(argv[0]) : NULL;
+    if (argc > 0 && !IS_STAGE_CHILD && !builtin && !is_envvar_definition(argv[0])) {
+        // stdin in this order (if possible) redirection > pipe_used > stdin
+        const int fd_in = *use_pipe && !redirect_targets(redirects, STDIN_FILENO) ? clone_memfd(pipe_used) : -1;
+
+        // Reset pipe_used to 0 for next command, only if something was or will be written inside
+        if (*use_pipe || is_piped) {
+            ftruncate(pipe_used, 0);
+            lseek(pipe_used, 0, SEEK_SET);
+        }
+        *use_pipe = is_piped;
 
-    // Go to first redirection in the command
-    // redirections are always at the end of the command
-    while ((end < argc) && (strcmp(argv[end], "<") != 0) && (strcmp(argv[end], ">") != 0)) end++;
+        // stdout in this order (if possible) redirection > pipe_used > stdout
+        const int return_code = spawn_command((const char **)argv, redirects, fd_in, is_piped ? pipe_used : -1);
 
-    // Get input and output files path/name
-    // stdin redirection is always before stdout redirection
-    for (int i = end; i < argc - 1; i++) {
-        if (strcmp(argv[i], "<") == 0) input_file = argv[++i];
-        else if (strcmp(argv[i], ">") == 0) output_file = argv[++i];
+        if (fd_in != -1) close(fd_in);
+
+        // Go back to the start of the pipe
+        if (is_piped) lseek(pipe_used, 0, SEEK_SET);
+
+        TRACE_END("call_command");
+        return return_code;
     }
 
-    // Copy the command from argv to end it at right position
-    int cmd_argc = end;
-    const char **cmd_argv = malloc((cmd_argc + 1) * sizeof(char *));
-    for (int i = 0; i < cmd_argc; i++) cmd_argv[i] = argv[i];
-    cmd_argv[cmd_argc] = NULL;
+    // Builtins which must not run on the shell itself run inside a copy of it, like a pipeline stage
+    if (builtin && (builtin->flags & BUILTIN_NEEDS_FORK) && !IS_STAGE_CHILD) {
+        fflush(stdout);
+        TRACE_BEGIN("fork", argv[0]);
+        pid_t pid = fork();
+        if (pid != 0) TRACE_END("fork");
+        if (pid > 0) stats_add(STAT_FORKS, 1);
+        if (pid == 0) {
+            jobs_child_setup(0);
+            IS_STAGE_CHILD = 1;
+            INTERACTIVE = 0;
+            exit(call_command(argc, argv, redirects, use_pipe, pipe_used, is_piped));
+        }
+
+        // The copy filled pipe_used and moved back to its start, the file is shared
+        int return_code = 1;
+        if (pid == -1) sink_perror("fork");
+        else {
+            if (INTERACTIVE) setpgid(pid, pid);
+            jobs_wait_foreground(pid, &pid, &return_code, 1, 1, &argc, &argv, NULL);
+        }
+        *use_pipe = is_piped;
+
+        TRACE_END("call_command");
+        return return_code;
+    }
 
-    // Redirect stdin in this order (if possible) input_file > pipe_used > saved_stdin
-    const int saved_stdin = dup(STDIN_FILENO);
-    int fd_in = saved_stdin;
-    if (input_file != NULL) fd_in = open(input_file, O_RDONLY);
-    else if (use_pipe)      fd_in = clone_memfd(pipe_used);
-    dup2(fd_in, STDIN_FILENO);
-    close(fd_in);
+    // Plug stdin on the previous output, only cloned for builtins reading their stdin, and stdout on pipe_used
+    // the redirections of the command are applied after, they win over the pipe
+    fd_action_t pipe_actions[2];
+    fd_actions_t pipes = { pipe_actions, 0 };
+    int fd_in;
+    if (*use_pipe && (!builtin || (builtin->flags & BUILTIN_READS_STDIN)) && !redirect_targets(redirects, STDIN_FILENO)
+        && (fd_in = clone_memfd(pipe_used)) != -1) {
+        pipe_actions[pipes.count++] = (fd_action_t){ FD_ACTION_DUP, STDIN_FILENO, NULL, 0, fd_in, 1, 1 };
+    }
 
     // Reset pipe_used to 0 for next command
+    if (*use_pipe || is_piped) {
+        ftruncate(pipe_used, 0);
+        lseek(pipe_used, 0, SEEK_SET);
+    }
     *use_pipe = is_piped;
-    ftruncate(pipe_used, 0);
-    lseek(pipe_used, 0, SEEK_SET);
-
-    // Redirect stdout in this order (if possible) output_file > pipe_used > saved_stdin
-    const int saved_stdout = dup(STDOUT_FILENO);
-    int fd_out = saved_stdout;
-    if (output_file != NULL) fd_out = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    else if (is_piped)       fd_out = pipe_used;
-    dup2(fd_out, STDOUT_FILENO);
-    if (fd_out != pipe_used) close(fd_out);
+    if (is_piped) pipe_actions[pipes.count++] = (fd_action_t){ FD_ACTION_DUP, STDOUT_FILENO, NULL, 0, pipe_used, 0, 1 };
+
+    // Only the file descriptors touched are saved and restored, a plain builtin costs no system call
+    const int redirected = pipes.count > 0 || redirects->count > 0;
+    int pipes_saved[2];
+    int *saved = NULL;
+    int ready = 1;
+    if (redirected) {
+        fflush(stdout);
+        ready = redirect_apply(&pipes, pipes_saved) == 0;
+        if (ready && redirects->count > 0) {
+            saved = arena_alloc(&LINE_ARENA, redirects->count * sizeof(int));
+            ready = saved && redirect_apply(redirects, saved) == 0;
+        }
+    }
 
     int return_code = 0;
 
-    if (setting_envvar(cmd_argv[0]));
-    else if (strcmp(cmd_argv[0], "exit") == 0) {
-        // free memory
-        free(cmd_argv);
-        // Reset stdin and stdout
-        dup2(saved_stdout, STDOUT_FILENO);
-        close(saved_stdout);
-        dup2(saved_stdin, STDIN_FILENO);
-        close(saved_stdin);
-        // Close CShell
-        printf("\nBye Bye \033[32m%s\033[0m!\n\n", USER);
-        fflush(stdout);
-        exit(0);
-    }
-    else if (strcmp(cmd_argv[0], "history") == 0) {
-        int count = 0;
-        while (count < HISTORY_SIZE && HISTORY[count][0]) count++;
-        for (int i = count - 1; i > -1; i--) printf("%d: %s\n", count - i, HISTORY[i]);
-        if (count == 0) printf("No history available.\n");
-    }
-    else if (strcmp(cmd_argv[0], "cat") == 0)   return_code = our_cat(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "cd") == 0)    return_code = our_cd(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "chmod") == 0) return_code = our_chmod(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "chown") == 0) return_code = our_chown(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "cp") == 0)    return_code = our_cp(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "ls") == 0)    return_code = our_ls(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "mkdir") == 0) return_code = our_mkdir(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "mv") == 0)    return_code = our_mv(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "rm") == 0)    return_code = our_rm(cmd_argc, cmd_argv);
-    else if (strcmp(cmd_argv[0], "touch") == 0) return_code = our_touch(cmd_argc, cmd_argv);
+    if (!ready) return_code = 1;
+    else if (argc == 0);
+    else if (builtin) {
+        stats_add(STAT_BUILTIN_CALLS, 1);
+        return_code = builtin->function(argc, (const char *const *)argv);
+    }
+    else if (setting_envvar(argv[0]));
     else {
-        pid_t pid = fork();
-        if (pid == 0) {
-            execvp(cmd_argv[0], (char **)cmd_argv);
-            // execvp exit if it succeeds, if we are here, it failed
-            perror("execvp");
-            exit(1);
-        }
-        else if (pid > 0) wait(&return_code);
+        // Already inside a forked pipeline stage, no need to fork again
+        fflush(stdout);
+        var_environ();
+        // Events of this copy are lost once replaced by the command
+        trace_flush();
+        execvp(argv[0], argv);
+        sink_perror("execvp");
+        exit(127);
+    }
+
+    // Reset the file descriptors, a redirection may have replaced pipe_used meanwhile
+    if (redirected) {
+        fflush(stdout);
+        redirect_restore(redirects, saved);
+        redirect_restore(&pipes, pipes_saved);
+        redirect_close(&pipes);
     }
 
-    // free memory
-    free(cmd_argv);
-    
     // Go back to the start of the pipe
-    lseek(pipe_used, 0, SEEK_SET);
-    
-    // Reset stdin and stdout
-    fflush(stdout);
-    dup2(saved_stdout, STDOUT_FILENO);
-    close(saved_stdout);
-    dup2(saved_stdin, STDIN_FILENO);
-    close(saved_stdin);
+    if (is_piped) lseek(pipe_used, 0, SEEK_SET);
+    TRACE_END("call_command");
+
+    // Close CShell if exit was called, an embedding program only stops running the line
+    if (SHELL_EXIT && !EMBEDDED) {
+        if (INTERACTIVE) printf("\nBye Bye \033[32m%s\033[0m!\n\n", USER);
+        fflush(stdout);
+        exit(return_code);
+    }
 
     return return_code;
 }
 
 
 /**
- * @see memfd_create, strcmp, call_command, fork, getpid, printf, fflush, exit, close
+ * @see jobs_running_count, jobs_wait_any, get_fusable_builtin, arena_alloc, memset, ring_create, pipe2, redirect_shell_fd, fcntl, is_builtin, spawn_process, fflush, fork, jobs_child_setup, setpgid, dup2, close, memfd_create, execute_node, call_command, exit, jobs_add, jobs_command_string, sink_printf, pthread_create, run_fused_stage, jobs_wait_foreground, pthread_join, ring_destroy, printf
  */
-int parse_commands(int argc, char **argv) {
-    int start = 0, end = 0;
-    int return_code = 0;
+int run_pipeline(const int count, int *const argcs, char ***const argvs, const fd_actions_t *const redirects, node_t *const *const stages, const int background, timing_t *const timing) {
+    pid_t pids[MAX_PIPELINE_STAGES];
+    pthread_t threads[MAX_PIPELINE_STAGES];
+    int started[MAX_PIPELINE_STAGES] = { 0 };
+    int spawn_errors[MAX_PIPELINE_STAGES];
     int use_pipe = 0;
-    const int pipe_used = memfd_create("pipe_used", 0);
+    for (int i = 0; i < count; i++) {
+        pids[i] = -1;
+        spawn_errors[i] = 1;
+    }
 
-    pid_t pid;
-    pid_t cpid;
-    while (end < argc) {
-        // Run parsed command and wait for it to finish
-        if (strcmp(argv[end], ";") == 0)      return_code = call_command(end - start, &argv[start], &use_pipe, pipe_used, 0);
+    // Do not start more background jobs than allowed, wait for one to finish instead
+    while (background && MAX_JOBS > 0 && jobs_running_count() >= MAX_JOBS && jobs_wait_any() == 0);
+
+    // Builtins next to each other are fused, they run on threads and exchange data through ring buffers
+    // A background job must not keep threads in the shell, its stages are always processes
+    builtin_t builtins[MAX_PIPELINE_STAGES] = { NULL };
+    fused_stage_t *fused[MAX_PIPELINE_STAGES] = { NULL };
+    int has_fused = 0;
+    if (PIPE_FUSION && !background) for (int i = 0; i < count; i++) if (stages[i]->type == NODE_COMMAND) builtins[i] = get_fusable_builtin(argcs[i], argvs[i], &redirects[i]);
+    for (int i = 0; i < count; i++) {
+        if (!builtins[i] || !((i > 0 && builtins[i - 1]) || (i < count - 1 && builtins[i + 1]))) continue;
+        fused[i] = arena_alloc(&LINE_ARENA, sizeof(fused_stage_t));
+        if (!fused[i]) continue;
+        memset(fused[i], 0, sizeof(fused_stage_t));
+        has_fused = 1;
+    }
+
+    // Processes of the pipeline share a process group, led by the first one (0 until it exists)
+    // With fused stages, part of the pipeline runs inside the shell, so processes stay in the group of the shell
+    pid_t pgid = has_fused ? -1 : 0;
+
+    // File descriptors kept open by the shell for fused stages, processes must not inherit them
+    int thread_fds[2 * MAX_PIPELINE_STAGES];
+    int thread_fds_count = 0;
+
+    int prev_read = -1;
+    ring_t *prev_ring = NULL;
+    ring_t *out_ring;
+    int fds[2];
+
+    for (int i = 0; i < count; i++) {
+        // Connect this stage to the next one (except for the last stage)
+        // with a ring buffer if both are fused, with a kernel pipe otherwise
+        fds[0] = fds[1] = -1;
+        out_ring = NULL;
+        // Without memory for the ring, the two fused stages exchange data through a kernel pipe, as with --no-fusion
+        if (i < count - 1 && fused[i] && fused[i + 1]) out_ring = ring_create();
+        if (i < count - 1 && !out_ring) {
+            if (pipe2(fds, O_CLOEXEC) == -1 || (fds[0] = redirect_shell_fd(fds[0])) == -1 || (fds[1] = redirect_shell_fd(fds[1])) == -1) {
+                sink_perror("pipe");
+                pids[i] = -1;
+                break;
+            }
+            if (PIPE_SIZE > 0 && fcntl(fds[1], F_SETPIPE_SZ, PIPE_SIZE) == -1 && DEBUG) sink_perror("F_SETPIPE_SZ");
+        }
+
+        // Prepare the fused stage, its thread is started once every process is forked
+        if (fused[i]) {
+            fused[i]->argc = argcs[i];
+            fused[i]->argv = argvs[i];
+            fused[i]->redirects = &redirects[i];
+            fused[i]->builtin = builtins[i];
+            fused[i]->in_ring = prev_ring;
+            fused[i]->in_fd = prev_read;
+            fused[i]->out_ring = out_ring;
+            fused[i]->out_fd = fds[1];
+            fused[i]->timing = timing ? &timing->stages[i] : NULL;
+            if (prev_read != -1) thread_fds[thread_fds_count++] = prev_read;
+            if (fds[1] != -1)    thread_fds[thread_fds_count++] = fds[1];
+            pids[i] = 0;
+        }
+        // Spawn external commands directly, plugged on previous and next stages
+        else if (stages[i]->type == NODE_COMMAND && argcs[i] > 0 && !is_builtin(argvs[i][0])) {
+            pids[i] = spawn_process((const char **)argvs[i], &redirects[i], prev_read, fds[1], pgid);
+            if (pids[i] == -1) spawn_errors[i] = errno == ENOENT ? 127 : 126;
+            else if (pgid == 0) pgid = pids[i];
+
+            if (prev_read != -1) close(prev_read);
+            if (fds[1] != -1) close(fds[1]);
+        }
+        else {
+            // Do not duplicate buffered output inside children
+            fflush(stdout);
+
+            TRACE_BEGIN("fork", stages[i]->type == NODE_COMMAND && argcs[i] > 0 ? argvs[i][0] : NULL);
+            pids[i] = fork();
+            if (pids[i] != 0) TRACE_END("fork");
+            if (pids[i] > 0) stats_add(STAT_FORKS, 1);
+            if (pids[i] == 0) {
+                IS_STAGE_CHILD = stages[i]->type == NODE_COMMAND;
+                jobs_child_setup(pgid);
+
+                for (int j = 0; j < thread_fds_count; j++) close(thread_fds[j]);
+
+                // Plug stdin on previous stage and stdout on next stage
+                if (prev_read != -1) {
+                    dup2(prev_read, STDIN_FILENO);
+                    close(prev_read);
+                }
+                if (fds[1] != -1) {
+                    dup2(fds[1], STDOUT_FILENO);
+                    close(fds[1]);
+                    close(fds[0]);
+                }
+
+                // Compound commands run inside this copy of the shell, their commands stay in the group of the pipeline
+                if (stages[i]->type != NODE_COMMAND) {
+                    INTERACTIVE = 0;
+                    exit(execute_node(stages[i], &use_pipe, memfd_create("pipe_used", MFD_CLOEXEC)));
+                }
+
+                exit(call_command(argcs[i], argvs[i], &redirects[i], &use_pipe, -1, 0));
+            }
+            if (pids[i] == -1) sink_perror("fork");
+            else {
+                // Set the group from both sides, whichever runs first
+                if (INTERACTIVE && pgid != -1) setpgid(pids[i], pgid ? pgid : pids[i]);
+                if (pgid == 0) pgid = pids[i];
+            }
+
+            // The parent keeps only the read end for the next stage
+            if (prev_read != -1) close(prev_read);
+            if (fds[1] != -1) close(fds[1]);
+        }
+
+        prev_read = fds[0];
+        prev_ring = out_ring;
+    }
+    if (prev_read != -1) close(prev_read);
+
+    // A background pipeline becomes a job, the shell does not wait for it
+    if (background) {
+        pid_t job_pids[MAX_PIPELINE_STAGES];
+        int job_count = 0;
+        for (int i = 0; i < count; i++) if (pids[i] > 0) job_pids[job_count++] = pids[i];
+        if (job_count == 0) return spawn_errors[count - 1];
+
+        const int id = jobs_add(pgid, job_pids, job_count, jobs_command_string(count, argcs, argvs), JOB_RUNNING);
+        if (id != -1) sink_printf("[%d] %d\n", id, job_pids[job_count - 1]);
+        return 0;
+    }
+
+    // Start fused stages now that no more process will be forked
+    fflush(stdout);
+    for (int i = 0; i < count; i++) {
+        if (!fused[i] || !fused[i]->builtin) continue;
+        started[i] = pthread_create(&threads[i], NULL, run_fused_stage, fused[i]) == 0;
+        if (started[i]) stats_add(STAT_THREADS, 1);
+        else sink_perror("pthread_create");
+    }
+
+    // Wait for every process, they all run at the same time
+    // The pipeline gets the terminal and can be stopped, unless some stages are threads of the shell
+    PIPE_STATUS_COUNT = count;
+    for (int i = 0; i < count; i++) {
+        PIPE_STATUS[i] = spawn_errors[i];
+        if (fused[i]) pids[i] = -1;
+    }
+    jobs_wait_foreground(pgid, pids, PIPE_STATUS, count, count, has_fused ? NULL : argcs, argvs, timing ? timing->stages : NULL);
 
-        // Run parsed command, capture its output inside our pipe and wait for it to finish
-        else if (strcmp(argv[end], "|") == 0) return_code = call_command(end - start, &argv[start], &use_pipe, pipe_used, 1);
+    // Wait for fused stages
+    for (int i = 0; i < count; i++) {
+        if (!fused[i] || !started[i]) continue;
+        pthread_join(threads[i], NULL);
+        PIPE_STATUS[i] = fused[i]->return_code;
+    }
+
+    // Free ring buffers of fused stages
+    for (int i = 0; i < count; i++) if (fused[i]) ring_destroy(fused[i]->out_ring);
+
+    if (DEBUG) {
+        printf("Pipeline stages return codes:");
+        for (int i = 0; i < count; i++) printf(" %d", PIPE_STATUS[i]);
+        printf("\n");
+    }
 
-        // Run parsed command and do not wait for it to finish
-        else if (strcmp(argv[end], "&") == 0) {
-            pid = fork();
+    return PIPE_STATUS[count - 1];
+}
+
+
+/**
+ * @see arena_realloc, memcpy
+ */
+int append_string(char **const buffer, int *const length, int *const capacity, const char *const str, const int size) {
+    // Reallocate memory if needed, in place while nothing else was allocated after the string
+    if (*length + size >= *capacity) {
+        int new_capacity = *capacity;
+        while (*length + size >= new_capacity) new_capacity *= 2;
+        char *const bigger = arena_realloc(&LINE_ARENA, *buffer, *capacity, new_capacity);
+        if (!bigger) return -1;
+        *buffer = bigger;
+        *capacity = new_capacity;
+    }
 
-            if (pid == 0) {
-                cpid = getpid();
+    memcpy(&(*buffer)[*length], str, size);
+    *length += size;
+    (*buffer)[*length] = '\0';
+    return 0;
+}
 
-                printf("[bg]    Process %d\n", cpid);
-                fflush(stdout);
-                return_code = call_command(end - start, &argv[start], &use_pipe, pipe_used, 0);
-                printf("[bg]    Done %d\n", cpid);
-                fflush(stdout);
 
-                exit(0);
+/**
+ * @see redirect_shell_fd, memfd_create, dup, dup2, close, execute_line, fflush, load_memfd_to_string, append_string, unload_memfd_string
+ */
+int substitute_command(const char *const command, char **const buffer, int *const length, int *const capacity) {
+    // Capture the output of the command inside an in-memory file
+    // Inside another program only the stdout of the shell is replaced, the one of the process is not ours
+    const int sub_pipe_used = redirect_shell_fd(memfd_create("sub_pipe_used", MFD_CLOEXEC));
+    if (sub_pipe_used == -1) return -1;
+    fflush(stdout);
+    const int saved_stdout = EMBEDDED ? SHELL_FDS[STDOUT_FILENO] : dup(STDOUT_FILENO);
+    if (EMBEDDED) SHELL_FDS[STDOUT_FILENO] = sub_pipe_used;
+    else {
+        dup2(sub_pipe_used, STDOUT_FILENO);
+        close(sub_pipe_used);
+    }
+
+    // The command is compiled once, then taken from the cache
+    execute_line(command);
+    fflush(stdout);
+
+    // Get output from the in-memory file, without trailing new lines
+    size_t size;
+    char *const result = load_memfd_to_string(EMBEDDED ? sub_pipe_used : STDOUT_FILENO, &size);
+    int error = 0;
+    if (result) {
+        while (size > 0 && result[size - 1] == '\n') size--;
+        error = append_string(buffer, length, capacity, result, size);
+        unload_memfd_string(result, size);
+    }
+
+    // Reset stdout to the original value
+    if (EMBEDDED) {
+        SHELL_FDS[STDOUT_FILENO] = saved_stdout;
+        close(sub_pipe_used);
+    }
+    else {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+
+    return error;
+}
+
+
+/**
+ * @see sink_error, pipe2, redirect_shell_fd, sink_perror, fflush, fork, jobs_child_setup, close, dup2, execute_line, exit, fcntl, snprintf, append_string
+ */
+int substitute_process(const char *const command, const int is_input, char **const buffer, int *const length, int *const capacity) {
+    if (SUBSTITUTION_COUNT == MAX_PROCESS_SUBSTITUTIONS) {
+        sink_error("Too many process substitutions, at most %d\n", MAX_PROCESS_SUBSTITUTIONS);
+        return -1;
+    }
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1 || (fds[0] = redirect_shell_fd(fds[0])) == -1 || (fds[1] = redirect_shell_fd(fds[1])) == -1) {
+        sink_perror("pipe");
+        return -1;
+    }
+    // The command writes into the pipe for <(...), reads from it for >(...)
+    const int child_end = is_input ? fds[1] : fds[0];
+    const int shell_end = is_input ? fds[0] : fds[1];
+
+    // The command runs inside a copy of the shell, at the same time as the command using it
+    fflush(stdout);
+    TRACE_BEGIN("fork", NULL);
+    const pid_t pid = fork();
+    if (pid != 0) TRACE_END("fork");
+    if (pid > 0) stats_add(STAT_FORKS, 1);
+    if (pid == 0) {
+        jobs_child_setup(-1);
+        INTERACTIVE = 0;
+        // Ends of other substitutions would keep their pipes open
+        for (int i = 0; i < SUBSTITUTION_COUNT; i++) close(SUBSTITUTION_FDS[i]);
+        SUBSTITUTION_COUNT = 0;
+        close(shell_end);
+        dup2(child_end, is_input ? STDOUT_FILENO : STDIN_FILENO);
+        close(child_end);
+        exit(execute_line(command));
+    }
+    close(child_end);
+    if (pid == -1) {
+        sink_perror("fork");
+        close(shell_end);
+        return -1;
+    }
+
+    // Commands get the end of the shell by inheritance, it is closed once they started
+    fcntl(shell_end, F_SETFD, 0);
+    SUBSTITUTION_PIDS[SUBSTITUTION_COUNT] = pid;
+    SUBSTITUTION_FDS[SUBSTITUTION_COUNT++] = shell_end;
+
+    char path[32];
+    const int path_length = snprintf(path, sizeof(path), "/dev/fd/%d", shell_end);
+    return append_string(buffer, length, capacity, path, path_length);
+}
+
+
+/**
+ * @see close, waitpid, jobs_reap
+ */
+void close_substitutions(const int count) {
+    while (SUBSTITUTION_COUNT > count) {
+        close(SUBSTITUTION_FDS[--SUBSTITUTION_COUNT]);
+        // Inside another program, only known children are reaped, their pipe is closed so they end
+        if (EMBEDDED) waitpid(SUBSTITUTION_PIDS[SUBSTITUTION_COUNT], NULL, 0);
+    }
+    // Their commands are children of the shell, reaped with jobs
+    jobs_reap();
+}
+
+
+/**
+ * @see lex_skip_substitution
+ */
+int is_arithmetic(const char *const ptr) {
+    // $(( starts an expression only if it ends with )), otherwise it is a command starting with a subshell
+    const char *const end = lex_skip_substitution(ptr);
+    return end - ptr >= 5 && end[-1] == ')' && end[-2] == ')';
+}
+
+
+/**
+ * @see arena_strndup, strchr, expand_word, arith_evaluate, snprintf, append_string
+ */
+int expand_arithmetic(const char *const expression, const int size, char **const buffer, int *const length, int *const capacity) {
+    // $NAME and $(...) inside the expression are expanded first, plain names are read by the expression itself
+    const char *text = arena_strndup(&LINE_ARENA, expression, size);
+    if (text && strchr(text, '$')) text = expand_word(text);
+    if (!text) return -1;
+
+    long long value;
+    if (arith_evaluate(text, &value) == -1) return -1;
+
+    char number[32];
+    const int number_length = snprintf(number, sizeof(number), "%lld", value);
+    return append_string(buffer, length, capacity, number, number_length);
+}
+
+
+/**
+ * @see arena_realloc, arena_strndup
+ */
+int push_field(char ***const fields, int *const count, int *const capacity, const char *const field, const int size) {
+    // Keep room for the final NULL
+    if (*count + 1 >= *capacity) {
+        char **const bigger = arena_realloc(&LINE_ARENA, *fields, *capacity * sizeof(char *), 2 * *capacity * sizeof(char *));
+        if (!bigger) return -1;
+        *fields = bigger;
+        *capacity *= 2;
+    }
+
+    if (!((*fields)[*count] = arena_strndup(&LINE_ARENA, field, size))) return -1;
+    (*fields)[++(*count)] = NULL;
+    return 0;
+}
+
+
+/**
+ * @see strchr, append_string
+ */
+int append_escaped(char **const buffer, int *const length, int *const capacity, const char *const str, const int size) {
+    // Characters of patterns get a backslash before them, to be matched as is
+    int error = 0, start = 0;
+    for (int i = 0; i < size; i++) {
+        if (!str[i] || !strchr(GLOB_SPECIAL_CHARACTERS, str[i])) continue;
+        error |= append_string(buffer, length, capacity, &str[start], i - start);
+        error |= append_string(buffer, length, capacity, "\\", 1);
+        start = i;
+    }
+    return error | append_string(buffer, length, capacity, &str[start], size - start);
+}
+
+
+/**
+ * @see push_field
+ */
+int push_glob_match(const char *const path, const size_t length, void *const data) {
+    field_list_t *const list = data;
+    return push_field(list->fields, list->count, list->capacity, path, length);
+}
+
+
+/**
+ * @see glob_has_magic, glob_expand, push_glob_match, push_field, glob_unescape
+ */
+int push_pattern(char ***const fields, int *const count, int *const capacity, const char *const pattern, const int size) {
+    // A pattern gives the paths matching it, or stays as is if none match
+    if (glob_has_magic(pattern)) {
+        field_list_t list = { fields, count, capacity };
+        const int matches = glob_expand(pattern, push_glob_match, &list);
+        if (matches != 0) return matches == -1 ? -1 : 0;
+    }
+
+    if (push_field(fields, count, capacity, pattern, size) == -1) return -1;
+    glob_unescape((*fields)[*count - 1]);
+    return 0;
+}
+
+
+/**
+ * @see append_string, isspace, push_pattern
+ */
+int append_expansion(char **const buffer, int *const length, int *const capacity, int *const has_field, const char *const value, const int size, char ***const fields, int *const count, int *const fields_capacity) {
+    // Inside quotes or without splitting, the value stays a single piece of the word
+    if (!fields) return append_string(buffer, length, capacity, value, size);
+
+    // Spaces of an unquoted expansion separate fields, runs of spaces never give empty fields
+    // Wildcards of the value stay active, only its backslashes are escaped
+    int error = 0;
+    for (int i = 0; i < size && !error; i++) {
+        if (value[i] == '\\') error |= append_string(buffer, length, capacity, "\\\\", 2);
+        else if (!isspace((unsigned char)value[i])) error |= append_string(buffer, length, capacity, &value[i], 1);
+        else if (*length > 0 || *has_field) {
+            error |= push_pattern(fields, count, fields_capacity, *buffer, *length);
+            *length = 0;
+            (*buffer)[0] = '\0';
+            *has_field = 0;
+        }
+    }
+    return error;
+}
+
+
+/**
+ * @see strcmp, snprintf
+ */
+const char *get_special_variable(const char *const name, char *const value) {
+    if (strcmp(name, "?") == 0) {
+        snprintf(value, SPECIAL_VARIABLE_LENGTH, "%d", LAST_RETURN_CODE);
+        return value;
+    }
+
+    if (strcmp(name, "PIPE_STATUS") == 0) {
+        int length = 0;
+        value[0] = '\0';
+        for (int i = 0; i < PIPE_STATUS_COUNT; i++) length += snprintf(value + length, SPECIAL_VARIABLE_LENGTH - length, i ? " %d" : "%d", PIPE_STATUS[i]);
+        return value;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @see arena_alloc, strchr, append_string, append_escaped, is_arithmetic, lex_skip_substitution, expand_arithmetic, arena_strndup, substitute_command, substitute_process, append_expansion, isalnum, get_special_variable, var_get, strlen, push_pattern, push_field
+ */
+int expand_fields(const char *const word, const expand_mode_t mode, char ***const fields, int *const count, int *const fields_capacity) {
+    const int split = (mode == EXPAND_FIELDS);
+    int length = 0, capacity = 16;
+    char *buffer = arena_alloc(&LINE_ARENA, capacity);
+    if (!buffer) return -1;
+    buffer[0] = '\0';
+
+    const char *ptr = word;
+    // Current quote, '\0' outside of quotes, a here-document is inside double quotes which never close
+    char quote = mode == EXPAND_HEREDOC ? '\"' : '\0';
+    // Set by quotes, "" gives an empty field instead of none
+    int has_field = !split;
+    char varname[MAX_ENV_NAME_LENGTH];
+    char special[SPECIAL_VARIABLE_LENGTH];
+    int error = 0;
+    while (*ptr && !error) {
+        // Only unquoted expansions are split into fields
+        char ***const split_fields = split && quote == '\0' ? fields : NULL;
+        // Split fields are patterns, quoted and escaped characters are escaped to be matched as is
+        int (*const append_quoted)(char **const, int *const, int *const, const char *const, const int) = split ? append_escaped : append_string;
+
+        // Escaped character, inside double quotes only some characters can be escaped
+        if (*ptr == '\\' && quote != '\'') {
+            ptr++;
+            if (!(*ptr)) break;
+            // An escaped new line of a here-document joins its lines
+            if (mode == EXPAND_HEREDOC && *ptr == '\n') {
+                ptr++;
+                continue;
             }
+            if (quote == '\"' && !strchr(mode == EXPAND_HEREDOC ? "$`\\" : "$`\"\\\n", *ptr)) error |= append_quoted(&buffer, &length, &capacity, "\\", 1);
+            error |= append_quoted(&buffer, &length, &capacity, ptr++, 1);
+        }
+
+        // Open or close quotes
+        else if ((*ptr == '\'' || *ptr == '\"') && (quote == '\0' || quote == *ptr) && mode != EXPAND_HEREDOC) {
+            quote = quote ? '\0' : *ptr;
+            has_field = 1;
+            ptr++;
         }
 
-        // Run parsed command, wait for it to finish and if it failed, skip next command
-        else if (strcmp(argv[end], "&&") == 0) {
-            return_code = call_command(end - start, &argv[start], &use_pipe, pipe_used, 0);
+        // Replace $((...)) with the value of the expression, computed inside the shell
+        else if (*ptr == '$' && quote != '\'' && ptr[1] == '(' && ptr[2] == '(' && is_arithmetic(ptr)) {
+            const char *const end = lex_skip_substitution(ptr);
+            error |= expand_arithmetic(ptr + 3, end - ptr - 5, &buffer, &length, &capacity);
+            ptr = end;
+        }
 
-            if (return_code != 0) {
-                while (end < argc) {
-                    if (strcmp(argv[end], ";") == 0 || strcmp(argv[end], "&") == 0 || strcmp(argv[end], "||") == 0 || strcmp(argv[end], "|") == 0) break;
-                    end++;
-                }
+        // Replace $(...) with the output of the command
+        else if (*ptr == '$' && quote != '\'' && ptr[1] == '(') {
+            const char *const end = lex_skip_substitution(ptr);
+            const char *const command = arena_strndup(&LINE_ARENA, ptr + 2, end - ptr - 2 - (end[-1] == ')'));
+            if (!split) error |= !command || substitute_command(command, &buffer, &length, &capacity);
+            else {
+                // Capture the output aside, to split it or escape it
+                int output_length = 0, output_capacity = 16;
+                char *output = arena_alloc(&LINE_ARENA, output_capacity);
+                error |= !command || !output || substitute_command(command, &output, &output_length, &output_capacity);
+                if (!error && split_fields) error |= append_expansion(&buffer, &length, &capacity, &has_field, output, output_length, split_fields, count, fields_capacity);
+                else if (!error) error |= append_escaped(&buffer, &length, &capacity, output, output_length);
             }
+            ptr = end;
         }
 
-        // Run parsed command, wait for it to finish and if it succeeded, skip next command
-        else if (strcmp(argv[end], "||") == 0) {
-            return_code = call_command(end - start, &argv[start], &use_pipe, pipe_used, 0);
+        // Replace <(...) and >(...) with the path of a pipe to a command running at the same time
+        else if ((*ptr == '<' || *ptr == '>') && ptr[1] == '(' && quote == '\0') {
+            const char *const end = lex_skip_substitution(ptr);
+            const char *const command = arena_strndup(&LINE_ARENA, ptr + 2, end - ptr - 2 - (end[-1] == ')'));
+            error |= !command || substitute_process(command, *ptr == '<', &buffer, &length, &capacity);
+            ptr = end;
+        }
 
-            if (return_code == 0) {
-                while (end < argc) {
-                    if (strcmp(argv[end], ";") == 0 || strcmp(argv[end], "&&") == 0 || strcmp(argv[end], "&") == 0 || strcmp(argv[end], "|") == 0) break;
-                    end++;
-                }
+        // Replace $NAME or ${NAME} with the value of the shell variable, $? with the return code of the last command
+        else if (*ptr == '$' && quote != '\'' && (ptr[1] == '{' || isalnum((unsigned char)ptr[1]) || ptr[1] == '_' || ptr[1] == '?')) {
+            ptr++;
+            const int bracket = (*ptr == '{');
+            if (bracket) ptr++;
+
+            int i = 0;
+            if (*ptr == '?') varname[i++] = *ptr++;
+            else while (*ptr && (i < MAX_ENV_NAME_LENGTH - 1) && (isalnum((unsigned char)*ptr) || *ptr == '_')) varname[i++] = *ptr++;
+            varname[i] = '\0';
+            if (bracket) while (*ptr && *ptr++ != '}');
+
+            const char *value = get_special_variable(varname, special);
+            if (!value) value = var_get(varname);
+            if (value && split_fields) error |= append_expansion(&buffer, &length, &capacity, &has_field, value, strlen(value), split_fields, count, fields_capacity);
+            else if (value) error |= append_quoted(&buffer, &length, &capacity, value, strlen(value));
+        }
+
+        // Continue to copy characters, wildcards stay active outside of quotes
+        else if (quote != '\0') error |= append_quoted(&buffer, &length, &capacity, ptr++, 1);
+        else error |= append_string(&buffer, &length, &capacity, ptr++, 1);
+    }
+
+    // The last field, unless the word expanded to nothing
+    if (!error && (length > 0 || has_field)) error |= (split ? push_pattern : push_field)(fields, count, fields_capacity, buffer, length);
+
+    return error ? -1 : 0;
+}
+
+
+/**
+ * @see arena_alloc, expand_fields
+ */
+char *expand_word(const char *const word) {
+    int count = 0, capacity = 2;
+    char **fields = arena_alloc(&LINE_ARENA, capacity * sizeof(char *));
+    if (!fields || expand_fields(word, EXPAND_WORD, &fields, &count, &capacity) == -1) return NULL;
+    return fields[0];
+}
+
+
+/**
+ * @see arena_alloc, expand_fields, expand_word, strlen, redirect_shell_fd, memfd_create, write, close, fcntl, lseek
+ */
+int open_here_document(const redirect_t *const redirect) {
+    // The body of a literal here-document is written straight from the plan
+    const char *content = redirect->word;
+    if (redirect->type == REDIRECT_HEREDOC) {
+        int count = 0, capacity = 2;
+        char **fields = arena_alloc(&LINE_ARENA, capacity * sizeof(char *));
+        if (!fields || expand_fields(redirect->word, EXPAND_HEREDOC, &fields, &count, &capacity) == -1) return -1;
+        content = fields[0];
+    }
+    else if (redirect->type == REDIRECT_HERESTRING) content = expand_word(redirect->word);
+    if (!content) return -1;
+
+    const int fd = redirect_shell_fd(memfd_create("here_document", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (fd == -1) return -1;
+
+    // A here-string ends with a new line
+    const size_t size = strlen(content);
+    ssize_t written = 0;
+    for (size_t done = 0; done < size && written != -1; done += written) written = write(fd, &content[done], size - done);
+    if (written != -1 && redirect->type == REDIRECT_HERESTRING) written = write(fd, "\n", 1);
+    if (written == -1) {
+        close(fd);
+        return -1;
+    }
+
+    // Sealed, no command reading it can change it
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+
+/**
+ * @see arena_alloc, expand_word, strspn, strlen, atoi, strcmp, sink_error, open_here_document, sink_perror
+ */
+int expand_redirects(const node_t *const node, fd_actions_t *const redirects) {
+    redirects->count = 0;
+    redirects->actions = NULL;
+    if (node->redirect_count == 0) return 0;
+
+    // Each redirection gives a single action, counted as soon as it is built so a failure still closes the here-documents
+    redirects->actions = arena_alloc(&LINE_ARENA, node->redirect_count * sizeof(fd_action_t));
+    if (!redirects->actions) return -1;
+
+    for (int i = 0; i < node->redirect_count; i++) {
+        static const int flags[] = { O_RDONLY, O_WRONLY | O_CREAT | O_TRUNC, O_WRONLY | O_CREAT | O_APPEND, O_RDWR | O_CREAT };
+        const redirect_t *const redirect = &node->redirects[i];
+        fd_action_t *const action = &redirects->actions[redirects->count];
+        action->fd = redirect->fd;
+        action->path = NULL;
+        action->flags = 0;
+        action->source = -1;
+        action->owned = 0;
+        action->internal = 0;
+
+        if (redirect->type <= REDIRECT_READ_WRITE) {
+            action->type = FD_ACTION_OPEN;
+            action->flags = flags[redirect->type];
+            if (!(action->path = expand_word(redirect->word))) return -1;
+        }
+        else if (redirect->type == REDIRECT_DUPLICATE) {
+            // The word is a file descriptor or - to close it
+            const char *const word = expand_word(redirect->word);
+            if (!word) return -1;
+            if (strcmp(word, "-") == 0) action->type = FD_ACTION_CLOSE;
+            else if (*word && strspn(word, "0123456789") == strlen(word) && strlen(word) < 10) {
+                action->type = FD_ACTION_DUP;
+                action->source = atoi(word);
+            }
+            else {
+                sink_error("%s: ambiguous redirect\n", word);
+                return -1;
             }
         }
+        else {
+            // A here-document is a sealed memfd, copied on its file descriptor by the shell or by the commands
+            action->type = FD_ACTION_DUP;
+            action->owned = 1;
+            action->internal = 1;
+            if ((action->source = open_here_document(redirect)) == -1) {
+                sink_perror("here-document");
+                return -1;
+            }
+        }
+        redirects->count++;
+    }
 
-        // Continue to parse the command
+    return 0;
+}
+
+
+/**
+ * @see arena_alloc, is_envvar_definition, expand_fields, expand_redirects
+ */
+char **expand_command(const node_t *const node, int *const argc, fd_actions_t *const redirects) {
+    int capacity = node->argc + 1;
+    char **argv = arena_alloc(&LINE_ARENA, capacity * sizeof(char *));
+    redirects->count = 0;
+    if (!argv) return NULL;
+
+    // Unquoted expansions are split into several arguments, except in assignments
+    *argc = 0;
+    argv[0] = NULL;
+    for (int i = 0; i < node->argc; i++) {
+        if (expand_fields(node->words[i], is_envvar_definition(node->words[i]) ? EXPAND_WORD : EXPAND_FIELDS, &argv, argc, &capacity) == -1) return NULL;
+    }
+
+    // Redirections are not arguments, they become actions on file descriptors
+    if (expand_redirects(node, redirects) == -1) return NULL;
+
+    return argv;
+}
+
+
+/**
+ * @see node_to_string, arena_alloc, arena_strdup, free
+ */
+char **describe_compound(const node_t *const node, int *const argc) {
+    // A compound stage is shown as its text in the jobs table
+    char *const text = node_to_string(node);
+    char **const argv = arena_alloc(&LINE_ARENA, 2 * sizeof(char *));
+    if (!text || !argv || !(argv[0] = arena_strdup(&LINE_ARENA, text))) {
+        free(text);
+        return NULL;
+    }
+    free(text);
+
+    argv[1] = NULL;
+    *argc = 1;
+    return argv;
+}
+
+
+/**
+ * @see timing_take, expand_command, describe_compound, timing_label, is_builtin, call_command, _timing_sample, timing_end_shell, run_pipeline, redirect_close, close_substitutions
+ */
+int execute_pipeline(const node_t *const node, int *const use_pipe, const int pipe_used, const int background) {
+    // A simple command is a pipeline of a single stage
+    const int count = node->type == NODE_PIPELINE ? node->count : 1;
+    node_t *const *const stages = node->type == NODE_PIPELINE ? node->children : (node_t *const *)&node;
+    if (count > MAX_PIPELINE_STAGES) {
+        sink_error("Too many pipeline stages, at most %d\n", MAX_PIPELINE_STAGES);
+        return 1;
+    }
+
+    // Measures of time are for this pipeline only, not for the ones run by $(...) inside it
+    timing_t *const timing = timing_take();
+
+    // Expand every stage before starting any of them, compound stages are expanded by their own process
+    const int substitutions = SUBSTITUTION_COUNT;
+    int argcs[MAX_PIPELINE_STAGES];
+    char **argvs[MAX_PIPELINE_STAGES];
+    fd_actions_t redirects[MAX_PIPELINE_STAGES];
+    int has_compound = 0;
+    for (int i = 0; i < count; i++) {
+        if (stages[i]->type == NODE_COMMAND) argvs[i] = expand_command(stages[i], &argcs[i], &redirects[i]);
         else {
-            end++;
-            continue;
+            // A compound stage applies its own redirections
+            redirects[i].count = 0;
+            argvs[i] = describe_compound(stages[i], &argcs[i]);
+            has_compound = 1;
+        }
+    }
+
+    int expanded = 1;
+    for (int i = 0; i < count; i++) if (!argvs[i]) expanded = 0;
+
+    // Stages run by time are measured one by one
+    if (timing && expanded) {
+        timing->count = count;
+        for (int i = 0; i < count; i++) timing_label(&timing->stages[i], argcs[i], argvs[i]);
+    }
+
+    // A single command runs inside the shell, a real pipeline or a background job runs all its stages at the same time
+    // A timed external command is waited like a pipeline, to get the resources of its own process
+    int return_code = 1;
+    if (!expanded);
+    else if (count == 1 && !background && !(timing && argcs[0] > 0 && !is_builtin(argvs[0][0]))) {
+        return_code = call_command(argcs[0], argvs[0], &redirects[0], use_pipe, pipe_used, 0);
+        PIPE_STATUS_COUNT = 1;
+        PIPE_STATUS[0] = return_code;
+    }
+
+    // Run stages one after another, each one capturing its output inside our pipe
+    else if (PIPE_BUFFERED && !background && !has_compound) {
+        PIPE_STATUS_COUNT = count;
+        for (int i = 0; i < count; i++) {
+            struct rusage before;
+            if (timing) _timing_sample(&before);
+            return_code = call_command(argcs[i], argvs[i], &redirects[i], use_pipe, pipe_used, i < count - 1);
+            if (timing) timing_end_shell(&timing->stages[i], &before);
+            PIPE_STATUS[i] = return_code;
+        }
+    }
+
+    else return_code = run_pipeline(count, argcs, argvs, redirects, stages, background, timing);
+
+    // Commands opened their here-documents and substitutions by now
+    for (int i = 0; i < count; i++) redirect_close(&redirects[i]);
+    close_substitutions(substitutions);
+
+    return return_code;
+}
+
+
+/**
+ * @see jobs_running_count, jobs_wait_any, fflush, fork, jobs_child_setup, execute_node, exit, sink_perror, setpgid, node_to_string, jobs_add, sink_printf
+ */
+int execute_background(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    // Pipelines are started directly as jobs
+    if (node->type == NODE_COMMAND || node->type == NODE_PIPELINE) return execute_pipeline(node, use_pipe, pipe_used, 1);
+
+    // Other lists run inside a copy of the shell, which is the job
+    while (MAX_JOBS > 0 && jobs_running_count() >= MAX_JOBS && jobs_wait_any() == 0);
+
+    fflush(stdout);
+    TRACE_BEGIN("fork", NULL);
+    const pid_t pid = fork();
+    if (pid != 0) TRACE_END("fork");
+    if (pid > 0) stats_add(STAT_FORKS, 1);
+    if (pid == 0) {
+        // The copy is not interactive, its commands stay in the process group of the job
+        jobs_child_setup(0);
+        INTERACTIVE = 0;
+        exit(execute_node(node, use_pipe, pipe_used));
+    }
+    if (pid == -1) {
+        sink_perror("fork");
+        return 1;
+    }
+    if (INTERACTIVE) setpgid(pid, pid);
+
+    const int id = jobs_add(pid, &pid, 1, node_to_string(node), JOB_RUNNING);
+    if (id != -1) sink_printf("[%d] %d\n", id, pid);
+
+    return 0;
+}
+
+
+/**
+ * @see execute_node
+ */
+int execute_if(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    // Run the body of the first condition which succeeds
+    for (int i = 0; i + 1 < node->count; i += 2) {
+        const int condition = execute_node(node->children[i], use_pipe, pipe_used);
+        if (LOOP_BREAK || LOOP_CONTINUE) return condition;
+        if (condition == 0) return execute_node(node->children[i + 1], use_pipe, pipe_used);
+    }
+
+    // Else, if any
+    return node->count % 2 ? execute_node(node->children[node->count - 1], use_pipe, pipe_used) : 0;
+}
+
+
+int loop_should_stop(const int return_code) {
+    // A command interrupted from the terminal stops every loop, the shell itself ignores SIGINT
+    if ((INTERACTIVE && return_code == 128 + SIGINT) || SHELL_EXIT) return 1;
+
+    if (LOOP_BREAK) {
+        LOOP_BREAK--;
+        return 1;
+    }
+
+    // continue n leaves n - 1 loops, then goes on with the next iteration
+    if (LOOP_CONTINUE) {
+        LOOP_CONTINUE--;
+        return LOOP_CONTINUE > 0;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see arena_mark, execute_node, loop_should_stop, arena_rewind
+ */
+int execute_while(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    int return_code = 0;
+    int stop = 0;
+
+    LOOP_DEPTH++;
+    while (!stop) {
+        // Everything allocated by an iteration is freed before the next one
+        const arena_mark_t mark = arena_mark(&LINE_ARENA);
+
+        // while runs the body while the condition succeeds, until while it fails
+        const int condition = execute_node(node->children[0], use_pipe, pipe_used);
+        if (LOOP_BREAK || LOOP_CONTINUE || (INTERACTIVE && condition == 128 + SIGINT)) stop = loop_should_stop(condition);
+        else if ((condition == 0) != (node->type == NODE_WHILE)) stop = 1;
+        else {
+            return_code = execute_node(node->children[1], use_pipe, pipe_used);
+            stop = loop_should_stop(return_code);
+        }
+
+        arena_rewind(&LINE_ARENA, mark);
+    }
+    LOOP_DEPTH--;
+
+    return return_code;
+}
+
+
+/**
+ * @see isalpha, isalnum, sink_error, arena_alloc, expand_fields, arena_mark, set_variable, execute_node, arena_rewind, loop_should_stop
+ */
+int execute_for(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    // The variable must be a valid name
+    int valid = isalpha((unsigned char)node->name[0]) || node->name[0] == '_';
+    for (int i = 1; valid && node->name[i]; i++) valid = isalnum((unsigned char)node->name[i]) || node->name[i] == '_';
+    if (!valid) {
+        sink_error("for: `%s': not a valid identifier\n", node->name);
+        return 1;
+    }
+
+    // Items are expanded and split once, before the first iteration
+    int count = 0, capacity = 8;
+    char **items = arena_alloc(&LINE_ARENA, capacity * sizeof(char *));
+    if (!items) return 1;
+    for (int i = 0; i < node->argc; i++) if (expand_fields(node->words[i], EXPAND_FIELDS, &items, &count, &capacity) == -1) return 1;
+
+    int return_code = 0;
+
+    LOOP_DEPTH++;
+    for (int i = 0; i < count; i++) {
+        // Everything allocated by an iteration is freed before the next one
+        const arena_mark_t mark = arena_mark(&LINE_ARENA);
+        set_variable(node->name, items[i]);
+        return_code = execute_node(node->children[0], use_pipe, pipe_used);
+        arena_rewind(&LINE_ARENA, mark);
+
+        if (loop_should_stop(return_code)) break;
+    }
+    LOOP_DEPTH--;
+
+    return return_code;
+}
+
+
+/**
+ * @see expand_word, fnmatch, execute_node
+ */
+int execute_case(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    const char *const subject = expand_word(node->name);
+    if (!subject) return 1;
+
+    // Run the body of the first item with a pattern matching the subject
+    for (int i = 0; i < node->count; i++) {
+        const node_t *const item = node->children[i];
+        for (int j = 0; j < item->argc; j++) {
+            const char *const pattern = expand_word(item->words[j]);
+            if (pattern && fnmatch(pattern, subject, 0) == 0) return execute_node(item->children[0], use_pipe, pipe_used);
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see fflush, fork, jobs_child_setup, execute_node, exit, sink_perror, setpgid, describe_compound, jobs_wait_foreground
+ */
+int execute_subshell(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    // The copy of the shell is a job of its own, its commands stay in its process group
+    fflush(stdout);
+    TRACE_BEGIN("fork", NULL);
+    pid_t pid = fork();
+    if (pid != 0) TRACE_END("fork");
+    if (pid > 0) stats_add(STAT_FORKS, 1);
+    if (pid == 0) {
+        jobs_child_setup(0);
+        INTERACTIVE = 0;
+        exit(execute_node(node->children[0], use_pipe, pipe_used));
+    }
+    if (pid == -1) {
+        sink_perror("fork");
+        return 1;
+    }
+    if (INTERACTIVE) setpgid(pid, pid);
+
+    // It gets the terminal and can be stopped like any other job
+    int argc = 0;
+    char **argv = describe_compound(node, &argc);
+    int code = 1;
+    jobs_wait_foreground(pid, &pid, &code, 1, 1, argv ? &argc : NULL, &argv, NULL);
+
+    return code;
+}
+
+
+/**
+ * @see arena_alloc, timing_start, execute_node, timing_stop, fflush, timing_print
+ */
+int execute_time(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    timing_t *const timing = arena_alloc(&LINE_ARENA, sizeof(timing_t));
+    if (!timing) return 1;
+
+    // Stages are measured only for a pipeline run directly
+    const node_t *const child = node->children[0];
+    timing_start(timing, child->type == NODE_COMMAND || child->type == NODE_PIPELINE);
+    const int return_code = execute_node(child, use_pipe, pipe_used);
+    timing_stop(timing);
+
+    // Measures come after the output of the command
+    fflush(stdout);
+    timing_print(timing);
+
+    return return_code;
+}
+
+
+/**
+ * @see expand_redirects, arena_alloc, fflush, redirect_apply, execute_if, execute_while, execute_for, execute_case, execute_subshell, redirect_restore, redirect_close
+ */
+int execute_compound(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    // Redirections apply to every command of the body, they are set up inside the shell and restored after
+    fd_actions_t redirects;
+    int *saved = NULL;
+    int ready = expand_redirects(node, &redirects) == 0;
+    if (ready && redirects.count > 0) {
+        fflush(stdout);
+        saved = arena_alloc(&LINE_ARENA, redirects.count * sizeof(int));
+        ready = saved && redirect_apply(&redirects, saved) == 0;
+    }
+
+    int return_code = 1;
+    if (ready) {
+        switch (node->type) {
+            case NODE_IF:       return_code = execute_if(node, use_pipe, pipe_used);       break;
+            case NODE_WHILE:
+            case NODE_UNTIL:    return_code = execute_while(node, use_pipe, pipe_used);    break;
+            case NODE_FOR:      return_code = execute_for(node, use_pipe, pipe_used);      break;
+            case NODE_CASE:     return_code = execute_case(node, use_pipe, pipe_used);     break;
+            case NODE_SUBSHELL: return_code = execute_subshell(node, use_pipe, pipe_used); break;
+            default: break;
         }
+    }
+
+    // Reset the file descriptors
+    if (redirects.count > 0) {
+        fflush(stdout);
+        redirect_restore(&redirects, saved);
+    }
+    redirect_close(&redirects);
+
+    return return_code;
+}
+
+
+/**
+ * @see execute_pipeline, execute_background, execute_time, execute_compound
+ */
+int execute_node(const node_t *const node, int *const use_pipe, const int pipe_used) {
+    int return_code = 0;
 
-        // Reset parsed command
-        start = ++end;
+    switch (node->type) {
+        case NODE_COMMAND:
+        case NODE_PIPELINE:
+            return_code = execute_pipeline(node, use_pipe, pipe_used, 0);
+            break;
+
+        // Run the right side only if the left side succeeded
+        case NODE_AND:
+            return_code = execute_node(node->children[0], use_pipe, pipe_used);
+            if (return_code == 0 && !LOOP_BREAK && !LOOP_CONTINUE && !SHELL_EXIT) return_code = execute_node(node->children[1], use_pipe, pipe_used);
+            break;
+
+        // Run the right side only if the left side failed
+        case NODE_OR:
+            return_code = execute_node(node->children[0], use_pipe, pipe_used);
+            if (return_code != 0 && !LOOP_BREAK && !LOOP_CONTINUE && !SHELL_EXIT) return_code = execute_node(node->children[1], use_pipe, pipe_used);
+            break;
+
+        // break, continue and exit skip the rest of the list
+        case NODE_SEQUENCE:
+            for (int i = 0; i < node->count && !LOOP_BREAK && !LOOP_CONTINUE && !SHELL_EXIT; i++) return_code = execute_node(node->children[i], use_pipe, pipe_used);
+            break;
+
+        case NODE_BACKGROUND:
+            return_code = execute_background(node->children[0], use_pipe, pipe_used);
+            break;
+
+        case NODE_TIME:
+            return_code = execute_time(node, use_pipe, pipe_used);
+            break;
+
+        case NODE_IF:
+        case NODE_WHILE:
+        case NODE_UNTIL:
+        case NODE_FOR:
+        case NODE_CASE:
+        case NODE_SUBSHELL:
+            return_code = execute_compound(node, use_pipe, pipe_used);
+            break;
+
+        // Items are only run through their case
+        case NODE_CASE_ITEM:
+            return return_code;
     }
 
-    // Run last command if it is not empty
-    if (start < end) return_code = call_command(end - start, &argv[start], &use_pipe, pipe_used, 0);
+    // Expanded by $? in the next commands
+    LAST_RETURN_CODE = return_code;
+    return return_code;
+}
+
+
+/**
+ * @see arena_mark, redirect_shell_fd, memfd_create, execute_node, close, arena_rewind, close_substitutions
+ */
+int execute_tree(const node_t *const root) {
+    // Everything allocated for the tree is freed at once at the end, also for lines inside $(...)
+    const arena_mark_t mark = arena_mark(&LINE_ARENA);
+    const int substitutions = SUBSTITUTION_COUNT;
+
+    int use_pipe = 0;
+    const int pipe_used = redirect_shell_fd(memfd_create("pipe_used", MFD_CLOEXEC));
+
+    const int return_code = execute_node(root, &use_pipe, pipe_used);
 
-    // Close the pipe
     close(pipe_used);
+    arena_rewind(&LINE_ARENA, mark);
+    // Substitutions of for items and redirections of compound commands live until the end of the line
+    close_substitutions(substitutions);
 
     return return_code;
 }
 
 
 /**
- * @see sizeof, malloc, isspace, realloc, isalnum, memset, memfd_create, dup, dup2, close, parse_commands, fflush, free, load_memfd_to_string, strlen, strncpy, getenv
+ * @see stats_add, plan_acquire, execute_tree, plan_release
  */
-void parse_line(const char *const line, int *const argc, char ***const argv) {
-    int argv_capacity = 10;
-    *argc = 0;
-    *argv = malloc(argv_capacity * sizeof(char *));
+int execute_line(const char *const line) {
+    stats_add(STAT_LINES, 1);
+    TRACE_BEGIN("execute_line", line);
 
-    const char *ptr = line;
-    char *arg, end;
-    int arg_capacity, len, is_name;
+    // Lines already run are not lexed and parsed again
+    plan_t *const plan = plan_acquire(line, NULL);
+    const int return_code = !plan ? 2 : plan->root ? execute_tree(plan->root) : 0;
+
+    plan_release(plan);
+
+    TRACE_END("execute_line");
+    return return_code;
+}
 
-    int sub_i;
 
-    char sub_command[MAX_LINE_LENGTH], **sub_argv = NULL;
-    char *sub_result;
-    int sub_argc, sub_pipe_used, sub_saved_stdout, sub_len;
+/**
+ * @see execute_line, jobs_notify, printf, fflush, arena_reset
+ */
+int run_line(const char *const line) {
+    // Compile (or take from the cache) and call commands
+    const int return_code = execute_line(line);
 
-    char sub_varname[MAX_ENV_NAME_LENGTH];
-    char *sub_envval;
-    int sub_bracket;
-    while (*ptr) {
-        // Skip leading spaces
-        while (isspace((unsigned char)*ptr)) ptr++;
+    // Without terminal, background jobs which finished meanwhile are dropped at the end of each line
+    if (!INTERACTIVE) jobs_notify();
 
-        // Break if we reach the end of the line
-        if (!(*ptr)) break;
+    if (DEBUG) {
+        printf("Last command return code: %d\n", return_code);
+        printf("Line arena: %zu allocations, %zu bytes (peak %zu bytes), %zu chunks\n", LINE_ARENA.allocations, LINE_ARENA.bytes, LINE_ARENA.peak, LINE_ARENA.chunks);
+    }
+    fflush(stdout);
 
-        arg_capacity = 10;
-        len = 0;
-        end = *ptr == '\"' || *ptr == '\'' ? *ptr : ' ';
-        is_name = 1;
+    // Free everything allocated for the line at once
+    arena_reset(&LINE_ARENA);
 
-        arg = malloc(arg_capacity * sizeof(char));
+    return return_code;
+}
 
-        if (end != ' ') ptr++;
-        while (*ptr && *ptr != end && !(end == ' ' && isspace((unsigned char)*ptr))) {
-            // Reallocate memory if needed
-            while (len >= arg_capacity - 1) {
-                arg_capacity *= 2;
-                arg = realloc(arg, arg_capacity * sizeof(char));
-            }
 
-            // Check if subsequent characters are valid for an environment variable name
-            if ((len >= MAX_ENV_NAME_LENGTH) || !(isalnum(*ptr) || *ptr == '_' || *ptr == '=')) is_name = 0;
+/**
+ * @see strlen, realloc, memcpy, free
+ */
+int append_line(char **const pending, size_t *const length, size_t *const capacity, const char *const line) {
+    // Lines are joined with the new line between them, which separates commands like ;
+    const int separator = *pending != NULL;
+    const size_t line_length = strlen(line);
+    if (!*pending) *length = *capacity = 0;
+
+    // The buffer grows twice bigger, long here-documents are not copied at each line
+    if (*length + separator + line_length + 1 > *capacity) {
+        size_t new_capacity = *capacity ? *capacity : 256;
+        while (*length + separator + line_length + 1 > new_capacity) new_capacity *= 2;
+        char *const bigger = realloc(*pending, new_capacity);
+        if (!bigger) {
+            free(*pending);
+            *pending = NULL;
+            return -1;
+        }
+        *pending = bigger;
+        *capacity = new_capacity;
+    }
 
-            // Check for escaped characters inside double quotes
-            // Currently, just to be sure they are not interpreted as special characters
-            if (*ptr == '\\' && end != '\'') {
-                arg[len++] = *ptr++;
-                if (!(*ptr)) break;
-                arg[len++] = *ptr++;
-            }
+    if (separator) (*pending)[(*length)++] = '\n';
+    memcpy(&(*pending)[*length], line, line_length + 1);
+    *length += line_length;
+    return 0;
+}
 
-            // Check if it is a definition of an environment variable
-            else if (is_name && *ptr == '=') {
-                is_name = 0;
-                arg[len++] = *ptr++;
-                if (!(*ptr)) break;
-                end = *ptr == '\"' || *ptr == '\'' ? *ptr : ' ';
-                if (end != ' ') ptr++;
-            }
 
-            // Parse for sub-shell or environment variable
-            else if (*ptr == '$' && end != '\'') {
-                ptr++;
+/**
+ * @see strcmp
+ */
+int is_heredoc_delimiter(const char *const delimiter, const char *line) {
+    // Tabs are skipped for <<-, a line starting with tabs can only end a <<- but checking it costs nothing
+    while (*line == '\t') line++;
+    return strcmp(line, delimiter) == 0;
+}
 
-                // Parse for sub-shell
-                if (*ptr == '(') {
-                    ptr++;
-
-                    memset(sub_command, '\0', MAX_LINE_LENGTH);
-                    sub_i = 0;
-
-                    // Copy the command inside the parentheses
-                    while (*ptr && *ptr != ')') {
-                        if (*ptr == '\\') {
-                            ptr++;
-                            if (!(*ptr)) break;
-                        }
-
-                        if (sub_i < MAX_LINE_LENGTH - 1) sub_command[sub_i++] = *ptr++;
-                    }
-                    if (*ptr == ')') ptr++;
-
-                    // Parse the sub-command
-                    parse_line(sub_command, &sub_argc, &sub_argv);
-
-                    // Create a new pipe to capture the output of the sub-command
-                    sub_pipe_used = memfd_create("sub_pipe_used", 0);
-                    sub_saved_stdout = dup(STDOUT_FILENO);
-                    dup2(sub_pipe_used, STDOUT_FILENO);
-                    close(sub_pipe_used);
-
-                    // Call the sub-command
-                    parse_commands(sub_argc, sub_argv);
-                    fflush(stdout);
-
-                    // free memory
-                    for (int i = 0; i < sub_argc; i++) free(sub_argv[i]);
-                    free(sub_argv);
-                    sub_argv = NULL;
-                    sub_argc = 0;
-
-                    // Get output from the pipe
-                    sub_result = load_memfd_to_string(STDOUT_FILENO);
-                    sub_len = strlen(sub_result);
-                    if (sub_len) {
-                        // Reallocate memory if needed
-                        while (len + sub_len >= arg_capacity - 1) {
-                            arg_capacity *= 2;
-                            arg = realloc(arg, arg_capacity * sizeof(char));
-                        }
-
-                        // Copy the result to the argument
-                        strncpy(&arg[len], sub_result, sub_len);
-                        len += sub_len;
-                    }
-                    if (sub_result) free(sub_result);
-
-                    // Reset stdout to the original value
-                    dup2(sub_saved_stdout, STDOUT_FILENO);
-                    close(sub_saved_stdout);
-                }
 
-                // Parse for environment variable
-                else if (*ptr == '{' || isalnum(*ptr) || *ptr == '_') {
-                    memset(sub_varname, '\0', MAX_ENV_NAME_LENGTH);
-                    sub_i = 0;
-                    sub_bracket = (*ptr == '{');
-
-                    // Copy the variable name inside the braces or until a non-valid character
-                    if (sub_bracket) ptr++;
-                    while (*ptr && (sub_i < MAX_ENV_NAME_LENGTH - 1) && (isalnum(*ptr) || *ptr == '_')) sub_varname[sub_i++] = *ptr++;
-                    if (sub_bracket) while (*ptr && *ptr != '}') ptr++;
-                    if (*ptr == '}') ptr++;
-
-                    // Get the environment variable value
-                    sub_envval = getenv(sub_varname);
-                    sub_len = strlen(sub_envval);
-                    if (sub_len) {
-                        // Reallocate memory if needed
-                        while (len + sub_len >= arg_capacity - 1) {
-                            arg_capacity *= 2;
-                            arg = realloc(arg, arg_capacity * sizeof(char));
-                        }
-
-                        // Copy the result to the argument
-                        strncpy(&arg[len], sub_result, sub_len);
-                        len += sub_len;
-                    }
-                }
-            }
+/**
+ * @see reader_init, sink_perror, reader_next_line, is_heredoc_delimiter, append_line, free, plan_check, lex_heredoc_delimiter, reader_sync_before, run_line, reader_sync_after, free, sink_error, reader_free
+ */
+int run_script(const int fd, const int shared) {
+    reader_t reader;
+    if (reader_init(&reader, fd, shared) == -1) {
+        sink_perror("malloc");
+        return 1;
+    }
 
-            // Continue to copy characters
-            else arg[len++] = *ptr++;
+    // Run every line, a command reading stdin gets the rest of the script if stdin is a file
+    int return_code = 0;
+    char *line;
+    char *pending = NULL;
+    size_t pending_length = 0, pending_capacity = 0;
+    // Delimiter of the here-document being read, lines before it can not end the command
+    char *delimiter = NULL;
+    while ((line = reader_next_line(&reader, NULL)) != NULL) {
+        // Lines of a compound command, or ending inside quotes, are joined before running
+        if (pending) {
+            const int delimited = !delimiter || is_heredoc_delimiter(delimiter, line);
+            if (append_line(&pending, &pending_length, &pending_capacity, line) == -1) break;
+            if (!delimited) continue;
+            line = pending;
         }
-        if (end != ' ') ptr++;
+        free(delimiter);
+        delimiter = NULL;
 
-        arg[len] = '\0';
+        const int status = plan_check(line);
+        if (status == 1) {
+            if (!pending && append_line(&pending, &pending_length, &pending_capacity, line) == -1) break;
+            delimiter = lex_heredoc_delimiter(pending);
+            continue;
+        }
 
-        // Reallocate memory if needed
-        while (*argc >= argv_capacity - 1) {
-            argv_capacity *= 2;
-            *argv = realloc(*argv, argv_capacity * sizeof(char *));
+        if (status == -1) return_code = 2;
+        else {
+            reader_sync_before(&reader);
+            return_code = run_line(line);
+            reader_sync_after(&reader);
         }
+        free(pending);
+        pending = NULL;
+    }
 
-        (*argv)[*argc] = arg;
-        (*argc)++;
+    // The script ends in the middle of a command
+    free(delimiter);
+    if (pending) {
+        sink_error("Syntax error: unexpected end of file\n");
+        return_code = 2;
+        free(pending);
     }
 
-    (*argv)[*argc] = NULL;
+    reader_free(&reader);
+    return return_code;
 }
 
 
@@ -473,15 +1641,27 @@ void parse_line(const char *const line, int *const argc, char ***const argv) {
  * @see printf
  */
 void print_usage(const char *const program_name) {
-    printf("Usage: %s [Options]\n", program_name);
+    printf("Usage: %s [Options] [-c COMMAND | SCRIPT]\n", program_name);
+    printf("Without COMMAND nor SCRIPT, commands are read from stdin, interactively if it is a terminal\n");
     printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
-    printf("    -v             Verbose, debug mode\n");
+    printf("    -h | --help         Print this help message\n");
+    printf("    -v                  Verbose, debug mode\n");
+    printf("    -c COMMAND          Run the command line COMMAND and exit\n");
+    printf("    --pipe-size SIZE    Size in bytes of pipes between pipeline stages\n");
+    printf("                        SIZE > 0 and by default is the kernel default\n");
+    printf("    --buffered-pipes    Run pipeline stages one after another through an in-memory file\n");
+    printf("    --no-fusion         Run every pipeline stage in its own process, even builtins\n");
+    printf("    --max-jobs N        Maximum number of background jobs running at the same time\n");
+    printf("                        N > 0 and by default there is no limit\n");
+    printf("    --norc              Do not source ~/%s (interactive) nor $CSHELL_ENV (otherwise) at startup\n", RC_FILE_NAME);
+    printf("    --no-source-cache   Parse sourced files each time, without the cache of their syntax trees\n");
+    printf("    --server SOCKET     Listen on the Unix socket SOCKET and run the command line of each client\n");
+    printf("    --connect SOCKET    Run COMMAND on the server of SOCKET with stdin, stdout, stderr and directory of this process\n");
 }
 
 
 /**
- * @see strcmp, print_usage, exit
+ * @see strcmp, print_usage, exit, isdigit, atoi
  */
 void parse_arguments(const int argc, const char *const *const argv) {
     for (int i = 1; i < argc; i++) {
@@ -498,10 +1678,147 @@ void parse_arguments(const int argc, const char *const *const argv) {
             DEBUG = 1;
             continue;
         }
+
+        // Check if the argument is -c
+        if (strcmp(argv[i], "-c") == 0) {
+            i++;
+
+            // Check if there is a command after -c
+            if (i >= argc) {
+                sink_error("Missing COMMAND\n");
+                print_usage(argv[0]);
+                exit(2);
+            }
+
+            // Set the COMMAND_STRING, next arguments are ignored
+            COMMAND_STRING = argv[i];
+            return;
+        }
+
+        // The first argument which is not an option is the script, next arguments are ignored
+        if (argv[i][0] != '-') {
+            SCRIPT_PATH = argv[i];
+            return;
+        }
+
+        // Check if the argument is --buffered-pipes
+        if (strcmp(argv[i], "--buffered-pipes") == 0) {
+            // Set PIPE_BUFFERED
+            PIPE_BUFFERED = 1;
+            continue;
+        }
+
+        // Check if the argument is --no-fusion
+        if (strcmp(argv[i], "--no-fusion") == 0) {
+            // Reset PIPE_FUSION
+            PIPE_FUSION = 0;
+            continue;
+        }
+
+        // Check if the argument is --norc
+        if (strcmp(argv[i], "--norc") == 0) {
+            // Set NO_RC
+            NO_RC = 1;
+            continue;
+        }
+
+        // Check if the argument is --no-source-cache
+        if (strcmp(argv[i], "--no-source-cache") == 0) {
+            // Reset SOURCE_CACHE
+            SOURCE_CACHE = 0;
+            continue;
+        }
+
+        // Check if the argument is --server or --connect
+        if (strcmp(argv[i], "--server") == 0 || strcmp(argv[i], "--connect") == 0) {
+            const int is_server = argv[i][2] == 's';
+            i++;
+
+            // Check if there is a socket after --server or --connect
+            if (i >= argc) {
+                sink_error("Missing SOCKET\n");
+                print_usage(argv[0]);
+                exit(1);
+            }
+
+            // Set the SERVER_PATH or CONNECT_PATH
+            if (is_server) SERVER_PATH = argv[i];
+            else CONNECT_PATH = argv[i];
+            continue;
+        }
+
+        // Check if the argument is --max-jobs
+        if (strcmp(argv[i], "--max-jobs") == 0) {
+            i++;
+
+            // Check if there is a positive number after --max-jobs
+            if (i >= argc || atoi(argv[i]) <= 0) {
+                sink_error("Invalid N: %s\n", i < argc ? argv[i] : "missing");
+                print_usage(argv[0]);
+                exit(1);
+            }
+
+            // Set the MAX_JOBS
+            MAX_JOBS = atoi(argv[i]);
+            continue;
+        }
+
+        // Check if the argument is --pipe-size
+        if (strcmp(argv[i], "--pipe-size") == 0) {
+            i++;
+
+            // Check if there is an argument after --pipe-size
+            if (i >= argc) {
+                sink_error("Missing SIZE\n");
+                print_usage(argv[0]);
+                exit(1);
+            }
+
+            // Check if the argument is a number
+            for (int j = 0; argv[i][j] != '\0'; j++) {
+                if (!isdigit((unsigned char)argv[i][j])) {
+                    sink_error("Invalid SIZE: %s\n", argv[i]);
+                    print_usage(argv[0]);
+                    exit(1);
+                }
+            }
+
+            // Set the PIPE_SIZE
+            PIPE_SIZE = atoi(argv[i]);
+
+            // Check if the PIPE_SIZE is valid
+            if (PIPE_SIZE <= 0) {
+                sink_error("Invalid SIZE: %i\n", PIPE_SIZE);
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
     }
 }
 
 
+/**
+ * @see var_get, snprintf, access, source_file
+ */
+void source_startup_file() {
+    if (NO_RC) return;
+
+    char path[MAX_PATH_LENGTH];
+    const char *file = NULL;
+    if (INTERACTIVE) {
+        const char *const home = var_get("HOME");
+        if (home && *home) {
+            snprintf(path, MAX_PATH_LENGTH, "%s/%s", home, RC_FILE_NAME);
+            file = path;
+        }
+    }
+    else file = var_get("CSHELL_ENV");
+
+    // A missing startup file is not an error
+    if (file && *file && access(file, R_OK) == 0) source_file(file);
+}
+
+
 /**
  * @see printf
  */
@@ -515,7 +1832,7 @@ void print_login_message() {
     printf("\033[1;40m   \033[35m \\_____| \033[36m|_____/  |_|  |_| |______| |______| |______| |_|   \033[0m\n");
     printf("\033[1;40m                                                               \033[0m\n");
     printf("\n");
-    printf("Welcome \033[32m%s\033[0m to CShell release 1.0.0 !\n", USER);
+    printf("Welcome \033[32m%s\033[0m to CShell release %s !\n", USER, CSHELL_VERSION);
     printf("\n");
     printf("If you have any issue, please consider compiling and executing with gcc 13.3.0 under Ubuntu 24.04.2\n");
     printf("If it persists, contact us: cshell@et3-os-project.fr\n");
@@ -523,14 +1840,29 @@ void print_login_message() {
 }
 
 
+#ifndef CSHELL_LIBRARY
 /**
- * @see parse_arguments, getcwd, getuid, getpwuid, strncpy, enable_raw_mode, print_login_message, printf, fflush, our_terminal, parse_line, parse_commands, free
+ * @see parse_arguments, server_connect, getenv, trace_open, var_init, getcwd, getuid, getpwuid, strncpy, jobs_init, server_run, source_startup_file, run_line, open, sink_perror, isatty, run_script, enable_raw_mode, print_login_message, jobs_notify, printf, fflush, our_terminal, plan_check, append_line, terminal_continue_line, free
  */
 int main(int argc, char *argv[]) {
     // Parse the arguments
     parse_arguments(argc, (const char *const *const)argv);
 
-    // Initialize
+    // A client only sends its command line, the server already did the startup
+    if (CONNECT_PATH != NULL) {
+        if (COMMAND_STRING == NULL) {
+            sink_error("Missing -c COMMAND to send to %s\n", CONNECT_PATH);
+            return 2;
+        }
+        return server_connect(CONNECT_PATH, COMMAND_STRING);
+    }
+
+    // Spans of the shell are written to SHELL_TRACE, forked copies append to the same file
+    const char *const trace_path = getenv("SHELL_TRACE");
+    if (trace_path && trace_path[0] != '\0' && trace_open(trace_path) == -1) sink_perror(trace_path);
+
+    // Initialize, variables of the environment are exported
+    var_init();
     getcwd(CWD, MAX_PATH_LENGTH);
     getcwd(PWD, MAX_PATH_LENGTH);
 
@@ -539,13 +1871,38 @@ int main(int argc, char *argv[]) {
     strncpy(USER, pw ? pw->pw_name : "", MAX_ENV_NAME_LENGTH);
     USER[MAX_ENV_NAME_LENGTH - 1] = '\0';
 
+    // Serve requests of clients, each one inside a copy of this started shell
+    if (SERVER_PATH != NULL) {
+        jobs_init(0);
+        source_startup_file();
+        return server_run(SERVER_PATH);
+    }
+
+    // Run the command line given with -c
+    if (COMMAND_STRING != NULL) {
+        jobs_init(0);
+        source_startup_file();
+        return run_line(COMMAND_STRING);
+    }
+
+    // Read the script file, or stdin
+    int fd = STDIN_FILENO;
+    if (SCRIPT_PATH != NULL && (fd = open(SCRIPT_PATH, O_RDONLY | O_CLOEXEC)) == -1) {
+        sink_perror(SCRIPT_PATH);
+        return 127;
+    }
+
+    // Without terminal, there is no prompt nor line edition, lines are read by large blocks
+    INTERACTIVE = SCRIPT_PATH == NULL && isatty(STDIN_FILENO);
+    jobs_init(INTERACTIVE);
+    source_startup_file();
+    if (!INTERACTIVE) return run_script(fd, fd == STDIN_FILENO);
+
     enable_raw_mode();
 
     // Display login message
     print_login_message();
 
-    char **n_argv;
-    int n_argc, return_code;
     while (1) {
         // Update CWD and USER
         getcwd(CWD, MAX_PATH_LENGTH);
@@ -553,6 +1910,9 @@ int main(int argc, char *argv[]) {
         strncpy(USER, pw ? pw->pw_name : "", MAX_ENV_NAME_LENGTH);
         USER[MAX_ENV_NAME_LENGTH - 1] = '\0';
 
+        // Tell about background jobs that finished or stopped
+        jobs_notify();
+
         // Display terminal for first time
         printf("\033[32m%s\033[37m@\033[32mCShell\033[37m:\033[34m%s\033[0m > ", USER, CWD);
         fflush(stdout);
@@ -561,22 +1921,30 @@ int main(int argc, char *argv[]) {
         while (!our_terminal());
         fflush(stdout);
 
-        // Parse line
-        parse_line(COMMAND, &n_argc, &n_argv);
-
-        // Call commands
-        return_code = parse_commands(n_argc, n_argv);
-        if (DEBUG) printf("Last command return code: %d\n", return_code);
-        fflush(stdout);
+        // A compound command, or a line ending inside quotes, goes on over the next lines
+        const char *line = COMMAND;
+        char *pending = NULL;
+        size_t pending_length = 0, pending_capacity = 0;
+        int status = 0;
+        while (line && (status = plan_check(line)) == 1) {
+            if (!pending && append_line(&pending, &pending_length, &pending_capacity, COMMAND) == -1) break;
+
+            terminal_continue_line(1);
+            printf("> ");
+            fflush(stdout);
+            while (!our_terminal());
+            terminal_continue_line(0);
+
+            line = append_line(&pending, &pending_length, &pending_capacity, COMMAND) == -1 ? NULL : pending;
+        }
 
-        // Reset and free n_argv
-        for (int i = 0; i < n_argc; i++) free(n_argv[i]);
-        free(n_argv);
-        n_argv = NULL;
-        n_argc = 0;
+        // Compile (or take from the cache) and call commands
+        if (line && status != -1) run_line(line);
+        free(pending);
     }
 
     printf("\nBye Bye \033[32m%s\033[0m!\n\n", USER);
 
     return 0;
 }
+#endif
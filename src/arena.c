@@ -0,0 +1,148 @@
+// CShell Project - Bump-pointer arena allocator
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+arena_t LINE_ARENA = { 0 };
+
+
+void arena_init(arena_t *const arena, const size_t chunk_size) {
+    memset(arena, 0, sizeof(arena_t));
+    arena->chunk_size = chunk_size;
+}
+
+
+/**
+ * @see malloc
+ */
+arena_chunk_t *_arena_add_chunk(arena_t *const arena, const size_t size) {
+    const size_t chunk_size = arena->chunk_size ? arena->chunk_size : ARENA_CHUNK_SIZE;
+    const size_t data_size = size > chunk_size ? size : chunk_size;
+
+    arena_chunk_t *const chunk = malloc(sizeof(arena_chunk_t) + data_size);
+    if (!chunk) return NULL;
+    chunk->size = data_size;
+    arena->chunks++;
+
+    // Insert the chunk after the current one, chunks after it are still reused later
+    if (arena->current) {
+        chunk->next = arena->current->next;
+        arena->current->next = chunk;
+    }
+    else {
+        chunk->next = arena->first;
+        arena->first = chunk;
+    }
+
+    return chunk;
+}
+
+
+/**
+ * @see _arena_add_chunk
+ */
+void *arena_alloc(arena_t *const arena, const size_t size) {
+    const size_t aligned = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    // Go to the next chunk if the current one is full, reusing chunks kept by a reset
+    if (!arena->current || arena->used + aligned > arena->current->size) {
+        arena_chunk_t *next = arena->current ? arena->current->next : arena->first;
+        if (!next || next->size < aligned) next = _arena_add_chunk(arena, aligned);
+        if (!next) return NULL;
+
+        arena->current = next;
+        arena->used = 0;
+    }
+
+    void *const ptr = &arena->current->data[arena->used];
+    arena->used += aligned;
+
+    arena->allocations++;
+    arena->bytes += size;
+    if (arena->bytes > arena->peak) arena->peak = arena->bytes;
+
+    return ptr;
+}
+
+
+/**
+ * @see arena_alloc, memcpy
+ */
+void *arena_realloc(arena_t *const arena, void *const ptr, const size_t old_size, const size_t new_size) {
+    if (ptr && new_size <= old_size) return ptr;
+
+    // The last allocation grows in place when the chunk has room
+    const size_t old_aligned = (old_size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    const size_t new_aligned = (new_size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (ptr && arena->current && (char *)ptr + old_aligned == &arena->current->data[arena->used]
+        && arena->used - old_aligned + new_aligned <= arena->current->size) {
+        arena->used += new_aligned - old_aligned;
+        arena->bytes += new_size - old_size;
+        if (arena->bytes > arena->peak) arena->peak = arena->bytes;
+        return ptr;
+    }
+
+    void *const bigger = arena_alloc(arena, new_size);
+    if (bigger && ptr) memcpy(bigger, ptr, old_size);
+    return bigger;
+}
+
+
+/**
+ * @see strnlen, arena_alloc, memcpy
+ */
+char *arena_strndup(arena_t *const arena, const char *const str, const size_t size) {
+    const size_t length = strnlen(str, size);
+    char *const copy = arena_alloc(arena, length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+
+/**
+ * @see arena_strndup, strlen
+ */
+char *arena_strdup(arena_t *const arena, const char *const str) {
+    return arena_strndup(arena, str, strlen(str));
+}
+
+
+arena_mark_t arena_mark(const arena_t *const arena) {
+    const arena_mark_t mark = { arena->current, arena->used };
+    return mark;
+}
+
+
+void arena_rewind(arena_t *const arena, const arena_mark_t mark) {
+    arena->current = mark.chunk;
+    arena->used = mark.used;
+}
+
+
+void arena_reset(arena_t *const arena) {
+    arena->current = NULL;
+    arena->used = 0;
+    arena->allocations = 0;
+    arena->bytes = 0;
+}
+
+
+/**
+ * @see free
+ */
+void arena_destroy(arena_t *const arena) {
+    arena_chunk_t *chunk = arena->first;
+    while (chunk) {
+        arena_chunk_t *const next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena_init(arena, arena->chunk_size);
+}
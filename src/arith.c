@@ -0,0 +1,583 @@
+// CShell Project - Arithmetic expansion and new let command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "arith.h"
+#include "arena.h"
+#include "hash.h"
+#include "variables.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+
+// Compiled expressions, a single one per slot, replaced on collision
+static arith_expr_t *_arith_CACHE[ARITH_CACHE_SIZE] = { NULL };
+
+// Binary operators, the longest first, with their priority (higher binds tighter)
+static const struct {
+    const char *text;
+    arith_op_t op;
+    int priority;
+} _ARITH_BINARY[] = {
+    { "**", ARITH_POW, 11 },
+    { "<<", ARITH_SHL, 8 }, { ">>", ARITH_SHR, 8 },
+    { "<=", ARITH_LE, 7 }, { ">=", ARITH_GE, 7 },
+    { "==", ARITH_EQ, 6 }, { "!=", ARITH_NE, 6 },
+    { "&&", ARITH_JUMP_FALSE, 2 }, { "||", ARITH_JUMP_TRUE, 1 },
+    { "*", ARITH_MUL, 10 }, { "/", ARITH_DIV, 10 }, { "%", ARITH_MOD, 10 },
+    { "+", ARITH_ADD, 9 }, { "-", ARITH_SUB, 9 },
+    { "<", ARITH_LT, 7 }, { ">", ARITH_GT, 7 },
+    { "&", ARITH_BIT_AND, 5 }, { "^", ARITH_BIT_XOR, 4 }, { "|", ARITH_BIT_OR, 3 },
+    { NULL, ARITH_NOP, 0 },
+};
+
+// Assignment operators, the longest first
+static const struct {
+    const char *text;
+    arith_op_t op;
+} _ARITH_ASSIGN[] = {
+    { "<<=", ARITH_SHL }, { ">>=", ARITH_SHR },
+    { "*=", ARITH_MUL }, { "/=", ARITH_DIV }, { "%=", ARITH_MOD }, { "+=", ARITH_ADD }, { "-=", ARITH_SUB },
+    { "&=", ARITH_BIT_AND }, { "^=", ARITH_BIT_XOR }, { "|=", ARITH_BIT_OR },
+    { "=", ARITH_NOP },
+    { NULL, ARITH_NOP },
+};
+
+
+void _arith_skip_spaces(arith_compiler_t *const compiler) {
+    while (isspace((unsigned char)*compiler->ptr)) compiler->ptr++;
+}
+
+
+/**
+ * @see realloc
+ */
+int _arith_emit(arith_compiler_t *const compiler, const arith_op_t op, const long long value, const char *const name) {
+    if (compiler->error) return -1;
+    if (compiler->count >= compiler->capacity) {
+        const int capacity = compiler->capacity ? 2 * compiler->capacity : 16;
+        arith_instr_t *const code = realloc(compiler->code, capacity * sizeof(arith_instr_t));
+        if (!code) {
+            compiler->error = 1;
+            return -1;
+        }
+        compiler->code = code;
+        compiler->capacity = capacity;
+    }
+
+    arith_instr_t *const instr = &compiler->code[compiler->count];
+    instr->op = op;
+    instr->binary = ARITH_NOP;
+    instr->value = value;
+    instr->name = name;
+
+    // Keep track of the depth of the stack, to allocate it at once when running
+    if (op == ARITH_PUSH || op == ARITH_LOAD || op == ARITH_PRE_INCREMENT || op == ARITH_POST_INCREMENT) compiler->depth++;
+    else if (op == ARITH_POP || op == ARITH_JUMP_FALSE || op == ARITH_JUMP_TRUE || (op >= ARITH_MUL && op <= ARITH_POW)) compiler->depth--;
+    if (compiler->depth > compiler->max_depth) compiler->max_depth = compiler->depth;
+
+    return compiler->count++;
+}
+
+
+/**
+ * @see isalpha, isalnum, arena_strndup
+ */
+const char *_arith_read_name(arith_compiler_t *const compiler) {
+    const char *const start = compiler->ptr;
+    if (!isalpha((unsigned char)*start) && *start != '_') return NULL;
+
+    const char *end = start;
+    while (isalnum((unsigned char)*end) || *end == '_') end++;
+    compiler->ptr = end;
+
+    const char *const name = arena_strndup(compiler->arena, start, end - start);
+    if (!name) compiler->error = 1;
+    return name;
+}
+
+
+/**
+ * @see _arith_skip_spaces, _arith_parse_comma, strtoll, isalnum, _arith_emit, _arith_read_name, strncmp
+ */
+void _arith_parse_primary(arith_compiler_t *const compiler) {
+    _arith_skip_spaces(compiler);
+    const char c = *compiler->ptr;
+
+    // ( expression )
+    if (c == '(') {
+        compiler->ptr++;
+        _arith_parse_comma(compiler);
+        _arith_skip_spaces(compiler);
+        if (*compiler->ptr != ')') compiler->error = 1;
+        else compiler->ptr++;
+    }
+
+    // Numbers: decimal, 0x hexadecimal, 0 octal, or base#digits
+    else if (isdigit((unsigned char)c)) {
+        char *end;
+        long long value = strtoll(compiler->ptr, &end, 0);
+        if (*end == '#') {
+            const long long base = value;
+            const char *const digits = end + 1;
+            value = base >= 2 && base <= 36 ? strtoll(digits, &end, base) : 0;
+            if (base < 2 || base > 36 || end == digits) compiler->error = 1;
+        }
+        if (isalnum((unsigned char)*end) || *end == '_') compiler->error = 1;
+        compiler->ptr = end;
+        _arith_emit(compiler, ARITH_PUSH, value, NULL);
+    }
+
+    // Variables, maybe followed by ++ or --
+    else if (isalpha((unsigned char)c) || c == '_') {
+        const char *const name = _arith_read_name(compiler);
+        _arith_skip_spaces(compiler);
+        if (strncmp(compiler->ptr, "++", 2) == 0 || strncmp(compiler->ptr, "--", 2) == 0) {
+            _arith_emit(compiler, ARITH_POST_INCREMENT, *compiler->ptr == '+' ? 1 : -1, name);
+            compiler->ptr += 2;
+        }
+        else _arith_emit(compiler, ARITH_LOAD, 0, name);
+    }
+
+    else compiler->error = 1;
+}
+
+
+/**
+ * @see _arith_skip_spaces, strncmp, isalpha, _arith_read_name, _arith_emit, _arith_parse_primary
+ */
+void _arith_parse_unary(arith_compiler_t *const compiler) {
+    _arith_skip_spaces(compiler);
+    const char c = *compiler->ptr;
+
+    // ++name and --name, otherwise two signs
+    if ((c == '+' || c == '-') && compiler->ptr[1] == c) {
+        const char *const save = compiler->ptr;
+        compiler->ptr += 2;
+        _arith_skip_spaces(compiler);
+        if (isalpha((unsigned char)*compiler->ptr) || *compiler->ptr == '_') {
+            const char *const name = _arith_read_name(compiler);
+            _arith_emit(compiler, ARITH_PRE_INCREMENT, c == '+' ? 1 : -1, name);
+            return;
+        }
+        compiler->ptr = save;
+    }
+
+    if (c == '+' || c == '-' || c == '!' || c == '~') {
+        compiler->ptr++;
+        _arith_parse_unary(compiler);
+        if (c == '-')      _arith_emit(compiler, ARITH_NEGATE, 0, NULL);
+        else if (c == '!') _arith_emit(compiler, ARITH_NOT, 0, NULL);
+        else if (c == '~') _arith_emit(compiler, ARITH_BIT_NOT, 0, NULL);
+        return;
+    }
+
+    _arith_parse_primary(compiler);
+}
+
+
+/**
+ * @see _arith_parse_unary, _arith_skip_spaces, strncmp, strlen, _arith_emit
+ */
+void _arith_parse_binary(arith_compiler_t *const compiler, const int min_priority) {
+    _arith_parse_unary(compiler);
+
+    while (!compiler->error) {
+        _arith_skip_spaces(compiler);
+
+        // Find the operator, an operator followed by = is an assignment
+        int k = 0;
+        while (_ARITH_BINARY[k].text && strncmp(compiler->ptr, _ARITH_BINARY[k].text, strlen(_ARITH_BINARY[k].text)) != 0) k++;
+        if (!_ARITH_BINARY[k].text || _ARITH_BINARY[k].priority < min_priority) break;
+        const size_t length = strlen(_ARITH_BINARY[k].text);
+        const arith_op_t op = _ARITH_BINARY[k].op;
+        if (compiler->ptr[length] == '=' && op != ARITH_LE && op != ARITH_GE && op != ARITH_EQ && op != ARITH_NE) break;
+        compiler->ptr += length;
+
+        // && and || only evaluate their right side if needed, the result is 0 or 1
+        if (op == ARITH_JUMP_FALSE || op == ARITH_JUMP_TRUE) {
+            const int skip = _arith_emit(compiler, op, 0, NULL);
+            _arith_parse_binary(compiler, _ARITH_BINARY[k].priority + 1);
+            _arith_emit(compiler, ARITH_BOOL, 0, NULL);
+            const int jump = _arith_emit(compiler, ARITH_JUMP, 0, NULL);
+            compiler->depth--;
+            if (compiler->error) return;
+            compiler->code[skip].value = compiler->count;
+            _arith_emit(compiler, ARITH_PUSH, op == ARITH_JUMP_TRUE, NULL);
+            if (compiler->error) return;
+            compiler->code[jump].value = compiler->count;
+            continue;
+        }
+
+        // ** is read from right to left, other operators from left to right
+        _arith_parse_binary(compiler, op == ARITH_POW ? _ARITH_BINARY[k].priority : _ARITH_BINARY[k].priority + 1);
+        _arith_emit(compiler, op, 0, NULL);
+    }
+}
+
+
+/**
+ * @see _arith_parse_binary, _arith_skip_spaces, _arith_emit, _arith_parse_comma
+ */
+void _arith_parse_ternary(arith_compiler_t *const compiler) {
+    _arith_parse_binary(compiler, 1);
+    _arith_skip_spaces(compiler);
+    if (compiler->error || *compiler->ptr != '?') return;
+    compiler->ptr++;
+
+    // condition ? then : else, only one side is evaluated
+    const int skip = _arith_emit(compiler, ARITH_JUMP_FALSE, 0, NULL);
+    _arith_parse_comma(compiler);
+    _arith_skip_spaces(compiler);
+    if (*compiler->ptr != ':') compiler->error = 1;
+    const int jump = _arith_emit(compiler, ARITH_JUMP, 0, NULL);
+    compiler->depth--;
+    if (compiler->error) return;
+    compiler->ptr++;
+
+    compiler->code[skip].value = compiler->count;
+    _arith_parse_ternary(compiler);
+    if (compiler->error) return;
+    compiler->code[jump].value = compiler->count;
+}
+
+
+/**
+ * @see _arith_skip_spaces, _arith_read_name, strncmp, strlen, _arith_emit, _arith_parse_ternary
+ */
+void _arith_parse_assignment(arith_compiler_t *const compiler) {
+    _arith_skip_spaces(compiler);
+
+    // name op= expression, read from right to left
+    const char *const save = compiler->ptr;
+    const char *const name = _arith_read_name(compiler);
+    if (name) {
+        _arith_skip_spaces(compiler);
+        int k = 0;
+        while (_ARITH_ASSIGN[k].text && strncmp(compiler->ptr, _ARITH_ASSIGN[k].text, strlen(_ARITH_ASSIGN[k].text)) != 0) k++;
+
+        // = is an assignment, but not ==
+        if (_ARITH_ASSIGN[k].text && !(_ARITH_ASSIGN[k].op == ARITH_NOP && compiler->ptr[1] == '=')) {
+            compiler->ptr += strlen(_ARITH_ASSIGN[k].text);
+            _arith_parse_assignment(compiler);
+            const int store = _arith_emit(compiler, ARITH_STORE, 0, name);
+            if (store != -1) compiler->code[store].binary = _ARITH_ASSIGN[k].op;
+            return;
+        }
+    }
+    compiler->ptr = save;
+
+    _arith_parse_ternary(compiler);
+}
+
+
+/**
+ * @see _arith_parse_assignment, _arith_skip_spaces, _arith_emit
+ */
+void _arith_parse_comma(arith_compiler_t *const compiler) {
+    _arith_parse_assignment(compiler);
+    _arith_skip_spaces(compiler);
+
+    // Only the value of the last expression is kept
+    while (!compiler->error && *compiler->ptr == ',') {
+        compiler->ptr++;
+        _arith_emit(compiler, ARITH_POP, 0, NULL);
+        _arith_parse_assignment(compiler);
+        _arith_skip_spaces(compiler);
+    }
+}
+
+
+/**
+ * @see arena_destroy, free
+ */
+void _arith_free(arith_expr_t *const expr) {
+    if (!expr) return;
+    arena_destroy(&expr->arena);
+    free(expr);
+}
+
+
+/**
+ * @see calloc, arena_init, arena_strdup, _arith_skip_spaces, _arith_emit, _arith_parse_comma, sink_error, arena_alloc, memcpy, free, _arith_free
+ */
+arith_expr_t *_arith_build(const char *const expression) {
+    arith_expr_t *const expr = calloc(1, sizeof(arith_expr_t));
+    if (!expr) return NULL;
+    arena_init(&expr->arena, ARITH_ARENA_CHUNK_SIZE);
+
+    arith_compiler_t compiler = { 0 };
+    compiler.ptr = expression;
+    compiler.arena = &expr->arena;
+
+    // An empty expression is 0
+    _arith_skip_spaces(&compiler);
+    if (!(*compiler.ptr)) _arith_emit(&compiler, ARITH_PUSH, 0, NULL);
+    else _arith_parse_comma(&compiler);
+    if (!compiler.error && *compiler.ptr) compiler.error = 1;
+
+    if (compiler.error) sink_error("%s: syntax error in expression (error token is \"%s\")\n", expression, compiler.ptr);
+
+    // The instructions are moved inside the arena, next to the names
+    if (!compiler.error) {
+        expr->text = arena_strdup(&expr->arena, expression);
+        expr->code = arena_alloc(&expr->arena, compiler.count * sizeof(arith_instr_t));
+        if (expr->text && expr->code) memcpy(expr->code, compiler.code, compiler.count * sizeof(arith_instr_t));
+        expr->count = compiler.count;
+        expr->depth = compiler.max_depth;
+    }
+    free(compiler.code);
+
+    if (compiler.error || !expr->text || !expr->code) {
+        _arith_free(expr);
+        return NULL;
+    }
+    return expr;
+}
+
+
+/**
+ * @see _hash_string, strcmp, _arith_build, _arith_free
+ */
+arith_expr_t *_arith_compile(const char *const expression) {
+    const unsigned long hash = _hash_string(expression);
+    arith_expr_t **const slot = &_arith_CACHE[hash & (ARITH_CACHE_SIZE - 1)];
+    if (*slot && (*slot)->hash == hash && strcmp((*slot)->text, expression) == 0) return *slot;
+
+    arith_expr_t *const expr = _arith_build(expression);
+    if (!expr) return NULL;
+    expr->hash = hash;
+
+    _arith_free(*slot);
+    *slot = expr;
+    return expr;
+}
+
+
+/**
+ * @see sink_error
+ */
+int _arith_apply(const arith_op_t op, const long long a, const long long b, long long *const result) {
+    // Overflows wrap around like in other shells, through unsigned operations
+    const unsigned long long ua = (unsigned long long)a, ub = (unsigned long long)b;
+    switch (op) {
+        case ARITH_MUL: *result = (long long)(ua * ub); return 0;
+        case ARITH_ADD: *result = (long long)(ua + ub); return 0;
+        case ARITH_SUB: *result = (long long)(ua - ub); return 0;
+        case ARITH_SHL: *result = (long long)(ua << (b & 63)); return 0;
+        case ARITH_SHR: *result = a >> (b & 63); return 0;
+        case ARITH_LT: *result = a < b; return 0;
+        case ARITH_LE: *result = a <= b; return 0;
+        case ARITH_GT: *result = a > b; return 0;
+        case ARITH_GE: *result = a >= b; return 0;
+        case ARITH_EQ: *result = a == b; return 0;
+        case ARITH_NE: *result = a != b; return 0;
+        case ARITH_BIT_AND: *result = a & b; return 0;
+        case ARITH_BIT_XOR: *result = a ^ b; return 0;
+        case ARITH_BIT_OR: *result = a | b; return 0;
+        case ARITH_NOP: *result = b; return 0;
+
+        case ARITH_DIV:
+        case ARITH_MOD:
+            if (b == 0) {
+                sink_error("division by 0\n");
+                return -1;
+            }
+            // The smallest number divided by -1 does not fit
+            if (b == -1) *result = op == ARITH_DIV ? (long long)(0ULL - ua) : 0;
+            else *result = op == ARITH_DIV ? a / b : a % b;
+            return 0;
+
+        case ARITH_POW:
+            if (b < 0) {
+                sink_error("exponent less than 0\n");
+                return -1;
+            }
+            unsigned long long power = 1, base = ua;
+            for (long long e = b; e > 0; e >>= 1) {
+                if (e & 1) power *= base;
+                base *= base;
+            }
+            *result = (long long)power;
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+
+/**
+ * @see var_get, strtoll, isspace, sink_error, _arith_build, _arith_run, _arith_free
+ */
+int _arith_get(const char *const name, long long *const value, const int nesting) {
+    // Unset and empty variables are 0
+    const char *const text = var_get(name);
+    *value = 0;
+    if (!text || !(*text)) return 0;
+
+    char *end;
+    *value = strtoll(text, &end, 0);
+    while (isspace((unsigned char)*end)) end++;
+    if (!(*end)) return 0;
+
+    // A value which is not a number is itself an expression, compiled aside to not evict the running one
+    if (nesting >= ARITH_MAX_NESTING) {
+        sink_error("%s: expression recursion level exceeded\n", name);
+        return -1;
+    }
+    arith_expr_t *const expr = _arith_build(text);
+    if (!expr) return -1;
+    const int error = _arith_run(expr, value, nesting + 1);
+    _arith_free(expr);
+    return error;
+}
+
+
+/**
+ * @see snprintf, var_set
+ */
+void _arith_set(const char *const name, const long long value) {
+    char number[32];
+    snprintf(number, sizeof(number), "%lld", value);
+    var_set(name, number);
+}
+
+
+/**
+ * @see _arith_get, _arith_apply, _arith_set
+ */
+int _arith_run(const arith_expr_t *const expr, long long *const result, const int nesting) {
+    long long stack[expr->depth + 1];
+    int top = 0;
+    long long old;
+
+    for (int pc = 0; pc < expr->count; pc++) {
+        const arith_instr_t *const instr = &expr->code[pc];
+        switch (instr->op) {
+            case ARITH_PUSH:
+                stack[top++] = instr->value;
+                break;
+
+            case ARITH_LOAD:
+                if (_arith_get(instr->name, &stack[top++], nesting) == -1) return -1;
+                break;
+
+            case ARITH_STORE:
+                if (instr->binary != ARITH_NOP) {
+                    if (_arith_get(instr->name, &old, nesting) == -1) return -1;
+                    if (_arith_apply(instr->binary, old, stack[top - 1], &stack[top - 1]) == -1) return -1;
+                }
+                _arith_set(instr->name, stack[top - 1]);
+                break;
+
+            case ARITH_PRE_INCREMENT:
+            case ARITH_POST_INCREMENT:
+                if (_arith_get(instr->name, &old, nesting) == -1) return -1;
+                _arith_set(instr->name, (long long)((unsigned long long)old + instr->value));
+                stack[top++] = instr->op == ARITH_PRE_INCREMENT ? (long long)((unsigned long long)old + instr->value) : old;
+                break;
+
+            case ARITH_NEGATE:  stack[top - 1] = (long long)(0ULL - (unsigned long long)stack[top - 1]); break;
+            case ARITH_NOT:     stack[top - 1] = !stack[top - 1]; break;
+            case ARITH_BIT_NOT: stack[top - 1] = ~stack[top - 1]; break;
+            case ARITH_BOOL:    stack[top - 1] = stack[top - 1] != 0; break;
+            case ARITH_POP:     top--; break;
+            case ARITH_NOP:     break;
+
+            // The loop increments pc after the jump
+            case ARITH_JUMP:
+                pc = instr->value - 1;
+                break;
+            case ARITH_JUMP_FALSE:
+                if (!stack[--top]) pc = instr->value - 1;
+                break;
+            case ARITH_JUMP_TRUE:
+                if (stack[--top]) pc = instr->value - 1;
+                break;
+
+            default:
+                top--;
+                if (_arith_apply(instr->op, stack[top - 1], stack[top], &stack[top - 1]) == -1) return -1;
+                break;
+        }
+    }
+
+    *result = top > 0 ? stack[top - 1] : 0;
+    return 0;
+}
+
+
+/**
+ * @see _arith_compile, _arith_run
+ */
+int arith_evaluate(const char *const expression, long long *const result) {
+    const arith_expr_t *const expr = _arith_compile(expression);
+    if (!expr) return -1;
+    return _arith_run(expr, result, 0);
+}
+
+
+/**
+ * @see _arith_free
+ */
+void arith_cache_clear() {
+    for (int i = 0; i < ARITH_CACHE_SIZE; i++) {
+        _arith_free(_arith_CACHE[i]);
+        _arith_CACHE[i] = NULL;
+    }
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _let_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] expression...\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+}
+
+
+/**
+ * @see strcmp, _let_print_usage, sink_error, arith_evaluate
+ */
+int our_let(const int argc, const char *const *const argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        _let_print_usage(argv[0]);
+        return 0;
+    }
+    if (argc < 2) {
+        sink_error("%s: expression expected\n", argv[0]);
+        return 1;
+    }
+
+    // Every expression is evaluated, the last one gives the return code
+    long long value = 0;
+    for (int i = 1; i < argc; i++) {
+        if (arith_evaluate(argv[i], &value) == -1) return 1;
+    }
+
+    return value == 0;
+}
+
+
+REGISTER_BUILTIN("let", our_let, 0);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_let(argc, argv);
+}
+#endif
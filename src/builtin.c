@@ -0,0 +1,103 @@
+// CShell Project - Registry of builtin commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "builtin.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+
+// Bounds of the cshell_builtins section, given by the linker
+extern const builtin_entry_t __start_cshell_builtins[];
+extern const builtin_entry_t __stop_cshell_builtins[];
+
+// Perfect hash table of builtins, every builtin has its own slot
+static const builtin_entry_t **_builtin_TABLE = NULL;
+// Number of slots of the table minus 1 (power of 2)
+static unsigned int _builtin_MASK = 0;
+// Seed of the hash giving no collision
+static unsigned int _builtin_SEED = 0;
+// The table is built once, by the first lookup of any thread
+static pthread_once_t _builtin_TABLE_ONCE = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @see _hash_string
+ */
+unsigned int _builtin_hash(const char *name, const unsigned int seed) {
+    // Mix the seed into every bit, so that names sharing low bits of their hash are split by another seed
+    unsigned long hash = _hash_string(name) ^ (seed * 0x9E3779B97F4A7C15UL);
+    hash ^= hash >> 31;
+    hash *= 0xBF58476D1CE4E5B9UL;
+    hash ^= hash >> 29;
+    return (unsigned int)hash;
+}
+
+
+/**
+ * @see strcmp, fprintf, abort, calloc, realloc, memset, _builtin_hash
+ */
+void _builtin_build_table() {
+    const int count = __stop_cshell_builtins - __start_cshell_builtins;
+
+    // Two builtins with the same name collide with every seed, the search would never end
+    for (int i = 0; i < count; i++) for (int j = i + 1; j < count; j++) {
+        if (strcmp(__start_cshell_builtins[i].name, __start_cshell_builtins[j].name) != 0) continue;
+        fprintf(stderr, "cshell: builtin %s is registered twice\n", __start_cshell_builtins[i].name);
+        abort();
+    }
+
+    // Start with at least twice more slots than builtins
+    unsigned int size = 8;
+    while (size < 2 * (unsigned int)count) size *= 2;
+
+    const builtin_entry_t **table = calloc(size, sizeof(builtin_entry_t *));
+    if (!table) return;
+
+    unsigned int seed = 0, slot;
+    int i;
+    while (1) {
+        // Try to place every builtin with this seed
+        for (i = 0; i < count; i++) {
+            slot = _builtin_hash(__start_cshell_builtins[i].name, seed) & (size - 1);
+            if (table[slot]) break;
+            table[slot] = &__start_cshell_builtins[i];
+        }
+        if (i == count) break;
+
+        // Collision, try next seed and make the table bigger from time to time
+        memset(table, 0, size * sizeof(builtin_entry_t *));
+        if (++seed % 64 == 0) {
+            size *= 2;
+            const builtin_entry_t **bigger = realloc(table, size * sizeof(builtin_entry_t *));
+            if (!bigger) {
+                free(table);
+                return;
+            }
+            table = bigger;
+            memset(table, 0, size * sizeof(builtin_entry_t *));
+        }
+    }
+
+    _builtin_TABLE = table;
+    _builtin_MASK = size - 1;
+    _builtin_SEED = seed;
+}
+
+
+/**
+ * @see pthread_once, _builtin_build_table, _builtin_hash, strcmp
+ */
+const builtin_entry_t *builtin_lookup(const char *const name) {
+    pthread_once(&_builtin_TABLE_ONCE, _builtin_build_table);
+    if (_builtin_TABLE == NULL) return NULL;
+
+    const builtin_entry_t *const entry = _builtin_TABLE[_builtin_hash(name, _builtin_SEED) & _builtin_MASK];
+    if (entry && strcmp(entry->name, name) == 0) return entry;
+
+    return NULL;
+}
@@ -3,20 +3,29 @@
 // Date: 2025-03-17
 
 
+#include "config.h"
 #include "cat.h"
+#include "sink.h"
+#include "builtin.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+
+// Buffer size to read/write files
+#define _cat_BUFFER_SIZE 65536
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _cat_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options]\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
 }
 
 
@@ -38,7 +47,28 @@ int _cat_parse_arguments(const int argc, const char *const *const argv) {
 
 
 /**
- * @see _cat_parse_arguments
+ * @see source_read, sink_write
+ */
+int _cat_copy(const int fd) {
+    char buffer[_cat_BUFFER_SIZE];
+    ssize_t size;
+
+    // Read by blocks from the file, or from the input of the command if fd is -1
+    while (1) {
+        if (fd == -1) size = source_read(buffer, _cat_BUFFER_SIZE);
+        else          size = read(fd, buffer, _cat_BUFFER_SIZE);
+        if (size <= 0) break;
+
+        // Stop if the output is closed (e.g. next stage of the pipeline is done)
+        if (sink_write(buffer, size) == -1) return 1;
+    }
+
+    return size == -1;
+}
+
+
+/**
+ * @see _cat_parse_arguments, _cat_copy, openat, sink_perror, close
  */
 int our_cat(const int argc, const char *const *const argv) {
     // Parse the arguments
@@ -47,28 +77,28 @@ int our_cat(const int argc, const char *const *const argv) {
     if (parse_result) return parse_result;
 
     // Check if there are any files to read else read form stdin
-    if (argc == 1) {
-        int character;
-        while ((character = getchar()) != EOF) putchar(character);
-        return 0;
-    }
+    if (argc == 1) return _cat_copy(-1);
 
     // Loop through each file and print its contents
+    int res = 0;
     for (int i = 1; i < argc; i++) {
-        FILE *file = fopen(argv[i], "r");
-        if (file == NULL) {
-            perror("Error opening file");
+        int file = openat(CWD_FD, argv[i], O_RDONLY | O_CLOEXEC);
+        if (file == -1) {
+            sink_perror("Error opening file");
             continue;
         }
-        int character;
-        while ((character = fgetc(file)) != EOF) putchar(character);
-        fclose(file);
+        res = _cat_copy(file);
+        close(file);
+        if (res) break;
     }
 
-    return 0;
+    return res;
 }
 
 
+REGISTER_BUILTIN("cat", our_cat, BUILTIN_FUSABLE | BUILTIN_READS_STDIN);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
@@ -3,23 +3,29 @@
 // Date: 2025-03-17
 
 
+#define _GNU_SOURCE
 #include "config.h"
 #include "cd.h"
+#include "pwd_cmd.h"
+#include "variables.h"
+#include "sink.h"
+#include "builtin.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <assert.h>
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _cd_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options]\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
 }
 
 
@@ -41,7 +47,26 @@ int _cd_parse_arguments(const int argc, const char *const *const argv) {
 
 
 /**
- * @see _cd_parse_arguments
+ * @see chdir, openat, faccessat, fcntl, close
+ */
+int _cd_change_directory(const char *const path) {
+    if (CWD_FD == AT_FDCWD) return chdir(path);
+
+    // Entering a directory needs the search permission, as for chdir
+    const int fd = openat(CWD_FD, path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    const int moved = faccessat(fd, ".", X_OK, 0) == 0 ? fcntl(fd, F_DUPFD_CLOEXEC, SHELL_FDS_COUNT) : -1;
+    close(fd);
+    if (moved == -1) return -1;
+
+    close(CWD_FD);
+    CWD_FD = moved;
+    return 0;
+}
+
+
+/**
+ * @see _cd_parse_arguments, var_get, sink_perror, _cd_change_directory, strncpy, pwd_physical
  */
 int our_cd(const int argc, const char *const *const argv) {
     // Parse the arguments
@@ -51,28 +76,35 @@ int our_cd(const int argc, const char *const *const argv) {
 
     const char *path = argv[1];
     if (argc == 1 || ((argc == 2) && (strcmp(argv[1], "~") == 0))) {
-        path = getenv("HOME");
+        path = var_get("HOME");
         if (path == NULL) {
-            perror("cd: HOME not set");
+            sink_perror("cd: HOME not set");
             return 1;
         }
     }
 
     if ((argc == 2) && strcmp(argv[1], "-") == 0) {
         if (PWD[0] == '\0') {
-            perror("cd: no previous directory");
+            sink_perror("cd: no previous directory");
             return 1;
         }
         path = PWD;
     }
 
-    if (chdir(path) == 0) strncpy(PWD, CWD, MAX_PATH_LENGTH);
-    else perror("cd error");
+    // Keep CWD up to date, pwd answers from it
+    if (_cd_change_directory(path) == 0) {
+        strncpy(PWD, CWD, MAX_PATH_LENGTH);
+        if (pwd_physical(CWD) == -1) CWD[0] = '\0';
+    }
+    else sink_perror("cd error");
 
     return 0;
 }
 
 
+REGISTER_BUILTIN("cd", our_cd, 0);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
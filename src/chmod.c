@@ -3,22 +3,26 @@
 // Date: 2025-03-17
 
 
+#include "config.h"
 #include "chmod.h"
+#include "sink.h"
+#include "builtin.h"
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <fcntl.h>
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _chmod_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options]\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
 }
 
 
@@ -36,7 +40,7 @@ int _chmod_parse_arguments(const int argc, const char *const *const argv, const
         }
 
         else if (argv[i][0] == '-' && strlen(argv[i]) > 1) {
-            perror("Unknown option");
+            sink_perror("Unknown option");
             return 1;
         }
 
@@ -45,13 +49,13 @@ int _chmod_parse_arguments(const int argc, const char *const *const argv, const
         else if (*file_arg == NULL) *file_arg = argv[i];
 
         else {
-            perror("Too many arguments");
+            sink_perror("Too many arguments");
             return 1;
         }
     }
 
     if (*mode_arg == NULL || *file_arg == NULL) {
-        perror("Missing mode or file");
+        sink_perror("Missing mode or file");
         return 1;
     }
 
@@ -74,11 +78,11 @@ int our_chmod(const int argc, const char *const *const argv) {
     char *endptr;
     long mode = strtol(mode_str, &endptr, 8);
     if (*endptr != '\0') {
-        perror("Invalid mode");
+        sink_perror("Invalid mode");
         return 1;
     }
-    if (chmod(filename, (mode_t)mode) != 0) {
-        perror("Error changing mode of file");
+    if (fchmodat(CWD_FD, filename, (mode_t)mode, 0) != 0) {
+        sink_perror("Error changing mode of file");
         return 1;
     }
 
@@ -86,6 +90,9 @@ int our_chmod(const int argc, const char *const *const argv) {
 }
 
 
+REGISTER_BUILTIN("chmod", our_chmod, BUILTIN_FUSABLE);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
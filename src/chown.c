@@ -3,7 +3,10 @@
 // Date: 2025-03-17
 
 
+#include "config.h"
 #include "chown.h"
+#include "sink.h"
+#include "builtin.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -12,15 +15,16 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/types.h>
+#include <fcntl.h>
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _chown_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options]\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
 }
 
 
@@ -29,7 +33,7 @@ void _chown_print_usage(const char *const program_name) {
  */
 int _chown_parse_arguments(const int argc, const char *const *const argv) {
     if (argc < 3) {
-        perror("Error: Not enough arguments");
+        sink_perror("Error: Not enough arguments");
         _chown_print_usage(argv[0]);
         return 1;
     }
@@ -63,7 +67,7 @@ int our_chown(const int argc, const char *const *const argv) {
     // Get the provided owner
     struct passwd *pwd = getpwnam(owner);
     if (!pwd) {
-        perror("Error: User not found");
+        sink_perror("Error: User not found");
         return -1;
     }
 
@@ -74,7 +78,7 @@ int our_chown(const int argc, const char *const *const argv) {
     if (group) {
         struct group *grp = getgrnam(group);
         if (!grp) {
-            perror("Error: Group not found");
+            sink_perror("Error: Group not found");
             return 1;
         }
         gid = grp->gr_gid;
@@ -83,17 +87,20 @@ int our_chown(const int argc, const char *const *const argv) {
     // Loop through each file and change ownership
     for (int i = 2; i < argc; i++) {
         const char *const file = argv[i];
-        if (chown(file, uid, gid) != 0) {
-            perror("Error: Failed to change ownership");
+        if (fchownat(CWD_FD, file, uid, gid, 0) != 0) {
+            sink_perror("Error: Failed to change ownership");
             return 1;
         }
-        printf("Changed ownership of '%s' to '%s:%s'\n", file, owner, group ? group : "none");
+        sink_printf("Changed ownership of '%s' to '%s:%s'\n", file, owner, group ? group : "none");
     }
 
     return 0;
 }
 
 
+REGISTER_BUILTIN("chown", our_chown, 0);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
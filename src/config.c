@@ -6,11 +6,30 @@
 #include "config.h"
 #include <unistd.h>
 #include <string.h>
+#include <fcntl.h>
 #include <termios.h>
 
 
 char COMMAND[MAX_LINE_LENGTH] = { '\0' };
-char HISTORY[HISTORY_SIZE][MAX_LINE_LENGTH] = { { '\0' } };
+static char _config_HISTORY[HISTORY_SIZE][MAX_LINE_LENGTH] = { { '\0' } };
+char (*HISTORY)[MAX_LINE_LENGTH] = _config_HISTORY;
 char CWD[MAX_PATH_LENGTH] = { '\0' };
 char PWD[MAX_PATH_LENGTH] = { '\0' };
+int CWD_FD = AT_FDCWD;
 char USER[MAX_ENV_NAME_LENGTH] = { '\0' };
+int SHELL_EXIT = 0;
+int EMBEDDED = 0;
+int TRACE_ENABLED = 0;
+int SHELL_FDS[SHELL_FDS_COUNT] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+int PIPE_SIZE = 0;
+int PIPE_BUFFERED = 0;
+int PIPE_FUSION = 1;
+int PIPE_STATUS[MAX_PIPELINE_STAGES] = { 0 };
+int PIPE_STATUS_COUNT = 0;
+int LAST_RETURN_CODE = 0;
+int INTERACTIVE = 0;
+int MAX_JOBS = 0;
+int SOURCE_CACHE = 1;
+int LOOP_DEPTH = 0;
+int LOOP_BREAK = 0;
+int LOOP_CONTINUE = 0;
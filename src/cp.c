@@ -5,35 +5,30 @@
 
 #define _GNU_SOURCE
 #include "cp.h"
+#include "sink.h"
+#include "stats.h"
+#include "trace.h"
+#include "builtin.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <dirent.h>
 
 
-// Debug flag to print debug messages
-static int _cp_DEBUG = 0;
-// Space indentation for folders
-static int _cp_SPACE = 0;
-// Hidden flag to allow secret files/folders
-static int _cp_HIDDEN = 0;
-// Buffer size to read/write files
-static int _cp_BUFFER_SIZE = 1024;
-
-
 /**
- * @see strlen, malloc, strcpy, strcat, fprintf
+ * @see strlen, malloc, strcpy, strcat, sink_error
  */
-char *_cp_path_file_concat(const char *path, const char *name) {
+char *_cp_path_file_concat(const char *path, const char *name, const cp_options_t *const options) {
     int path_size = strlen(path);
 
     // +2 because of the '/' and '\0'
     char *res = malloc(path_size + strlen(name) + 2);
     if (res == NULL) {
-        if (_cp_DEBUG) fprintf(stderr, "%*s  No more memory to malloc\n", _cp_SPACE, "");
+        if (options->debug) sink_error("%*s  No more memory to malloc\n", options->space, "");
         return NULL;
     }
 
@@ -47,35 +42,37 @@ char *_cp_path_file_concat(const char *path, const char *name) {
 
 
 /**
- * @see open, stat, chmod, copy_file_range, close, fprintf
+ * @see openat, fstatat, fchmodat, copy_file_range, stats_add, close, sink_error
  */
-int _cp_copy_file(const char *input_path, const char *output_path) {
-    if (_cp_DEBUG) fprintf(stdout, "%*s- Copying file %s to %s\n", _cp_SPACE, "", input_path, output_path);
+int _cp_copy_file(const char *input_path, const char *output_path, const cp_options_t *const options) {
+    if (options->debug) sink_printf("%*s- Copying file %s to %s\n", options->space, "", input_path, output_path);
 
     // Open the input file for reading
-    int input_file  = open(input_path,  O_RDONLY);
+    int input_file  = openat(CWD_FD, input_path,  O_RDONLY | O_CLOEXEC);
     if (input_file == -1) {
-        if (_cp_DEBUG) fprintf(stderr, "%*s  Error reading file %s\n", _cp_SPACE, "", input_path);
+        if (options->debug) sink_error("%*s  Error reading file %s\n", options->space, "", input_path);
         return 1;
     }
 
     // Open the output file for writing (create and no overwrite)
-    int output_file = open(output_path, O_WRONLY | O_CREAT | O_EXCL, 0660);
+    int output_file = openat(CWD_FD, output_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
     if (output_file == -1) {
-        if (_cp_DEBUG) fprintf(stderr, "%*s  Error writing in file %s\n", _cp_SPACE, "", output_path);
+        if (options->debug) sink_error("%*s  Error writing in file %s\n", options->space, "", output_path);
         return 1;
     }
 
     // Copy the permissions of the input file to the output file
     struct stat input_perms;
-    if (stat(input_path, &input_perms) != 0 && _cp_DEBUG)          fprintf(stderr, "%*s  Error reading permissions of %s\n", _cp_SPACE, "", input_path);
-    if (chmod(output_path, input_perms.st_mode) != 0 && _cp_DEBUG) fprintf(stderr, "%*s  Error setting permissions of %s\n", _cp_SPACE, "", output_path);
+    if (fstatat(CWD_FD, input_path, &input_perms, 0) != 0 && options->debug)          sink_error("%*s  Error reading permissions of %s\n", options->space, "", input_path);
+    if (fchmodat(CWD_FD, output_path, input_perms.st_mode, 0) != 0 && options->debug) sink_error("%*s  Error setting permissions of %s\n", options->space, "", output_path);
 
     // Copy loop
     off_t offset = 0;
-    while (copy_file_range(input_file, &offset, output_file, NULL, _cp_BUFFER_SIZE, 0) > 0) {
+    while (copy_file_range(input_file, &offset, output_file, NULL, options->buffer_size, 0) > 0) {
         continue;
     }
+    stats_add(STAT_FILES_COPIED, 1);
+    stats_add(STAT_BYTES_COPIED, offset);
 
     // Close the files
     close(input_file);
@@ -86,27 +83,29 @@ int _cp_copy_file(const char *input_path, const char *output_path) {
 
 
 /**
- * @see opendir, stat, mkdir, chmod, readdir, closedir, free, _cp_path_file_concat, _cp_copy_file, fprintf
+ * @see openat, fdopendir, close, mkdirat, fstatat, fchmodat, readdir, closedir, free, _cp_path_file_concat, _cp_copy_file, sink_error
  */
-int _cp_copy_dir(const char *input_dir, const char *output_dir) {
-    if (_cp_DEBUG) fprintf(stdout, "%*s- Copying folder %s to %s\n", _cp_SPACE, "", input_dir, output_dir);
+int _cp_copy_dir(const char *input_dir, const char *output_dir, cp_options_t *const options) {
+    if (options->debug) sink_printf("%*s- Copying folder %s to %s\n", options->space, "", input_dir, output_dir);
 
     // Open the input directory
-    DIR *dir = opendir(input_dir);
+    const int dir_fd = openat(CWD_FD, input_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = dir_fd == -1 ? NULL : fdopendir(dir_fd);
     if (dir == NULL) {
-        if (_cp_DEBUG) fprintf(stderr, "%*s  Error opening directory %s\n", _cp_SPACE, "", input_dir);
+        if (dir_fd != -1) close(dir_fd);
+        if (options->debug) sink_error("%*s  Error opening directory %s\n", options->space, "", input_dir);
         return 1;
     }
 
     // Create the output directory
-    if (mkdir(output_dir, 0660) != 0 && _cp_DEBUG) fprintf(stderr, "%*s  Error creating %s\n", _cp_SPACE, "", output_dir);
+    if (mkdirat(CWD_FD, output_dir, 0660) != 0 && options->debug) sink_error("%*s  Error creating %s\n", options->space, "", output_dir);
 
     // Copy the permissions of the input directory to the output directory
     struct stat input_stat;
-    if (stat(input_dir, &input_stat) != 0 && _cp_DEBUG)          fprintf(stderr, "%*s  Error reading permissions of %s\n", _cp_SPACE, "", input_dir);
-    if (chmod(output_dir, input_stat.st_mode) != 0 && _cp_DEBUG) fprintf(stderr, "%*s  Error setting permissions of %s\n", _cp_SPACE, "", output_dir);
+    if (fstatat(CWD_FD, input_dir, &input_stat, 0) != 0 && options->debug)          sink_error("%*s  Error reading permissions of %s\n", options->space, "", input_dir);
+    if (fchmodat(CWD_FD, output_dir, input_stat.st_mode, 0) != 0 && options->debug) sink_error("%*s  Error setting permissions of %s\n", options->space, "", output_dir);
 
-    if (_cp_DEBUG) _cp_SPACE += 4;
+    if (options->debug) options->space += 4;
 
     // Copy all the files and folders inside the input directory to the output directory
     struct dirent *current_child;
@@ -116,26 +115,28 @@ int _cp_copy_dir(const char *input_dir, const char *output_dir) {
         current_child = readdir(dir);
         if (current_child == NULL) break;
 
-        // If __cp_HIDDEN : Skip . (itself) and .. (parent)
-        // If not __cp_HIDDEN : Skip . (itself), .. (parent) and all files/folders starting with .
-        if (current_child->d_name[0] == '.' && (!_cp_HIDDEN || current_child->d_name[1] == '\0' || (current_child->d_name[1] == '.' && current_child->d_name[2] == '\0'))) continue;
+        // If options->hidden : Skip . (itself) and .. (parent)
+        // If not options->hidden : Skip . (itself), .. (parent) and all files/folders starting with .
+        if (current_child->d_name[0] == '.' && (!options->hidden || current_child->d_name[1] == '\0' || (current_child->d_name[1] == '.' && current_child->d_name[2] == '\0'))) continue;
 
-        input_path  = _cp_path_file_concat(input_dir,  current_child->d_name);
+        input_path  = _cp_path_file_concat(input_dir,  current_child->d_name, options);
         if (input_path == NULL) return 2;
-        output_path = _cp_path_file_concat(output_dir, current_child->d_name);
+        output_path = _cp_path_file_concat(output_dir, current_child->d_name, options);
         if (output_path == NULL) return 2;
 
         // Get permissions of the file/folder to check if it is a directory
-        if (stat(input_path, &input_stat)) {
-            if (_cp_DEBUG) fprintf(stderr, "%*s  Error reading permissions of %s\n", _cp_SPACE, "", input_path);
+        if (fstatat(CWD_FD, input_path, &input_stat, 0)) {
+            if (options->debug) sink_error("%*s  Error reading permissions of %s\n", options->space, "", input_path);
             free(input_path);
             free(output_path);
             continue;
         }
 
         // Copy the file/folder
-        if (S_ISDIR(input_stat.st_mode)) _cp_copy_dir(input_path, output_path);
-        else                             _cp_copy_file(input_path, output_path);
+        TRACE_BEGIN(S_ISDIR(input_stat.st_mode) ? "_cp_copy_dir" : "_cp_copy_file", input_path);
+        if (S_ISDIR(input_stat.st_mode)) _cp_copy_dir(input_path, output_path, options);
+        else                             _cp_copy_file(input_path, output_path, options);
+        TRACE_END(S_ISDIR(input_stat.st_mode) ? "_cp_copy_dir" : "_cp_copy_file");
 
         // Free the memory allocated by __cp_path_file_concat
         free(input_path);
@@ -145,45 +146,45 @@ int _cp_copy_dir(const char *input_dir, const char *output_dir) {
     // Close the directory
     closedir(dir);
 
-    if (_cp_DEBUG) _cp_SPACE -= 4;
+    if (options->debug) options->space -= 4;
 
     return 0;
 }
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _cp_print_usage(const char *const program_name) {
-    printf("Usage: %s <input_file_path> <output_file_path> [Options]\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help      Print this help message\n");
-    printf("    -v               Verbose, debug mode\n");
-    printf("    -a               Allow copy of secret files/folders\n");
-    printf("    --buffer SIZE    Number of bytes for the buffer to read/write files\n");
-    printf("                     SIZE > 0 and by default is 4096 bytes\n");
+    sink_printf("Usage: %s <input_file_path> <output_file_path> [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help      Print this help message\n");
+    sink_printf("    -v               Verbose, debug mode\n");
+    sink_printf("    -a               Allow copy of secret files/folders\n");
+    sink_printf("    --buffer SIZE    Number of bytes for the buffer to read/write files\n");
+    sink_printf("                     SIZE > 0 and by default is 4096 bytes\n");
 }
 
 
 /**
  * @see strcmp, _cp_print_usage
  */
-int _cp_parse_arguments(const int argc, const char *const *const argv) {
+int _cp_parse_arguments(const int argc, const char *const *const argv, cp_options_t *const options) {
     // Check if the number of arguments is correct
     if (argc < 3) {
-        fprintf(stderr, "Missing arguments\n");
+        sink_error("Missing arguments\n");
         _cp_print_usage(argv[0]);
         return 1;
     }
 
     // Check if the input file/folder exists
     struct stat input_stat;
-    if (stat(argv[1], &input_stat) != 0) {
-        fprintf(stderr, "Input file/folder does not exist\n");
+    if (fstatat(CWD_FD, argv[1], &input_stat, 0) != 0) {
+        sink_error("Input file/folder does not exist\n");
         return 1;
     }
 
-    // Set _cp_DEBUG, _cp_HIDDEN and _cp_BUFFER_SIZE
+    // Set the debug, hidden and buffer size options
     for (int i = 1; i < argc; i++) {
         // Check if the argument is -h or --help
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -194,15 +195,15 @@ int _cp_parse_arguments(const int argc, const char *const *const argv) {
 
         // Check if the argument is -v
         if (strcmp(argv[i], "-v") == 0) {
-            // Set __cp_DEBUG
-            _cp_DEBUG = 1;
+            // Set options->debug
+            options->debug = 1;
             continue;
         }
 
         // Check if the argument is -a
         if (strcmp(argv[i], "-a") == 0) {
-            // Set __cp_HIDDEN
-            _cp_HIDDEN = 1;
+            // Set options->hidden
+            options->hidden = 1;
             continue;
         }
 
@@ -212,7 +213,7 @@ int _cp_parse_arguments(const int argc, const char *const *const argv) {
 
             // Check if there is an argument after --buffer
             if (i >= argc) {
-                fprintf(stderr, "Missing SIZE\n");
+                sink_error("Missing SIZE\n");
                 _cp_print_usage(argv[0]);
                 return 1;
             }
@@ -223,18 +224,18 @@ int _cp_parse_arguments(const int argc, const char *const *const argv) {
             // Check if the argument is a number
             for (int j = 0; argv[i][j] != '\0'; j++) {
                 if (!isdigit((unsigned char)argv[i][j])) {
-                    fprintf(stderr, "Invalid SIZE: %s\n", argv[i]);
+                    sink_error("Invalid SIZE: %s\n", argv[i]);
                     _cp_print_usage(argv[0]);
                     return 1;
                 }
             }
 
-            // Set the __cp_BUFFER_SIZE
-            _cp_BUFFER_SIZE = atoi(argv[i]);
+            // Set the options->buffer_size
+            options->buffer_size = atoi(argv[i]);
 
-            // Check if the __cp_BUFFER_SIZE is valid
-            if (_cp_BUFFER_SIZE <= 0) {
-                fprintf(stderr, "Invalid SIZE: %i\n", _cp_BUFFER_SIZE);
+            // Check if the options->buffer_size is valid
+            if (options->buffer_size <= 0) {
+                sink_error("Invalid SIZE: %i\n", options->buffer_size);
                 _cp_print_usage(argv[0]);
                 return 1;
             }
@@ -249,23 +250,31 @@ int _cp_parse_arguments(const int argc, const char *const *const argv) {
  * @see _cp_parse_arguments, S_ISDIR, _cp_copy_dir, _cp_copy_file
  */
 int our_cp(const int argc, const char *const *const argv) {
+    // Options are reset at each call, nothing is kept from a previous copy
+    cp_options_t options = { 0, 0, 0, 1024 };
+
     // Parse the arguments
-    int parse_result = _cp_parse_arguments(argc, argv);
+    int parse_result = _cp_parse_arguments(argc, argv, &options);
     if (parse_result == -1) return 0;
     if (parse_result)       return parse_result;
 
     // Copy the file/folder
     struct stat input_stat;
-    if (stat(argv[1], &input_stat) != 0 && _cp_DEBUG) fprintf(stderr, "%*s  Error reading permissions of %s\n", _cp_SPACE, "", argv[1]);
+    if (fstatat(CWD_FD, argv[1], &input_stat, 0) != 0 && options.debug) sink_error("%*s  Error reading permissions of %s\n", options.space, "", argv[1]);
 
     int res;
-    if (S_ISDIR(input_stat.st_mode)) res = _cp_copy_dir(argv[1], argv[2]);
-    else                             res = _cp_copy_file(argv[1], argv[2]);
+    TRACE_BEGIN(S_ISDIR(input_stat.st_mode) ? "_cp_copy_dir" : "_cp_copy_file", argv[1]);
+    if (S_ISDIR(input_stat.st_mode)) res = _cp_copy_dir(argv[1], argv[2], &options);
+    else                             res = _cp_copy_file(argv[1], argv[2], &options);
+    TRACE_END(S_ISDIR(input_stat.st_mode) ? "_cp_copy_dir" : "_cp_copy_file");
 
     return res;
 }
 
 
+REGISTER_BUILTIN("cp", our_cp, 0);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
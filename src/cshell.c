@@ -0,0 +1,176 @@
+// CShell Project - Library to run command lines inside another program (libcshell)
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#define _GNU_SOURCE
+#include "main.h"
+#include "cshell.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+
+struct cshell_s {
+    // Variables, resolved commands, compiled lines and jobs of the context, the tables in use while one of its lines runs
+    var_table_t variables;
+    hash_table_t commands;
+    plan_cache_t plans;
+    jobs_table_t jobs;
+    // History of the context, HISTORY while one of its lines runs
+    char (*history)[MAX_LINE_LENGTH];
+    char history_lines[HISTORY_SIZE][MAX_LINE_LENGTH];
+    // Working directory and previous one (cd -) of the context, and the directory relative paths start from
+    char cwd[MAX_PATH_LENGTH];
+    char previous_cwd[MAX_PATH_LENGTH];
+    int cwd_fd;
+    // Return codes of the last command and of the stages of the last pipeline ($? and $PIPE_STATUS)
+    int last_return_code;
+    int pipe_status[MAX_PIPELINE_STAGES];
+    int pipe_status_count;
+};
+
+// Lines run one at a time, the state of the running context is swapped into the globals of the shell
+static pthread_mutex_t _cshell_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * @see calloc, getcwd, strcpy, open, fcntl, close, free, pthread_mutex_lock, getenv, trace_open, sink_perror,
+ *      var_use, var_init, pthread_mutex_unlock
+ */
+cshell_t *cshell_new() {
+    cshell_t *const shell = calloc(1, sizeof(cshell_t));
+    if (!shell) return NULL;
+
+    shell->variables.env_dirty = 1;
+    shell->history = shell->history_lines;
+    if (!getcwd(shell->cwd, MAX_PATH_LENGTH)) shell->cwd[0] = '\0';
+    strcpy(shell->previous_cwd, shell->cwd);
+
+    // The directory of the context is kept open above the file descriptors of the shell
+    const int cwd_fd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    shell->cwd_fd = cwd_fd == -1 ? -1 : fcntl(cwd_fd, F_DUPFD_CLOEXEC, SHELL_FDS_COUNT);
+    if (cwd_fd != -1) close(cwd_fd);
+    if (shell->cwd_fd == -1) {
+        free(shell);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&_cshell_LOCK);
+    EMBEDDED = 1;
+    // Every context of the program traces into the file opened by the first one
+    const char *const trace_path = getenv("SHELL_TRACE");
+    if (trace_path && trace_path[0] != '\0' && trace_open(trace_path) == -1) sink_perror(trace_path);
+    // Variables of the environment are exported, like in a new shell
+    var_use(&shell->variables);
+    var_init();
+    var_use(NULL);
+    pthread_mutex_unlock(&_cshell_LOCK);
+
+    return shell;
+}
+
+
+void _cshell_swap(void *const a, void *const b, const size_t size) {
+    unsigned char *const x = a, *const y = b;
+    for (size_t i = 0; i < size; i++) {
+        const unsigned char c = x[i];
+        x[i] = y[i];
+        y[i] = c;
+    }
+}
+
+
+/**
+ * @see _cshell_swap
+ */
+void _cshell_exchange(cshell_t *const shell) {
+    // Swapping twice puts everything back, the same exchange enters and leaves the context
+    _cshell_swap(&LAST_RETURN_CODE, &shell->last_return_code, sizeof(int));
+    _cshell_swap(PIPE_STATUS, shell->pipe_status, sizeof(PIPE_STATUS));
+    _cshell_swap(&PIPE_STATUS_COUNT, &shell->pipe_status_count, sizeof(int));
+    _cshell_swap(CWD, shell->cwd, MAX_PATH_LENGTH);
+    _cshell_swap(PWD, shell->previous_cwd, MAX_PATH_LENGTH);
+    _cshell_swap(&CWD_FD, &shell->cwd_fd, sizeof(int));
+    _cshell_swap(&HISTORY, &shell->history, sizeof(HISTORY));
+}
+
+
+/**
+ * @see var_use, hash_use, plan_use, jobs_use, _cshell_exchange
+ */
+void _cshell_enter(cshell_t *const shell) {
+    var_use(&shell->variables);
+    hash_use(&shell->commands);
+    plan_use(&shell->plans);
+    jobs_use(&shell->jobs);
+    _cshell_exchange(shell);
+    LOOP_DEPTH = LOOP_BREAK = LOOP_CONTINUE = SHELL_EXIT = 0;
+}
+
+
+/**
+ * @see _cshell_exchange, var_use, hash_use, plan_use, jobs_use
+ */
+void _cshell_leave(cshell_t *const shell) {
+    LOOP_DEPTH = LOOP_BREAK = LOOP_CONTINUE = SHELL_EXIT = 0;
+    _cshell_exchange(shell);
+    var_use(NULL);
+    hash_use(NULL);
+    plan_use(NULL);
+    jobs_use(NULL);
+}
+
+
+/**
+ * @see pthread_mutex_lock, fcntl, _cshell_enter, run_line, _cshell_leave, fflush, close, pthread_mutex_unlock
+ */
+int cshell_eval(cshell_t *const shell, const char *const line, const int in_fd, const int out_fd, const int err_fd) {
+    pthread_mutex_lock(&_cshell_LOCK);
+    EMBEDDED = 1;
+
+    // The file descriptors given by the caller become the ones of the shell, as copies above them,
+    // the ones of the process are never replaced and other ones are closed for the line
+    const int fds[3] = { in_fd, out_fd, err_fd };
+    int copies[3];
+    for (int i = 0; i < SHELL_FDS_COUNT; i++) SHELL_FDS[i] = -1;
+    for (int i = 0; i < 3; i++) {
+        copies[i] = fds[i] == -1 ? -1 : fcntl(fds[i], F_DUPFD_CLOEXEC, SHELL_FDS_COUNT);
+        SHELL_FDS[i] = fds[i] == -1 ? i : copies[i];
+    }
+
+    _cshell_enter(shell);
+    const int return_code = run_line(line);
+    _cshell_leave(shell);
+
+    // Output kept by stdio goes out before returning, when the line wrote on the stdout of the process
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < 3; i++) if (copies[i] != -1) close(copies[i]);
+    for (int i = 0; i < SHELL_FDS_COUNT; i++) SHELL_FDS[i] = i;
+
+    pthread_mutex_unlock(&_cshell_LOCK);
+
+    return return_code;
+}
+
+
+/**
+ * @see pthread_mutex_lock, var_table_free, hash_table_free, plan_cache_free, jobs_table_free, pthread_mutex_unlock, close, free
+ */
+void cshell_free(cshell_t *const shell) {
+    if (!shell) return;
+
+    pthread_mutex_lock(&_cshell_LOCK);
+    var_table_free(&shell->variables);
+    hash_table_free(&shell->commands);
+    plan_cache_free(&shell->plans);
+    jobs_table_free(&shell->jobs);
+    pthread_mutex_unlock(&_cshell_LOCK);
+
+    close(shell->cwd_fd);
+    free(shell);
+}
@@ -0,0 +1,126 @@
+// CShell Project - New echo command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "echo.h"
+#include "sink.h"
+#include "builtin.h"
+#include <string.h>
+
+
+/**
+ * @see strspn
+ */
+int _echo_parse_arguments(const int argc, const char *const *const argv, int *const newline, int *const escapes) {
+    *newline = 1;
+    *escapes = 0;
+
+    // Options are only made of n, e and E, anything else is printed (echo has no --help)
+    int i = 1;
+    while (i < argc && argv[i][0] == '-' && argv[i][1] && strspn(&argv[i][1], "neE") == strlen(&argv[i][1])) {
+        for (const char *c = &argv[i][1]; *c; c++) {
+            if (*c == 'n')      *newline = 0;
+            else if (*c == 'e') *escapes = 1;
+            else                *escapes = 0;
+        }
+        i++;
+    }
+
+    return i;
+}
+
+
+/**
+ * @see sink_write, sink_putc
+ */
+int _echo_write_escaped(const char *const str) {
+    const char *ptr = str;
+    const char *start = str;
+    while (*ptr) {
+        if (*ptr != '\\' || !ptr[1]) {
+            ptr++;
+            continue;
+        }
+
+        // Write the plain characters before the escape at once
+        sink_write(start, ptr - start);
+        ptr++;
+
+        int c = *ptr++;
+        switch (c) {
+            case 'a': c = '\a'; break;
+            case 'b': c = '\b'; break;
+            case 'e': c = 033;  break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'v': c = '\v'; break;
+            case '\\': break;
+
+            // Stop the output, even the final new line
+            case 'c': return 1;
+
+            // \0nnn in octal, \xHH in hexadecimal
+            case '0':
+                c = 0;
+                for (int k = 0; k < 3 && *ptr >= '0' && *ptr <= '7'; k++) c = c * 8 + (*ptr++ - '0');
+                break;
+            case 'x':
+                if (!strchr("0123456789abcdefABCDEF", *ptr) || !(*ptr)) {
+                    sink_putc('\\');
+                    break;
+                }
+                c = 0;
+                for (int k = 0; k < 2 && *ptr && strchr("0123456789abcdefABCDEF", *ptr); k++, ptr++) c = c * 16 + (*ptr <= '9' ? *ptr - '0' : (*ptr | 0x20) - 'a' + 10);
+                break;
+
+            // Unknown escapes are printed as they are
+            default:
+                sink_putc('\\');
+                break;
+        }
+        sink_putc(c);
+        start = ptr;
+    }
+
+    sink_write(start, ptr - start);
+    return 0;
+}
+
+
+/**
+ * @see _echo_parse_arguments, _echo_write_escaped, sink_write, sink_putc, strlen
+ */
+int our_echo(const int argc, const char *const *const argv) {
+    // Parse the arguments
+    int newline, escapes;
+    const int first = _echo_parse_arguments(argc, argv, &newline, &escapes);
+
+    // Arguments separated by spaces
+    for (int i = first; i < argc; i++) {
+        if (i > first) sink_putc(' ');
+        if (!escapes) sink_write(argv[i], strlen(argv[i]));
+        else if (_echo_write_escaped(argv[i])) return 0;
+    }
+    if (newline) sink_putc('\n');
+
+    return 0;
+}
+
+
+REGISTER_BUILTIN("echo", our_echo, BUILTIN_FUSABLE);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_echo(argc, argv);
+}
+#endif
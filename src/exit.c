@@ -0,0 +1,84 @@
+// CShell Project - New exit command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "exit.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+
+/**
+ * @see sink_printf
+ */
+void _exit_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] [code]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+}
+
+
+/**
+ * @see strcmp, _exit_print_usage, isdigit, sink_error
+ */
+int _exit_parse_arguments(const int argc, const char *const *const argv) {
+    if (argc > 2) {
+        sink_error("exit: too many arguments\n");
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        // Check if the argument is -h or --help
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            // Print the usage and return
+            _exit_print_usage(argv[0]);
+            return -1;
+        }
+
+        // Check if the argument is a number
+        for (int j = (argv[i][0] == '-'); argv[i][j] != '\0'; j++) {
+            if (!isdigit((unsigned char)argv[i][j])) {
+                sink_error("exit: %s: numeric argument required\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see _exit_parse_arguments, atoi
+ */
+int our_exit(const int argc, const char *const *const argv) {
+    // Parse the arguments
+    int parse_result = _exit_parse_arguments(argc, argv);
+    if (parse_result == -1) return 0;
+    if (parse_result) return parse_result;
+
+    // The shell leaves once its file descriptors are restored (see call_command)
+    SHELL_EXIT = 1;
+
+    return argc == 2 ? atoi(argv[1]) & 0xff : 0;
+}
+
+
+REGISTER_BUILTIN("exit", our_exit, 0);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_exit(argc, argv);
+}
+#endif
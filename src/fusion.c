@@ -0,0 +1,103 @@
+// CShell Project - Fused pipelines of builtins running on threads
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#define _GNU_SOURCE
+#include "main.h"
+#include "fusion.h"
+#include "sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+
+/**
+ * @see redirect_is_simple, builtin_lookup
+ */
+builtin_t get_fusable_builtin(const int argc, char **const argv, const fd_actions_t *const redirects) {
+    if (argc == 0 || !redirect_is_simple(redirects)) return NULL;
+
+    const builtin_entry_t *const builtin = builtin_lookup(argv[0]);
+    if (builtin == NULL || !(builtin->flags & BUILTIN_FUSABLE) || (builtin->flags & BUILTIN_NEEDS_FORK)) return NULL;
+
+    return builtin->function;
+}
+
+
+/**
+ * @see getrusage, sigemptyset, sigaddset, pthread_sigmask, openat, sink_perror, close, source_init_ring, source_init_fd, sink_init_ring, sink_init_fd, sink_close, source_close, ring_close_reader, ring_close_writer, timing_end_thread
+ */
+void *run_fused_stage(void *arg) {
+    fused_stage_t *const stage = arg;
+
+    // Resources of the thread only, the shell and other stages run at the same time
+    struct rusage before;
+    if (stage->timing) getrusage(RUSAGE_THREAD, &before);
+
+    // Writing in a closed pipe must fail with EPIPE instead of killing the whole shell
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    // Open redirections in order, the last one on stdin and on stdout replaces the ring buffers
+    int file_in = -1, file_out = -1;
+    int opened = 1;
+    for (int i = 0; i < stage->redirects->count && opened; i++) {
+        const fd_action_t *const action = &stage->redirects->actions[i];
+        int *const file = action->fd == STDIN_FILENO ? &file_in : &file_out;
+        if (*file != -1) close(*file);
+        if ((*file = openat(CWD_FD, action->path, action->flags | O_CLOEXEC, 0644)) == -1) {
+            sink_perror(action->path);
+            opened = 0;
+        }
+    }
+
+    stage->return_code = 1;
+    if (opened) {
+        source_t source;
+        if (file_in != -1)      source_init_fd(&source, file_in);
+        else if (stage->in_ring) source_init_ring(&source, stage->in_ring);
+        else                     source_init_fd(&source, stage->in_fd == -1 ? SHELL_FDS[STDIN_FILENO] : stage->in_fd);
+
+        sink_t sink;
+        int ready = 1;
+        if (file_out != -1)        ready = sink_init_fd(&sink, file_out) == 0;
+        else if (stage->out_ring)  sink_init_ring(&sink, stage->out_ring);
+        else                       ready = sink_init_fd(&sink, stage->out_fd == -1 ? SHELL_FDS[STDOUT_FILENO] : stage->out_fd) == 0;
+
+        if (ready) {
+            SOURCE_IN = &source;
+            SINK_OUT = &sink;
+
+            stats_add(STAT_BUILTIN_CALLS, 1);
+            TRACE_BEGIN("run_fused_stage", stage->argv[0]);
+            stage->return_code = stage->builtin(stage->argc, (const char *const *)stage->argv);
+            TRACE_END("run_fused_stage");
+
+            SOURCE_IN = NULL;
+            SINK_OUT = NULL;
+            sink_close(&sink);
+        }
+        source_close(&source);
+    }
+
+    // Make sure neighbours never wait for this stage anymore
+    if (stage->in_ring)  ring_close_reader(stage->in_ring);
+    if (stage->out_ring) ring_close_writer(stage->out_ring);
+
+    // Close every file descriptor of the stage
+    if (file_in != -1)       close(file_in);
+    if (file_out != -1)      close(file_out);
+    if (stage->in_fd != -1)  close(stage->in_fd);
+    if (stage->out_fd != -1) close(stage->out_fd);
+
+    if (stage->timing) timing_end_thread(stage->timing, &before);
+
+    return NULL;
+}
@@ -0,0 +1,457 @@
+// CShell Project - Pathname expansion with compiled patterns
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#define _GNU_SOURCE
+#include "config.h"
+#include "globbing.h"
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+// Named classes allowed inside [...], e.g. [[:digit:]]
+static const struct {
+    const char *name;
+    int (*test)(int);
+} _GLOB_CLASSES[] = {
+    { "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank }, { "cntrl", iscntrl },
+    { "digit", isdigit }, { "graph", isgraph }, { "lower", islower }, { "print", isprint },
+    { "punct", ispunct }, { "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit },
+    { NULL, NULL },
+};
+
+
+int glob_has_magic(const char *const pattern) {
+    for (const char *ptr = pattern; *ptr; ptr++) {
+        if (*ptr == '\\') {
+            if (!ptr[1]) break;
+            ptr++;
+        }
+        else if (*ptr == '*' || *ptr == '?') return 1;
+        else if (*ptr == '[' && strchr(ptr + 1, ']')) return 1;
+    }
+    return 0;
+}
+
+
+size_t glob_unescape(char *const pattern) {
+    char *write = pattern;
+    for (const char *read = pattern; *read; read++) {
+        if (*read == '\\' && read[1]) read++;
+        *write++ = *read;
+    }
+    *write = '\0';
+    return write - pattern;
+}
+
+
+/**
+ * @see memset, strncmp, strstr
+ */
+const char *_glob_parse_class(const char *ptr, unsigned char *const set, int *const negated) {
+    memset(set, 0, 32);
+    *negated = (*ptr == '!' || *ptr == '^');
+    if (*negated) ptr++;
+
+    // A ] right after [ or [! is a character of the class
+    const char *const start = ptr;
+    while (*ptr && (*ptr != ']' || ptr == start)) {
+        // Named class, e.g. [:alpha:]
+        if (ptr[0] == '[' && ptr[1] == ':') {
+            const char *const end = strstr(ptr + 2, ":]");
+            int found = 0;
+            for (int i = 0; end && _GLOB_CLASSES[i].name && !found; i++) {
+                if ((size_t)(end - ptr - 2) != strlen(_GLOB_CLASSES[i].name) || strncmp(ptr + 2, _GLOB_CLASSES[i].name, end - ptr - 2) != 0) continue;
+                for (int c = 0; c < 256; c++) if (_GLOB_CLASSES[i].test(c)) set[c >> 3] |= 1 << (c & 7);
+                found = 1;
+            }
+            if (found) {
+                ptr = end + 2;
+                continue;
+            }
+        }
+
+        // Single character or range, e.g. a-z
+        if (*ptr == '\\' && ptr[1]) ptr++;
+        const unsigned char low = *ptr++;
+        unsigned char high = low;
+        if (ptr[0] == '-' && ptr[1] && ptr[1] != ']') {
+            ptr++;
+            if (*ptr == '\\' && ptr[1]) ptr++;
+            high = *ptr++;
+        }
+        for (int c = low; c <= high; c++) set[c >> 3] |= 1 << (c & 7);
+    }
+
+    return *ptr == ']' ? ptr + 1 : NULL;
+}
+
+
+/**
+ * @see arena_strndup, arena_alloc, _glob_parse_class
+ */
+int _glob_compile(arena_t *const arena, const char *const start, const char *const end, glob_component_t *const component) {
+    const size_t size = end - start;
+    const char *const raw = arena_strndup(arena, start, size);
+    char *const text = arena_alloc(arena, size + 1);
+    glob_instr_t *const code = arena_alloc(arena, (size + 1) * sizeof(glob_instr_t));
+    if (!raw || !text || !code) return -1;
+
+    memset(component, 0, sizeof(glob_component_t));
+    component->recursive = (strcmp(raw, "**") == 0);
+    if (component->recursive) return 0;
+
+    // Literal characters are joined into runs, stored one after the other inside text
+    int count = 0, magic = 0;
+    size_t length = 0;
+    const char *ptr = raw;
+    while (*ptr) {
+        if (*ptr == '*') {
+            if (!count || code[count - 1].op != GLOB_STAR) code[count++] = (glob_instr_t){ GLOB_STAR, NULL, 0, NULL, 0 };
+            magic = 1;
+            ptr++;
+            continue;
+        }
+        if (*ptr == '?') {
+            code[count++] = (glob_instr_t){ GLOB_ANY, NULL, 0, NULL, 0 };
+            magic = 1;
+            ptr++;
+            continue;
+        }
+        if (*ptr == '[') {
+            unsigned char *const set = arena_alloc(arena, 32);
+            if (!set) return -1;
+            int negated;
+            const char *const after = _glob_parse_class(ptr + 1, set, &negated);
+            // Without closing ], the [ is a literal
+            if (after) {
+                code[count++] = (glob_instr_t){ GLOB_CLASS, NULL, 0, set, negated };
+                magic = 1;
+                ptr = after;
+                continue;
+            }
+        }
+
+        if (*ptr == '\\' && ptr[1]) ptr++;
+        if (!count || code[count - 1].op != GLOB_LITERAL) code[count++] = (glob_instr_t){ GLOB_LITERAL, &text[length], 0, NULL, 0 };
+        text[length++] = *ptr++;
+        code[count - 1].length++;
+    }
+    text[length] = '\0';
+
+    component->text = text;
+    component->literal = !magic;
+    component->code = code;
+    component->count = count;
+    return 0;
+}
+
+
+/**
+ * @see strncmp
+ */
+int _glob_match(const glob_component_t *const component, const char *const name) {
+    const glob_instr_t *const code = component->code;
+    const char *ptr = name;
+    int i = 0;
+    // Position after the last * and the character it is retried from
+    int star = -1;
+    const char *star_ptr = NULL;
+
+    while (1) {
+        int matched = 0;
+        if (i < component->count) {
+            const glob_instr_t *const instr = &code[i];
+            switch (instr->op) {
+                case GLOB_STAR:
+                    star = ++i;
+                    star_ptr = ptr;
+                    continue;
+                case GLOB_LITERAL:
+                    matched = strncmp(ptr, instr->text, instr->length) == 0;
+                    if (matched) ptr += instr->length;
+                    break;
+                case GLOB_ANY:
+                    matched = *ptr != '\0';
+                    if (matched) ptr++;
+                    break;
+                case GLOB_CLASS: {
+                    const unsigned char c = *ptr;
+                    matched = c != '\0' && (((instr->set[c >> 3] >> (c & 7)) & 1) != instr->negated);
+                    if (matched) ptr++;
+                    break;
+                }
+            }
+            if (matched) {
+                i++;
+                continue;
+            }
+        }
+        else if (*ptr == '\0') return 1;
+
+        // Mismatch, the last * takes one more character
+        if (star == -1 || *star_ptr == '\0') return 0;
+        i = star;
+        ptr = ++star_ptr;
+    }
+}
+
+
+/**
+ * @see strcmp
+ */
+int _glob_compare(const void *const a, const void *const b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+
+/**
+ * @see lseek, arena_alloc, getdents64, _glob_match, arena_realloc, arena_strdup
+ */
+glob_entry_t *_glob_list(glob_walker_t *const walker, const int fd, const glob_component_t *const component, int *const count) {
+    *count = 0;
+    // The directory may have been read already, by ** matching no directory
+    if (lseek(fd, 0, SEEK_SET) == -1) return NULL;
+
+    // Files starting with a dot are only matched by a component starting with a literal dot
+    const int dot = component && component->count > 0 && component->code[0].op == GLOB_LITERAL && component->code[0].text[0] == '.';
+
+    int capacity = 16;
+    glob_entry_t *entries = arena_alloc(&walker->arena, capacity * sizeof(glob_entry_t));
+    if (!entries) return NULL;
+
+    ssize_t size;
+    while ((size = getdents64(fd, walker->dents, sizeof(walker->dents))) > 0) {
+        for (ssize_t offset = 0; offset < size;) {
+            const struct dirent64 *const dent = (const struct dirent64 *)&walker->dents[offset];
+            offset += dent->d_reclen;
+
+            const char *const name = dent->d_name;
+            if (name[0] == '.' && (!dot || name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+            if (component && !_glob_match(component, name)) continue;
+
+            if (*count == capacity) {
+                glob_entry_t *const bigger = arena_realloc(&walker->arena, entries, capacity * sizeof(glob_entry_t), 2 * capacity * sizeof(glob_entry_t));
+                if (!bigger) return NULL;
+                entries = bigger;
+                capacity *= 2;
+            }
+            entries[*count].name = arena_strdup(&walker->arena, name);
+            entries[*count].type = dent->d_type;
+            if (!entries[*count].name) return NULL;
+            (*count)++;
+        }
+    }
+
+    return entries;
+}
+
+
+/**
+ * @see fstatat, S_ISDIR
+ */
+int _glob_is_directory(const int fd, const glob_entry_t *const entry, const int follow) {
+    if (entry->type == DT_DIR) return 1;
+    if (entry->type != DT_UNKNOWN && !(follow && entry->type == DT_LNK)) return 0;
+
+    struct stat st;
+    return fstatat(fd, entry->name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+}
+
+
+/**
+ * @see strlen, memcpy
+ */
+long _glob_append(glob_walker_t *const walker, const char *const name) {
+    const size_t old_length = walker->length;
+    const size_t size = strlen(name);
+    const int slash = old_length > 0 && walker->path[old_length - 1] != '/';
+    if (old_length + slash + size + 1 >= MAX_PATH_LENGTH) return -1;
+
+    if (slash) walker->path[walker->length++] = '/';
+    memcpy(&walker->path[walker->length], name, size + 1);
+    walker->length += size;
+    return old_length;
+}
+
+
+void _glob_restore(glob_walker_t *const walker, const size_t length) {
+    walker->length = length;
+    walker->path[length] = '\0';
+}
+
+
+/**
+ * @see arena_alloc, arena_realloc, arena_strndup, _glob_restore
+ */
+int _glob_emit(glob_walker_t *const walker) {
+    // Paths are sorted as a whole at the end, d/e/f comes before d/x whatever the directory it is in
+    if (walker->paths == NULL || walker->matches == walker->paths_capacity) {
+        const int capacity = walker->paths ? 2 * walker->paths_capacity : 16;
+        char **const bigger = walker->paths ? arena_realloc(&walker->results, walker->paths, walker->paths_capacity * sizeof(char *), capacity * sizeof(char *))
+                                            : arena_alloc(&walker->results, capacity * sizeof(char *));
+        if (!bigger) {
+            walker->stopped = 1;
+            return -1;
+        }
+        walker->paths = bigger;
+        walker->paths_capacity = capacity;
+    }
+
+    // A pattern ending with / gives directories with a final /
+    const size_t length = walker->length;
+    if (walker->directories) {
+        walker->path[walker->length++] = '/';
+        walker->path[walker->length] = '\0';
+    }
+
+    char *const path = arena_strndup(&walker->results, walker->path, walker->length);
+    _glob_restore(walker, length);
+    if (!path) {
+        walker->stopped = 1;
+        return -1;
+    }
+    walker->paths[walker->matches++] = path;
+    return 0;
+}
+
+
+/**
+ * @see _glob_append, fstatat, S_ISDIR, _glob_emit, openat, close, _glob_restore, arena_mark, _glob_list, _glob_is_directory, arena_rewind
+ */
+int _glob_walk(glob_walker_t *const walker, const int fd, const int index) {
+    if (index == walker->count) return _glob_emit(walker);
+    const glob_component_t *const component = &walker->components[index];
+
+    // Components without wildcards are opened at once, their directories are never read
+    if (component->literal) {
+        const long old_length = walker->length;
+        int next = index;
+        while (next < walker->count && walker->components[next].literal) {
+            if (_glob_append(walker, walker->components[next].text) == -1) {
+                _glob_restore(walker, old_length);
+                return 0;
+            }
+            next++;
+        }
+        const char *const relative = &walker->path[old_length + (old_length > 0 && walker->path[old_length - 1] != '/')];
+
+        int result = 0;
+        if (next == walker->count) {
+            struct stat st;
+            if (fstatat(fd, relative, &st, walker->directories ? 0 : AT_SYMLINK_NOFOLLOW) == 0 && (!walker->directories || S_ISDIR(st.st_mode))) result = _glob_emit(walker);
+        }
+        else {
+            const int child = openat(fd, relative, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (child != -1) {
+                result = _glob_walk(walker, child, next);
+                close(child);
+            }
+        }
+
+        _glob_restore(walker, old_length);
+        return result;
+    }
+
+    // Entries are freed once every path below this directory is found
+    const arena_mark_t mark = arena_mark(&walker->arena);
+    int count;
+    glob_entry_t *const entries = _glob_list(walker, fd, component->recursive ? NULL : component, &count);
+    const int last = (index + 1 == walker->count);
+
+    // ** matches no directory too, the next components are matched right here first
+    int result = 0;
+    if (component->recursive && !last) result = _glob_walk(walker, fd, index + 1);
+
+    for (int i = 0; i < count && result == 0; i++) {
+        // Only the last component needs to know if a file is a directory, when the pattern ends with /
+        const int directory = (!last || component->recursive || walker->directories) ? _glob_is_directory(fd, &entries[i], !component->recursive) : 0;
+        if (!last && !directory) continue;
+
+        const long old_length = _glob_append(walker, entries[i].name);
+        if (old_length == -1) continue;
+
+        if (last && (!walker->directories || directory)) result = _glob_emit(walker);
+
+        // ** goes down every directory without following links, other components go on with the next one
+        if (result == 0 && directory && (!last || component->recursive)) {
+            const int child = openat(fd, entries[i].name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | (component->recursive ? O_NOFOLLOW : 0));
+            if (child != -1) {
+                result = _glob_walk(walker, child, component->recursive ? index : index + 1);
+                close(child);
+            }
+        }
+
+        _glob_restore(walker, old_length);
+    }
+
+    arena_rewind(&walker->arena, mark);
+    return result;
+}
+
+
+/**
+ * @see malloc, arena_init, strlen, arena_alloc, _glob_compile, open, _glob_walk, close, qsort, _glob_compare, arena_destroy, free
+ */
+int glob_expand(const char *const pattern, const glob_callback_t callback, void *const data) {
+    // The walker holds the buffer of getdents64, too big for the stack of deep recursions
+    glob_walker_t *const walker = malloc(sizeof(glob_walker_t));
+    if (!walker) return -1;
+    arena_init(&walker->arena, GLOB_ARENA_CHUNK_SIZE);
+    walker->count = 0;
+    walker->callback = callback;
+    walker->data = data;
+    walker->matches = 0;
+    walker->stopped = 0;
+    arena_init(&walker->results, GLOB_ARENA_CHUNK_SIZE);
+    walker->paths = NULL;
+    walker->paths_capacity = 0;
+
+    // Split the pattern into components, each compiled once
+    const size_t size = strlen(pattern);
+    walker->components = arena_alloc(&walker->arena, (size / 2 + 1) * sizeof(glob_component_t));
+    int error = !walker->components;
+    const char *ptr = pattern;
+    while (*ptr && !error) {
+        while (*ptr == '/') ptr++;
+        if (!*ptr) break;
+        const char *end = ptr;
+        while (*end && *end != '/') end++;
+        error |= _glob_compile(&walker->arena, ptr, end, &walker->components[walker->count++]);
+        ptr = end;
+    }
+    walker->directories = walker->count > 0 && pattern[size - 1] == '/';
+
+    // Absolute patterns start from /, others from the current directory
+    const int absolute = (pattern[0] == '/');
+    walker->length = absolute;
+    walker->path[0] = '/';
+    walker->path[absolute] = '\0';
+
+    const int fd = error ? -1 : openat(CWD_FD, absolute ? "/" : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd != -1) {
+        _glob_walk(walker, fd, 0);
+        close(fd);
+    }
+
+    // Give every path in order, like other shells sort the whole expansion
+    if (!error && !walker->stopped && walker->matches > 0) {
+        qsort(walker->paths, walker->matches, sizeof(char *), _glob_compare);
+        for (int i = 0; i < walker->matches && !walker->stopped; i++) {
+            if (walker->callback(walker->paths[i], strlen(walker->paths[i]), walker->data) == -1) walker->stopped = 1;
+        }
+    }
+
+    const int result = (error || walker->stopped) ? -1 : walker->matches;
+    arena_destroy(&walker->results);
+    arena_destroy(&walker->arena);
+    free(walker);
+    return result;
+}
@@ -0,0 +1,321 @@
+// CShell Project - New hash command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "hash.h"
+#include "variables.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+// Resolved commands of the shell, and the table in use (another one while an embedding context runs, see hash_use)
+static hash_table_t _hash_MAIN = { NULL, 0, 0 };
+static hash_table_t *_hash_CURRENT = &_hash_MAIN;
+
+
+unsigned long _hash_string(const char *name) {
+    unsigned long hash = 14695981039346656037UL;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+
+/**
+ * @see _hash_string, strcmp
+ */
+int _hash_find_slot(const char *const name) {
+    int i = _hash_string(name) & (_hash_CURRENT->capacity - 1);
+    while (_hash_CURRENT->entries[i].name && strcmp(_hash_CURRENT->entries[i].name, name) != 0) i = (i + 1) & (_hash_CURRENT->capacity - 1);
+    return i;
+}
+
+
+/**
+ * @see calloc, _hash_find_slot, free, strdup
+ */
+hash_entry_t *_hash_insert(const char *const name, const char *const path, const struct timespec dir_mtime) {
+    // Allocate the table, or make it twice bigger when half full
+    if (_hash_CURRENT->entries == NULL || 2 * (_hash_CURRENT->count + 1) > _hash_CURRENT->capacity) {
+        hash_entry_t *const old_table = _hash_CURRENT->entries;
+        const int old_capacity = _hash_CURRENT->capacity;
+
+        _hash_CURRENT->capacity = old_table ? 2 * old_capacity : HASH_INITIAL_CAPACITY;
+        _hash_CURRENT->entries = calloc(_hash_CURRENT->capacity, sizeof(hash_entry_t));
+        if (!_hash_CURRENT->entries) {
+            _hash_CURRENT->entries = old_table;
+            _hash_CURRENT->capacity = old_capacity;
+            return NULL;
+        }
+
+        for (int i = 0; i < old_capacity; i++) if (old_table[i].name) _hash_CURRENT->entries[_hash_find_slot(old_table[i].name)] = old_table[i];
+        free(old_table);
+    }
+
+    hash_entry_t *const entry = &_hash_CURRENT->entries[_hash_find_slot(name)];
+    if (entry->name) free(entry->path);
+    else {
+        entry->name = strdup(name);
+        entry->hits = 0;
+        _hash_CURRENT->count++;
+    }
+    entry->path = strdup(path);
+    entry->dir_mtime = dir_mtime;
+
+    return entry;
+}
+
+
+/**
+ * @see _hash_find_slot, free, _hash_string
+ */
+int _hash_remove(const char *const name) {
+    if (_hash_CURRENT->entries == NULL) return 1;
+
+    int i = _hash_find_slot(name);
+    if (!_hash_CURRENT->entries[i].name) return 1;
+
+    free(_hash_CURRENT->entries[i].name);
+    free(_hash_CURRENT->entries[i].path);
+    _hash_CURRENT->entries[i].name = NULL;
+    _hash_CURRENT->count--;
+
+    // Move back next entries of the cluster so every entry stays reachable
+    int j = i, k;
+    while (1) {
+        j = (j + 1) & (_hash_CURRENT->capacity - 1);
+        if (!_hash_CURRENT->entries[j].name) break;
+
+        k = _hash_string(_hash_CURRENT->entries[j].name) & (_hash_CURRENT->capacity - 1);
+        // Keep the entry if its home slot is cyclically between the hole and itself
+        if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) continue;
+
+        _hash_CURRENT->entries[i] = _hash_CURRENT->entries[j];
+        _hash_CURRENT->entries[j].name = NULL;
+        i = j;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see strrchr, strcpy, memcpy, fstatat
+ */
+int _hash_dir_mtime(const char *const path, struct timespec *const mtime) {
+    char dir[MAX_PATH_LENGTH];
+    const char *const slash = strrchr(path, '/');
+    const size_t len = slash ? (size_t)(slash - path) : 0;
+    if (len >= MAX_PATH_LENGTH) return -1;
+
+    // The directory part of the path, "." without slash and "/" for the root
+    if (!slash) strcpy(dir, ".");
+    else if (len == 0) strcpy(dir, "/");
+    else {
+        memcpy(dir, path, len);
+        dir[len] = '\0';
+    }
+
+    struct stat st;
+    if (fstatat(CWD_FD, dir, &st, 0) == -1) return -1;
+    *mtime = st.st_mtim;
+    return 0;
+}
+
+
+/**
+ * @see var_get, strchr, snprintf, fstatat, S_ISREG, faccessat
+ */
+int _hash_search_path(const char *const name, char *const path) {
+    const char *dirs = var_get("PATH");
+    if (dirs == NULL) dirs = "/usr/local/bin:/usr/bin:/bin";
+
+    const char *end;
+    int len;
+    struct stat st;
+    while (1) {
+        end = strchr(dirs, ':');
+        len = end ? end - dirs : (int)strlen(dirs);
+
+        // An empty directory in PATH means the current directory
+        if (len == 0) snprintf(path, MAX_PATH_LENGTH, "./%s", name);
+        else          snprintf(path, MAX_PATH_LENGTH, "%.*s/%s", len, dirs, name);
+
+        if (fstatat(CWD_FD, path, &st, 0) == 0 && S_ISREG(st.st_mode) && faccessat(CWD_FD, path, X_OK, 0) == 0) return 0;
+
+        if (!end) break;
+        dirs = end + 1;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @see strchr, _hash_find_slot, _hash_dir_mtime, _hash_search_path, _hash_insert
+ */
+const char *hash_lookup(const char *const name) {
+    // Paths are never resolved
+    if (strchr(name, '/')) return name;
+
+    struct timespec mtime;
+
+    // Use the resolved path if its directory did not change
+    if (_hash_CURRENT->entries) {
+        hash_entry_t *const entry = &_hash_CURRENT->entries[_hash_find_slot(name)];
+        if (entry->name && _hash_dir_mtime(entry->path, &mtime) == 0 && mtime.tv_sec == entry->dir_mtime.tv_sec && mtime.tv_nsec == entry->dir_mtime.tv_nsec) {
+            entry->hits++;
+            return entry->path;
+        }
+    }
+
+    // Resolve it through PATH
+    char path[MAX_PATH_LENGTH];
+    if (_hash_search_path(name, path) == -1) {
+        _hash_remove(name);
+        return NULL;
+    }
+    if (_hash_dir_mtime(path, &mtime) == -1) return NULL;
+
+    hash_entry_t *const entry = _hash_insert(name, path, mtime);
+    if (!entry) return NULL;
+    entry->hits++;
+    return entry->path;
+}
+
+
+/**
+ * @see hash_table_free
+ */
+void hash_clear() {
+    hash_table_free(_hash_CURRENT);
+}
+
+
+hash_table_t *hash_use(hash_table_t *const table) {
+    hash_table_t *const previous = _hash_CURRENT;
+    _hash_CURRENT = table ? table : &_hash_MAIN;
+    return previous;
+}
+
+
+/**
+ * @see free
+ */
+void hash_table_free(hash_table_t *const table) {
+    for (int i = 0; i < table->capacity; i++) {
+        if (!table->entries[i].name) continue;
+        free(table->entries[i].name);
+        free(table->entries[i].path);
+    }
+    free(table->entries);
+
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _hash_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] [name ...]\n", program_name);
+    sink_printf("Without name, print every remembered command with its number of hits\n");
+    sink_printf("With names, resolve them through PATH and remember them\n");
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -r             Forget every remembered command\n");
+    sink_printf("    -d             Forget the given names\n");
+    sink_printf("    -t             Print the remembered path of the given names\n");
+}
+
+
+/**
+ * @see strcmp, _hash_print_usage, hash_clear, sink_printf, _hash_remove, hash_lookup, sink_error
+ */
+int our_hash(const int argc, const char *const *const argv) {
+    int forget = 0, print_path = 0, first_name = argc;
+
+    // Parse the arguments
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            _hash_print_usage(argv[0]);
+            return 0;
+        }
+        else if (strcmp(argv[i], "-r") == 0) hash_clear();
+        else if (strcmp(argv[i], "-d") == 0) forget = 1;
+        else if (strcmp(argv[i], "-t") == 0) print_path = 1;
+        else if (argv[i][0] == '-') {
+            sink_error("hash: unknown option %s\n", argv[i]);
+            _hash_print_usage(argv[0]);
+            return 1;
+        }
+        else {
+            first_name = i;
+            break;
+        }
+    }
+
+    // Print the table
+    if (first_name == argc) {
+        if (forget || print_path) {
+            sink_error("hash: missing name\n");
+            return 1;
+        }
+        if (_hash_CURRENT->count == 0) {
+            if (argc == 1) sink_printf("hash: table empty\n");
+            return 0;
+        }
+        sink_printf("hits    command\n");
+        for (int i = 0; i < _hash_CURRENT->capacity; i++) if (_hash_CURRENT->entries[i].name) sink_printf("%4d    %s\n", _hash_CURRENT->entries[i].hits, _hash_CURRENT->entries[i].path);
+        return 0;
+    }
+
+    // Resolve, print or forget every name
+    int res = 0;
+    const char *path;
+    for (int i = first_name; i < argc; i++) {
+        if (forget) {
+            if (_hash_remove(argv[i])) {
+                sink_error("hash: %s: not found\n", argv[i]);
+                res = 1;
+            }
+            continue;
+        }
+
+        path = hash_lookup(argv[i]);
+        if (path == NULL) {
+            sink_error("hash: %s: not found\n", argv[i]);
+            res = 1;
+        }
+        else if (print_path) sink_printf("%s\n", path);
+    }
+
+    return res;
+}
+
+
+REGISTER_BUILTIN("hash", our_hash, 0);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_hash(argc, argv);
+}
+#endif
@@ -0,0 +1,71 @@
+// CShell Project - New history command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "history.h"
+#include "sink.h"
+#include "builtin.h"
+#include <string.h>
+
+
+/**
+ * @see sink_printf
+ */
+void _history_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+}
+
+
+/**
+ * @see strcmp, _history_print_usage
+ */
+int _history_parse_arguments(const int argc, const char *const *const argv) {
+    for (int i = 1; i < argc; i++) {
+        // Check if the argument is -h or --help
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            // Print the usage and return
+            _history_print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see _history_parse_arguments, sink_printf
+ */
+int our_history(const int argc, const char *const *const argv) {
+    // Parse the arguments
+    int parse_result = _history_parse_arguments(argc, argv);
+    if (parse_result == -1) return 0;
+    if (parse_result) return parse_result;
+
+    // Print from the oldest to the newest command
+    int count = 0;
+    while (count < HISTORY_SIZE && HISTORY[count][0]) count++;
+    for (int i = count - 1; i > -1; i--) sink_printf("%d: %s\n", count - i, HISTORY[i]);
+    if (count == 0) sink_printf("No history available.\n");
+
+    return 0;
+}
+
+
+REGISTER_BUILTIN("history", our_history, BUILTIN_FUSABLE);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_history(argc, argv);
+}
+#endif
@@ -0,0 +1,774 @@
+// CShell Project - New jobs, wait, fg and bg commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "main.h"
+#include "jobs.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+
+
+// Jobs of the shell, and the table in use (another one while an embedding context runs, see jobs_use)
+static jobs_table_t _jobs_MAIN = { 0 };
+static jobs_table_t *_jobs_TABLE = &_jobs_MAIN;
+// File descriptor receiving SIGCHLD
+static int _jobs_SIGNAL_FD = -1;
+// Set when SIGCHLD was read from the file descriptor without reaping every child
+static int _jobs_SIGNAL_PENDING = 0;
+// Process group of the shell
+static pid_t _jobs_SHELL_PGID = 0;
+
+
+/**
+ * @see sigemptyset, sigaddset, sigprocmask, signalfd, signal, setpgid, getpgrp, tcsetpgrp
+ */
+void jobs_init(const int interactive) {
+    // SIGCHLD is only read through a file descriptor, children are reaped when the shell decides
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+    _jobs_SIGNAL_FD = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    _jobs_SHELL_PGID = getpgrp();
+    if (!interactive) return;
+
+    // Keyboard signals are for the foreground job, not for the shell
+    signal(SIGINT, SIG_IGN);
+    signal(SIGQUIT, SIG_IGN);
+    signal(SIGTSTP, SIG_IGN);
+    signal(SIGTTIN, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+
+    // Take the terminal with our own process group
+    setpgid(0, 0);
+    _jobs_SHELL_PGID = getpgrp();
+    tcsetpgrp(STDIN_FILENO, _jobs_SHELL_PGID);
+}
+
+
+/**
+ * @see setpgid, getpid, signal, sigemptyset, sigprocmask, close, redirect_install_shell_fds, fchdir
+ */
+void jobs_child_setup(const pid_t pgid) {
+    if (INTERACTIVE && pgid != -1) setpgid(0, pgid);
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+
+    sigset_t set;
+    sigemptyset(&set);
+    sigprocmask(SIG_SETMASK, &set, NULL);
+
+    // SIGCHLD is not blocked anymore, it never comes through the file descriptor of the shell
+    if (_jobs_SIGNAL_FD != -1) {
+        close(_jobs_SIGNAL_FD);
+        _jobs_SIGNAL_FD = -1;
+    }
+
+    // A copy made by an embedding context is a shell of its own, on the file descriptors and directory of the context
+    if (EMBEDDED) {
+        redirect_install_shell_fds();
+        if (CWD_FD != AT_FDCWD && fchdir(CWD_FD) == 0) {
+            close(CWD_FD);
+            CWD_FD = AT_FDCWD;
+        }
+        EMBEDDED = 0;
+    }
+}
+
+
+/**
+ * @see strlen, malloc, strcpy
+ */
+char *jobs_command_string(const int count, int *const argcs, char ***const argvs) {
+    size_t size = 1;
+    for (int i = 0; i < count; i++) for (int j = 0; j < argcs[i]; j++) size += strlen(argvs[i][j]) + 3;
+
+    char *const command = malloc(size);
+    if (!command) return NULL;
+
+    char *ptr = command;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            strcpy(ptr, "| ");
+            ptr += 2;
+        }
+        for (int j = 0; j < argcs[i]; j++) {
+            strcpy(ptr, argvs[i][j]);
+            ptr += strlen(argvs[i][j]);
+            *ptr++ = ' ';
+        }
+    }
+    if (ptr > command) ptr--;
+    *ptr = '\0';
+
+    return command;
+}
+
+
+jobs_table_t *jobs_use(jobs_table_t *const table) {
+    jobs_table_t *const previous = _jobs_TABLE;
+    _jobs_TABLE = table ? table : &_jobs_MAIN;
+    return previous;
+}
+
+
+/**
+ * @see jobs_use, _jobs_wait_known, free, memset
+ */
+void jobs_table_free(jobs_table_t *const table) {
+    jobs_table_t *const previous = jobs_use(table);
+    _jobs_wait_known(WNOHANG);
+    jobs_use(previous);
+
+    for (int i = 0; i < table->capacity; i++) {
+        if (!table->jobs[i]) continue;
+        free(table->jobs[i]->command);
+        free(table->jobs[i]);
+    }
+    free(table->jobs);
+    memset(table, 0, sizeof(jobs_table_t));
+}
+
+
+/**
+ * @see _jobs_drop_done, realloc, calloc, memcpy
+ */
+int jobs_add(const pid_t pgid, const pid_t *const pids, const int count, char *const command, const job_state_t state) {
+    // Without terminal nobody is told about finished jobs, a loop starting jobs must not grow the table
+    if (!INTERACTIVE) _jobs_drop_done();
+
+    // Take the first free number
+    int i = 0;
+    while (i < _jobs_TABLE->capacity && _jobs_TABLE->jobs[i]) i++;
+
+    // Make the table bigger if it is full
+    if (i == _jobs_TABLE->capacity) {
+        const int capacity = _jobs_TABLE->capacity ? 2 * _jobs_TABLE->capacity : 16;
+        job_t **const table = realloc(_jobs_TABLE->jobs, capacity * sizeof(job_t *));
+        if (!table) return -1;
+        for (int j = _jobs_TABLE->capacity; j < capacity; j++) table[j] = NULL;
+        _jobs_TABLE->jobs = table;
+        _jobs_TABLE->capacity = capacity;
+    }
+
+    job_t *const job = calloc(1, sizeof(job_t));
+    if (!job) return -1;
+
+    job->id = i + 1;
+    job->pgid = pgid;
+    job->count = count;
+    memcpy(job->pids, pids, count * sizeof(pid_t));
+    job->state = state;
+    job->command = command;
+    _jobs_TABLE->jobs[i] = job;
+
+    _jobs_TABLE->previous = _jobs_TABLE->current;
+    _jobs_TABLE->current = job->id;
+
+    return job->id;
+}
+
+
+/**
+ * @see free
+ */
+void _jobs_remove(job_t *const job) {
+    if (_jobs_TABLE->current == job->id) {
+        _jobs_TABLE->current = _jobs_TABLE->previous;
+        _jobs_TABLE->previous = 0;
+    }
+    if (_jobs_TABLE->previous == job->id) _jobs_TABLE->previous = 0;
+
+    _jobs_TABLE->jobs[job->id - 1] = NULL;
+    free(job->command);
+    free(job);
+}
+
+
+/**
+ * @see _jobs_remove
+ */
+void _jobs_drop_done() {
+    for (int i = 0; i < _jobs_TABLE->capacity; i++) {
+        job_t *const job = _jobs_TABLE->jobs[i];
+        if (!job || job->state != JOB_DONE) continue;
+
+        for (int j = 0; j < job->count; j++) {
+            if (job->pids[j] <= 0) continue;
+            _jobs_TABLE->done_pids[_jobs_TABLE->done_next] = job->pids[j];
+            _jobs_TABLE->done_codes[_jobs_TABLE->done_next] = job->codes[j];
+            _jobs_TABLE->done_next = (_jobs_TABLE->done_next + 1) % JOBS_DONE_KEPT;
+        }
+        _jobs_remove(job);
+    }
+}
+
+
+int _jobs_done_code(const pid_t pid, int *const code) {
+    // Latest first, a pid may have been reused
+    for (int i = 1; i <= JOBS_DONE_KEPT; i++) {
+        const int slot = (_jobs_TABLE->done_next + JOBS_DONE_KEPT - i) % JOBS_DONE_KEPT;
+        if (_jobs_TABLE->done_pids[slot] != pid) continue;
+        *code = _jobs_TABLE->done_codes[slot];
+        return 1;
+    }
+    return 0;
+}
+
+
+int jobs_running_count() {
+    int count = 0;
+    for (int i = 0; i < _jobs_TABLE->capacity; i++) if (_jobs_TABLE->jobs[i] && _jobs_TABLE->jobs[i]->state == JOB_RUNNING) count++;
+    return count;
+}
+
+
+/**
+ * @see WIFSTOPPED, WIFCONTINUED, status_to_code
+ */
+int _jobs_update_job(job_t *const job, const pid_t pid, const int status) {
+    int i = 0;
+    while (i < job->count && job->pids[i] != pid) i++;
+    if (i == job->count) return 0;
+
+    if (WIFSTOPPED(status)) {
+        job->state = JOB_STOPPED;
+        job->notified = 0;
+        if (_jobs_TABLE->current != job->id) {
+            _jobs_TABLE->previous = _jobs_TABLE->current;
+            _jobs_TABLE->current = job->id;
+        }
+        return 1;
+    }
+    if (WIFCONTINUED(status)) {
+        job->state = JOB_RUNNING;
+        return 1;
+    }
+
+    job->finished[i] = 1;
+    job->codes[i] = status_to_code(status);
+
+    // The job is done once every process is done
+    for (i = 0; i < job->count; i++) if (!job->finished[i]) return 1;
+    job->state = JOB_DONE;
+    job->notified = 0;
+
+    return 1;
+}
+
+
+/**
+ * @see _jobs_update_job
+ */
+void _jobs_update(const pid_t pid, const int status) {
+    for (int i = 0; i < _jobs_TABLE->capacity; i++) if (_jobs_TABLE->jobs[i] && _jobs_update_job(_jobs_TABLE->jobs[i], pid, status)) return;
+}
+
+
+/**
+ * @see waitpid, _jobs_update
+ */
+int _jobs_wait_known(const int options) {
+    for (int i = 0; i < _jobs_TABLE->capacity; i++) {
+        job_t *const job = _jobs_TABLE->jobs[i];
+        if (!job || job->state == JOB_DONE) continue;
+
+        for (int j = 0; j < job->count; j++) {
+            if (job->finished[j]) continue;
+
+            int status;
+            pid_t pid;
+            do pid = waitpid(job->pids[j], &status, options | WUNTRACED | WCONTINUED);
+            while (pid == -1 && errno == EINTR);
+            if (pid > 0) _jobs_update(pid, status);
+            // A blocking wait stops at the first change
+            if (!(options & WNOHANG)) return pid > 0 ? 0 : -1;
+        }
+    }
+
+    return options & WNOHANG ? 0 : -1;
+}
+
+
+/**
+ * @see read, waitpid, _jobs_update, _jobs_wait_known
+ */
+void jobs_reap() {
+    // Inside another program, its own children are not ours to reap
+    if (EMBEDDED) {
+        _jobs_wait_known(WNOHANG);
+        return;
+    }
+
+    // Nothing to do if no SIGCHLD was received
+    struct signalfd_siginfo info;
+    int received = _jobs_SIGNAL_FD == -1 || _jobs_SIGNAL_PENDING;
+    _jobs_SIGNAL_PENDING = 0;
+    while (_jobs_SIGNAL_FD != -1 && read(_jobs_SIGNAL_FD, &info, sizeof(info)) == sizeof(info)) received = 1;
+    if (!received) return;
+
+    pid_t pid;
+    int status;
+    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) _jobs_update(pid, status);
+}
+
+
+/**
+ * @see waitpid, _jobs_update, _jobs_wait_known
+ */
+int jobs_wait_any() {
+    if (EMBEDDED) return _jobs_wait_known(0);
+
+    pid_t pid;
+    int status;
+
+    do pid = waitpid(-1, &status, WUNTRACED | WCONTINUED);
+    while (pid == -1 && errno == EINTR);
+    if (pid == -1) return -1;
+
+    _jobs_update(pid, status);
+    return 0;
+}
+
+
+/**
+ * @see jobs_reap, _jobs_drop_done, _jobs_print, _jobs_remove, fflush
+ */
+void jobs_notify() {
+    jobs_reap();
+
+    // Without terminal, finished jobs are dropped silently, only their return codes are kept for wait
+    if (!INTERACTIVE) {
+        _jobs_drop_done();
+        return;
+    }
+
+    for (int i = 0; i < _jobs_TABLE->capacity; i++) {
+        job_t *const job = _jobs_TABLE->jobs[i];
+        if (!job || job->notified || job->state == JOB_RUNNING) continue;
+
+        _jobs_print(job, 0);
+        job->notified = 1;
+        if (job->state == JOB_DONE) _jobs_remove(job);
+    }
+
+    fflush(stdout);
+}
+
+
+/**
+ * @see poll, jobs_reap
+ */
+void jobs_poll_input(const int fd) {
+    if (_jobs_SIGNAL_FD == -1) return;
+
+    struct pollfd fds[2] = {
+        { .fd = fd, .events = POLLIN },
+        { .fd = _jobs_SIGNAL_FD, .events = POLLIN },
+    };
+
+    // Reap background jobs as soon as they change, while the user is typing
+    while (1) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents & POLLIN) jobs_reap();
+        if (fds[0].revents) return;
+    }
+}
+
+
+/**
+ * @see disable_raw_mode, tcsetpgrp, wait4, _jobs_update_job, timing_end_process, poll, read, enable_raw_mode
+ */
+void _jobs_wait_job(job_t *const job, const int allow_stop, timing_stage_t *const timings) {
+    // Give the terminal to the job
+    const int give_terminal = INTERACTIVE && job->pgid > 0 && allow_stop;
+    if (give_terminal) {
+        disable_raw_mode();
+        tcsetpgrp(STDIN_FILENO, job->pgid);
+    }
+
+    // Processes are waited in order, unless they are timed: each one is then reaped as soon as it ends,
+    // checking all of them at each SIGCHLD
+    const int in_order = !timings || _jobs_SIGNAL_FD == -1;
+    struct rusage usage;
+    pid_t pid;
+    int status;
+    int waiting = 1;
+    job->state = JOB_RUNNING;
+    while (waiting && job->state != JOB_STOPPED) {
+        waiting = 0;
+        for (int i = 0; i < job->count && job->state != JOB_STOPPED; i++) {
+            if (job->finished[i]) continue;
+            if (job->pids[i] <= 0) {
+                job->finished[i] = 1;
+                continue;
+            }
+
+            do pid = wait4(job->pids[i], &status, (allow_stop ? WUNTRACED : 0) | (in_order ? 0 : WNOHANG), &usage);
+            while (pid == -1 && errno == EINTR);
+
+            if (pid == 0) waiting = 1;
+            else if (pid == -1) job->finished[i] = 1;
+            else {
+                _jobs_update_job(job, pid, status);
+                if (timings && job->finished[i]) timing_end_process(&timings[i], &usage);
+            }
+        }
+        if (!waiting || job->state == JOB_STOPPED) break;
+
+        // Sleep until the next SIGCHLD, jobs_reap must still reap the other children it was for
+        struct pollfd fd = { .fd = _jobs_SIGNAL_FD, .events = POLLIN };
+        struct signalfd_siginfo info;
+        while (poll(&fd, 1, -1) == -1 && errno == EINTR);
+        while (read(_jobs_SIGNAL_FD, &info, sizeof(info)) == sizeof(info)) _jobs_SIGNAL_PENDING = 1;
+    }
+
+    // Check if the whole job is done
+    int done = 1;
+    for (int i = 0; i < job->count; i++) if (!job->finished[i]) done = 0;
+    if (done) job->state = JOB_DONE;
+
+    // Take the terminal back
+    if (give_terminal) {
+        tcsetpgrp(STDIN_FILENO, _jobs_SHELL_PGID);
+        enable_raw_mode();
+    }
+}
+
+
+/**
+ * @see _jobs_wait_job, jobs_command_string, jobs_add, _jobs_print, WSTOPSIG
+ */
+int jobs_wait_foreground(const pid_t pgid, const pid_t *const pids, int *const codes, const int count, const int stages, int *const argcs, char ***const argvs, timing_stage_t *const timings) {
+    job_t job = { 0 };
+    job.pgid = pgid;
+    job.count = count;
+    for (int i = 0; i < count; i++) {
+        job.pids[i] = pids[i];
+        job.codes[i] = codes[i];
+        job.finished[i] = pids[i] <= 0;
+    }
+
+    TRACE_BEGIN("wait", argcs && argcs[0] > 0 && argvs[0] ? argvs[0][0] : NULL);
+    _jobs_wait_job(&job, argcs != NULL, timings);
+    TRACE_END("wait");
+    for (int i = 0; i < count; i++) codes[i] = job.finished[i] ? job.codes[i] : 128 + SIGTSTP;
+    if (job.state != JOB_STOPPED) return 0;
+
+    // Keep the stopped pipeline as a job
+    const int id = jobs_add(pgid, pids, count, jobs_command_string(stages, argcs, argvs), JOB_STOPPED);
+    if (id == -1) return 1;
+
+    job_t *const stopped = _jobs_TABLE->jobs[id - 1];
+    for (int i = 0; i < count; i++) {
+        stopped->finished[i] = job.finished[i];
+        stopped->codes[i] = job.codes[i];
+    }
+    printf("\n");
+    _jobs_print(stopped, 0);
+    stopped->notified = 1;
+
+    return 1;
+}
+
+
+/**
+ * @see strcmp, isdigit, atoi, strncmp, strlen
+ */
+job_t *_jobs_find(const char *const spec) {
+    int id = 0;
+
+    if (spec == NULL || strcmp(spec, "%") == 0 || strcmp(spec, "%%") == 0 || strcmp(spec, "%+") == 0) id = _jobs_TABLE->current;
+    else if (strcmp(spec, "%-") == 0) id = _jobs_TABLE->previous;
+    else if (spec[0] == '%' && isdigit((unsigned char)spec[1])) id = atoi(&spec[1]);
+    else if (isdigit((unsigned char)spec[0])) {
+        // Job containing this process
+        const pid_t pid = atoi(spec);
+        for (int i = 0; i < _jobs_TABLE->capacity; i++) {
+            if (!_jobs_TABLE->jobs[i]) continue;
+            for (int j = 0; j < _jobs_TABLE->jobs[i]->count; j++) if (_jobs_TABLE->jobs[i]->pids[j] == pid) return _jobs_TABLE->jobs[i];
+        }
+        return NULL;
+    }
+    else if (spec[0] == '%') {
+        // Last job whose command starts with the string
+        for (int i = _jobs_TABLE->capacity - 1; i >= 0; i--) if (_jobs_TABLE->jobs[i] && strncmp(_jobs_TABLE->jobs[i]->command, &spec[1], strlen(&spec[1])) == 0) return _jobs_TABLE->jobs[i];
+        return NULL;
+    }
+
+    // Without current job, take the last one
+    if (spec == NULL && (id <= 0 || id > _jobs_TABLE->capacity || !_jobs_TABLE->jobs[id - 1])) {
+        for (int i = _jobs_TABLE->capacity - 1; i >= 0; i--) if (_jobs_TABLE->jobs[i]) return _jobs_TABLE->jobs[i];
+        return NULL;
+    }
+
+    if (id <= 0 || id > _jobs_TABLE->capacity) return NULL;
+    return _jobs_TABLE->jobs[id - 1];
+}
+
+
+/**
+ * @see kill
+ */
+void _jobs_signal(const job_t *const job, const int sig) {
+    if (INTERACTIVE && job->pgid > 0) {
+        kill(-job->pgid, sig);
+        return;
+    }
+    for (int i = 0; i < job->count; i++) if (!job->finished[i] && job->pids[i] > 0) kill(job->pids[i], sig);
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _jobs_print(const job_t *const job, const int with_pids) {
+    const char mark = job->id == _jobs_TABLE->current ? '+' : job->id == _jobs_TABLE->previous ? '-' : ' ';
+    const int code = job->codes[job->count - 1];
+
+    char state[32];
+    if (job->state == JOB_RUNNING)      snprintf(state, sizeof(state), "Running");
+    else if (job->state == JOB_STOPPED) snprintf(state, sizeof(state), "Stopped");
+    else if (code == 0)                 snprintf(state, sizeof(state), "Done");
+    else                                snprintf(state, sizeof(state), "Exit %d", code);
+
+    sink_printf("[%d]%c  %-10s %s%s\n", job->id, mark, state, job->command ? job->command : "", job->state == JOB_RUNNING ? " &" : "");
+    if (with_pids) for (int i = 0; i < job->count; i++) if (job->pids[i] > 0) sink_printf("      %d\n", job->pids[i]);
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _jobs_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -l             Print the processes of each job\n");
+    sink_printf("    -p             Print only the process group of each job\n");
+}
+
+
+/**
+ * @see strcmp, _jobs_print_usage, jobs_reap, _jobs_print, sink_printf, _jobs_remove
+ */
+int our_jobs(const int argc, const char *const *const argv) {
+    int with_pids = 0, only_pgid = 0;
+
+    // Parse the arguments
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            _jobs_print_usage(argv[0]);
+            return 0;
+        }
+        else if (strcmp(argv[i], "-l") == 0) with_pids = 1;
+        else if (strcmp(argv[i], "-p") == 0) only_pgid = 1;
+        else {
+            sink_error("jobs: unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    jobs_reap();
+
+    // Print every job, finished ones are forgotten once printed
+    for (int i = 0; i < _jobs_TABLE->capacity; i++) {
+        job_t *const job = _jobs_TABLE->jobs[i];
+        if (!job) continue;
+
+        if (only_pgid) sink_printf("%d\n", job->pgid > 0 ? job->pgid : job->pids[0]);
+        else           _jobs_print(job, with_pids);
+
+        job->notified = 1;
+        if (job->state == JOB_DONE) _jobs_remove(job);
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see strcmp, jobs_reap, _jobs_find, isdigit, atoi, _jobs_done_code, jobs_wait_any, _jobs_remove, sink_error
+ */
+int our_wait(const int argc, const char *const *const argv) {
+    int next = 0, first_spec = argc;
+
+    // Parse the arguments
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            sink_printf("Usage: %s [-n] [%%job | pid ...]\n", argv[0]);
+            sink_printf("Without job, wait for every job, with -n wait for the next job to finish\n");
+            return 0;
+        }
+        else if (strcmp(argv[i], "-n") == 0) next = 1;
+        else {
+            first_spec = i;
+            break;
+        }
+    }
+
+    jobs_reap();
+    int code = 0;
+
+    // Wait for the next job to finish
+    if (next && first_spec == argc) {
+        while (1) {
+            int running = 0;
+            for (int i = 0; i < _jobs_TABLE->capacity; i++) {
+                job_t *const job = _jobs_TABLE->jobs[i];
+                if (!job) continue;
+                if (job->state == JOB_DONE) {
+                    code = job->codes[job->count - 1];
+                    _jobs_remove(job);
+                    return code;
+                }
+                running += job->state == JOB_RUNNING;
+            }
+            if (!running || jobs_wait_any() == -1) return 127;
+        }
+    }
+
+    // Wait for every job
+    if (first_spec == argc) {
+        while (jobs_running_count() > 0 && jobs_wait_any() == 0);
+        for (int i = 0; i < _jobs_TABLE->capacity; i++) if (_jobs_TABLE->jobs[i] && _jobs_TABLE->jobs[i]->state == JOB_DONE) _jobs_remove(_jobs_TABLE->jobs[i]);
+        return 0;
+    }
+
+    // Wait for given jobs
+    for (int i = first_spec; i < argc; i++) {
+        job_t *const job = _jobs_find(argv[i]);
+        if (!job && isdigit((unsigned char)argv[i][0]) && _jobs_done_code(atoi(argv[i]), &code)) continue;
+        if (!job) {
+            sink_error("wait: %s: no such job\n", argv[i]);
+            code = 127;
+            continue;
+        }
+
+        while (job->state == JOB_RUNNING && jobs_wait_any() == 0);
+        if (job->state == JOB_STOPPED) {
+            code = 128 + SIGTSTP;
+            continue;
+        }
+
+        code = job->codes[job->count - 1];
+        _jobs_remove(job);
+    }
+
+    return code;
+}
+
+
+/**
+ * @see _jobs_find, sink_error, sink_printf, sink_flush, _jobs_signal, _jobs_wait_job, _jobs_print, _jobs_remove
+ */
+int our_fg(const int argc, const char *const *const argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        sink_printf("Usage: %s [%%job]\n", argv[0]);
+        sink_printf("Continue a job in foreground, the current one by default\n");
+        return 0;
+    }
+
+    jobs_reap();
+    job_t *const job = _jobs_find(argc > 1 ? argv[1] : NULL);
+    if (!job) {
+        sink_error("fg: %s: no such job\n", argc > 1 ? argv[1] : "current");
+        return 1;
+    }
+
+    sink_printf("%s\n", job->command ? job->command : "");
+    sink_flush();
+
+    // Continue the job with the terminal and wait for it
+    if (INTERACTIVE && job->pgid > 0) {
+        disable_raw_mode();
+        tcsetpgrp(STDIN_FILENO, job->pgid);
+    }
+    _jobs_signal(job, SIGCONT);
+    _jobs_wait_job(job, 1, NULL);
+
+    if (job->state == JOB_STOPPED) {
+        sink_printf("\n");
+        _jobs_print(job, 0);
+        job->notified = 1;
+        return 128 + SIGTSTP;
+    }
+
+    const int code = job->codes[job->count - 1];
+    _jobs_remove(job);
+    return code;
+}
+
+
+/**
+ * @see _jobs_find, sink_error, _jobs_signal, sink_printf
+ */
+int our_bg(const int argc, const char *const *const argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        sink_printf("Usage: %s [%%job ...]\n", argv[0]);
+        sink_printf("Continue stopped jobs in background, the current one by default\n");
+        return 0;
+    }
+
+    jobs_reap();
+    int code = 0;
+    for (int i = 1; i < (argc > 1 ? argc : 2); i++) {
+        job_t *const job = _jobs_find(argc > 1 ? argv[i] : NULL);
+        if (!job) {
+            sink_error("bg: %s: no such job\n", argc > 1 ? argv[i] : "current");
+            code = 1;
+            continue;
+        }
+        if (job->state != JOB_STOPPED) {
+            sink_error("bg: job %d already in background\n", job->id);
+            continue;
+        }
+
+        job->state = JOB_RUNNING;
+        _jobs_signal(job, SIGCONT);
+        sink_printf("[%d]%c %s &\n", job->id, job->id == _jobs_TABLE->current ? '+' : ' ', job->command ? job->command : "");
+    }
+
+    return code;
+}
+
+
+REGISTER_BUILTIN("jobs", our_jobs, 0);
+REGISTER_BUILTIN("wait", our_wait, 0);
+REGISTER_BUILTIN("fg", our_fg, 0);
+REGISTER_BUILTIN("bg", our_bg, 0);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_jobs(argc, argv);
+}
+#endif
@@ -0,0 +1,116 @@
+// CShell Project - New break and continue commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "loop.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+
+/**
+ * @see sink_printf
+ */
+void _loop_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] [n]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+}
+
+
+/**
+ * @see strcmp, _loop_print_usage, isdigit, atoi, sink_error
+ */
+int _loop_parse_arguments(const int argc, const char *const *const argv, int *const levels) {
+    *levels = 1;
+    if (argc > 2) {
+        sink_error("%s: too many arguments\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        // Check if the argument is -h or --help
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            // Print the usage and return
+            _loop_print_usage(argv[0]);
+            return -1;
+        }
+
+        // Check if the argument is a positive number
+        for (int j = 0; argv[i][j] != '\0'; j++) {
+            if (!isdigit((unsigned char)argv[i][j])) {
+                sink_error("%s: %s: numeric argument required\n", argv[0], argv[i]);
+                return 1;
+            }
+        }
+        *levels = atoi(argv[i]);
+        if (*levels < 1) {
+            sink_error("%s: %s: loop count out of range\n", argv[0], argv[i]);
+            return 1;
+        }
+    }
+
+    // Only meaningful inside a loop, and never further than the outermost one
+    if (LOOP_DEPTH == 0) {
+        sink_error("%s: only meaningful in a `for', `while', or `until' loop\n", argv[0]);
+        return -1;
+    }
+    if (*levels > LOOP_DEPTH) *levels = LOOP_DEPTH;
+
+    return 0;
+}
+
+
+/**
+ * @see _loop_parse_arguments
+ */
+int our_break(const int argc, const char *const *const argv) {
+    // Parse the arguments
+    int levels;
+    int parse_result = _loop_parse_arguments(argc, argv, &levels);
+    if (parse_result == -1) return 0;
+    if (parse_result) return parse_result;
+
+    // Loops stop once the current command is done (see execute_node)
+    LOOP_BREAK = levels;
+
+    return 0;
+}
+
+
+/**
+ * @see _loop_parse_arguments
+ */
+int our_continue(const int argc, const char *const *const argv) {
+    // Parse the arguments
+    int levels;
+    int parse_result = _loop_parse_arguments(argc, argv, &levels);
+    if (parse_result == -1) return 0;
+    if (parse_result) return parse_result;
+
+    // Inner loops stop, the last one goes on with its next iteration (see execute_node)
+    LOOP_CONTINUE = levels;
+
+    return 0;
+}
+
+
+REGISTER_BUILTIN("break", our_break, 0);
+REGISTER_BUILTIN("continue", our_continue, 0);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_break(argc, argv);
+}
+#endif
@@ -3,7 +3,10 @@
 // Date: 2025-03-17
 
 
+#include "config.h"
 #include "ls.h"
+#include "sink.h"
+#include "builtin.h"
 #include <stdio.h>
 #include <string.h>
 #include <dirent.h>
@@ -13,17 +16,18 @@
 #include <pwd.h>
 #include <grp.h>
 #include <time.h>
+#include <fcntl.h>
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _ls_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options]\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
-    printf("    -l            List in long format\n");
-    printf("    -a            List all files, including hidden ones\n");
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -l            List in long format\n");
+    sink_printf("    -a            List all files, including hidden ones\n");
 }
 
 
@@ -42,7 +46,7 @@ int _ls_parse_arguments(const int argc, const char *const *const argv, int *cons
         else if (strcmp(argv[i], "-l") == 0) *long_format = 1;
 
         else {
-            perror("ls: option inconnue");
+            sink_perror("ls: option inconnue");
             return 1;
         }
     }
@@ -52,7 +56,7 @@ int _ls_parse_arguments(const int argc, const char *const *const argv, int *cons
 
 
 /**
- * @see _ls_parse_arguments, opendir, perror, readdir, printf, stat, S_ISDIR, getpwuid, getgrgid, localtime, strftime, closedir
+ * @see _ls_parse_arguments, openat, fdopendir, close, sink_perror, readdir, sink_printf, fstatat, dirfd, S_ISDIR, getpwuid, getgrgid, localtime, strftime, closedir
  */
 int our_ls(const int argc, const char *const *const argv) {
     int show_all = 0;
@@ -62,9 +66,11 @@ int our_ls(const int argc, const char *const *const argv) {
     if (parse_result == -1) return 0;
     if (parse_result) return parse_result;
 
-    DIR *dir = opendir(".");
+    const int dir_fd = openat(CWD_FD, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = dir_fd == -1 ? NULL : fdopendir(dir_fd);
     if (dir == NULL) {
-        perror("ls");
+        if (dir_fd != -1) close(dir_fd);
+        sink_perror("ls");
         return 1;
     }
 
@@ -72,52 +78,55 @@ int our_ls(const int argc, const char *const *const argv) {
     while ((entry = readdir(dir)) != NULL) {
         if (!show_all && entry->d_name[0] == '.') continue;
 
-        if (!long_format) printf("%s  ", entry->d_name);
+        if (!long_format) sink_printf("%s  ", entry->d_name);
         else {
             struct stat info;
-            if (stat(entry->d_name, &info) == -1) {
-                perror("stat");
+            if (fstatat(dirfd(dir), entry->d_name, &info, 0) == -1) {
+                sink_perror("stat");
                 continue;
             }
 
             // Type
-            printf(S_ISDIR(info.st_mode) ? "d" : "-");
+            sink_printf(S_ISDIR(info.st_mode) ? "d" : "-");
 
             // Permissions
-            printf((info.st_mode & S_IRUSR) ? "r" : "-");
-            printf((info.st_mode & S_IWUSR) ? "w" : "-");
-            printf((info.st_mode & S_IXUSR) ? "x" : "-");
-            printf((info.st_mode & S_IRGRP) ? "r" : "-");
-            printf((info.st_mode & S_IWGRP) ? "w" : "-");
-            printf((info.st_mode & S_IXGRP) ? "x" : "-");
-            printf((info.st_mode & S_IROTH) ? "r" : "-");
-            printf((info.st_mode & S_IWOTH) ? "w" : "-");
-            printf((info.st_mode & S_IXOTH) ? "x" : "-");
+            sink_printf((info.st_mode & S_IRUSR) ? "r" : "-");
+            sink_printf((info.st_mode & S_IWUSR) ? "w" : "-");
+            sink_printf((info.st_mode & S_IXUSR) ? "x" : "-");
+            sink_printf((info.st_mode & S_IRGRP) ? "r" : "-");
+            sink_printf((info.st_mode & S_IWGRP) ? "w" : "-");
+            sink_printf((info.st_mode & S_IXGRP) ? "x" : "-");
+            sink_printf((info.st_mode & S_IROTH) ? "r" : "-");
+            sink_printf((info.st_mode & S_IWOTH) ? "w" : "-");
+            sink_printf((info.st_mode & S_IXOTH) ? "x" : "-");
 
             // Liens, utilisateur, groupe, taille
-            printf(" %lu", info.st_nlink);
+            sink_printf(" %lu", info.st_nlink);
             struct passwd *pw = getpwuid(info.st_uid);
             struct group  *gr = getgrgid(info.st_gid);
-            printf(" %s %s", pw ? pw->pw_name : "?", gr ? gr->gr_name : "?");
-            printf(" %5ld", info.st_size);
+            sink_printf(" %s %s", pw ? pw->pw_name : "?", gr ? gr->gr_name : "?");
+            sink_printf(" %5ld", info.st_size);
 
             // Date
             char date[20];
             strftime(date, sizeof(date), "%b %d %H:%M", localtime(&info.st_mtime));
-            printf(" %s", date);
+            sink_printf(" %s", date);
 
             // Nom
-            printf(" %s\n", entry->d_name);
+            sink_printf(" %s\n", entry->d_name);
         }
     }
 
-    if (!long_format) printf("\n");
+    if (!long_format) sink_printf("\n");
 
     closedir(dir);
     return 0;
 }
 
 
+REGISTER_BUILTIN("ls", our_ls, BUILTIN_FUSABLE);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING PURPOSES
@@ -3,21 +3,25 @@
 // Date: 2025-03-17
 
 
+#include "config.h"
 #include "mkdir.h"
+#include "sink.h"
+#include "builtin.h"
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
+#include <fcntl.h>
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _mkdir_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options] path\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
+    sink_printf("Usage: %s [Options] path\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
 }
 
 
@@ -45,7 +49,7 @@ int _mkdir_parse_arguments(const int argc, const char *const *const argv) {
 
 
 /**
- * @see _mkdir_parse_arguments, mkdir, printf, perror
+ * @see _mkdir_parse_arguments, mkdirat, sink_printf, sink_perror
  */
 int our_mkdir(const int argc, const char *const *const argv) {
     // Parse the arguments
@@ -54,11 +58,11 @@ int our_mkdir(const int argc, const char *const *const argv) {
     if (parse_result) return parse_result;
 
     const char *dir_name = argv[1];
-    int status = mkdir(dir_name, 0755);
+    int status = mkdirat(CWD_FD, dir_name, 0755);
 
-    if (status == 0) printf("Directory '%s' created successfully.\n", dir_name);
+    if (status == 0) sink_printf("Directory '%s' created successfully.\n", dir_name);
     else {
-        perror("Error creating directory");
+        sink_perror("Error creating directory");
         return 1;
     }
 
@@ -66,6 +70,9 @@ int our_mkdir(const int argc, const char *const *const argv) {
 }
 
 
+REGISTER_BUILTIN("mkdir", our_mkdir, BUILTIN_FUSABLE);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
@@ -3,7 +3,10 @@
 // Date: 2025-03-17
 
 
+#include "config.h"
 #include "mv.h"
+#include "sink.h"
+#include "builtin.h"
 #include "cp.h"
 #include <stdio.h>
 #include <string.h>
@@ -14,12 +17,12 @@
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _mv_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options] old_path new_path\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
+    sink_printf("Usage: %s [Options] old_path new_path\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
 }
 
 
@@ -47,7 +50,7 @@ int _mv_parse_arguments(const int argc, const char *const *const argv) {
 
 
 /**
- * @see _mv_parse_arguments, rename, printf, our_cp, perror, unlink
+ * @see _mv_parse_arguments, renameat, sink_printf, our_cp, sink_perror, unlinkat
  */
 int our_mv(const int argc, const char *const *const argv) {
     // Parse the arguments
@@ -58,19 +61,19 @@ int our_mv(const int argc, const char *const *const argv) {
     const char *const source = argv[1];
     const char *const destination = argv[2];
 
-    if (rename(source, destination) == 0) {
-        printf("Moved '%s' to '%s'\n", source, destination);
+    if (renameat(CWD_FD, source, CWD_FD, destination) == 0) {
+        sink_printf("Moved '%s' to '%s'\n", source, destination);
         return 0;
     }
 
     // If rename fails, try to copy and then delete the source
     if (our_cp(argc, argv) != 0) {
-        perror("Error: Failed to copy");
+        sink_perror("Error: Failed to copy");
         return 1;
     }
 
-    if (unlink(source) != 0) {
-        perror("Error: Failed to delete source file");
+    if (unlinkat(CWD_FD, source, 0) != 0) {
+        sink_perror("Error: Failed to delete source file");
         return 1;
     }
 
@@ -78,6 +81,9 @@ int our_mv(const int argc, const char *const *const argv) {
 }
 
 
+REGISTER_BUILTIN("mv", our_mv, 0);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
@@ -0,0 +1,1062 @@
+// CShell Project - Tokenizer, parser and cache of compiled command lines
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "parser.h"
+#include "arena.h"
+#include "hash.h"
+#include "sink.h"
+#include "stats.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+
+// Cache of plans of the shell, and the cache in use (another one while an embedding context runs, see plan_use)
+static plan_cache_t _plan_MAIN = { { NULL }, NULL, NULL, 0 };
+static plan_cache_t *_plan_CURRENT = &_plan_MAIN;
+
+// Text of each token type, for syntax errors
+static const char *const _TOKEN_NAMES[] = { "word", "|", "&&", "||", ";", ";;", "&", "<", ">", ">>", "<>", "<&", ">&", "&>", "&>>", "<<", "<<-", "<<<", "(", ")", "end of file" };
+// Reserved words closing a compound command, they can not start a command
+static const char *const _CLOSING_KEYWORDS[] = { "then", "elif", "else", "fi", "do", "done", "esac", NULL };
+
+
+/**
+ * @see strchr
+ */
+const char *lex_skip_substitution(const char *ptr) {
+    // Skip $( and find the matching parenthesis, quotes and escapes included
+    int depth = 1;
+    ptr += 2;
+    while (*ptr && depth > 0) {
+        if (*ptr == '\\' && ptr[1]) ptr++;
+        else if (*ptr == '\'' || *ptr == '\"') {
+            const char quote = *ptr++;
+            while (*ptr && *ptr != quote) {
+                if (quote == '\"' && *ptr == '\\' && ptr[1]) ptr++;
+                ptr++;
+            }
+            if (!(*ptr)) break;
+        }
+        else if (*ptr == '(') depth++;
+        else if (*ptr == ')') depth--;
+        ptr++;
+    }
+    return ptr;
+}
+
+
+/**
+ * @see isspace, strchr, lex_skip_substitution, arena_strndup
+ */
+char *_lex_word(arena_t *const arena, const char **const ptr, int *const incomplete) {
+    const char *const start = *ptr;
+    const char *cur = start;
+
+    // A word ends on a space or an operator outside of quotes, <(...) and >(...) are part of words
+    while (*cur && !isspace((unsigned char)*cur) && (!strchr("|&;<>()", *cur) || ((*cur == '<' || *cur == '>') && cur[1] == '('))) {
+        if ((*cur == '<' || *cur == '>') && cur[1] == '(') {
+            cur = lex_skip_substitution(cur);
+            if (cur[-1] != ')') *incomplete = 1;
+        }
+        else if (*cur == '\\') {
+            cur++;
+            if (*cur) cur++;
+        }
+        else if (*cur == '\'') {
+            cur++;
+            while (*cur && *cur != '\'') cur++;
+            if (*cur) cur++;
+            else *incomplete = 1;
+        }
+        else if (*cur == '\"') {
+            cur++;
+            while (*cur && *cur != '\"') {
+                if (*cur == '\\' && cur[1]) cur += 2;
+                else if (*cur == '$' && cur[1] == '(') {
+                    cur = lex_skip_substitution(cur);
+                    if (cur[-1] != ')') *incomplete = 1;
+                }
+                else cur++;
+            }
+            if (*cur) cur++;
+            else *incomplete = 1;
+        }
+        else if (*cur == '$' && cur[1] == '(') {
+            cur = lex_skip_substitution(cur);
+            if (cur[-1] != ')') *incomplete = 1;
+        }
+        else cur++;
+    }
+
+    *ptr = cur;
+    return arena_strndup(arena, start, cur - start);
+}
+
+
+/**
+ * @see arena_alloc
+ */
+char *_lex_unquote(arena_t *const arena, const char *const word) {
+    char *const copy = arena_alloc(arena, strlen(word) + 1);
+    if (!copy) return NULL;
+
+    char *write = copy;
+    for (const char *read = word; *read; read++) {
+        if (*read == '\'' || *read == '\"') continue;
+        if (*read == '\\' && read[1]) read++;
+        *write++ = *read;
+    }
+    *write = '\0';
+    return copy;
+}
+
+
+/**
+ * @see _lex_unquote, strlen, strchr, strncmp, arena_alloc, memcpy
+ */
+int _lex_heredocs(arena_t *const arena, token_t *const tokens, const int first, const int last, const char **const ptr, int *const incomplete) {
+    for (int k = first; k + 1 < last; k++) {
+        if ((tokens[k].type != TOKEN_HEREDOC && tokens[k].type != TOKEN_HEREDOC_TABS) || tokens[k + 1].type != TOKEN_WORD) continue;
+        const int tabs = tokens[k].type == TOKEN_HEREDOC_TABS;
+        const char *const delimiter = _lex_unquote(arena, tokens[k + 1].text);
+        if (!delimiter) return -1;
+        const size_t delimiter_length = strlen(delimiter);
+
+        // Find the line of the delimiter, the body is every line before it
+        const char *cur = *ptr;
+        const char *stop = NULL;
+        while (*cur && !stop) {
+            const char *line = cur;
+            if (tabs) while (*line == '\t') line++;
+            const char *end = strchr(line, '\n');
+            if (!end) end = line + strlen(line);
+            if ((size_t)(end - line) == delimiter_length && strncmp(line, delimiter, delimiter_length) == 0) stop = cur;
+            cur = *end ? end + 1 : end;
+        }
+        if (!stop) {
+            *incomplete = 1;
+            return 0;
+        }
+
+        // Copy the lines of the body, without their leading tabs for <<-
+        char *const body = arena_alloc(arena, stop - *ptr + 1);
+        if (!body) return -1;
+        size_t length = 0;
+        for (const char *line = *ptr; line < stop;) {
+            if (tabs) while (*line == '\t') line++;
+            const char *const end = strchr(line, '\n');
+            memcpy(&body[length], line, end - line + 1);
+            length += end - line + 1;
+            line = end + 1;
+        }
+        body[length] = '\0';
+
+        tokens[k].text = body;
+        *ptr = cur;
+    }
+    return 0;
+}
+
+
+/**
+ * @see arena_mark, lex_line, _lex_unquote, strdup, arena_rewind
+ */
+char *lex_heredoc_delimiter(const char *const line) {
+    const arena_mark_t mark = arena_mark(&LINE_ARENA);
+    int count, incomplete;
+    const token_t *const tokens = lex_line(&LINE_ARENA, line, &count, &incomplete);
+
+    // Bodies already read are set, the first one not set is being read
+    char *delimiter = NULL;
+    for (int k = 0; tokens && incomplete && !delimiter && k + 1 < count; k++) {
+        if ((tokens[k].type != TOKEN_HEREDOC && tokens[k].type != TOKEN_HEREDOC_TABS) || tokens[k].text || tokens[k + 1].type != TOKEN_WORD) continue;
+        const char *const unquoted = _lex_unquote(&LINE_ARENA, tokens[k + 1].text);
+        if (!unquoted) break;
+        delimiter = strdup(unquoted);
+    }
+
+    arena_rewind(&LINE_ARENA, mark);
+    return delimiter;
+}
+
+
+/**
+ * @see arena_alloc, arena_realloc, isspace, isdigit, atoi, _lex_word, _lex_heredocs
+ */
+token_t *lex_line(arena_t *const arena, const char *const line, int *const count, int *const incomplete) {
+    int capacity = 16;
+    token_t *tokens = arena_alloc(arena, capacity * sizeof(token_t));
+    if (!tokens) return NULL;
+    *count = 0;
+    *incomplete = 0;
+
+    const char *ptr = line;
+    token_type_t type;
+    // Index of the first token of the current line, for its here-documents
+    int line_start = 0;
+    while (1) {
+        // Skip spaces and escaped new lines, but a new line separates commands like ;
+        while ((*ptr != '\n' && isspace((unsigned char)*ptr)) || (ptr[0] == '\\' && ptr[1] == '\n')) ptr += *ptr == '\\' ? 2 : 1;
+
+        // Skip comments until the end of the line
+        if (*ptr == '#') while (*ptr && *ptr != '\n') ptr++;
+
+        // A line ending with an escaped new line goes on with the next line
+        if (ptr[0] == '\\' && ptr[1] == '\0') *incomplete = 1;
+
+        // Keep room for the final TOKEN_END
+        if (*count >= capacity - 1) {
+            tokens = arena_realloc(arena, tokens, capacity * sizeof(token_t), 2 * capacity * sizeof(token_t));
+            if (!tokens) return NULL;
+            capacity *= 2;
+        }
+
+        if (!(*ptr) || *incomplete) break;
+
+        // A number just before < or > is the file descriptor of the redirection (2>file), not a word
+        int fd = -1;
+        const char *digits = ptr;
+        while (isdigit((unsigned char)*digits)) digits++;
+        if (digits > ptr && digits - ptr < 10 && (*digits == '<' || *digits == '>') && digits[1] != '(') {
+            fd = atoi(ptr);
+            ptr = digits;
+        }
+
+        // Operators, the longest first
+        int length = 3;
+        if      (ptr[0] == '<' && ptr[1] == '<' && ptr[2] == '<') type = TOKEN_HERESTRING;
+        else if (ptr[0] == '<' && ptr[1] == '<' && ptr[2] == '-') type = TOKEN_HEREDOC_TABS;
+        else if (ptr[0] == '&' && ptr[1] == '>' && ptr[2] == '>') type = TOKEN_APPEND_ALL;
+        else {
+            length = 2;
+            if      (ptr[0] == '|' && ptr[1] == '|') type = TOKEN_OR;
+            else if (ptr[0] == '&' && ptr[1] == '&') type = TOKEN_AND;
+            else if (ptr[0] == ';' && ptr[1] == ';') type = TOKEN_DSEMI;
+            else if (ptr[0] == '&' && ptr[1] == '>') type = TOKEN_OUTPUT_ALL;
+            else if ((ptr[0] == '<' || ptr[0] == '>') && ptr[1] == '(') type = TOKEN_WORD;
+            else if (ptr[0] == '<' && ptr[1] == '<') type = TOKEN_HEREDOC;
+            else if (ptr[0] == '<' && ptr[1] == '>') type = TOKEN_READ_WRITE;
+            else if (ptr[0] == '<' && ptr[1] == '&') type = TOKEN_DUP_INPUT;
+            else if (ptr[0] == '>' && ptr[1] == '>') type = TOKEN_APPEND;
+            else if (ptr[0] == '>' && ptr[1] == '&') type = TOKEN_DUP_OUTPUT;
+            // >| forces the truncation, the same as > without noclobber
+            else if (ptr[0] == '>' && ptr[1] == '|') type = TOKEN_OUTPUT;
+            else {
+                length = 1;
+                if      (ptr[0] == '|')                   type = TOKEN_PIPE;
+                else if (ptr[0] == '&')                   type = TOKEN_BACKGROUND;
+                else if (ptr[0] == ';' || ptr[0] == '\n') type = TOKEN_SEMI;
+                else if (ptr[0] == '<')                   type = TOKEN_INPUT;
+                else if (ptr[0] == '>')                   type = TOKEN_OUTPUT;
+                else if (ptr[0] == '(')                   type = TOKEN_LPAREN;
+                else if (ptr[0] == ')')                   type = TOKEN_RPAREN;
+                else                                      type = TOKEN_WORD;
+            }
+        }
+
+        tokens[*count].type = type;
+        tokens[*count].text = NULL;
+        tokens[*count].fd = fd;
+        if (type == TOKEN_WORD) {
+            tokens[*count].text = _lex_word(arena, &ptr, incomplete);
+            if (!tokens[*count].text) return NULL;
+        }
+        else if (type == TOKEN_SEMI && *ptr == '\n') {
+            // Bodies of the here-documents of the line start after its new line
+            ptr++;
+            if (_lex_heredocs(arena, tokens, line_start, *count, &ptr, incomplete) == -1) return NULL;
+            line_start = *count + 1;
+        }
+        else ptr += length;
+        (*count)++;
+    }
+
+    // A here-document without new line after its line is not ended
+    for (int k = line_start; k < *count; k++) if (tokens[k].type == TOKEN_HEREDOC || tokens[k].type == TOKEN_HEREDOC_TABS) *incomplete = 1;
+
+    tokens[*count].type = TOKEN_END;
+    tokens[*count].text = NULL;
+    tokens[*count].fd = -1;
+    return tokens;
+}
+
+
+/**
+ * @see arena_alloc, memset
+ */
+node_t *_node_new(arena_t *const arena, const node_type_t type) {
+    node_t *const node = arena_alloc(arena, sizeof(node_t));
+    if (!node) return NULL;
+    memset(node, 0, sizeof(node_t));
+    node->type = type;
+    return node;
+}
+
+
+/**
+ * @see arena_realloc
+ */
+int _node_append(arena_t *const arena, node_t *const node, node_t *const child) {
+    if (!child) return -1;
+
+    // The array grows twice bigger when full (capacity 4, 8, 16...), long lists like sourced files are not copied at each command
+    if (node->count >= 4 ? (node->count & (node->count - 1)) == 0 : node->count == 0) {
+        const int capacity = node->count ? 2 * node->count : 4;
+        node_t **const children = arena_realloc(arena, node->children, node->count * sizeof(node_t *), capacity * sizeof(node_t *));
+        if (!children) return -1;
+        node->children = children;
+    }
+    node->children[node->count++] = child;
+    return 0;
+}
+
+
+/**
+ * @see arena_realloc, arena_strdup
+ */
+int _node_add_word(arena_t *const arena, node_t *const node, const char *const word) {
+    // The array of words always ends with NULL
+    char **const words = arena_realloc(arena, node->words, (node->argc + 1) * sizeof(char *), (node->argc + 2) * sizeof(char *));
+    if (!words) return -1;
+    node->words = words;
+    if (!(node->words[node->argc] = arena_strdup(arena, word))) return -1;
+    node->words[++node->argc] = NULL;
+    return 0;
+}
+
+
+/**
+ * @see arena_realloc, arena_strdup
+ */
+int _node_add_redirect(arena_t *const arena, node_t *const node, const redirect_type_t type, const int fd, const char *const word) {
+    redirect_t *const redirects = arena_realloc(arena, node->redirects, node->redirect_count * sizeof(redirect_t), (node->redirect_count + 1) * sizeof(redirect_t));
+    if (!redirects) return -1;
+    node->redirects = redirects;
+
+    redirect_t *const redirect = &node->redirects[node->redirect_count++];
+    redirect->type = type;
+    redirect->fd = fd;
+    if (!(redirect->word = arena_strdup(arena, word))) return -1;
+    return 0;
+}
+
+
+/**
+ * @see sink_error
+ */
+void _parse_error(parser_t *const parser) {
+    const token_t *const token = &parser->tokens[parser->i];
+
+    // The line stops in the middle of a command, it may go on with the next line
+    if (token->type == TOKEN_END) {
+        parser->incomplete = 1;
+        return;
+    }
+    sink_error("Syntax error near unexpected token `%s'\n", token->type == TOKEN_WORD ? token->text : _TOKEN_NAMES[token->type]);
+}
+
+
+/**
+ * @see strcmp
+ */
+int _parse_is_keyword(const parser_t *const parser, const char *const keyword) {
+    const token_t *const token = &parser->tokens[parser->i];
+    return token->type == TOKEN_WORD && strcmp(token->text, keyword) == 0;
+}
+
+
+/**
+ * @see _parse_is_keyword, _parse_error
+ */
+int _parse_expect(parser_t *const parser, const char *const keyword) {
+    if (!_parse_is_keyword(parser, keyword)) {
+        _parse_error(parser);
+        return -1;
+    }
+    parser->i++;
+    return 0;
+}
+
+
+/**
+ * @see _parse_is_keyword
+ */
+int _parse_is_terminator(const parser_t *const parser, const char *const *const terminators) {
+    for (int k = 0; terminators && terminators[k]; k++) {
+        if (_parse_is_keyword(parser, terminators[k])) return 1;
+    }
+    return 0;
+}
+
+
+void _parse_skip_newlines(parser_t *const parser) {
+    while (parser->tokens[parser->i].type == TOKEN_SEMI) parser->i++;
+}
+
+
+/**
+ * @see _parse_compound, _parse_is_terminator, _parse_error, _node_new, _node_add_word, _node_add_redirect, strpbrk
+ */
+node_t *_parse_command(parser_t *const parser) {
+    // Compound commands start with a reserved word or a parenthesis
+    node_t *node = _parse_compound(parser);
+    if (!node && (parser->incomplete || parser->failed)) return NULL;
+
+    // Reserved words closing a compound command are not commands
+    if (!node && _parse_is_terminator(parser, _CLOSING_KEYWORDS)) {
+        _parse_error(parser);
+        parser->failed = 1;
+        return NULL;
+    }
+
+    if (!node && !(node = _node_new(parser->arena, NODE_COMMAND))) return NULL;
+
+    const token_t *const tokens = parser->tokens;
+    while ((tokens[parser->i].type >= TOKEN_INPUT && tokens[parser->i].type <= TOKEN_HERESTRING)
+           || (node->type == NODE_COMMAND && tokens[parser->i].type == TOKEN_WORD)) {
+        if (tokens[parser->i].type == TOKEN_WORD) {
+            if (_node_add_word(parser->arena, node, tokens[parser->i++].text) == -1) return NULL;
+            continue;
+        }
+
+        // Redirections need a file, they are applied in order
+        const token_type_t type = tokens[parser->i].type;
+        const int fd = tokens[parser->i++].fd;
+        if (tokens[parser->i].type != TOKEN_WORD) {
+            _parse_error(parser);
+            parser->failed = 1;
+            return NULL;
+        }
+        const char *const word = tokens[parser->i++].text;
+        int error;
+        switch (type) {
+            case TOKEN_INPUT:
+            case TOKEN_READ_WRITE:
+                error = _node_add_redirect(parser->arena, node, type == TOKEN_INPUT ? REDIRECT_INPUT : REDIRECT_READ_WRITE, fd == -1 ? 0 : fd, word);
+                break;
+
+            case TOKEN_OUTPUT:
+            case TOKEN_APPEND:
+                error = _node_add_redirect(parser->arena, node, type == TOKEN_OUTPUT ? REDIRECT_OUTPUT : REDIRECT_APPEND, fd == -1 ? 1 : fd, word);
+                break;
+
+            case TOKEN_DUP_INPUT:
+            case TOKEN_DUP_OUTPUT:
+                error = _node_add_redirect(parser->arena, node, REDIRECT_DUPLICATE, fd != -1 ? fd : type == TOKEN_DUP_INPUT ? 0 : 1, word);
+                break;
+
+            // &>file is >file 2>&1
+            case TOKEN_OUTPUT_ALL:
+            case TOKEN_APPEND_ALL:
+                error = _node_add_redirect(parser->arena, node, type == TOKEN_OUTPUT_ALL ? REDIRECT_OUTPUT : REDIRECT_APPEND, 1, word);
+                error |= _node_add_redirect(parser->arena, node, REDIRECT_DUPLICATE, 2, "1");
+                break;
+
+            // A here-document keeps its body, expanded at execution unless its delimiter is quoted
+            case TOKEN_HEREDOC:
+            case TOKEN_HEREDOC_TABS:
+                error = _node_add_redirect(parser->arena, node, strpbrk(word, "'\"\\") ? REDIRECT_HEREDOC_LITERAL : REDIRECT_HEREDOC, fd == -1 ? 0 : fd, tokens[parser->i - 2].text);
+                break;
+
+            default:
+                error = _node_add_redirect(parser->arena, node, REDIRECT_HERESTRING, fd == -1 ? 0 : fd, word);
+                break;
+        }
+        if (error) return NULL;
+    }
+
+    // An empty command is only valid with a redirection
+    if (node->type == NODE_COMMAND && node->argc == 0 && node->redirect_count == 0) {
+        _parse_error(parser);
+        parser->failed = 1;
+        return NULL;
+    }
+
+    return node;
+}
+
+
+/**
+ * @see _parse_is_keyword, _node_new, _node_append, _parse_command, _parse_skip_newlines
+ */
+node_t *_parse_pipeline(parser_t *const parser) {
+    // time is a reserved word before a pipeline, it measures the whole pipeline
+    if (_parse_is_keyword(parser, "time")) {
+        parser->i++;
+        node_t *const node = _node_new(parser->arena, NODE_TIME);
+        if (!node || _node_append(parser->arena, node, _parse_pipeline(parser)) == -1) return NULL;
+        return node;
+    }
+
+    node_t *const first = _parse_command(parser);
+    if (!first || parser->tokens[parser->i].type != TOKEN_PIPE) return first;
+
+    node_t *const node = _node_new(parser->arena, NODE_PIPELINE);
+    if (!node || _node_append(parser->arena, node, first) == -1) return NULL;
+
+    while (parser->tokens[parser->i].type == TOKEN_PIPE) {
+        // A pipe at the end of a line goes on with the next line
+        parser->i++;
+        _parse_skip_newlines(parser);
+        if (_node_append(parser->arena, node, _parse_command(parser)) == -1) return NULL;
+    }
+
+    return node;
+}
+
+
+/**
+ * @see _parse_pipeline, _node_new, _node_append, _parse_skip_newlines
+ */
+node_t *_parse_and_or(parser_t *const parser) {
+    node_t *left = _parse_pipeline(parser);
+
+    // && and || have the same priority and are read from left to right
+    while (left && (parser->tokens[parser->i].type == TOKEN_AND || parser->tokens[parser->i].type == TOKEN_OR)) {
+        node_t *const node = _node_new(parser->arena, parser->tokens[parser->i++].type == TOKEN_AND ? NODE_AND : NODE_OR);
+        if (!node || _node_append(parser->arena, node, left) == -1) return NULL;
+        _parse_skip_newlines(parser);
+        if (_node_append(parser->arena, node, _parse_pipeline(parser)) == -1) return NULL;
+        left = node;
+    }
+
+    return left;
+}
+
+
+/**
+ * @see _node_new, _parse_skip_newlines, _parse_is_terminator, _parse_and_or, _node_append, _parse_error
+ */
+node_t *_parse_list(parser_t *const parser, const char *const *const terminators) {
+    node_t *const list = _node_new(parser->arena, NODE_SEQUENCE);
+    if (!list) return NULL;
+
+    const token_t *const tokens = parser->tokens;
+    while (1) {
+        // Empty commands between separators are ignored
+        _parse_skip_newlines(parser);
+
+        // The list ends on the end of the line, a closing token or a reserved word closing it
+        const token_type_t type = tokens[parser->i].type;
+        if (type == TOKEN_END || type == TOKEN_RPAREN || type == TOKEN_DSEMI) break;
+        if (_parse_is_terminator(parser, terminators)) break;
+
+        node_t *node = _parse_and_or(parser);
+        if (!node) return NULL;
+
+        // A list ended by & runs in background
+        if (tokens[parser->i].type == TOKEN_BACKGROUND) {
+            node_t *const background = _node_new(parser->arena, NODE_BACKGROUND);
+            if (!background || _node_append(parser->arena, background, node) == -1) return NULL;
+            node = background;
+            parser->i++;
+        }
+        else if (tokens[parser->i].type == TOKEN_SEMI) parser->i++;
+        else if (tokens[parser->i].type != TOKEN_END && tokens[parser->i].type != TOKEN_RPAREN && tokens[parser->i].type != TOKEN_DSEMI
+                 && !_parse_is_terminator(parser, terminators)) {
+            _parse_error(parser);
+            parser->failed = 1;
+            return NULL;
+        }
+
+        if (_node_append(parser->arena, list, node) == -1) return NULL;
+    }
+
+    // Do not keep a sequence of a single node
+    return list->count == 1 ? list->children[0] : list;
+}
+
+
+/**
+ * @see _parse_list, _parse_expect, _node_new, _node_append, _parse_is_keyword
+ */
+node_t *_parse_if(parser_t *const parser) {
+    static const char *const condition_end[] = { "then", NULL };
+    static const char *const body_end[] = { "elif", "else", "fi", NULL };
+    static const char *const else_end[] = { "fi", NULL };
+
+    node_t *const node = _node_new(parser->arena, NODE_IF);
+    if (!node) return NULL;
+
+    // Pairs of condition and body, for if and each elif
+    do {
+        parser->i++;
+        if (_node_append(parser->arena, node, _parse_list(parser, condition_end)) == -1) return NULL;
+        if (_parse_expect(parser, "then") == -1) return NULL;
+        if (_node_append(parser->arena, node, _parse_list(parser, body_end)) == -1) return NULL;
+    } while (_parse_is_keyword(parser, "elif"));
+
+    // The body of else is the last child
+    if (_parse_is_keyword(parser, "else")) {
+        parser->i++;
+        if (_node_append(parser->arena, node, _parse_list(parser, else_end)) == -1) return NULL;
+    }
+
+    if (_parse_expect(parser, "fi") == -1) return NULL;
+    return node;
+}
+
+
+/**
+ * @see _node_new, _parse_list, _parse_expect, _node_append
+ */
+node_t *_parse_while(parser_t *const parser, const node_type_t type) {
+    static const char *const condition_end[] = { "do", NULL };
+    static const char *const body_end[] = { "done", NULL };
+
+    node_t *const node = _node_new(parser->arena, type);
+    if (!node) return NULL;
+
+    parser->i++;
+    if (_node_append(parser->arena, node, _parse_list(parser, condition_end)) == -1) return NULL;
+    if (_parse_expect(parser, "do") == -1) return NULL;
+    if (_node_append(parser->arena, node, _parse_list(parser, body_end)) == -1) return NULL;
+    if (_parse_expect(parser, "done") == -1) return NULL;
+
+    return node;
+}
+
+
+/**
+ * @see _node_new, _parse_error, arena_strdup, _parse_is_keyword, _node_add_word, _parse_skip_newlines, _parse_expect, _parse_list, _node_append
+ */
+node_t *_parse_for(parser_t *const parser) {
+    static const char *const body_end[] = { "done", NULL };
+
+    node_t *const node = _node_new(parser->arena, NODE_FOR);
+    if (!node) return NULL;
+
+    // Name of the variable
+    parser->i++;
+    if (parser->tokens[parser->i].type != TOKEN_WORD) {
+        _parse_error(parser);
+        return NULL;
+    }
+    if (!(node->name = arena_strdup(parser->arena, parser->tokens[parser->i++].text))) return NULL;
+
+    // Words to iterate on, until the end of the line
+    if (_parse_is_keyword(parser, "in")) {
+        parser->i++;
+        while (parser->tokens[parser->i].type == TOKEN_WORD) {
+            if (_node_add_word(parser->arena, node, parser->tokens[parser->i++].text) == -1) return NULL;
+        }
+    }
+    _parse_skip_newlines(parser);
+
+    if (_parse_expect(parser, "do") == -1) return NULL;
+    if (_node_append(parser->arena, node, _parse_list(parser, body_end)) == -1) return NULL;
+    if (_parse_expect(parser, "done") == -1) return NULL;
+
+    return node;
+}
+
+
+/**
+ * @see _node_new, _parse_error, arena_strdup, _parse_expect, _parse_skip_newlines, _parse_is_keyword, _node_add_word, _parse_list, _node_append
+ */
+node_t *_parse_case(parser_t *const parser) {
+    static const char *const body_end[] = { "esac", NULL };
+
+    node_t *const node = _node_new(parser->arena, NODE_CASE);
+    if (!node) return NULL;
+
+    // Word to match
+    parser->i++;
+    if (parser->tokens[parser->i].type != TOKEN_WORD) {
+        _parse_error(parser);
+        return NULL;
+    }
+    if (!(node->name = arena_strdup(parser->arena, parser->tokens[parser->i++].text))) return NULL;
+    if (_parse_expect(parser, "in") == -1) return NULL;
+
+    // Items: (pattern | pattern) list ;;
+    _parse_skip_newlines(parser);
+    while (!_parse_is_keyword(parser, "esac")) {
+        node_t *const item = _node_new(parser->arena, NODE_CASE_ITEM);
+        if (!item) return NULL;
+
+        if (parser->tokens[parser->i].type == TOKEN_LPAREN) parser->i++;
+        while (1) {
+            if (parser->tokens[parser->i].type != TOKEN_WORD) {
+                _parse_error(parser);
+                return NULL;
+            }
+            if (_node_add_word(parser->arena, item, parser->tokens[parser->i++].text) == -1) return NULL;
+            if (parser->tokens[parser->i].type != TOKEN_PIPE) break;
+            parser->i++;
+        }
+        if (parser->tokens[parser->i].type != TOKEN_RPAREN) {
+            _parse_error(parser);
+            return NULL;
+        }
+        parser->i++;
+
+        if (_node_append(parser->arena, item, _parse_list(parser, body_end)) == -1) return NULL;
+        if (_node_append(parser->arena, node, item) == -1) return NULL;
+
+        // The last item may end without ;;
+        if (parser->tokens[parser->i].type == TOKEN_DSEMI) parser->i++;
+        else if (!_parse_is_keyword(parser, "esac")) {
+            _parse_error(parser);
+            return NULL;
+        }
+        _parse_skip_newlines(parser);
+    }
+    parser->i++;
+
+    return node;
+}
+
+
+/**
+ * @see _parse_is_keyword, _parse_if, _parse_while, _parse_for, _parse_case, _node_new, _parse_list, _node_append, _parse_error
+ */
+node_t *_parse_compound(parser_t *const parser) {
+    node_t *node = NULL;
+
+    if      (_parse_is_keyword(parser, "if"))    node = _parse_if(parser);
+    else if (_parse_is_keyword(parser, "while")) node = _parse_while(parser, NODE_WHILE);
+    else if (_parse_is_keyword(parser, "until")) node = _parse_while(parser, NODE_UNTIL);
+    else if (_parse_is_keyword(parser, "for"))   node = _parse_for(parser);
+    else if (_parse_is_keyword(parser, "case"))  node = _parse_case(parser);
+    else if (parser->tokens[parser->i].type == TOKEN_LPAREN) {
+        // ( list ) runs inside a copy of the shell
+        parser->i++;
+        node = _node_new(parser->arena, NODE_SUBSHELL);
+        if (!node || _node_append(parser->arena, node, _parse_list(parser, NULL)) == -1) node = NULL;
+        else if (parser->tokens[parser->i].type != TOKEN_RPAREN) {
+            _parse_error(parser);
+            node = NULL;
+        }
+        else parser->i++;
+    }
+    else return NULL;
+
+    if (!node) parser->failed = 1;
+    return node;
+}
+
+
+/**
+ * @see _parse_list, _parse_error
+ */
+int parse_tokens(arena_t *const arena, const token_t *const tokens, node_t **const root, int *const incomplete) {
+    parser_t parser = { arena, tokens, 0, 0, 0 };
+    *root = _parse_list(&parser, NULL);
+
+    // Tokens left after the list can not start a command
+    if (*root && tokens[parser.i].type != TOKEN_END) {
+        _parse_error(&parser);
+        *root = NULL;
+    }
+    if (incomplete) *incomplete = parser.incomplete;
+    if (!*root) return -1;
+
+    // An empty line has no tree
+    if ((*root)->type == NODE_SEQUENCE && (*root)->count == 0) *root = NULL;
+    return 0;
+}
+
+
+/**
+ * @see strlen, realloc, memcpy
+ */
+int _node_write(char **const buffer, size_t *const length, size_t *const capacity, const char *const text) {
+    const size_t size = strlen(text);
+    if (*length + size + 1 > *capacity) {
+        while (*length + size + 1 > *capacity) *capacity *= 2;
+        char *const bigger = realloc(*buffer, *capacity);
+        if (!bigger) return -1;
+        *buffer = bigger;
+    }
+    memcpy(&(*buffer)[*length], text, size + 1);
+    *length += size;
+    return 0;
+}
+
+
+/**
+ * @see _node_write
+ */
+int _node_write_words(char **const buffer, size_t *const length, size_t *const capacity, const node_t *const node, const char *const separator) {
+    int error = 0;
+    for (int i = 0; i < node->argc; i++) {
+        if (i > 0) error |= _node_write(buffer, length, capacity, separator);
+        error |= _node_write(buffer, length, capacity, node->words[i]);
+    }
+    return error;
+}
+
+
+/**
+ * @see _node_write, _node_write_words, snprintf
+ */
+int _node_write_tree(char **const buffer, size_t *const length, size_t *const capacity, const node_t *const node) {
+    int error = 0;
+    switch (node->type) {
+        case NODE_COMMAND:
+            error |= _node_write_words(buffer, length, capacity, node, " ");
+            break;
+
+        case NODE_BACKGROUND:
+            return _node_write_tree(buffer, length, capacity, node->children[0]);
+
+        case NODE_IF:
+            // Pairs of condition and body, then the body of else if any
+            for (int i = 0; i + 1 < node->count; i += 2) {
+                error |= _node_write(buffer, length, capacity, i == 0 ? "if " : "; elif ");
+                error |= _node_write_tree(buffer, length, capacity, node->children[i]);
+                error |= _node_write(buffer, length, capacity, "; then ");
+                error |= _node_write_tree(buffer, length, capacity, node->children[i + 1]);
+            }
+            if (node->count % 2) {
+                error |= _node_write(buffer, length, capacity, "; else ");
+                error |= _node_write_tree(buffer, length, capacity, node->children[node->count - 1]);
+            }
+            error |= _node_write(buffer, length, capacity, "; fi");
+            break;
+
+        case NODE_WHILE:
+        case NODE_UNTIL:
+            error |= _node_write(buffer, length, capacity, node->type == NODE_WHILE ? "while " : "until ");
+            error |= _node_write_tree(buffer, length, capacity, node->children[0]);
+            error |= _node_write(buffer, length, capacity, "; do ");
+            error |= _node_write_tree(buffer, length, capacity, node->children[1]);
+            error |= _node_write(buffer, length, capacity, "; done");
+            break;
+
+        case NODE_FOR:
+            error |= _node_write(buffer, length, capacity, "for ");
+            error |= _node_write(buffer, length, capacity, node->name);
+            error |= _node_write(buffer, length, capacity, " in ");
+            error |= _node_write_words(buffer, length, capacity, node, " ");
+            error |= _node_write(buffer, length, capacity, "; do ");
+            error |= _node_write_tree(buffer, length, capacity, node->children[0]);
+            error |= _node_write(buffer, length, capacity, "; done");
+            break;
+
+        case NODE_CASE:
+            error |= _node_write(buffer, length, capacity, "case ");
+            error |= _node_write(buffer, length, capacity, node->name);
+            error |= _node_write(buffer, length, capacity, " in ");
+            for (int i = 0; i < node->count; i++) {
+                error |= _node_write_tree(buffer, length, capacity, node->children[i]);
+                error |= _node_write(buffer, length, capacity, ";; ");
+            }
+            error |= _node_write(buffer, length, capacity, "esac");
+            break;
+
+        case NODE_CASE_ITEM:
+            error |= _node_write_words(buffer, length, capacity, node, " | ");
+            error |= _node_write(buffer, length, capacity, ") ");
+            return error | _node_write_tree(buffer, length, capacity, node->children[0]);
+
+        case NODE_TIME:
+            error |= _node_write(buffer, length, capacity, "time ");
+            return error | _node_write_tree(buffer, length, capacity, node->children[0]);
+
+        case NODE_SUBSHELL:
+            error |= _node_write(buffer, length, capacity, "(");
+            error |= _node_write_tree(buffer, length, capacity, node->children[0]);
+            error |= _node_write(buffer, length, capacity, ")");
+            break;
+
+        default:
+            for (int i = 0; i < node->count; i++) {
+                if (i > 0 && node->children[i - 1]->type == NODE_BACKGROUND) error |= _node_write(buffer, length, capacity, " ");
+                else if (i > 0) error |= _node_write(buffer, length, capacity, node->type == NODE_PIPELINE ? " | " : node->type == NODE_AND ? " && " : node->type == NODE_OR ? " || " : "; ");
+                error |= _node_write_tree(buffer, length, capacity, node->children[i]);
+                if (node->children[i]->type == NODE_BACKGROUND) error |= _node_write(buffer, length, capacity, " &");
+            }
+            return error;
+    }
+
+    // Redirections of simple and compound commands, the file descriptor only when it is not the default one
+    for (int i = 0; i < node->redirect_count; i++) {
+        static const char *const operators[] = { "<", ">", ">>", "<>", ">&", "<<", "<<", "<<<" };
+        const redirect_t *const redirect = &node->redirects[i];
+        const char *operator = operators[redirect->type];
+        if (redirect->type == REDIRECT_DUPLICATE && redirect->fd == 0) operator = "<&";
+        const int default_fd = operator[0] == '>' ? 1 : 0;
+
+        char fd[16] = "";
+        if (redirect->fd != default_fd) snprintf(fd, sizeof(fd), "%d", redirect->fd);
+        if (*length && (*buffer)[*length - 1] != ' ') error |= _node_write(buffer, length, capacity, " ");
+        error |= _node_write(buffer, length, capacity, fd);
+        error |= _node_write(buffer, length, capacity, operator);
+        error |= _node_write(buffer, length, capacity, redirect->type == REDIRECT_DUPLICATE ? "" : " ");
+        error |= _node_write(buffer, length, capacity, redirect->type == REDIRECT_HEREDOC || redirect->type == REDIRECT_HEREDOC_LITERAL ? "(here-document)" : redirect->word);
+    }
+    return error;
+}
+
+
+/**
+ * @see malloc, _node_write_tree, free
+ */
+char *node_to_string(const node_t *const node) {
+    size_t length = 0, capacity = 64;
+    char *buffer = malloc(capacity);
+    if (!buffer) return NULL;
+    buffer[0] = '\0';
+
+    if (node && _node_write_tree(&buffer, &length, &capacity, node)) {
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+
+void _plan_lru_unlink(plan_t *const plan) {
+    if (plan->lru_prev) plan->lru_prev->lru_next = plan->lru_next;
+    else                _plan_CURRENT->lru_head = plan->lru_next;
+    if (plan->lru_next) plan->lru_next->lru_prev = plan->lru_prev;
+    else                _plan_CURRENT->lru_tail = plan->lru_prev;
+    plan->lru_prev = plan->lru_next = NULL;
+}
+
+
+void _plan_lru_push(plan_t *const plan) {
+    plan->lru_prev = NULL;
+    plan->lru_next = _plan_CURRENT->lru_head;
+    if (_plan_CURRENT->lru_head) _plan_CURRENT->lru_head->lru_prev = plan;
+    else                _plan_CURRENT->lru_tail = plan;
+    _plan_CURRENT->lru_head = plan;
+}
+
+
+/**
+ * @see _plan_lru_unlink, free_node, free
+ */
+void _plan_evict(plan_t *const plan) {
+    // Unchain the plan from its bucket
+    plan_t **link = &_plan_CURRENT->buckets[plan->hash & (PLAN_CACHE_BUCKETS - 1)];
+    while (*link && *link != plan) link = &(*link)->bucket_next;
+    if (*link) *link = plan->bucket_next;
+
+    _plan_lru_unlink(plan);
+    _plan_CURRENT->count--;
+
+    // The line and the tree are inside the arena of the plan
+    arena_destroy(&plan->arena);
+    free(plan);
+}
+
+
+/**
+ * @see _hash_string, strcmp, _plan_lru_unlink, _plan_lru_push, stats_add, calloc, arena_init, arena_strdup, arena_mark, lex_line, parse_tokens, arena_rewind, sink_error, arena_destroy, free, _plan_evict
+ */
+plan_t *plan_acquire(const char *const line, int *const incomplete) {
+    const unsigned long hash = _hash_string(line);
+    plan_t **const bucket = &_plan_CURRENT->buckets[hash & (PLAN_CACHE_BUCKETS - 1)];
+
+    // Already compiled, move it to the head of the LRU list
+    for (plan_t *plan = *bucket; plan; plan = plan->bucket_next) {
+        if (plan->hash != hash || strcmp(plan->line, line) != 0) continue;
+        _plan_lru_unlink(plan);
+        _plan_lru_push(plan);
+        plan->refs++;
+        stats_add(STAT_PLAN_HITS, 1);
+        return plan;
+    }
+
+    // The plan owns its tree through its own arena, freed at once when evicted
+    plan_t *const plan = calloc(1, sizeof(plan_t));
+    if (!plan) return NULL;
+    arena_init(&plan->arena, PLAN_ARENA_CHUNK_SIZE);
+
+    // Compile the line, tokens only live in the arena of the line, lines with syntax errors are not kept
+    const arena_mark_t mark = arena_mark(&LINE_ARENA);
+    const size_t allocations = LINE_ARENA.allocations;
+    int count, lex_incomplete, parse_incomplete = 0;
+    TRACE_BEGIN("lex_line", line);
+    const token_t *const tokens = lex_line(&LINE_ARENA, line, &count, &lex_incomplete);
+    TRACE_END("lex_line");
+    TRACE_BEGIN("parse_tokens", NULL);
+    const int error = !tokens || lex_incomplete || !(plan->line = arena_strdup(&plan->arena, line))
+                      || parse_tokens(&plan->arena, tokens, &plan->root, &parse_incomplete);
+    TRACE_END("parse_tokens");
+    arena_rewind(&LINE_ARENA, mark);
+    stats_add(STAT_PLAN_MISSES, 1);
+    stats_add(STAT_PARSE_ALLOCATIONS, LINE_ARENA.allocations - allocations + plan->arena.allocations);
+    if (incomplete) *incomplete = tokens && (lex_incomplete || parse_incomplete);
+    else if (tokens && (lex_incomplete || parse_incomplete)) sink_error("Syntax error: unexpected end of file\n");
+    if (error) {
+        arena_destroy(&plan->arena);
+        free(plan);
+        return NULL;
+    }
+    plan->hash = hash;
+    plan->refs = 1;
+
+    // Make room by evicting the least recently used plans not in use
+    plan_t *victim = _plan_CURRENT->lru_tail;
+    while (_plan_CURRENT->count >= PLAN_CACHE_SIZE && victim) {
+        plan_t *const prev = victim->lru_prev;
+        if (victim->refs == 0) _plan_evict(victim);
+        victim = prev;
+    }
+
+    plan->bucket_next = *bucket;
+    *bucket = plan;
+    _plan_lru_push(plan);
+    _plan_CURRENT->count++;
+
+    return plan;
+}
+
+
+/**
+ * @see plan_acquire, plan_release
+ */
+int plan_check(const char *const line) {
+    // The plan is kept in the cache, running the line next will not compile it again
+    int incomplete;
+    plan_t *const plan = plan_acquire(line, &incomplete);
+    if (plan) {
+        plan_release(plan);
+        return 0;
+    }
+    return incomplete ? 1 : -1;
+}
+
+
+void plan_release(plan_t *const plan) {
+    if (plan) plan->refs--;
+}
+
+
+/**
+ * @see _plan_evict
+ */
+void plan_cache_clear() {
+    plan_t *plan = _plan_CURRENT->lru_head;
+    while (plan) {
+        plan_t *const next = plan->lru_next;
+        if (plan->refs == 0) _plan_evict(plan);
+        plan = next;
+    }
+}
+
+
+plan_cache_t *plan_use(plan_cache_t *const cache) {
+    plan_cache_t *const previous = _plan_CURRENT;
+    _plan_CURRENT = cache ? cache : &_plan_MAIN;
+    return previous;
+}
+
+
+/**
+ * @see plan_use, plan_cache_clear
+ */
+void plan_cache_free(plan_cache_t *const cache) {
+    plan_cache_t *const previous = plan_use(cache);
+    plan_cache_clear();
+    plan_use(previous);
+}
@@ -0,0 +1,276 @@
+// CShell Project - New printf command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "printf.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+
+
+/**
+ * @see sink_printf
+ */
+void _printf_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] format [arguments]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+}
+
+
+/**
+ * @see strchr
+ */
+int _printf_escape(const char **const ptr, char *const out, const int is_argument) {
+    // ptr is after the backslash
+    int c = *(*ptr)++;
+    switch (c) {
+        case 'a': out[0] = '\a'; return 1;
+        case 'b': out[0] = '\b'; return 1;
+        case 'e': out[0] = 033;  return 1;
+        case 'f': out[0] = '\f'; return 1;
+        case 'n': out[0] = '\n'; return 1;
+        case 'r': out[0] = '\r'; return 1;
+        case 't': out[0] = '\t'; return 1;
+        case 'v': out[0] = '\v'; return 1;
+        case '\\':
+        case '\"':
+        case '\'':
+            out[0] = c;
+            return 1;
+
+        // Stop the output
+        case 'c':
+            return -1;
+
+        // \xHH in hexadecimal
+        case 'x':
+            if (!(**ptr) || !strchr("0123456789abcdefABCDEF", **ptr)) break;
+            c = 0;
+            for (int k = 0; k < 2 && **ptr && strchr("0123456789abcdefABCDEF", **ptr); k++, (*ptr)++) c = c * 16 + (**ptr <= '9' ? **ptr - '0' : (**ptr | 0x20) - 'a' + 10);
+            out[0] = c;
+            return 1;
+
+        // \nnn in octal inside the format, \0nnn inside arguments of %b
+        default:
+            if (c < '0' || c > '7' || (is_argument && c != '0')) break;
+            c = is_argument ? 0 : c - '0';
+            for (int k = 0; k < (is_argument ? 3 : 2) && **ptr >= '0' && **ptr <= '7'; k++) c = c * 8 + (*(*ptr)++ - '0');
+            out[0] = c;
+            return 1;
+    }
+
+    // Unknown escapes are printed as they are
+    if (c == '\0') {
+        (*ptr)--;
+        out[0] = '\\';
+        return 1;
+    }
+    out[0] = '\\';
+    out[1] = c;
+    return 2;
+}
+
+
+/**
+ * @see strtoll, strtoull, isspace, sink_error
+ */
+long long _printf_number(const char *const arg, int *const return_code) {
+    if (!arg || !(*arg)) return 0;
+
+    // 'c gives the code of the character c
+    if (arg[0] == '\'' || arg[0] == '\"') return (unsigned char)arg[1];
+
+    char *end;
+    const char *start = arg;
+    while (isspace((unsigned char)*start)) start++;
+    const long long value = *start == '-' ? strtoll(arg, &end, 0) : (long long)strtoull(arg, &end, 0);
+    if (*end || end == arg) {
+        sink_error("printf: %s: invalid number\n", arg);
+        *return_code = 1;
+    }
+    return value;
+}
+
+
+/**
+ * @see vsnprintf, malloc, sink_write, free
+ */
+void _printf_emit(const char *const spec, ...) {
+    char small[256];
+    va_list args, copy;
+    va_start(args, spec);
+    va_copy(copy, args);
+
+    // Most conversions fit in the local buffer, bigger ones are formatted a second time
+    const int length = vsnprintf(small, sizeof(small), spec, args);
+    if (length >= (int)sizeof(small)) {
+        char *const big = malloc(length + 1);
+        if (big) {
+            vsnprintf(big, length + 1, spec, copy);
+            sink_write(big, length);
+            free(big);
+        }
+    }
+    else if (length > 0) sink_write(small, length);
+
+    va_end(copy);
+    va_end(args);
+}
+
+
+/**
+ * @see sink_write, _printf_escape, sink_putc, strchr, strlen, snprintf, _printf_number, strtod, malloc, _printf_emit, free, sink_error
+ */
+int _printf_format(const char *const format, const int argc, const char *const *const argv, int *const next, int *const return_code) {
+    const char *ptr = format;
+    char out[2];
+
+    while (*ptr) {
+        // Plain characters are written at once
+        const char *const start = ptr;
+        while (*ptr && *ptr != '\\' && *ptr != '%') ptr++;
+        if (ptr > start) sink_write(start, ptr - start);
+        if (!(*ptr)) break;
+
+        if (*ptr == '\\') {
+            ptr++;
+            const int count = _printf_escape(&ptr, out, 0);
+            if (count == -1) return 1;
+            sink_write(out, count);
+            continue;
+        }
+
+        if (ptr[1] == '%') {
+            sink_putc('%');
+            ptr += 2;
+            continue;
+        }
+
+        // Copy flags, width and precision of the conversion, * takes them from the arguments
+        char spec[64] = "%";
+        int length = 1;
+        ptr++;
+        while (*ptr && strchr("-+ #0", *ptr) && length < 16) spec[length++] = *ptr++;
+        for (int part = 0; part < 2; part++) {
+            if (part == 1) {
+                if (*ptr != '.') break;
+                spec[length++] = *ptr++;
+            }
+            if (*ptr == '*') {
+                ptr++;
+                const char *const arg = *next < argc ? argv[(*next)++] : NULL;
+                length += snprintf(&spec[length], sizeof(spec) - length - 4, "%d", (int)_printf_number(arg, return_code));
+            }
+            else while (isdigit((unsigned char)*ptr) && length < 48) spec[length++] = *ptr++;
+        }
+
+        const char conversion = *ptr;
+        if (!conversion || !strchr("diouxXcsbfFeEgGaA", conversion)) {
+            sink_error("printf: %c: invalid format character\n", conversion ? conversion : '%');
+            *return_code = 1;
+            return 1;
+        }
+        ptr++;
+
+        // Missing arguments are empty strings or 0
+        const char *const arg = *next < argc ? argv[(*next)++] : NULL;
+        if (strchr("diouxX", conversion)) {
+            spec[length++] = 'l';
+            spec[length++] = 'l';
+            spec[length++] = conversion;
+            spec[length] = '\0';
+            _printf_emit(spec, _printf_number(arg, return_code));
+        }
+        else if (strchr("fFeEgGaA", conversion)) {
+            spec[length++] = conversion;
+            spec[length] = '\0';
+            _printf_emit(spec, arg ? strtod(arg, NULL) : 0.0);
+        }
+        else if (conversion == 'c') {
+            // The first character of the argument, as a string to print nothing for an empty one
+            const char character[2] = { arg ? arg[0] : '\0', '\0' };
+            spec[length++] = 's';
+            spec[length] = '\0';
+            _printf_emit(spec, character);
+        }
+        else if (conversion == 's' || !arg) {
+            spec[length++] = 's';
+            spec[length] = '\0';
+            _printf_emit(spec, arg ? arg : "");
+        }
+        else {
+            // %b interprets escapes of its argument, escapes never make a string longer
+            char *const expanded = malloc(strlen(arg) + 1);
+            if (!expanded) return 1;
+            int size = 0, stop = 0;
+            for (const char *a = arg; *a && !stop; ) {
+                if (*a != '\\' || !a[1]) {
+                    expanded[size++] = *a++;
+                    continue;
+                }
+                a++;
+                const int count = _printf_escape(&a, &expanded[size], 1);
+                if (count == -1) stop = 1;
+                else size += count;
+            }
+            expanded[size] = '\0';
+            spec[length++] = 's';
+            spec[length] = '\0';
+            _printf_emit(spec, expanded);
+            free(expanded);
+            if (stop) return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see strcmp, _printf_print_usage, sink_error, _printf_format
+ */
+int our_printf(const int argc, const char *const *const argv) {
+    int first = 1;
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        _printf_print_usage(argv[0]);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--") == 0) first++;
+    if (first >= argc) {
+        sink_error("%s: usage: %s format [arguments]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    // The format is used again while it consumes arguments
+    int return_code = 0;
+    int next = first + 1;
+    int before;
+    do {
+        before = next;
+        if (_printf_format(argv[first], argc, argv, &next, &return_code)) break;
+    } while (next < argc && next > before);
+
+    return return_code;
+}
+
+
+REGISTER_BUILTIN("printf", our_printf, BUILTIN_FUSABLE);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_printf(argc, argv);
+}
+#endif
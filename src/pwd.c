@@ -0,0 +1,111 @@
+// CShell Project - New pwd command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "pwd_cmd.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+/**
+ * @see sink_printf
+ */
+void _pwd_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -L             Print the directory known by the shell (default)\n");
+    sink_printf("    -P             Print the physical directory, asking the kernel\n");
+}
+
+
+/**
+ * @see strcmp, _pwd_print_usage, sink_error
+ */
+int _pwd_parse_arguments(const int argc, const char *const *const argv, int *const physical) {
+    *physical = 0;
+    for (int i = 1; i < argc; i++) {
+        // Check if the argument is -h or --help
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            // Print the usage and return
+            _pwd_print_usage(argv[0]);
+            return -1;
+        }
+        else if (strcmp(argv[i], "-L") == 0) *physical = 0;
+        else if (strcmp(argv[i], "-P") == 0) *physical = 1;
+        else {
+            sink_error("%s: %s: invalid option\n", argv[0], argv[i]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see getcwd, snprintf, readlink
+ */
+int pwd_physical(char *const buffer) {
+    if (CWD_FD == AT_FDCWD) return getcwd(buffer, MAX_PATH_LENGTH) ? 0 : -1;
+
+    // The directory of an embedding context is only a file descriptor, the kernel knows its path
+    char link[32];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", CWD_FD);
+    const ssize_t length = readlink(link, buffer, MAX_PATH_LENGTH);
+    if (length == -1) return -1;
+    if (length == MAX_PATH_LENGTH) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    buffer[length] = '\0';
+    return 0;
+}
+
+
+/**
+ * @see _pwd_parse_arguments, pwd_physical, sink_perror, sink_printf
+ */
+int our_pwd(const int argc, const char *const *const argv) {
+    // Parse the arguments
+    int physical;
+    int parse_result = _pwd_parse_arguments(argc, argv, &physical);
+    if (parse_result == -1) return 0;
+    if (parse_result) return parse_result;
+
+    // The shell keeps its directory up to date (see cd), no system call is needed
+    const char *cwd = CWD;
+    char buffer[MAX_PATH_LENGTH];
+    if (physical || !CWD[0]) {
+        if (pwd_physical(buffer) == -1) {
+            sink_perror(argv[0]);
+            return 1;
+        }
+        cwd = buffer;
+    }
+
+    sink_printf("%s\n", cwd);
+    return 0;
+}
+
+
+REGISTER_BUILTIN("pwd", our_pwd, BUILTIN_FUSABLE);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_pwd(argc, argv);
+}
+#endif
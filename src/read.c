@@ -0,0 +1,273 @@
+// CShell Project - New read command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "read.h"
+#include "variables.h"
+#include "terminal.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+/**
+ * @see realloc, memcpy
+ */
+int _read_append(read_line_t *const line, const char *const data, const size_t size) {
+    if (line->length + size + 1 > line->capacity) {
+        size_t capacity = line->capacity ? 2 * line->capacity : 128;
+        while (line->length + size + 1 > capacity) capacity *= 2;
+        char *const text = realloc(line->text, capacity);
+        if (!text) return -1;
+        line->text = text;
+        line->capacity = capacity;
+    }
+
+    memcpy(&line->text[line->length], data, size);
+    line->length += size;
+    line->text[line->length] = '\0';
+
+    return 0;
+}
+
+
+int _read_ends_escaped(const read_line_t *const line) {
+    size_t count = 0;
+    while (count < line->length && line->text[line->length - 1 - count] == '\\') count++;
+    return count % 2;
+}
+
+
+/**
+ * @see read, memchr, _read_append, _read_ends_escaped, lseek
+ */
+int _read_blocks(const int fd, const char delimiter, const int raw, read_line_t *const line) {
+    char block[READ_BLOCK_SIZE];
+    ssize_t size;
+
+    while (1) {
+        do size = read(fd, block, READ_BLOCK_SIZE);
+        while (size == -1 && errno == EINTR);
+        if (size <= 0) return size == 0 ? 0 : -1;
+
+        const char *ptr = block;
+        const char *const end = block + size;
+        const char *found;
+        while ((found = memchr(ptr, delimiter, end - ptr)) != NULL) {
+            if (_read_append(line, ptr, found - ptr) == -1) return -1;
+            ptr = found + 1;
+
+            // An escaped newline joins the next line, another escaped delimiter stays in the line
+            if (!raw && _read_ends_escaped(line)) {
+                if (delimiter == '\n') line->text[--line->length] = '\0';
+                else if (_read_append(line, &delimiter, 1) == -1) return -1;
+                continue;
+            }
+
+            // Give back what follows the line, the next command reads from just after it
+            if (ptr < end) lseek(fd, ptr - end, SEEK_CUR);
+            return 1;
+        }
+
+        if (_read_append(line, ptr, end - ptr) == -1) return -1;
+    }
+}
+
+
+/**
+ * @see read, _read_ends_escaped, _read_append
+ */
+int _read_bytes(const int fd, const char delimiter, const int raw, read_line_t *const line) {
+    char c;
+    ssize_t size;
+
+    while (1) {
+        do size = read(fd, &c, 1);
+        while (size == -1 && errno == EINTR);
+        if (size <= 0) return size == 0 ? 0 : -1;
+
+        if (c == delimiter) {
+            if (raw || !_read_ends_escaped(line)) return 1;
+            if (delimiter == '\n') {
+                line->text[--line->length] = '\0';
+                continue;
+            }
+        }
+
+        if (_read_append(line, &c, 1) == -1) return -1;
+    }
+}
+
+
+/**
+ * @see strchr
+ */
+int _read_is_blank(const char c, const char *const ifs) {
+    return c != '\0' && strchr(" \t\n", c) != NULL && strchr(ifs, c) != NULL;
+}
+
+
+/**
+ * @see var_get, _read_is_blank, strchr, var_set
+ */
+int _read_assign(char *const line, const int raw, const char *const *const names, const int count) {
+    // Without variables, the line goes as is to REPLY
+    const char *ifs = count ? var_get("IFS") : "";
+    if (ifs == NULL) ifs = READ_DEFAULT_IFS;
+
+    // Characters are moved back in place as backslashes are removed
+    char *in = line, *out, *start;
+    int res = 0;
+    while (_read_is_blank(*in, ifs)) in++;
+
+    for (int i = 0; i < count - 1; i++) {
+        start = out = in;
+        while (*in && (!strchr(ifs, *in) || (!raw && *in == '\\'))) {
+            if (!raw && *in == '\\') {
+                in++;
+                if (*in) *out++ = *in++;
+                continue;
+            }
+            *out++ = *in++;
+        }
+
+        // A separator is a run of blanks, with at most one other character of IFS inside
+        while (_read_is_blank(*in, ifs)) in++;
+        if (*in && strchr(ifs, *in) && !(!raw && *in == '\\')) {
+            in++;
+            while (_read_is_blank(*in, ifs)) in++;
+        }
+
+        *out = '\0';
+        if (var_set(names[i], start) == -1) res = 1;
+    }
+
+    // The last variable gets the rest of the line, without its trailing blanks
+    start = out = in;
+    char *end = out;
+    while (*in) {
+        if (!raw && *in == '\\') {
+            in++;
+            if (*in) {
+                *out++ = *in++;
+                end = out;
+            }
+            continue;
+        }
+        if (!_read_is_blank(*in, ifs)) end = out + 1;
+        *out++ = *in++;
+    }
+    *end = '\0';
+    if (var_set(count ? names[count - 1] : "REPLY", start) == -1) res = 1;
+
+    return res;
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _read_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] [name ...]\n", program_name);
+    sink_printf("Read a line of stdin and split it on IFS into the variables, the last one gets the rest of the line\n");
+    sink_printf("Without name, the line is stored in REPLY\n");
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -r             Backslashes are characters, they do not escape the next one\n");
+    sink_printf("    -d delim       End the line at the first character of delim instead of newline\n");
+}
+
+
+/**
+ * @see strcmp, _read_print_usage, sink_error, var_is_name, strlen, fstat, S_ISREG, isatty, disable_raw_mode, _read_blocks, _read_bytes, enable_raw_mode, sink_perror, free, _read_assign
+ */
+int our_read(const int argc, const char *const *const argv) {
+    int raw = 0, first_name = argc;
+    char delimiter = '\n';
+
+    // Parse the arguments
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            _read_print_usage(argv[0]);
+            return 0;
+        }
+        else if (strcmp(argv[i], "-r") == 0) raw = 1;
+        else if (strcmp(argv[i], "-d") == 0) {
+            if (i + 1 >= argc) {
+                sink_error("%s: -d: option requires an argument\n", argv[0]);
+                return 2;
+            }
+            // An empty delimiter ends the line at a null byte
+            delimiter = argv[++i][0];
+        }
+        else if (strcmp(argv[i], "--") == 0) {
+            first_name = i + 1;
+            break;
+        }
+        else if (argv[i][0] == '-') {
+            sink_error("%s: unknown option %s\n", argv[0], argv[i]);
+            _read_print_usage(argv[0]);
+            return 2;
+        }
+        else {
+            first_name = i;
+            break;
+        }
+    }
+
+    for (int i = first_name; i < argc; i++) {
+        if (!var_is_name(argv[i], strlen(argv[i]))) {
+            sink_error("%s: `%s': not a valid identifier\n", argv[0], argv[i]);
+            return 1;
+        }
+    }
+
+    // Regular files and memfds are read by blocks and seeked back, pipes and terminals byte by byte
+    const int fd = SHELL_FDS[STDIN_FILENO];
+    read_line_t line = { NULL, 0, 0 };
+    struct stat st;
+    int found;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) found = _read_blocks(fd, delimiter, raw, &line);
+    else if (isatty(fd)) {
+        // The line is typed with echo and edition of the terminal
+        disable_raw_mode();
+        found = _read_bytes(fd, delimiter, raw, &line);
+        if (INTERACTIVE) enable_raw_mode();
+    }
+    else found = _read_bytes(fd, delimiter, raw, &line);
+
+    if (found == -1) {
+        sink_perror(argv[0]);
+        free(line.text);
+        return 1;
+    }
+
+    // Variables are set even at end of file, with what was read
+    char empty[1] = "";
+    const int res = _read_assign(line.text ? line.text : empty, raw, &argv[first_name], argc - first_name);
+    free(line.text);
+
+    return found ? res : 1;
+}
+
+
+REGISTER_BUILTIN("read", our_read, BUILTIN_READS_STDIN);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_read(argc, argv);
+}
+#endif
@@ -0,0 +1,114 @@
+// CShell Project - Buffered line reader for scripts
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "reader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+/**
+ * @see malloc, fstat, lseek
+ */
+int reader_init(reader_t *const reader, const int fd, const int shared) {
+    memset(reader, 0, sizeof(reader_t));
+    reader->fd = fd;
+    reader->capacity = READER_BLOCK_SIZE + 1;
+    reader->buffer = malloc(reader->capacity);
+    if (!reader->buffer) return -1;
+
+    // Only regular files can be given back to commands at the right offset, pipes are read by blocks anyway
+    struct stat st;
+    if (shared && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        reader->offset = lseek(fd, 0, SEEK_CUR);
+        reader->seekable = reader->offset != -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see memchr, memmove, realloc, pread, read
+ */
+char *reader_next_line(reader_t *const reader, size_t *const length) {
+    char *newline;
+    while (!(newline = memchr(&reader->buffer[reader->start], '\n', reader->end - reader->start))) {
+        if (reader->eof) break;
+
+        // Move the start of the line to the start of the buffer, make it bigger for very long lines
+        if (reader->start > 0) {
+            memmove(reader->buffer, &reader->buffer[reader->start], reader->end - reader->start);
+            reader->end -= reader->start;
+            reader->start = 0;
+        }
+        if (reader->capacity - reader->end < READER_BLOCK_SIZE + 1) {
+            char *const bigger = realloc(reader->buffer, reader->end + READER_BLOCK_SIZE + 1);
+            if (!bigger) return NULL;
+            reader->buffer = bigger;
+            reader->capacity = reader->end + READER_BLOCK_SIZE + 1;
+        }
+
+        // A shared file is read at our own offset, the offset of the file descriptor is left to commands
+        const ssize_t size = reader->seekable ? pread(reader->fd, &reader->buffer[reader->end], READER_BLOCK_SIZE, reader->offset)
+                                              : read(reader->fd, &reader->buffer[reader->end], READER_BLOCK_SIZE);
+        if (size == -1 && errno == EINTR) continue;
+        if (size <= 0) reader->eof = 1;
+        else {
+            reader->end += size;
+            reader->offset += size;
+        }
+    }
+
+    // Last line without new line
+    if (!newline) {
+        if (reader->start == reader->end) return NULL;
+        newline = &reader->buffer[reader->end];
+    }
+
+    char *const line = &reader->buffer[reader->start];
+    *newline = '\0';
+    if (length) *length = newline - line;
+    reader->start = newline - reader->buffer + (newline < &reader->buffer[reader->end]);
+    if (reader->start > reader->end) reader->start = reader->end;
+
+    return line;
+}
+
+
+/**
+ * @see lseek
+ */
+void reader_sync_before(reader_t *const reader) {
+    if (reader->seekable) lseek(reader->fd, reader->offset - (reader->end - reader->start), SEEK_SET);
+}
+
+
+/**
+ * @see lseek
+ */
+void reader_sync_after(reader_t *const reader) {
+    if (!reader->seekable) return;
+
+    // Nobody read the script, continue with the buffer
+    const off_t current = lseek(reader->fd, 0, SEEK_CUR);
+    if (current == -1 || current == reader->offset - (off_t)(reader->end - reader->start)) return;
+
+    // A command consumed part of the script, continue after it
+    reader->start = reader->end = 0;
+    reader->offset = current;
+    reader->eof = 0;
+}
+
+
+/**
+ * @see free
+ */
+void reader_free(reader_t *const reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+}
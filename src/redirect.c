@@ -0,0 +1,219 @@
+// CShell Project - File descriptor actions of redirections
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "redirect.h"
+#include "sink.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+
+
+int redirect_targets(const fd_actions_t *const actions, const int fd) {
+    for (int i = 0; i < actions->count; i++) if (actions->actions[i].fd == fd) return 1;
+    return 0;
+}
+
+
+int redirect_is_simple(const fd_actions_t *const actions) {
+    for (int i = 0; i < actions->count; i++) {
+        const fd_action_t *const action = &actions->actions[i];
+        if (action->type != FD_ACTION_OPEN || (action->fd != STDIN_FILENO && action->fd != STDOUT_FILENO)) return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @see posix_spawn_file_actions_addopen, posix_spawn_file_actions_adddup2, posix_spawn_file_actions_addclose
+ */
+void redirect_spawn_actions(const fd_actions_t *const actions, posix_spawn_file_actions_t *const file_actions) {
+    for (int i = 0; i < actions->count; i++) {
+        const fd_action_t *const action = &actions->actions[i];
+        switch (action->type) {
+            case FD_ACTION_OPEN:  posix_spawn_file_actions_addopen(file_actions, action->fd, action->path, action->flags, 0644); break;
+            case FD_ACTION_DUP:   posix_spawn_file_actions_adddup2(file_actions, action->source, action->fd);                   break;
+            case FD_ACTION_CLOSE: posix_spawn_file_actions_addclose(file_actions, action->fd);                                  break;
+        }
+    }
+}
+
+
+/**
+ * @see posix_spawn_file_actions_adddup2, posix_spawn_file_actions_addclose
+ */
+void redirect_spawn_shell_fds(posix_spawn_file_actions_t *const file_actions) {
+    // Copies of SHELL_FDS are all above them, putting one in place never overwrites another
+    for (int i = 0; i < SHELL_FDS_COUNT; i++) {
+        if (SHELL_FDS[i] == i) continue;
+        if (SHELL_FDS[i] == -1) posix_spawn_file_actions_addclose(file_actions, i);
+        else                    posix_spawn_file_actions_adddup2(file_actions, SHELL_FDS[i], i);
+    }
+}
+
+
+/**
+ * @see dup2, close
+ */
+void redirect_install_shell_fds() {
+    for (int i = 0; i < SHELL_FDS_COUNT; i++) {
+        if (SHELL_FDS[i] == i) continue;
+        if (SHELL_FDS[i] == -1) close(i);
+        else                    dup2(SHELL_FDS[i], i);
+    }
+    for (int i = 0; i < SHELL_FDS_COUNT; i++) {
+        if (SHELL_FDS[i] >= SHELL_FDS_COUNT) close(SHELL_FDS[i]);
+        SHELL_FDS[i] = i;
+    }
+}
+
+
+/**
+ * @see fcntl, close
+ */
+int redirect_shell_fd(const int fd) {
+    if (!EMBEDDED || fd == -1 || fd >= SHELL_FDS_COUNT) return fd;
+
+    const int moved = fcntl(fd, F_DUPFD_CLOEXEC, SHELL_FDS_COUNT);
+    close(fd);
+    return moved;
+}
+
+
+/**
+ * @see _redirect_apply_shell, fcntl, openat, sink_perror, dup2, close, sink_error, strerror
+ */
+int redirect_apply(const fd_actions_t *const actions, int *const saved) {
+    // Inside another program the file descriptors of the process are not ours to replace
+    if (EMBEDDED && saved) return _redirect_apply_shell(actions, saved);
+
+    // Saved copies go above every file descriptor of the list, a later action can not overwrite them
+    int lowest = REDIRECT_SAVED_FD_MIN;
+    for (int i = 0; i < actions->count; i++) {
+        if (saved) saved[i] = REDIRECT_NOT_SAVED;
+        if (actions->actions[i].fd >= lowest) lowest = actions->actions[i].fd + 1;
+    }
+
+    for (int i = 0; i < actions->count; i++) {
+        const fd_action_t *const action = &actions->actions[i];
+
+        // Only the first action on a file descriptor saves it, -1 if it was closed
+        if (saved) {
+            int first = 1;
+            for (int j = 0; j < i && first; j++) first = actions->actions[j].fd != action->fd;
+            if (first) saved[i] = fcntl(action->fd, F_DUPFD_CLOEXEC, lowest);
+        }
+
+        if (action->type == FD_ACTION_OPEN) {
+            const int fd = openat(CWD_FD, action->path, action->flags, 0644);
+            if (fd == -1) {
+                sink_perror(action->path);
+                return -1;
+            }
+            if (fd != action->fd) {
+                dup2(fd, action->fd);
+                close(fd);
+            }
+        }
+        else if (action->type == FD_ACTION_DUP && dup2(action->source, action->fd) == -1) {
+            sink_error("%d: %s\n", action->source, strerror(errno));
+            return -1;
+        }
+        else if (action->type == FD_ACTION_CLOSE) close(action->fd);
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see _redirect_restore_shell, dup2, close
+ */
+void redirect_restore(const fd_actions_t *const actions, const int *const saved) {
+    if (!saved) return;
+    if (EMBEDDED) {
+        _redirect_restore_shell(actions, saved);
+        return;
+    }
+
+    for (int i = actions->count - 1; i >= 0; i--) {
+        if (saved[i] == REDIRECT_NOT_SAVED) continue;
+        if (saved[i] == -1) close(actions->actions[i].fd);
+        else {
+            dup2(saved[i], actions->actions[i].fd);
+            close(saved[i]);
+        }
+    }
+}
+
+
+/**
+ * @see sink_error, strerror, openat, fcntl, sink_perror, close
+ */
+int _redirect_apply_shell(const fd_actions_t *const actions, int *const saved) {
+    for (int i = 0; i < actions->count; i++) saved[i] = REDIRECT_NOT_SAVED;
+
+    for (int i = 0; i < actions->count; i++) {
+        const fd_action_t *const action = &actions->actions[i];
+        if (action->fd < 0 || action->fd >= SHELL_FDS_COUNT) {
+            sink_error("%d: %s\n", action->fd, strerror(EBADF));
+            return -1;
+        }
+
+        // Only the first action on a file descriptor saves it, the copy made by an earlier action is closed
+        int first = i;
+        for (int j = 0; j < i && first == i; j++) if (actions->actions[j].fd == action->fd) first = j;
+        if (first == i) saved[i] = SHELL_FDS[action->fd];
+        else if (SHELL_FDS[action->fd] != saved[first] && SHELL_FDS[action->fd] != -1) close(SHELL_FDS[action->fd]);
+
+        int fd = -1;
+        if (action->type == FD_ACTION_OPEN) {
+            const int opened = openat(CWD_FD, action->path, action->flags | O_CLOEXEC, 0644);
+            if (opened == -1 || (fd = fcntl(opened, F_DUPFD_CLOEXEC, SHELL_FDS_COUNT)) == -1) {
+                sink_perror(action->path);
+                if (opened != -1) close(opened);
+                SHELL_FDS[action->fd] = -1;
+                return -1;
+            }
+            close(opened);
+        }
+        else if (action->type == FD_ACTION_DUP) {
+            const int source = action->internal ? action->source
+                             : action->source >= 0 && action->source < SHELL_FDS_COUNT ? SHELL_FDS[action->source] : -1;
+            if (source == -1 || (fd = fcntl(source, F_DUPFD_CLOEXEC, SHELL_FDS_COUNT)) == -1) {
+                sink_error("%d: %s\n", action->source, strerror(source == -1 ? EBADF : errno));
+                SHELL_FDS[action->fd] = -1;
+                return -1;
+            }
+        }
+        SHELL_FDS[action->fd] = fd;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see close
+ */
+void _redirect_restore_shell(const fd_actions_t *const actions, const int *const saved) {
+    for (int i = actions->count - 1; i >= 0; i--) {
+        if (saved[i] == REDIRECT_NOT_SAVED) continue;
+        const int fd = actions->actions[i].fd;
+        if (SHELL_FDS[fd] != saved[i] && SHELL_FDS[fd] != -1) close(SHELL_FDS[fd]);
+        SHELL_FDS[fd] = saved[i];
+    }
+}
+
+
+/**
+ * @see close
+ */
+void redirect_close(const fd_actions_t *const actions) {
+    for (int i = 0; i < actions->count; i++) if (actions->actions[i].owned) close(actions->actions[i].source);
+}
@@ -0,0 +1,149 @@
+// CShell Project - Single-producer/single-consumer ring buffer
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "ring.h"
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+
+
+// Number of busy loops before yielding the CPU while waiting
+#define RING_SPINS 256
+// Number of yields before sleeping while waiting
+#define RING_YIELDS 4096
+
+
+/**
+ * @see sched_yield, nanosleep
+ */
+void _ring_backoff(unsigned int *const spins) {
+    // Busy loop first, the other side is usually running on another CPU
+    if (*spins < RING_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    // Then let the other side run on this CPU
+    else if (*spins < RING_YIELDS) sched_yield();
+    // And finally stop burning CPU if the other side is slow (e.g. waiting on a terminal)
+    else {
+        const struct timespec pause = { 0, 50000 };
+        nanosleep(&pause, NULL);
+    }
+
+    (*spins)++;
+}
+
+
+/**
+ * @see sizeof, malloc, free, atomic_init
+ */
+ring_t *ring_create() {
+    ring_t *const ring = malloc(sizeof(ring_t));
+    if (!ring) return NULL;
+
+    ring->blocks = malloc(RING_BLOCKS * RING_BLOCK_SIZE);
+    if (!ring->blocks) {
+        free(ring);
+        return NULL;
+    }
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->writer_closed, 0);
+    atomic_init(&ring->reader_closed, 0);
+
+    return ring;
+}
+
+
+/**
+ * @see free
+ */
+void ring_destroy(ring_t *const ring) {
+    if (!ring) return;
+    free(ring->blocks);
+    free(ring);
+}
+
+
+/**
+ * @see atomic_load_explicit, _ring_backoff
+ */
+char *ring_acquire(ring_t *const ring) {
+    // Only the producer writes head, a relaxed load is enough
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    // Wait until the consumer released the block published RING_BLOCKS times ago
+    unsigned int spins = 0;
+    while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= RING_BLOCKS) {
+        if (atomic_load_explicit(&ring->reader_closed, memory_order_acquire)) return NULL;
+        _ring_backoff(&spins);
+    }
+    if (atomic_load_explicit(&ring->reader_closed, memory_order_acquire)) return NULL;
+
+    return &ring->blocks[(head % RING_BLOCKS) * RING_BLOCK_SIZE];
+}
+
+
+/**
+ * @see atomic_load_explicit, atomic_store_explicit
+ */
+void ring_publish(ring_t *const ring, const size_t length) {
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    // The release store makes the block content visible before the new head
+    ring->lengths[head % RING_BLOCKS] = length;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+
+/**
+ * @see atomic_load_explicit, _ring_backoff
+ */
+const char *ring_peek(ring_t *const ring, size_t *const length) {
+    // Only the consumer writes tail, a relaxed load is enough
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    // Wait until the producer published a block or closed the ring
+    unsigned int spins = 0;
+    while (atomic_load_explicit(&ring->head, memory_order_acquire) == tail) {
+        if (atomic_load_explicit(&ring->writer_closed, memory_order_acquire)) {
+            // Check again, the producer may have published just before closing
+            if (atomic_load_explicit(&ring->head, memory_order_acquire) != tail) break;
+            *length = 0;
+            return NULL;
+        }
+        _ring_backoff(&spins);
+    }
+
+    *length = ring->lengths[tail % RING_BLOCKS];
+    return &ring->blocks[(tail % RING_BLOCKS) * RING_BLOCK_SIZE];
+}
+
+
+/**
+ * @see atomic_load_explicit, atomic_store_explicit
+ */
+void ring_release(ring_t *const ring) {
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+
+/**
+ * @see atomic_store_explicit
+ */
+void ring_close_writer(ring_t *const ring) {
+    atomic_store_explicit(&ring->writer_closed, 1, memory_order_release);
+}
+
+
+/**
+ * @see atomic_store_explicit
+ */
+void ring_close_reader(ring_t *const ring) {
+    atomic_store_explicit(&ring->reader_closed, 1, memory_order_release);
+}
@@ -3,7 +3,12 @@
 // Date: 2025-03-17
 
 
+#include "config.h"
 #include "rm.h"
+#include "sink.h"
+#include "stats.h"
+#include "trace.h"
+#include "builtin.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -12,30 +17,26 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <dirent.h>
-
-
-static int _rm_recursive_flag;
-static int _rm_verbose_flag;
-static int _rm_force_flag;
+#include <fcntl.h>
 
 
 /**
- * @see printf
+ * @see sink_printf
  */
 void _rm_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options]\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
-    printf("    -r             Remove directories and their contents recursively\n");
-    printf("    -v             Enable verbose mode\n");
-    printf("    -f             Ignore nonexistent files and arguments, never prompt\n");
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -r             Remove directories and their contents recursively\n");
+    sink_printf("    -v             Enable verbose mode\n");
+    sink_printf("    -f             Ignore nonexistent files and arguments, never prompt\n");
 }
 
 
 /**
- * @see strcmp, _rm_print_usage, perror
+ * @see strcmp, _rm_print_usage, sink_perror
  */
-int _rm_parse_arguments(const int argc, const char *const *const argv) {
+int _rm_parse_arguments(const int argc, const char *const *const argv, rm_options_t *const options) {
     for (int i = 1; i < argc; i++) {
         // Check if the argument is -h or --help
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -49,16 +50,16 @@ int _rm_parse_arguments(const int argc, const char *const *const argv) {
             for (int j = 1; argv[i][j] != '\0'; j++) {
                 switch (argv[i][j]) {
                     case 'r':
-                        _rm_recursive_flag = 1;
+                        options->recursive = 1;
                         break;
                     case 'v':
-                        _rm_verbose_flag = 1;
+                        options->verbose = 1;
                         break;
                     case 'f':
-                        _rm_force_flag = 1;
+                        options->force = 1;
                         break;
                     default:
-                        perror("Unknown option");
+                        sink_perror("Unknown option");
                         return -1;
                 }
             }
@@ -70,24 +71,26 @@ int _rm_parse_arguments(const int argc, const char *const *const argv) {
 
 
 /**
- * @see stat, S_ISDIR
+ * @see fstatat, S_ISDIR
  */
 int _rm_is_directory(const char *path) {
     struct stat path_stat;
-    if (stat(path, &path_stat) != 0) return 0; // Assume not a directory on error
+    if (fstatat(CWD_FD, path, &path_stat, 0) != 0) return 0; // Assume not a directory on error
     return S_ISDIR(path_stat.st_mode);
 }
 
 
 /**
- * @see opendir, perror, readdir, strcmp, snprintf, _rm_is_directory, remove_recursively, closedir, remove, printf, rmdir
+ * @see openat, fdopendir, close, sink_perror, readdir, strcmp, snprintf, _rm_is_directory, remove_recursively, closedir, unlinkat, stats_add, sink_printf
  */
-int _rm_remove_recursively(const char *path) {
+int _rm_remove_recursively(const char *path, const rm_options_t *const options) {
     // Open the directory
-    DIR *dir = opendir(path);
+    const int dir_fd = openat(CWD_FD, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = dir_fd == -1 ? NULL : fdopendir(dir_fd);
     if (!dir) {
-        if (_rm_force_flag) return 0;
-        perror("opendir");
+        if (dir_fd != -1) close(dir_fd);
+        if (options->force) return 0;
+        sink_perror("opendir");
         return -1;
     }
 
@@ -103,51 +106,54 @@ int _rm_remove_recursively(const char *path) {
 
         if (_rm_is_directory(full_path)) {
             // Recursively remove the directory
-            if (_rm_remove_recursively(full_path) != 0) {
-                if (_rm_force_flag) return 0;
+            TRACE_BEGIN("_rm_remove_recursively", full_path);
+            const int removed = _rm_remove_recursively(full_path, options);
+            TRACE_END("_rm_remove_recursively");
+            if (removed != 0) {
+                if (options->force) return 0;
                 closedir(dir);
                 return -1;
             }
         }
         else {
             // Remove the file
-            if (remove(full_path) != 0) {
-                if (!_rm_force_flag) {
-                    perror("remove");
+            if (unlinkat(CWD_FD, full_path, 0) != 0) {
+                if (!options->force) {
+                    sink_perror("remove");
                     closedir(dir);
                 }
                 continue;
             }
-            else if (_rm_verbose_flag) printf("Removed file '%s'\n", full_path);
+            stats_add(STAT_FILES_REMOVED, 1);
+            if (options->verbose) sink_printf("Removed file '%s'\n", full_path);
         }
     }
 
     closedir(dir);
 
     // Remove the directory itself
-    if (rmdir(path) != 0) {
-        if (_rm_force_flag) return 0;
-        perror("rmdir");
+    if (unlinkat(CWD_FD, path, AT_REMOVEDIR) != 0) {
+        if (options->force) return 0;
+        sink_perror("rmdir");
         return -1;
     }
 
-    if (_rm_verbose_flag) printf("Removed directory '%s'\n", path);
+    stats_add(STAT_FILES_REMOVED, 1);
+    if (options->verbose) sink_printf("Removed directory '%s'\n", path);
 
     return 0;
 }
 
 
 /**
- * @see _rm_parse_arguments, _rm_is_directory, _rm_remove_recursively, perror, remove, printf
+ * @see _rm_parse_arguments, _rm_is_directory, _rm_remove_recursively, sink_perror, unlinkat, stats_add, sink_printf
  */
 int our_rm(const int argc, const char *const *const argv) {
-    // Reset the flags
-    _rm_recursive_flag = 0;
-    _rm_verbose_flag = 0;
-    _rm_force_flag = 0;
+    // Options live on the stack, rm can run from several threads or shells at once
+    rm_options_t options = { 0, 0, 0 };
 
     // Parse the arguments
-    int parse_result = _rm_parse_arguments(argc, argv);
+    int parse_result = _rm_parse_arguments(argc, argv, &options);
     if (parse_result == -1) return 0;
     if (parse_result) return parse_result;
 
@@ -157,28 +163,32 @@ int our_rm(const int argc, const char *const *const argv) {
 
         if (_rm_is_directory(argv[i])) {
             // Remove the directory recursively
-            if (_rm_recursive_flag) {
-                if (_rm_remove_recursively(argv[i]) != 0)
+            if (options.recursive) {
+                TRACE_BEGIN("_rm_remove_recursively", argv[i]);
+                const int removed = _rm_remove_recursively(argv[i], &options);
+                TRACE_END("_rm_remove_recursively");
+                if (removed != 0)
                 {
-                    if (_rm_force_flag) return 0;
-                    perror("Error removing directory");
+                    if (options.force) return 0;
+                    sink_perror("Error removing directory");
                     return -1;
                 }
             }
             else {
-                if (_rm_force_flag) return 0;
-                perror("Error: removing directory without -r");
+                if (options.force) return 0;
+                sink_perror("Error: removing directory without -r");
                 return -1;
             }
         }
         else {
             // Remove the file
-            if (remove(argv[i]) != 0) {
-                if (_rm_force_flag) continue;
-                perror("Error removing file");
+            if (unlinkat(CWD_FD, argv[i], 0) != 0) {
+                if (options.force) continue;
+                sink_perror("Error removing file");
                 return 1;
             }
-            else if (_rm_verbose_flag) printf("Removed file '%s'\n", argv[i]);
+            stats_add(STAT_FILES_REMOVED, 1);
+            if (options.verbose) sink_printf("Removed file '%s'\n", argv[i]);
         }
     }
 
@@ -186,6 +196,9 @@ int our_rm(const int argc, const char *const *const argv) {
 }
 
 
+REGISTER_BUILTIN("rm", our_rm, 0);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
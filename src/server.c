@@ -0,0 +1,232 @@
+// CShell Project - Shell server on a Unix socket, and its client
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#define _GNU_SOURCE
+#include "main.h"
+#include "server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+/**
+ * @see read
+ */
+int _server_read_all(const int fd, void *const buffer, const size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t count = read(fd, (char *)buffer + done, size - done);
+        if (count == -1 && errno == EINTR) continue;
+        if (count <= 0) return -1;
+        done += count;
+    }
+    return 0;
+}
+
+
+/**
+ * @see send
+ */
+int _server_write_all(const int fd, const void *const buffer, const size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        // A client gone away is an error, not a SIGPIPE killing the shell
+        const ssize_t count = send(fd, (const char *)buffer + done, size - done, MSG_NOSIGNAL);
+        if (count == -1 && errno == EINTR) continue;
+        if (count <= 0) return -1;
+        done += count;
+    }
+    return 0;
+}
+
+
+/**
+ * @see recvmsg, CMSG_FIRSTHDR, memcpy, close, malloc, _server_read_all, free, fcntl, dup2, chdir, perror, getcwd,
+ *      strncpy, run_line, fflush, _server_write_all
+ */
+int _server_serve(const int client) {
+    // The header comes with the three file descriptors of the client
+    server_request_t request;
+    union {
+        char buffer[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { .iov_base = &request, .iov_len = sizeof(request) };
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer) };
+
+    ssize_t received;
+    do received = recvmsg(client, &message, MSG_CMSG_CLOEXEC);
+    while (received == -1 && errno == EINTR);
+
+    int fds[3] = { -1, -1, -1 };
+    const struct cmsghdr *const header = received > 0 ? CMSG_FIRSTHDR(&message) : NULL;
+    if (header && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS && header->cmsg_len == CMSG_LEN(3 * sizeof(int))) {
+        memcpy(fds, CMSG_DATA(header), sizeof(fds));
+    }
+
+    // The rest of the header may come after the file descriptors
+    int invalid = fds[0] == -1 || received <= 0;
+    if (!invalid && (size_t)received < sizeof(request)) {
+        invalid = _server_read_all(client, (char *)&request + received, sizeof(request) - received) == -1;
+    }
+    invalid = invalid || request.version != SERVER_PROTOCOL_VERSION || request.cwd_length >= MAX_PATH_LENGTH || request.line_length > SERVER_MAX_LINE_LENGTH;
+    if (invalid) {
+        for (int i = 0; i < 3; i++) if (fds[i] != -1) close(fds[i]);
+        return 1;
+    }
+
+    char cwd[MAX_PATH_LENGTH];
+    char *const line = malloc(request.line_length + 1);
+    if (!line || _server_read_all(client, cwd, request.cwd_length) == -1 || _server_read_all(client, line, request.line_length) == -1) {
+        free(line);
+        for (int i = 0; i < 3; i++) close(fds[i]);
+        return 1;
+    }
+    cwd[request.cwd_length] = '\0';
+    line[request.line_length] = '\0';
+
+    // Received file descriptors take the lowest free numbers, moved above 2 if the server had 0 to 2 closed
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] > STDERR_FILENO) continue;
+        const int moved = fcntl(fds[i], F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+        close(fds[i]);
+        fds[i] = moved;
+    }
+
+    // The line reads and writes the files of the client directly
+    for (int i = 0; i < 3; i++) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+
+    // The line runs where the client is
+    if (cwd[0] != '\0' && chdir(cwd) == -1) perror(cwd);
+    if (!getcwd(CWD, MAX_PATH_LENGTH)) CWD[0] = '\0';
+    strncpy(PWD, CWD, MAX_PATH_LENGTH);
+
+    int return_code = run_line(line);
+    free(line);
+    fflush(stdout);
+    fflush(stderr);
+
+    _server_write_all(client, &return_code, sizeof(return_code));
+    close(client);
+
+    return return_code;
+}
+
+
+/**
+ * @see socket, strlen, fprintf, strcpy, unlink, bind, listen, perror, close, jobs_poll_input, accept4, fflush, fork, exit, _server_serve
+ */
+int server_run(const char *const path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: Socket path too long\n", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        perror("socket");
+        return 1;
+    }
+
+    // A socket left by a previous server is replaced
+    unlink(path);
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(listen_fd, SERVER_BACKLOG) == -1) {
+        perror(path);
+        close(listen_fd);
+        return 1;
+    }
+
+    while (1) {
+        // Workers are children of the server, reaped while waiting for the next client
+        jobs_poll_input(listen_fd);
+
+        const int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client == -1) {
+            if (errno != EINTR && errno != ECONNABORTED) perror("accept");
+            continue;
+        }
+
+        // Each request runs inside its own copy of the warm shell, nothing it changes is kept
+        fflush(stdout);
+        const pid_t pid = fork();
+        if (pid > 0) stats_add(STAT_FORKS, 1);
+        if (pid == 0) {
+            close(listen_fd);
+            // exit ends the line, the return code is still sent to the client
+            EMBEDDED = 1;
+            exit(_server_serve(client));
+        }
+        if (pid == -1) perror("fork");
+        close(client);
+    }
+}
+
+
+/**
+ * @see strlen, fprintf, strcpy, socket, perror, connect, close, getcwd, sendmsg, CMSG_FIRSTHDR, memcpy, _server_write_all, _server_read_all
+ */
+int server_connect(const char *const path, const char *const line) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: Socket path too long\n", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("socket");
+        return 1;
+    }
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == -1) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+
+    char cwd[MAX_PATH_LENGTH];
+    if (!getcwd(cwd, MAX_PATH_LENGTH)) cwd[0] = '\0';
+    const server_request_t request = { SERVER_PROTOCOL_VERSION, strlen(cwd), strlen(line) };
+
+    // Send the header with stdin, stdout and stderr
+    const int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    union {
+        char buffer[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = { .iov_base = (void *)&request, .iov_len = sizeof(request) };
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer) };
+    struct cmsghdr *const header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    ssize_t sent;
+    do sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+    while (sent == -1 && errno == EINTR);
+
+    int return_code;
+    if (sent == -1 || _server_write_all(fd, (const char *)&request + sent, sizeof(request) - sent) == -1
+        || _server_write_all(fd, cwd, request.cwd_length) == -1 || _server_write_all(fd, line, request.line_length) == -1
+        || _server_read_all(fd, &return_code, sizeof(return_code)) == -1) {
+        fprintf(stderr, "%s: Connection closed by the server\n", path);
+        return_code = 1;
+    }
+    close(fd);
+
+    return return_code;
+}
@@ -0,0 +1,316 @@
+// CShell Project - Output sinks and input sources of commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "sink.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+
+
+__thread sink_t *SINK_OUT = NULL;
+__thread source_t *SOURCE_IN = NULL;
+
+
+/**
+ * @see malloc
+ */
+int sink_init_fd(sink_t *const sink, const int fd) {
+    sink->type = SINK_FD;
+    sink->fd = fd;
+    sink->ring = NULL;
+    sink->length = 0;
+    sink->failed = 0;
+    sink->block = malloc(SINK_BUFFER_SIZE);
+
+    return sink->block ? 0 : -1;
+}
+
+
+/**
+ * @see ring_acquire
+ */
+void sink_init_ring(sink_t *const sink, ring_t *const ring) {
+    sink->type = SINK_RING;
+    sink->fd = -1;
+    sink->ring = ring;
+    sink->length = 0;
+    sink->block = ring_acquire(ring);
+    sink->failed = sink->block == NULL;
+}
+
+
+/**
+ * @see write, stats_add
+ */
+ssize_t _sink_write_fd(const int fd, const char *const buffer, const size_t length) {
+    // Write the whole buffer, write may be partial on pipes
+    size_t written = 0;
+    ssize_t res;
+    while (written < length) {
+        res = write(fd, &buffer[written], length - written);
+        stats_add(STAT_BUILTIN_SYSCALLS, 1);
+        if (res == -1 && errno == EINTR) continue;
+        if (res <= 0) return -1;
+        written += res;
+    }
+
+    return written;
+}
+
+
+/**
+ * @see va_copy, vsnprintf, va_end, malloc
+ */
+char *_sink_format(char *const local, const size_t size, int *const length, const char *const format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    *length = vsnprintf(local, size, format, copy);
+    va_end(copy);
+    if (*length < 0) return NULL;
+    if ((size_t)*length < size) return local;
+
+    char *const buffer = malloc(*length + 1);
+    if (buffer) vsnprintf(buffer, *length + 1, format, args);
+    return buffer;
+}
+
+
+/**
+ * @see _sink_write_fd
+ */
+int _sink_flush(sink_t *const sink) {
+    if (sink->failed) return -1;
+
+    // Publish the current block and take the next one
+    if (sink->type == SINK_RING) {
+        if (sink->length == 0) return 0;
+        ring_publish(sink->ring, sink->length);
+        sink->length = 0;
+        sink->block = ring_acquire(sink->ring);
+        if (sink->block == NULL) sink->failed = 1;
+        return sink->failed ? -1 : 0;
+    }
+
+    if (_sink_write_fd(sink->fd, sink->block, sink->length) == -1) {
+        sink->failed = 1;
+        return -1;
+    }
+    sink->length = 0;
+
+    return 0;
+}
+
+
+/**
+ * @see _sink_flush, ring_close_writer, free
+ */
+void sink_close(sink_t *const sink) {
+    _sink_flush(sink);
+
+    if (sink->type == SINK_RING) {
+        // An acquired block is simply never published
+        ring_close_writer(sink->ring);
+        sink->block = NULL;
+    }
+    else {
+        free(sink->block);
+        sink->block = NULL;
+    }
+}
+
+
+/**
+ * @see stats_add, fwrite, _sink_write_fd, memcpy, _sink_flush
+ */
+ssize_t sink_write(const char *const buffer, const size_t length) {
+    stats_add(STAT_BUILTIN_BYTES_WRITTEN, length);
+
+    // Default output is stdout, or the one given by an embedding context, written at once
+    if (SINK_OUT == NULL && SHELL_FDS[STDOUT_FILENO] == STDOUT_FILENO) return fwrite(buffer, 1, length, stdout) == length ? (ssize_t)length : -1;
+    if (SINK_OUT == NULL) return _sink_write_fd(SHELL_FDS[STDOUT_FILENO], buffer, length);
+
+    sink_t *const sink = SINK_OUT;
+    const size_t capacity = sink->type == SINK_RING ? RING_BLOCK_SIZE : SINK_BUFFER_SIZE;
+
+    size_t done = 0, chunk;
+    while (done < length) {
+        if (sink->failed) return -1;
+
+        // Copy as much as possible in the current block
+        chunk = capacity - sink->length;
+        if (chunk > length - done) chunk = length - done;
+        memcpy(&sink->block[sink->length], &buffer[done], chunk);
+        sink->length += chunk;
+        done += chunk;
+
+        // Send the block when it is full
+        if (sink->length == capacity && _sink_flush(sink) == -1) return -1;
+    }
+
+    return done;
+}
+
+
+/**
+ * @see va_start, vfprintf, _sink_format, sink_write, free, va_end
+ */
+int sink_printf(const char *const format, ...) {
+    va_list args;
+    int res;
+
+    // Default output is stdout
+    if (SINK_OUT == NULL && SHELL_FDS[STDOUT_FILENO] == STDOUT_FILENO) {
+        va_start(args, format);
+        res = vfprintf(stdout, format, args);
+        va_end(args);
+        return res;
+    }
+
+    // Format in a local buffer, or in the heap if it is too small
+    char local[1024];
+    va_start(args, format);
+    char *const buffer = _sink_format(local, sizeof(local), &res, format, args);
+    va_end(args);
+    if (!buffer) return -1;
+
+    res = sink_write(buffer, res);
+    if (buffer != local) free(buffer);
+
+    return res;
+}
+
+
+/**
+ * @see putchar, sink_write
+ */
+int sink_putc(const int c) {
+    if (SINK_OUT == NULL && SHELL_FDS[STDOUT_FILENO] == STDOUT_FILENO) return putchar(c);
+
+    const char character = c;
+    return sink_write(&character, 1) == 1 ? (unsigned char)c : EOF;
+}
+
+
+/**
+ * @see fflush, _sink_flush
+ */
+int sink_flush() {
+    if (SINK_OUT == NULL) return fflush(stdout) == 0 ? 0 : -1;
+    return _sink_flush(SINK_OUT);
+}
+
+
+/**
+ * @see va_start, vfprintf, _sink_format, _sink_write_fd, free, va_end
+ */
+int sink_error(const char *const format, ...) {
+    va_list args;
+    int res;
+
+    // Default error output is stderr
+    if (SHELL_FDS[STDERR_FILENO] == STDERR_FILENO) {
+        va_start(args, format);
+        res = vfprintf(stderr, format, args);
+        va_end(args);
+        return res;
+    }
+
+    char local[1024];
+    va_start(args, format);
+    char *const buffer = _sink_format(local, sizeof(local), &res, format, args);
+    va_end(args);
+    if (!buffer) return -1;
+
+    res = _sink_write_fd(SHELL_FDS[STDERR_FILENO], buffer, res);
+    if (buffer != local) free(buffer);
+
+    return res;
+}
+
+
+/**
+ * @see strerror, sink_error
+ */
+void sink_perror(const char *const message) {
+    const char *const error = strerror(errno);
+    if (message && message[0] != '\0') sink_error("%s: %s\n", message, error);
+    else                               sink_error("%s\n", error);
+}
+
+
+void source_init_fd(source_t *const source, const int fd) {
+    source->type = SOURCE_FD;
+    source->fd = fd;
+    source->ring = NULL;
+    source->block = NULL;
+    source->length = source->offset = 0;
+}
+
+
+void source_init_ring(source_t *const source, ring_t *const ring) {
+    source->type = SOURCE_RING;
+    source->fd = -1;
+    source->ring = ring;
+    source->block = NULL;
+    source->length = source->offset = 0;
+}
+
+
+/**
+ * @see ring_release, ring_close_reader
+ */
+void source_close(source_t *const source) {
+    if (source->type != SOURCE_RING) return;
+
+    if (source->block) ring_release(source->ring);
+    source->block = NULL;
+    ring_close_reader(source->ring);
+}
+
+
+/**
+ * @see read, stats_add, ring_release, ring_peek, memcpy
+ */
+ssize_t source_read(char *const buffer, const size_t length) {
+    ssize_t res;
+
+    // Default input is stdin, or the one given by an embedding context
+    if (SOURCE_IN == NULL || SOURCE_IN->type == SOURCE_FD) {
+        const int fd = SOURCE_IN == NULL ? SHELL_FDS[STDIN_FILENO] : SOURCE_IN->fd;
+        do {
+            res = read(fd, buffer, length);
+            stats_add(STAT_BUILTIN_SYSCALLS, 1);
+        } while (res == -1 && errno == EINTR);
+        if (res > 0) stats_add(STAT_BUILTIN_BYTES_READ, res);
+        return res;
+    }
+
+    source_t *const source = SOURCE_IN;
+
+    // Go to the next block when the current one is fully read
+    if (source->block && source->offset == source->length) {
+        ring_release(source->ring);
+        source->block = NULL;
+    }
+    if (source->block == NULL) {
+        source->block = ring_peek(source->ring, &source->length);
+        source->offset = 0;
+        if (source->block == NULL) return 0;
+    }
+
+    // Copy what is left in the block
+    size_t chunk = source->length - source->offset;
+    if (chunk > length) chunk = length;
+    memcpy(buffer, &source->block[source->offset], chunk);
+    source->offset += chunk;
+    stats_add(STAT_BUILTIN_BYTES_READ, chunk);
+
+    return chunk;
+}
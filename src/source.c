@@ -0,0 +1,438 @@
+// CShell Project - New source and . commands, with a cache of compiled scripts on disk
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "source.h"
+#include "main.h"
+#include "arena.h"
+#include "parser.h"
+#include "hash.h"
+#include "variables.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+
+// Number of files being sourced inside each other
+static int _source_DEPTH = 0;
+
+// Padding of the path inside cached files
+static const char _source_ZEROS[8] = { 0 };
+
+
+// Round a size up to a multiple of 8
+#define _SOURCE_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+
+/**
+ * @see var_get, snprintf, mkdir, _hash_string
+ */
+int _source_cache_path(const char *const real_path, char *const cache_path) {
+    char dir[MAX_PATH_LENGTH];
+    const char *const base = var_get("XDG_CACHE_HOME");
+    if (base && *base) snprintf(dir, MAX_PATH_LENGTH, "%s/%s", base, SOURCE_CACHE_DIRECTORY);
+    else {
+        const char *const home = var_get("HOME");
+        if (!home || !(*home)) return -1;
+        snprintf(dir, MAX_PATH_LENGTH, "%s/.cache", home);
+        mkdir(dir, 0700);
+        snprintf(dir, MAX_PATH_LENGTH, "%s/.cache/%s", home, SOURCE_CACHE_DIRECTORY);
+    }
+    if (mkdir(dir, 0700) == -1 && errno != EEXIST) return -1;
+
+    // A truncated path could be the cached file of another script
+    return snprintf(cache_path, MAX_PATH_LENGTH, "%s/%016lx.plan", dir, _hash_string(real_path)) < MAX_PATH_LENGTH ? 0 : -1;
+}
+
+
+/**
+ * @see open, fstat, close, mmap, memcmp, strncmp, strlen, munmap
+ */
+int _source_load(const char *const cache_path, const char *const real_path, const struct stat *const st, void **const map, size_t *const map_size, node_t **const root) {
+    const int fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+
+    struct stat cache_st;
+    if (fstat(fd, &cache_st) == -1 || (size_t)cache_st.st_size < sizeof(source_cache_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    // Private mapping, pages are only copied where pointers are written back
+    const size_t size = cache_st.st_size;
+    char *const data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+
+    // The cached tree must come from the same script, unchanged, written by the same shell
+    const source_cache_header_t *const header = (const source_cache_header_t *)data;
+    const size_t path_length = strlen(real_path);
+    const size_t image_offset = sizeof(source_cache_header_t) + _SOURCE_ALIGN(path_length);
+    int valid = memcmp(header->magic, SOURCE_CACHE_MAGIC, sizeof(SOURCE_CACHE_MAGIC)) == 0
+        && strncmp(header->version, CSHELL_VERSION, sizeof(header->version)) == 0
+        && header->format == SOURCE_CACHE_FORMAT
+        && header->node_size == sizeof(node_t)
+        && header->size == (long long)st->st_size
+        && header->mtime_sec == (long long)st->st_mtim.tv_sec
+        && header->mtime_nsec == (long long)st->st_mtim.tv_nsec
+        && header->path_length == path_length
+        && size >= image_offset
+        && memcmp(data + sizeof(source_cache_header_t), real_path, path_length) == 0
+        && header->image_size <= size - image_offset
+        && header->relocation_count == (size - image_offset - header->image_size) / sizeof(size_t)
+        && image_offset + header->image_size + header->relocation_count * sizeof(size_t) == size
+        && header->root <= header->image_size;
+
+    // Turn the offsets back into addresses, each one checked to stay inside the image
+    char *const image = data + image_offset;
+    const size_t *const relocations = (const size_t *)(image + (valid ? header->image_size : 0));
+    for (size_t i = 0; valid && i < header->relocation_count; i++) {
+        const size_t at = relocations[i];
+        if (at % sizeof(char *) != 0 || at + sizeof(char *) > header->image_size) {
+            valid = 0;
+            break;
+        }
+        char **const pointer = (char **)(image + at);
+        const uintptr_t target = (uintptr_t)*pointer;
+        if (target >= header->image_size) valid = 0;
+        else *pointer = image + target;
+    }
+
+    if (!valid) {
+        munmap(data, size);
+        return -1;
+    }
+
+    *map = data;
+    *map_size = size;
+    *root = header->root ? (node_t *)(image + header->root - 1) : NULL;
+    return 0;
+}
+
+
+/**
+ * @see realloc, memcpy, memset
+ */
+size_t _source_put(source_image_t *const image, const void *const data, const size_t size) {
+    if (image->failed) return 0;
+
+    const size_t offset = image->size;
+    const size_t aligned = _SOURCE_ALIGN(size);
+    if (offset + aligned > image->capacity) {
+        size_t capacity = image->capacity ? 2 * image->capacity : 4096;
+        while (offset + aligned > capacity) capacity *= 2;
+        char *const bigger = realloc(image->data, capacity);
+        if (!bigger) {
+            image->failed = 1;
+            return 0;
+        }
+        image->data = bigger;
+        image->capacity = capacity;
+    }
+
+    if (data) memcpy(&image->data[offset], data, size);
+    else memset(&image->data[offset], 0, size);
+    memset(&image->data[offset + size], 0, aligned - size);
+    image->size += aligned;
+
+    return offset;
+}
+
+
+/**
+ * @see realloc, memcpy
+ */
+void _source_set_pointer(source_image_t *const image, const size_t at, const size_t target) {
+    if (image->failed) return;
+
+    if (image->count == image->relocations_capacity) {
+        const size_t capacity = image->relocations_capacity ? 2 * image->relocations_capacity : 256;
+        size_t *const bigger = realloc(image->relocations, capacity * sizeof(size_t));
+        if (!bigger) {
+            image->failed = 1;
+            return;
+        }
+        image->relocations = bigger;
+        image->relocations_capacity = capacity;
+    }
+
+    // The offset takes the place of the address until the image is loaded
+    const uintptr_t value = target;
+    memcpy(&image->data[at], &value, sizeof(value));
+    image->relocations[image->count++] = at;
+}
+
+
+/**
+ * @see _source_put, strlen, _source_set_pointer
+ */
+void _source_put_string(source_image_t *const image, const size_t at, const char *const str) {
+    if (!str) return;
+    const size_t offset = _source_put(image, str, strlen(str) + 1);
+    _source_set_pointer(image, at, offset);
+}
+
+
+/**
+ * @see _source_put, _source_set_pointer, _source_put_string, memcpy
+ */
+size_t _source_put_node(source_image_t *const image, const node_t *const node) {
+    // Pointers are written after what they point to is added, the image may move meanwhile
+    node_t copy = *node;
+    copy.words = NULL;
+    copy.name = NULL;
+    copy.redirects = NULL;
+    copy.children = NULL;
+    const size_t offset = _source_put(image, &copy, sizeof(node_t));
+
+    if (node->words) {
+        const size_t words = _source_put(image, NULL, (node->argc + 1) * sizeof(char *));
+        _source_set_pointer(image, offset + offsetof(node_t, words), words);
+        for (int i = 0; i < node->argc; i++) _source_put_string(image, words + i * sizeof(char *), node->words[i]);
+    }
+    _source_put_string(image, offset + offsetof(node_t, name), node->name);
+
+    if (node->redirects) {
+        const size_t redirects = _source_put(image, NULL, node->redirect_count * sizeof(redirect_t));
+        _source_set_pointer(image, offset + offsetof(node_t, redirects), redirects);
+        for (int i = 0; i < node->redirect_count && !image->failed; i++) {
+            redirect_t redirect = node->redirects[i];
+            redirect.word = NULL;
+            memcpy(&image->data[redirects + i * sizeof(redirect_t)], &redirect, sizeof(redirect_t));
+            _source_put_string(image, redirects + i * sizeof(redirect_t) + offsetof(redirect_t, word), node->redirects[i].word);
+        }
+    }
+
+    if (node->children) {
+        const size_t children = _source_put(image, NULL, node->count * sizeof(node_t *));
+        _source_set_pointer(image, offset + offsetof(node_t, children), children);
+        for (int i = 0; i < node->count; i++) {
+            const size_t child = _source_put_node(image, node->children[i]);
+            _source_set_pointer(image, children + i * sizeof(node_t *), child);
+        }
+    }
+
+    return offset;
+}
+
+
+/**
+ * @see _source_put_node, memset, memcpy, strncpy, strlen, snprintf, getpid, open, writev, close, rename, unlink, free
+ */
+int _source_store(const char *const cache_path, const char *const real_path, const struct stat *const st, const node_t *const root) {
+    source_image_t image = { NULL, 0, 0, NULL, 0, 0, 0 };
+    const size_t root_offset = root ? _source_put_node(&image, root) : 0;
+
+    int res = -1;
+    if (!image.failed) {
+        source_cache_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SOURCE_CACHE_MAGIC, sizeof(SOURCE_CACHE_MAGIC));
+        strncpy(header.version, CSHELL_VERSION, sizeof(header.version));
+        header.format = SOURCE_CACHE_FORMAT;
+        header.node_size = sizeof(node_t);
+        header.size = st->st_size;
+        header.mtime_sec = st->st_mtim.tv_sec;
+        header.mtime_nsec = st->st_mtim.tv_nsec;
+        header.path_length = strlen(real_path);
+        header.image_size = image.size;
+        header.relocation_count = image.count;
+        header.root = root ? root_offset + 1 : 0;
+
+        const struct iovec parts[] = {
+            { &header, sizeof(header) },
+            { (void *)real_path, header.path_length },
+            { (void *)_source_ZEROS, _SOURCE_ALIGN(header.path_length) - header.path_length },
+            { image.data, image.size },
+            { image.relocations, image.count * sizeof(size_t) },
+        };
+        const size_t total = sizeof(header) + _SOURCE_ALIGN(header.path_length) + image.size + image.count * sizeof(size_t);
+
+        // Other shells never see a half written file
+        char tmp_path[MAX_PATH_LENGTH + 32];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", cache_path, (int)getpid());
+        const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd != -1) {
+            const ssize_t written = writev(fd, parts, sizeof(parts) / sizeof(parts[0]));
+            close(fd);
+            if (written == (ssize_t)total && rename(tmp_path, cache_path) == 0) res = 0;
+            else unlink(tmp_path);
+        }
+    }
+
+    free(image.data);
+    free(image.relocations);
+    return res;
+}
+
+
+/**
+ * @see malloc, realloc, read, sink_perror, free, lex_line, sink_error, parse_tokens
+ */
+int _source_parse(const int fd, const char *const path, const size_t size, arena_t *const arena, node_t **const root) {
+    // The whole file is parsed at once, as a list of commands separated by new lines
+    size_t capacity = size + 1, length = 0;
+    char *text = malloc(capacity);
+    if (!text) {
+        sink_perror("malloc");
+        return 1;
+    }
+
+    ssize_t res;
+    while (1) {
+        if (length + 1 == capacity) {
+            char *const bigger = realloc(text, 2 * capacity);
+            if (!bigger) {
+                free(text);
+                sink_perror("malloc");
+                return 1;
+            }
+            text = bigger;
+            capacity *= 2;
+        }
+        do res = read(fd, &text[length], capacity - length - 1);
+        while (res == -1 && errno == EINTR);
+        if (res <= 0) break;
+        length += res;
+    }
+    if (res == -1) {
+        sink_perror(path);
+        free(text);
+        return 1;
+    }
+    text[length] = '\0';
+
+    int count, incomplete = 0;
+    const token_t *const tokens = lex_line(arena, text, &count, &incomplete);
+    free(text);
+    if (!tokens) {
+        sink_perror("malloc");
+        return 1;
+    }
+    if (incomplete || parse_tokens(arena, tokens, root, &incomplete) == -1) {
+        if (incomplete) sink_error("%s: syntax error: unexpected end of file\n", path);
+        return 2;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @see sink_error, openat, sink_perror, fstat, snprintf, realpath, _source_cache_path, arena_init, _source_load, _source_parse, _source_store, close, execute_tree, munmap, arena_destroy
+ */
+int source_file(const char *const path) {
+    if (_source_DEPTH >= SOURCE_MAX_DEPTH) {
+        sink_error("%s: maximum source depth exceeded\n", path);
+        return 1;
+    }
+
+    const int fd = openat(CWD_FD, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        sink_perror(path);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        sink_error("%s: not a regular file\n", path);
+        close(fd);
+        return 1;
+    }
+
+    // The cache is skipped if the real path is unknown or if there is no directory for it
+    // A relative path of an embedding context starts from its directory, not from the one of the process
+    char full_path[MAX_PATH_LENGTH];
+    char real_path[PATH_MAX];
+    char cache_path[MAX_PATH_LENGTH];
+    const int relative = path[0] != '/' && CWD_FD != AT_FDCWD;
+    const int named = !relative || snprintf(full_path, sizeof(full_path), "%s/%s", CWD, path) < (int)sizeof(full_path);
+    const int cached = SOURCE_CACHE && named && realpath(relative ? full_path : path, real_path) && _source_cache_path(real_path, cache_path) == 0;
+
+    arena_t arena;
+    arena_init(&arena, SOURCE_ARENA_CHUNK_SIZE);
+    void *map = NULL;
+    size_t map_size = 0;
+    node_t *root = NULL;
+    int return_code = 0;
+    if (!cached || _source_load(cache_path, real_path, &st, &map, &map_size, &root) == -1) {
+        return_code = _source_parse(fd, path, st.st_size, &arena, &root);
+        if (return_code == 0 && cached) _source_store(cache_path, real_path, &st, root);
+    }
+    close(fd);
+
+    if (return_code == 0 && root) {
+        _source_DEPTH++;
+        return_code = execute_tree(root);
+        _source_DEPTH--;
+    }
+
+    if (map) munmap(map, map_size);
+    arena_destroy(&arena);
+    return return_code;
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _source_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] file\n", program_name);
+    sink_printf("Run the commands of file inside the current shell\n");
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+}
+
+
+/**
+ * @see strcmp, _source_print_usage, sink_error, source_file
+ */
+int our_source(const int argc, const char *const *const argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        _source_print_usage(argv[0]);
+        return 0;
+    }
+    if (argc != 2) {
+        sink_error("%s: %s\n", argv[0], argc < 2 ? "file argument required" : "too many arguments");
+        _source_print_usage(argv[0]);
+        return 2;
+    }
+
+    return source_file(argv[1]);
+}
+
+
+/**
+ * @see our_source
+ */
+int our_dot(const int argc, const char *const *const argv) {
+    return our_source(argc, argv);
+}
+
+
+REGISTER_BUILTIN("source", our_source, 0);
+REGISTER_BUILTIN(".", our_dot, 0);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_source(argc, argv);
+}
+#endif
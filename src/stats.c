@@ -0,0 +1,198 @@
+// CShell Project - Counters of the work done by the shell, and new shellstats command
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "stats.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+
+// Names and descriptions of the counters, in the order of stat_t
+static const char *const _stats_NAMES[STAT_COUNT] = {
+    "lines", "plan_hits", "plan_misses", "parse_allocations", "forks", "execs", "threads", "memfd_bytes",
+    "terminal_redraws", "builtin_calls", "builtin_syscalls", "builtin_bytes_written", "builtin_bytes_read",
+    "files_copied", "bytes_copied", "files_removed",
+};
+static const char *const _stats_DESCRIPTIONS[STAT_COUNT] = {
+    "command lines run", "lines found compiled in the plan cache", "lines lexed and parsed",
+    "arena allocations to lex and parse", "copies of the shell forked", "external commands started",
+    "threads of fused pipelines", "bytes copied between buffered commands", "prompts drawn again",
+    "builtins run", "read and write calls of builtins", "bytes written by builtins", "bytes read by builtins",
+    "files copied by cp", "bytes copied by cp", "files and directories removed by rm",
+};
+
+// Block of the current thread, NULL until its first count
+static __thread stats_block_t *_stats_LOCAL = NULL;
+// Blocks of running threads, counters of ended threads, and totals at the last reset, under the lock
+static stats_block_t *_stats_BLOCKS = NULL;
+static unsigned long long _stats_RETIRED[STAT_COUNT] = { 0 };
+static unsigned long long _stats_BASE[STAT_COUNT] = { 0 };
+static pthread_mutex_t _stats_LOCK = PTHREAD_MUTEX_INITIALIZER;
+// Key whose destructor retires the block of a thread when it ends
+static pthread_key_t _stats_KEY;
+static pthread_once_t _stats_KEY_ONCE = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @see pthread_key_create
+ */
+void _stats_create_key() {
+    pthread_key_create(&_stats_KEY, _stats_retire);
+}
+
+
+/**
+ * @see pthread_once, calloc, pthread_mutex_lock, pthread_mutex_unlock, pthread_setspecific
+ */
+stats_block_t *_stats_register() {
+    pthread_once(&_stats_KEY_ONCE, _stats_create_key);
+
+    stats_block_t *const block = calloc(1, sizeof(stats_block_t));
+    if (!block) return NULL;
+
+    pthread_mutex_lock(&_stats_LOCK);
+    block->next = _stats_BLOCKS;
+    _stats_BLOCKS = block;
+    pthread_mutex_unlock(&_stats_LOCK);
+
+    pthread_setspecific(_stats_KEY, block);
+    _stats_LOCAL = block;
+    return block;
+}
+
+
+/**
+ * @see pthread_mutex_lock, pthread_mutex_unlock, free
+ */
+void _stats_retire(void *block) {
+    stats_block_t *const retired = block;
+
+    pthread_mutex_lock(&_stats_LOCK);
+    for (int i = 0; i < STAT_COUNT; i++) _stats_RETIRED[i] += retired->counters[i];
+    for (stats_block_t **link = &_stats_BLOCKS; *link; link = &(*link)->next) {
+        if (*link != retired) continue;
+        *link = retired->next;
+        break;
+    }
+    pthread_mutex_unlock(&_stats_LOCK);
+
+    free(retired);
+}
+
+
+/**
+ * @see _stats_register, __atomic_store_n
+ */
+void stats_add(const stat_t stat, const unsigned long long value) {
+    stats_block_t *const block = _stats_LOCAL ? _stats_LOCAL : _stats_register();
+    if (!block) return;
+
+    // Only this thread writes its counter, readers only need to see whole values
+    __atomic_store_n(&block->counters[stat], block->counters[stat] + value, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @see __atomic_load_n
+ */
+void _stats_sum(unsigned long long *const totals) {
+    for (int i = 0; i < STAT_COUNT; i++) totals[i] = _stats_RETIRED[i] - _stats_BASE[i];
+    for (const stats_block_t *block = _stats_BLOCKS; block; block = block->next) {
+        for (int i = 0; i < STAT_COUNT; i++) totals[i] += __atomic_load_n(&block->counters[i], __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * @see pthread_mutex_lock, _stats_sum, pthread_mutex_unlock
+ */
+unsigned long long stats_get(const stat_t stat) {
+    unsigned long long totals[STAT_COUNT];
+    pthread_mutex_lock(&_stats_LOCK);
+    _stats_sum(totals);
+    pthread_mutex_unlock(&_stats_LOCK);
+    return totals[stat];
+}
+
+
+/**
+ * @see pthread_mutex_lock, _stats_sum, pthread_mutex_unlock
+ */
+void stats_reset() {
+    // Counters of other threads are never written from here, the current totals become the new origin
+    unsigned long long totals[STAT_COUNT];
+    pthread_mutex_lock(&_stats_LOCK);
+    _stats_sum(totals);
+    for (int i = 0; i < STAT_COUNT; i++) _stats_BASE[i] += totals[i];
+    pthread_mutex_unlock(&_stats_LOCK);
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _stats_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options]\n", program_name);
+    sink_printf("Print the counters of the work done by this shell (forked copies count on their own)\n");
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help     Print this help message\n");
+    sink_printf("    -j | --json     Print the counters as a JSON object on one line\n");
+    sink_printf("    -r | --reset    Start every counter again from 0 after printing them\n");
+}
+
+
+/**
+ * @see strcmp, _stats_print_usage, sink_error, pthread_mutex_lock, _stats_sum, pthread_mutex_unlock, sink_printf, stats_reset
+ */
+int our_shellstats(const int argc, const char *const *const argv) {
+    int json = 0, reset = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            _stats_print_usage(argv[0]);
+            return 0;
+        }
+        if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--json") == 0) json = 1;
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--reset") == 0) reset = 1;
+        else {
+            sink_error("%s: invalid option: %s\n", argv[0], argv[i]);
+            _stats_print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    unsigned long long totals[STAT_COUNT];
+    pthread_mutex_lock(&_stats_LOCK);
+    _stats_sum(totals);
+    pthread_mutex_unlock(&_stats_LOCK);
+
+    if (json) {
+        for (int i = 0; i < STAT_COUNT; i++) sink_printf("%s\"%s\": %llu", i ? ", " : "{", _stats_NAMES[i], totals[i]);
+        sink_printf("}\n");
+    }
+    else for (int i = 0; i < STAT_COUNT; i++) sink_printf("%-22s %14llu  %s\n", _stats_NAMES[i], totals[i], _stats_DESCRIPTIONS[i]);
+
+    if (reset) stats_reset();
+
+    return 0;
+}
+
+
+REGISTER_BUILTIN("shellstats", our_shellstats, BUILTIN_FUSABLE);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_shellstats(argc, (const char *const *)argv);
+}
+#endif
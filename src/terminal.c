@@ -5,6 +5,8 @@
 
 #include "config.h"
 #include "terminal.h"
+#include "jobs.h"
+#include "stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <termios.h>
@@ -21,6 +23,11 @@ static int CUR_LINE_LENGTH = 0;
 static int CUR_DESC = 0;
 // Position in history
 static int HISTORY_INDEX = -1;
+// Settings of the terminal before raw mode
+static struct termios ORIGINAL_TERMIOS;
+static int HAS_ORIGINAL_TERMIOS = 0;
+// Set while reading the next line of an incomplete command, the prompt is "> "
+static int CONTINUATION = 0;
 
 
 /**
@@ -29,7 +36,11 @@ static int HISTORY_INDEX = -1;
 void enable_raw_mode() {
     // Make a copy of the current settings to modify
     struct termios raw;
-    tcgetattr(STDIN_FILENO, &raw);
+    if (tcgetattr(STDIN_FILENO, &raw) == -1) return;
+    if (!HAS_ORIGINAL_TERMIOS) {
+        ORIGINAL_TERMIOS = raw;
+        HAS_ORIGINAL_TERMIOS = 1;
+    }
 
     // Disable echoing and canonical mode
     raw.c_lflag &= ~(ECHO | ICANON);
@@ -43,11 +54,26 @@ void enable_raw_mode() {
 
 
 /**
- * @see read, memmove, strncpy, strlen, memset, write, getuid, getpwuid, sizeof, malloc, snprintf
+ * @see tcsetattr
+ */
+void disable_raw_mode() {
+    // Jobs in foreground get the terminal as it was before the shell
+    if (HAS_ORIGINAL_TERMIOS) tcsetattr(STDIN_FILENO, TCSADRAIN, &ORIGINAL_TERMIOS);
+}
+
+
+void terminal_continue_line(const int enabled) {
+    CONTINUATION = enabled;
+}
+
+
+/**
+ * @see jobs_poll_input, read, memmove, strncpy, strlen, memset, write, stats_add, getuid, getpwuid, sizeof, malloc, snprintf
  */
 int our_terminal() {
     // get the next character from stdin
     char c;
+    jobs_poll_input(STDIN_FILENO);
     read(STDIN_FILENO, &c, 1);
 
     // Erase character in line at descriptor position
@@ -157,13 +183,18 @@ int our_terminal() {
     // Length of the string (with invisible characters)
     int prompt_size = prompt_length + 30;
 
-    // Create basic string for terminal
+    // Create basic string for terminal, a command going on over several lines only shows "> "
     char *prompt = malloc((prompt_size + 1) * sizeof(char));
-    snprintf(prompt, prompt_size, "\033[32m%s\033[37m@\033[32mCShell\033[37m:\033[34m%s\033[0m > ", user, CWD);
+    if (CONTINUATION) {
+        snprintf(prompt, prompt_size, "> ");
+        prompt_length = 2;
+    }
+    else snprintf(prompt, prompt_size, "\033[32m%s\033[37m@\033[32mCShell\033[37m:\033[34m%s\033[0m > ", user, CWD);
     prompt[prompt_size + 1] = '\0';
 
     // display basic string and replace previous
     write(STDOUT_FILENO, "\r\033[K", 4);
+    stats_add(STAT_TERMINAL_REDRAWS, 1);
     write(STDOUT_FILENO, prompt, strlen(prompt));
     free(prompt);
 
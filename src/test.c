@@ -0,0 +1,261 @@
+// CShell Project - New test and [ commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#define _GNU_SOURCE
+#include "config.h"
+#include "test.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+// Binary operators, string comparisons then integer comparisons then file comparisons
+static const char *const _TEST_BINARY[] = { "=", "==", "!=", "<", ">", "-eq", "-ne", "-lt", "-le", "-gt", "-ge", "-nt", "-ot", "-ef", NULL };
+
+
+/**
+ * @see strchr
+ */
+int _test_is_unary(const char *const op) {
+    return op[0] == '-' && op[1] && !op[2] && strchr("bcdefgGhkLnOprsStuwxz", op[1]) != NULL;
+}
+
+
+/**
+ * @see strcmp
+ */
+int _test_is_binary(const char *const op) {
+    for (int k = 0; _TEST_BINARY[k]; k++) if (strcmp(op, _TEST_BINARY[k]) == 0) return 1;
+    return 0;
+}
+
+
+/**
+ * @see faccessat, isatty, atoi, statx, geteuid, getegid
+ */
+int _test_unary(const char op, const char *const arg) {
+    switch (op) {
+        // Strings
+        case 'z': return arg[0] != '\0';
+        case 'n': return arg[0] == '\0';
+
+        // File descriptors
+        case 't': return !isatty(atoi(arg));
+
+        // Permissions are asked to the kernel, which knows about ACLs and read-only file systems
+        case 'r': return faccessat(CWD_FD, arg, R_OK, AT_EACCESS) != 0;
+        case 'w': return faccessat(CWD_FD, arg, W_OK, AT_EACCESS) != 0;
+        case 'x': return faccessat(CWD_FD, arg, X_OK, AT_EACCESS) != 0;
+    }
+
+    // Every other test needs a single statx, asking only for the fields it reads
+    unsigned int mask = STATX_TYPE | STATX_MODE;
+    if (op == 's') mask |= STATX_SIZE;
+    if (op == 'O') mask |= STATX_UID;
+    if (op == 'G') mask |= STATX_GID;
+    struct statx st;
+    if (statx(CWD_FD, arg, (op == 'L' || op == 'h') ? AT_SYMLINK_NOFOLLOW : 0, mask, &st) == -1) return 1;
+
+    switch (op) {
+        case 'e': return 0;
+        case 'f': return !S_ISREG(st.stx_mode);
+        case 'd': return !S_ISDIR(st.stx_mode);
+        case 'b': return !S_ISBLK(st.stx_mode);
+        case 'c': return !S_ISCHR(st.stx_mode);
+        case 'p': return !S_ISFIFO(st.stx_mode);
+        case 'S': return !S_ISSOCK(st.stx_mode);
+        case 'h':
+        case 'L': return !S_ISLNK(st.stx_mode);
+        case 's': return st.stx_size == 0;
+        case 'g': return !(st.stx_mode & S_ISGID);
+        case 'u': return !(st.stx_mode & S_ISUID);
+        case 'k': return !(st.stx_mode & S_ISVTX);
+        case 'O': return st.stx_uid != geteuid();
+        case 'G': return st.stx_gid != getegid();
+    }
+
+    return 2;
+}
+
+
+/**
+ * @see strtoll, isspace, sink_error
+ */
+int _test_integer(const char *const arg, long long *const value) {
+    char *end;
+    *value = strtoll(arg, &end, 10);
+    while (isspace((unsigned char)*end)) end++;
+    if (end == arg || *end) {
+        sink_error("test: %s: integer expression expected\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @see strcmp, _test_integer, statx
+ */
+int _test_binary(const char *const left, const char *const op, const char *const right) {
+    // Strings
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) return strcmp(left, right) != 0;
+    if (strcmp(op, "!=") == 0) return strcmp(left, right) == 0;
+    if (strcmp(op, "<") == 0)  return strcmp(left, right) >= 0;
+    if (strcmp(op, ">") == 0)  return strcmp(left, right) <= 0;
+
+    // Integers
+    if (op[1] != 'n' && op[1] != 'o' && !(op[1] == 'e' && op[2] == 'f')) {
+        long long a, b;
+        if (_test_integer(left, &a) == -1 || _test_integer(right, &b) == -1) return 2;
+        if (strcmp(op, "-eq") == 0) return !(a == b);
+        if (strcmp(op, "-ne") == 0) return !(a != b);
+        if (strcmp(op, "-lt") == 0) return !(a < b);
+        if (strcmp(op, "-le") == 0) return !(a <= b);
+        if (strcmp(op, "-gt") == 0) return !(a > b);
+        if (strcmp(op, "-ge") == 0) return !(a >= b);
+        return 2;
+    }
+
+    // Files, a single statx each
+    struct statx a, b;
+    const int has_a = statx(CWD_FD, left, 0, STATX_MTIME | STATX_INO, &a) == 0;
+    const int has_b = statx(CWD_FD, right, 0, STATX_MTIME | STATX_INO, &b) == 0;
+    const int newer = has_a && has_b && (a.stx_mtime.tv_sec > b.stx_mtime.tv_sec || (a.stx_mtime.tv_sec == b.stx_mtime.tv_sec && a.stx_mtime.tv_nsec > b.stx_mtime.tv_nsec));
+    const int older = has_a && has_b && (a.stx_mtime.tv_sec < b.stx_mtime.tv_sec || (a.stx_mtime.tv_sec == b.stx_mtime.tv_sec && a.stx_mtime.tv_nsec < b.stx_mtime.tv_nsec));
+    if (strcmp(op, "-nt") == 0) return !((has_a && !has_b) || newer);
+    if (strcmp(op, "-ot") == 0) return !((!has_a && has_b) || older);
+    return !(has_a && has_b && a.stx_ino == b.stx_ino && a.stx_dev_major == b.stx_dev_major && a.stx_dev_minor == b.stx_dev_minor);
+}
+
+
+/**
+ * @see strcmp, _test_or, _test_is_binary, _test_binary, _test_is_unary, _test_unary
+ */
+int _test_primary(const char *const *const argv, const int count, int *const i) {
+    if (*i >= count) return 2;
+    const char *const arg = argv[*i];
+
+    // arg op arg, checked first so that "-n = x" compares strings
+    if (*i + 2 < count && _test_is_binary(argv[*i + 1])) {
+        *i += 3;
+        return _test_binary(arg, argv[*i - 2], argv[*i - 1]);
+    }
+
+    // op arg
+    if (_test_is_unary(arg) && *i + 1 < count) {
+        *i += 2;
+        return _test_unary(arg[1], argv[*i - 1]);
+    }
+
+    // ( expression )
+    if (strcmp(arg, "(") == 0 && *i + 1 < count) {
+        (*i)++;
+        const int result = _test_or(argv, count, i);
+        if (*i >= count || strcmp(argv[*i], ")") != 0) return 2;
+        (*i)++;
+        return result;
+    }
+
+    // A single string is true if not empty
+    (*i)++;
+    return arg[0] == '\0';
+}
+
+
+/**
+ * @see strcmp, _test_primary
+ */
+int _test_not(const char *const *const argv, const int count, int *const i) {
+    if (*i < count && strcmp(argv[*i], "!") == 0 && *i + 1 < count) {
+        (*i)++;
+        const int result = _test_not(argv, count, i);
+        return result == 2 ? 2 : !result;
+    }
+    return _test_primary(argv, count, i);
+}
+
+
+/**
+ * @see _test_not, strcmp
+ */
+int _test_and(const char *const *const argv, const int count, int *const i) {
+    int result = _test_not(argv, count, i);
+    while (result != 2 && *i < count && strcmp(argv[*i], "-a") == 0) {
+        (*i)++;
+        const int right = _test_not(argv, count, i);
+        result = right == 2 ? 2 : (result || right);
+    }
+    return result;
+}
+
+
+/**
+ * @see _test_and, strcmp
+ */
+int _test_or(const char *const *const argv, const int count, int *const i) {
+    int result = _test_and(argv, count, i);
+    while (result != 2 && *i < count && strcmp(argv[*i], "-o") == 0) {
+        (*i)++;
+        const int right = _test_and(argv, count, i);
+        result = right == 2 ? 2 : (result && right);
+    }
+    return result;
+}
+
+
+/**
+ * @see _test_or, sink_error
+ */
+int our_test(const int argc, const char *const *const argv) {
+    const int count = argc - 1;
+
+    // No expression is false
+    if (count == 0) return 1;
+
+    int i = 0;
+    const int result = _test_or(&argv[1], count, &i);
+    // Errors in integers are already reported
+    if (result != 2 && i != count) {
+        sink_error("%s: %s: unexpected argument\n", argv[0], argv[1 + i]);
+        return 2;
+    }
+
+    return result;
+}
+
+
+/**
+ * @see strcmp, sink_error, our_test
+ */
+int our_bracket(const int argc, const char *const *const argv) {
+    // Same as test, without the closing ]
+    if (argc < 2 || strcmp(argv[argc - 1], "]") != 0) {
+        sink_error("%s: missing `]'\n", argv[0]);
+        return 2;
+    }
+    return our_test(argc - 1, argv);
+}
+
+
+REGISTER_BUILTIN("test", our_test, BUILTIN_FUSABLE);
+REGISTER_BUILTIN("[", our_bracket, BUILTIN_FUSABLE);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_test(argc, argv);
+}
+#endif
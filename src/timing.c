@@ -0,0 +1,185 @@
+// CShell Project - Measures of the time keyword: wall clock time and resources of pipelines and of their stages
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#define _GNU_SOURCE
+#include "timing.h"
+#include "sink.h"
+#include <stdio.h>
+#include <string.h>
+
+
+// Measures waiting for the pipeline run by time, NULL once taken
+static timing_t *_timing_PENDING = NULL;
+
+
+/**
+ * @see getrusage
+ */
+void _timing_sample(struct rusage *const usage) {
+    struct rusage children;
+    getrusage(RUSAGE_SELF, usage);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    usage->ru_utime.tv_sec  += children.ru_utime.tv_sec;
+    usage->ru_utime.tv_usec += children.ru_utime.tv_usec;
+    usage->ru_stime.tv_sec  += children.ru_stime.tv_sec;
+    usage->ru_stime.tv_usec += children.ru_stime.tv_usec;
+    if (children.ru_maxrss > usage->ru_maxrss) usage->ru_maxrss = children.ru_maxrss;
+    usage->ru_minflt += children.ru_minflt;
+    usage->ru_majflt += children.ru_majflt;
+    usage->ru_nvcsw  += children.ru_nvcsw;
+    usage->ru_nivcsw += children.ru_nivcsw;
+}
+
+
+void _timing_subtract(struct rusage *const result, const struct rusage *const after, const struct rusage *const before) {
+    // Microseconds may go above a second after _timing_sample, only the total matters
+    const long long user = (after->ru_utime.tv_sec - before->ru_utime.tv_sec) * 1000000LL + after->ru_utime.tv_usec - before->ru_utime.tv_usec;
+    const long long sys  = (after->ru_stime.tv_sec - before->ru_stime.tv_sec) * 1000000LL + after->ru_stime.tv_usec - before->ru_stime.tv_usec;
+
+    memset(result, 0, sizeof(struct rusage));
+    result->ru_utime.tv_sec  = user / 1000000;
+    result->ru_utime.tv_usec = user % 1000000;
+    result->ru_stime.tv_sec  = sys / 1000000;
+    result->ru_stime.tv_usec = sys % 1000000;
+    result->ru_maxrss = after->ru_maxrss;
+    result->ru_minflt = after->ru_minflt - before->ru_minflt;
+    result->ru_majflt = after->ru_majflt - before->ru_majflt;
+    result->ru_nvcsw  = after->ru_nvcsw - before->ru_nvcsw;
+    result->ru_nivcsw = after->ru_nivcsw - before->ru_nivcsw;
+}
+
+
+double _timing_seconds(const struct timespec *const start, const struct timespec *const end) {
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/**
+ * @see memset, _timing_sample, clock_gettime
+ */
+void timing_start(timing_t *const timing, const int pipeline) {
+    memset(timing, 0, sizeof(timing_t));
+    _timing_sample(&timing->usage);
+    clock_gettime(CLOCK_MONOTONIC, &timing->start);
+    _timing_PENDING = pipeline ? timing : NULL;
+}
+
+
+timing_t *timing_take() {
+    timing_t *const timing = _timing_PENDING;
+    _timing_PENDING = NULL;
+    return timing;
+}
+
+
+/**
+ * @see clock_gettime, _timing_sample, _timing_subtract
+ */
+void timing_stop(timing_t *const timing) {
+    _timing_PENDING = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &timing->end);
+
+    const struct rusage before = timing->usage;
+    struct rusage after;
+    _timing_sample(&after);
+    _timing_subtract(&timing->usage, &after, &before);
+
+    // The maximum of the children is the biggest child ever waited, the stages tell the one of this pipeline
+    long biggest = -1;
+    for (int i = 0; i < timing->count; i++) {
+        if (timing->stages[i].measured && timing->stages[i].usage.ru_maxrss > biggest) biggest = timing->stages[i].usage.ru_maxrss;
+    }
+    if (biggest != -1) timing->usage.ru_maxrss = biggest;
+}
+
+
+/**
+ * @see snprintf
+ */
+void timing_label(timing_stage_t *const stage, const int argc, char *const *const argv) {
+    int length = 0;
+    stage->label[0] = '\0';
+    for (int i = 0; i < argc && length < TIMING_LABEL_LENGTH - 1; i++) {
+        const int written = snprintf(stage->label + length, TIMING_LABEL_LENGTH - length, i ? " %s" : "%s", argv[i]);
+        if (written < 0) break;
+        length += written;
+    }
+}
+
+
+/**
+ * @see clock_gettime
+ */
+void timing_end_process(timing_stage_t *const stage, const struct rusage *const usage) {
+    clock_gettime(CLOCK_MONOTONIC, &stage->end);
+    stage->usage = *usage;
+    stage->measured = 1;
+}
+
+
+/**
+ * @see clock_gettime, getrusage, _timing_subtract
+ */
+void timing_end_thread(timing_stage_t *const stage, const struct rusage *const before) {
+    clock_gettime(CLOCK_MONOTONIC, &stage->end);
+    struct rusage after;
+    getrusage(RUSAGE_THREAD, &after);
+    _timing_subtract(&stage->usage, &after, before);
+    stage->measured = 1;
+    stage->in_shell = 1;
+}
+
+
+/**
+ * @see clock_gettime, _timing_sample, _timing_subtract
+ */
+void timing_end_shell(timing_stage_t *const stage, const struct rusage *const before) {
+    clock_gettime(CLOCK_MONOTONIC, &stage->end);
+    struct rusage after;
+    _timing_sample(&after);
+    _timing_subtract(&stage->usage, &after, before);
+    stage->measured = 1;
+    stage->in_shell = 1;
+}
+
+
+/**
+ * @see sink_error, _timing_seconds
+ */
+void timing_print(const timing_t *const timing) {
+    const double real = _timing_seconds(&timing->start, &timing->end);
+    const struct rusage *const usage = &timing->usage;
+    const double user = usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6;
+    const double sys  = usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6;
+
+    // Same first lines as other shells
+    sink_error("\nreal\t%dm%.3fs\n", (int)(real / 60), real - 60 * (int)(real / 60));
+    sink_error("user\t%dm%.3fs\n", (int)(user / 60), user - 60 * (int)(user / 60));
+    sink_error("sys\t%dm%.3fs\n", (int)(sys / 60), sys - 60 * (int)(sys / 60));
+    sink_error("maxrss\t%ld KB\n", usage->ru_maxrss);
+    sink_error("ctxsw\t%ld voluntary, %ld involuntary\n", usage->ru_nvcsw, usage->ru_nivcsw);
+    sink_error("faults\t%ld major, %ld minor\n", usage->ru_majflt, usage->ru_minflt);
+    if (timing->count < 2) return;
+
+    // A line per stage, the slowest one is the bottleneck
+    sink_error("%5s %9s %9s %9s %10s %11s %15s  %s\n", "stage", "real", "user", "sys", "maxrss", "ctxsw v/i", "faults maj/min", "command");
+    for (int i = 0; i < timing->count; i++) {
+        const timing_stage_t *const stage = &timing->stages[i];
+        if (!stage->measured) {
+            sink_error("%5d %9s %9s %9s %10s %11s %15s  %s\n", i + 1, "-", "-", "-", "-", "-", "-", stage->label);
+            continue;
+        }
+
+        char switches[32], faults[32];
+        snprintf(switches, sizeof(switches), "%ld/%ld", stage->usage.ru_nvcsw, stage->usage.ru_nivcsw);
+        snprintf(faults, sizeof(faults), "%ld/%ld", stage->usage.ru_majflt, stage->usage.ru_minflt);
+        sink_error("%5d %8.3fs %8.3fs %8.3fs %7ld KB %11s %15s  %s%s\n", i + 1,
+                _timing_seconds(&timing->start, &stage->end),
+                stage->usage.ru_utime.tv_sec + stage->usage.ru_utime.tv_usec / 1e6,
+                stage->usage.ru_stime.tv_sec + stage->usage.ru_stime.tv_usec / 1e6,
+                stage->usage.ru_maxrss, switches, faults, stage->label, stage->in_shell ? " (in shell)" : "");
+    }
+}
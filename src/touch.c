@@ -3,7 +3,10 @@
 // Date: 2025-03-17
 
 
+#include "config.h"
 #include "touch.h"
+#include "sink.h"
+#include "builtin.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -15,34 +18,26 @@
 #include <errno.h>
 
 
-// Number of files to create
-static int _touch_files_count = 0;
-// List of files to create
-static char **_touch_files = NULL;
-
-
 /**
- * @see printf
+ * @see sink_printf
  */
 void _touch_print_usage(const char *const program_name) {
-    printf("Usage: %s [Options] file1 [file2 ...]\n", program_name);
-    printf("Options:\n");
-    printf("    -h | --help    Print this help message\n");
+    sink_printf("Usage: %s [Options] file1 [file2 ...]\n", program_name);
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
 }
 
 
 /**
- * @see perror, _touch_print_usage, sizeof, malloc, strcmp, strlen, strcpy
+ * @see sink_perror, _touch_print_usage, strcmp
  */
 int _touch_parse_arguments(const int argc, const char *const *const argv) {
     if (argc < 2) {
-        perror("Error: No file specified");
+        sink_perror("Error: No file specified");
         _touch_print_usage(argv[0]);
         return 1;
     }
 
-    _touch_files = malloc(argc * sizeof(char *));
-
     for (int i = 1; i < argc; i++) {
         // Check if the argument is -h or --help
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -50,11 +45,6 @@ int _touch_parse_arguments(const int argc, const char *const *const argv) {
             _touch_print_usage(argv[0]);
             return -1;
         }
-
-        // Add the file to the list
-        _touch_files[_touch_files_count] = malloc(strlen(argv[i]) + 1);
-        strcpy(_touch_files[_touch_files_count], argv[i]);
-        _touch_files_count++;
     }
 
     return 0;
@@ -62,48 +52,46 @@ int _touch_parse_arguments(const int argc, const char *const *const argv) {
 
 
 /**
- * @see free, _touch_parse_arguments, stat, utime, perror, printf, fopen, fclose
+ * @see _touch_parse_arguments, fstatat, utimensat, sink_perror, sink_printf, openat, close
  */
 int our_touch(const int argc, const char *const *const argv) {
-    // free memory
-    for (int i = 0; i < _touch_files_count; i++) free(_touch_files[i]);
-    free(_touch_files);
-    _touch_files = NULL;
-    _touch_files_count = 0;
-
     // Parse the arguments
     int parse_result = _touch_parse_arguments(argc, argv);
     if (parse_result == -1) return 0;
     if (parse_result) return parse_result;
 
-    // Create every files
+    // Create every files, straight from the arguments
     const char *filename;
     struct stat st;
-    for (int i = 0; i < _touch_files_count; i++) {
-        filename = _touch_files[i];
+    for (int i = 1; i < argc; i++) {
+        filename = argv[i];
 
-        if (stat(filename, &st) == 0) {
+        if (fstatat(CWD_FD, filename, &st, 0) == 0) {
             // File exists, update the timestamp
-            if (utime(filename, NULL) != 0) {
-                perror("Error: Unable to update timestamp");
+            if (utimensat(CWD_FD, filename, NULL, 0) != 0) {
+                sink_perror("Error: Unable to update timestamp");
                 return -1;
             }
-            printf("Updated timestamp for %s\n", filename);
+            sink_printf("Updated timestamp for %s\n", filename);
         }
         else {
             // File does not exist, create it
-            FILE *file = fopen(filename, "w");
-            if (file == NULL) {
-                perror("Error: Unable to create file");
+            const int file = openat(CWD_FD, filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            if (file == -1) {
+                sink_perror("Error: Unable to create file");
                 return -1;
             }
-            fclose(file);
+            close(file);
         }
     }
 
     return 0;
 }
 
+
+REGISTER_BUILTIN("touch", our_touch, 0);
+
+
 #ifdef TEST_MAIN
 /**
  * ONLY FOR TESTING ALONE
@@ -0,0 +1,177 @@
+// CShell Project - Timeline of the shell written as Chrome trace events (SHELL_TRACE=path), viewable in Perfetto
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#define _GNU_SOURCE
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+
+// Trace file shared by every process, opened in append mode so each write lands whole at the end
+static int _trace_FD = -1;
+// Buffer of the current thread, NULL until its first event
+static __thread trace_buffer_t *_trace_LOCAL = NULL;
+// Key whose destructor writes the events of a thread when it ends
+static pthread_key_t _trace_KEY;
+static pthread_once_t _trace_KEY_ONCE = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @see pthread_key_create
+ */
+void _trace_create_key() {
+    pthread_key_create(&_trace_KEY, _trace_release);
+}
+
+
+/**
+ * @see pthread_once, malloc, getpid, syscall, pthread_setspecific
+ */
+trace_buffer_t *_trace_register() {
+    pthread_once(&_trace_KEY_ONCE, _trace_create_key);
+
+    trace_buffer_t *const buffer = malloc(sizeof(trace_buffer_t));
+    if (!buffer) return NULL;
+    buffer->pid = getpid();
+    buffer->tid = syscall(SYS_gettid);
+    buffer->count = 0;
+
+    pthread_setspecific(_trace_KEY, buffer);
+    _trace_LOCAL = buffer;
+    return buffer;
+}
+
+
+/**
+ * @see snprintf
+ */
+size_t _trace_escape(char *const destination, const size_t size, const char *const source) {
+    size_t length = 0;
+    for (const unsigned char *c = (const unsigned char *)source; *c && length + 7 < size; c++) {
+        if (*c == '"' || *c == '\\') {
+            destination[length++] = '\\';
+            destination[length++] = *c;
+        }
+        else if (*c < 0x20) length += snprintf(destination + length, size - length, "\\u%04x", *c);
+        else destination[length++] = *c;
+    }
+    destination[length] = '\0';
+    return length;
+}
+
+
+/**
+ * @see _trace_escape, snprintf, write
+ */
+void _trace_write_buffer(trace_buffer_t *const buffer) {
+    // Whole events are written at once, events of other processes and threads never cut them
+    char chunk[TRACE_CHUNK_SIZE];
+    char detail[TRACE_DETAIL_LENGTH * 6 + 1];
+    size_t length = 0;
+
+    for (int i = 0; i <= buffer->count; i++) {
+        if (i == buffer->count || length > TRACE_CHUNK_SIZE - 2 * sizeof(detail)) {
+            size_t written = 0;
+            while (written < length) {
+                const ssize_t res = write(_trace_FD, chunk + written, length - written);
+                if (res == -1 && errno == EINTR) continue;
+                if (res <= 0) break;
+                written += res;
+            }
+            length = 0;
+        }
+        if (i == buffer->count) break;
+
+        const trace_event_t *const event = &buffer->events[i];
+        _trace_escape(detail, sizeof(detail), event->detail);
+        length += snprintf(chunk + length, TRACE_CHUNK_SIZE - length,
+                           "{\"name\":\"%s\",\"cat\":\"cshell\",\"ph\":\"%c\",\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d",
+                           event->name, event->phase, event->time / 1000, event->time % 1000, buffer->pid, buffer->tid);
+        if (detail[0] != '\0') length += snprintf(chunk + length, TRACE_CHUNK_SIZE - length, ",\"args\":{\"detail\":\"%s\"}", detail);
+        length += snprintf(chunk + length, TRACE_CHUNK_SIZE - length, "},\n");
+    }
+
+    buffer->count = 0;
+}
+
+
+/**
+ * @see _trace_write_buffer, free
+ */
+void _trace_release(void *buffer) {
+    _trace_write_buffer(buffer);
+    free(buffer);
+}
+
+
+/**
+ * @see getpid, syscall
+ */
+void _trace_forked() {
+    // Only the thread which forked exists in the copy
+    if (!_trace_LOCAL) return;
+    _trace_LOCAL->count = 0;
+    _trace_LOCAL->pid = getpid();
+    _trace_LOCAL->tid = syscall(SYS_gettid);
+}
+
+
+/**
+ * @see _trace_register, clock_gettime, strncpy, _trace_write_buffer
+ */
+void trace_event(const char phase, const char *const name, const char *const detail) {
+    trace_buffer_t *const buffer = _trace_LOCAL ? _trace_LOCAL : _trace_register();
+    if (!buffer) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    trace_event_t *const event = &buffer->events[buffer->count++];
+    event->name = name;
+    event->phase = phase;
+    event->time = now.tv_sec * 1000000000LL + now.tv_nsec;
+    if (detail) strncpy(event->detail, detail, TRACE_DETAIL_LENGTH - 1);
+    event->detail[detail ? TRACE_DETAIL_LENGTH - 1 : 0] = '\0';
+
+    // A full buffer is written by its own thread, no lock is ever taken
+    if (buffer->count == TRACE_BUFFER_EVENTS) _trace_write_buffer(buffer);
+}
+
+
+/**
+ * @see _trace_write_buffer
+ */
+void trace_flush() {
+    if (_trace_LOCAL && _trace_LOCAL->count > 0) _trace_write_buffer(_trace_LOCAL);
+}
+
+
+/**
+ * @see open, fcntl, close, write, pthread_atfork, atexit
+ */
+int trace_open(const char *const path) {
+    if (TRACE_ENABLED) return 0;
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) return -1;
+    _trace_FD = fcntl(fd, F_DUPFD_CLOEXEC, TRACE_FD_MIN);
+    close(fd);
+    if (_trace_FD == -1) return -1;
+
+    // JSON array format: the closing bracket is optional, processes still running may append after the shell
+    write(_trace_FD, "[\n", 2);
+
+    pthread_atfork(NULL, NULL, _trace_forked);
+    atexit(trace_flush);
+    TRACE_ENABLED = 1;
+    return 0;
+}
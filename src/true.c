@@ -0,0 +1,40 @@
+// CShell Project - New true and false commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "true.h"
+#include "builtin.h"
+
+
+int our_true(const int argc, const char *const *const argv) {
+    // Arguments are ignored
+    (void)argc;
+    (void)argv;
+    return 0;
+}
+
+
+int our_false(const int argc, const char *const *const argv) {
+    // Arguments are ignored
+    (void)argc;
+    (void)argv;
+    return 1;
+}
+
+
+REGISTER_BUILTIN("true", our_true, BUILTIN_FUSABLE);
+REGISTER_BUILTIN("false", our_false, BUILTIN_FUSABLE);
+
+
+#ifdef TEST_MAIN
+/**
+ * ONLY FOR TESTING ALONE
+ * DO NOT TOUCH
+ */
+int main(int argc, char *argv[]) {
+    // DO NOT TOUCH
+    return our_true(argc, argv);
+}
+#endif
@@ -0,0 +1,428 @@
+// CShell Project - Shell variables and new export, unset and readonly commands
+// Author: Maxime DAUPHIN, Andrew ZIADEH and Abbas ALDIRANI
+// Date: 2025-03-17
+
+
+#include "config.h"
+#include "variables.h"
+#include "arena.h"
+#include "hash.h"
+#include "sink.h"
+#include "builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+
+extern char **environ;
+
+// Variables of the shell, and the table in use (another one while an embedding context runs, see var_use)
+static var_table_t _var_MAIN = { NULL, 0, 0, { 0 }, NULL, 1 };
+static var_table_t *_var_CURRENT = &_var_MAIN;
+
+
+/**
+ * @see strcmp
+ */
+int _var_find_slot(const char *const name, const unsigned long hash) {
+    int i = hash & (_var_CURRENT->capacity - 1);
+    while (_var_CURRENT->entries[i].name && (_var_CURRENT->entries[i].hash != hash || strcmp(_var_CURRENT->entries[i].name, name) != 0)) i = (i + 1) & (_var_CURRENT->capacity - 1);
+    return i;
+}
+
+
+/**
+ * @see _hash_string, _var_find_slot, calloc, free, strdup
+ */
+var_entry_t *_var_entry(const char *const name) {
+    const unsigned long hash = _hash_string(name);
+
+    if (_var_CURRENT->entries) {
+        var_entry_t *const entry = &_var_CURRENT->entries[_var_find_slot(name, hash)];
+        if (entry->name) return entry;
+    }
+
+    // Allocate the table, or make it twice bigger when half full
+    if (_var_CURRENT->entries == NULL || 2 * (_var_CURRENT->count + 1) > _var_CURRENT->capacity) {
+        var_entry_t *const old_table = _var_CURRENT->entries;
+        const int old_capacity = _var_CURRENT->capacity;
+
+        _var_CURRENT->capacity = old_table ? 2 * old_capacity : VAR_INITIAL_CAPACITY;
+        _var_CURRENT->entries = calloc(_var_CURRENT->capacity, sizeof(var_entry_t));
+        if (!_var_CURRENT->entries) {
+            _var_CURRENT->entries = old_table;
+            _var_CURRENT->capacity = old_capacity;
+            return NULL;
+        }
+
+        for (int i = 0; i < old_capacity; i++) if (old_table[i].name) _var_CURRENT->entries[_var_find_slot(old_table[i].name, old_table[i].hash)] = old_table[i];
+        free(old_table);
+    }
+
+    // The name is interned for the life of the shell, the entry stays after unset
+    var_entry_t *const entry = &_var_CURRENT->entries[_var_find_slot(name, hash)];
+    entry->name = strdup(name);
+    if (!entry->name) return NULL;
+    entry->hash = hash;
+    _var_CURRENT->count++;
+
+    return entry;
+}
+
+
+/**
+ * @see arena_init, strchr, strndup, _var_entry, var_set, free
+ */
+void var_init() {
+    arena_init(&_var_CURRENT->env_arena, VAR_ENV_ARENA_CHUNK_SIZE);
+
+    for (char **env = environ; env && *env; env++) {
+        const char *const equal = strchr(*env, '=');
+        if (!equal || equal == *env) continue;
+
+        char *const name = strndup(*env, equal - *env);
+        if (!name) continue;
+        var_entry_t *const entry = _var_entry(name);
+        if (entry) {
+            entry->flags |= VAR_EXPORTED;
+            var_set(name, equal + 1);
+        }
+        free(name);
+    }
+
+    _var_CURRENT->env_dirty = 1;
+}
+
+
+var_table_t *var_use(var_table_t *const table) {
+    var_table_t *const previous = _var_CURRENT;
+    _var_CURRENT = table ? table : &_var_MAIN;
+    return previous;
+}
+
+
+/**
+ * @see free, arena_destroy, memset
+ */
+void var_table_free(var_table_t *const table) {
+    for (int i = 0; i < table->capacity; i++) {
+        free(table->entries[i].name);
+        free(table->entries[i].value);
+    }
+    free(table->entries);
+    arena_destroy(&table->env_arena);
+    memset(table, 0, sizeof(var_table_t));
+    table->env_dirty = 1;
+}
+
+
+/**
+ * @see _var_find_slot, _hash_string
+ */
+const char *var_get(const char *const name) {
+    if (!_var_CURRENT->entries) return NULL;
+    return _var_CURRENT->entries[_var_find_slot(name, _hash_string(name))].value;
+}
+
+
+/**
+ * @see _var_entry, sink_error, strlen, realloc, memcpy, strcmp, hash_clear
+ */
+int var_set(const char *const name, const char *const value) {
+    var_entry_t *const entry = _var_entry(name);
+    if (!entry) return -1;
+    if (entry->flags & VAR_READONLY) {
+        sink_error("%s: readonly variable\n", name);
+        return -1;
+    }
+
+    // Reuse the buffer of the previous value when it is big enough
+    const size_t size = strlen(value) + 1;
+    if (size > entry->capacity) {
+        const size_t capacity = size < 16 ? 16 : size;
+        char *const buffer = realloc(entry->value, capacity);
+        if (!buffer) return -1;
+        entry->value = buffer;
+        entry->capacity = capacity;
+    }
+    memcpy(entry->value, value, size);
+
+    if (entry->flags & VAR_EXPORTED) _var_CURRENT->env_dirty = 1;
+
+    // Commands resolved with the previous PATH may not be the right ones anymore
+    if (strcmp(name, "PATH") == 0) hash_clear();
+
+    return 0;
+}
+
+
+/**
+ * @see _var_find_slot, _hash_string, sink_error, free, strcmp, hash_clear
+ */
+int var_unset(const char *const name) {
+    if (!_var_CURRENT->entries) return 0;
+
+    var_entry_t *const entry = &_var_CURRENT->entries[_var_find_slot(name, _hash_string(name))];
+    if (!entry->name) return 0;
+    if (entry->flags & VAR_READONLY) {
+        sink_error("%s: readonly variable\n", name);
+        return -1;
+    }
+
+    if (entry->flags & VAR_EXPORTED) _var_CURRENT->env_dirty = 1;
+    free(entry->value);
+    entry->value = NULL;
+    entry->capacity = 0;
+    entry->flags = 0;
+
+    if (strcmp(name, "PATH") == 0) hash_clear();
+
+    return 0;
+}
+
+
+/**
+ * @see _var_entry
+ */
+int var_add_flags(const char *const name, const int flags) {
+    var_entry_t *const entry = _var_entry(name);
+    if (!entry) return -1;
+
+    if ((flags & VAR_EXPORTED) && !(entry->flags & VAR_EXPORTED) && entry->value) _var_CURRENT->env_dirty = 1;
+    entry->flags |= flags;
+
+    return 0;
+}
+
+
+/**
+ * @see isalpha, isalnum
+ */
+int var_is_name(const char *const name, const size_t length) {
+    if (length == 0 || !(isalpha((unsigned char)name[0]) || name[0] == '_')) return 0;
+    for (size_t i = 1; i < length; i++) if (!(isalnum((unsigned char)name[i]) || name[i] == '_')) return 0;
+    return 1;
+}
+
+
+/**
+ * @see arena_reset, arena_alloc, strlen, memcpy
+ */
+char **var_environ() {
+    if (!_var_CURRENT->env_dirty && _var_CURRENT->env) {
+        if (!EMBEDDED) environ = _var_CURRENT->env;
+        return _var_CURRENT->env;
+    }
+
+    // The previous environment is thrown away at once with its arena
+    arena_reset(&_var_CURRENT->env_arena);
+
+    int count = 0;
+    for (int i = 0; i < _var_CURRENT->capacity; i++) if (_var_CURRENT->entries[i].name && _var_CURRENT->entries[i].value && (_var_CURRENT->entries[i].flags & VAR_EXPORTED)) count++;
+
+    char **const env = arena_alloc(&_var_CURRENT->env_arena, (count + 1) * sizeof(char *));
+    if (!env) return environ;
+
+    int j = 0;
+    for (int i = 0; i < _var_CURRENT->capacity; i++) {
+        const var_entry_t *const entry = &_var_CURRENT->entries[i];
+        if (!entry->name || !entry->value || !(entry->flags & VAR_EXPORTED)) continue;
+
+        const size_t name_length = strlen(entry->name), value_length = strlen(entry->value);
+        char *const str = arena_alloc(&_var_CURRENT->env_arena, name_length + value_length + 2);
+        if (!str) return environ;
+        memcpy(str, entry->name, name_length);
+        str[name_length] = '=';
+        memcpy(str + name_length + 1, entry->value, value_length + 1);
+        env[j++] = str;
+    }
+    env[j] = NULL;
+
+    // Functions of the libc reading the environment (getenv, execvp) see the same variables,
+    // inside another program the environment stays its own and is only given to commands
+    if (!EMBEDDED) environ = env;
+    _var_CURRENT->env = env;
+    _var_CURRENT->env_dirty = 0;
+
+    return env;
+}
+
+
+/**
+ * @see strcmp
+ */
+int _var_compare(const void *const a, const void *const b) {
+    return strcmp((*(const var_entry_t *const *)a)->name, (*(const var_entry_t *const *)b)->name);
+}
+
+
+/**
+ * @see malloc, qsort, _var_compare, sink_printf, free
+ */
+void _var_print(const char *const command, const int flag) {
+    const var_entry_t **const entries = malloc((_var_CURRENT->count + 1) * sizeof(var_entry_t *));
+    if (!entries) return;
+
+    int count = 0;
+    for (int i = 0; i < _var_CURRENT->capacity; i++) if (_var_CURRENT->entries[i].name && (_var_CURRENT->entries[i].flags & flag)) entries[count++] = &_var_CURRENT->entries[i];
+    qsort(entries, count, sizeof(var_entry_t *), _var_compare);
+
+    // Print the value between double quotes, escaping what would be expanded
+    for (int i = 0; i < count; i++) {
+        sink_printf("%s %s", command, entries[i]->name);
+        if (!entries[i]->value) {
+            sink_printf("\n");
+            continue;
+        }
+        sink_printf("=\"");
+        for (const char *ptr = entries[i]->value; *ptr; ptr++) sink_printf(strchr("\"$`\\", *ptr) ? "\\%c" : "%c", *ptr);
+        sink_printf("\"\n");
+    }
+
+    free(entries);
+}
+
+
+/**
+ * @see strchr, strlen, var_is_name, sink_error, strndup, var_add_flags, var_set, free
+ */
+int _var_set_flag_command(const int argc, const char *const *const argv, const int flag) {
+    int res = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *const equal = strchr(argv[i], '=');
+        const size_t length = equal ? (size_t)(equal - argv[i]) : strlen(argv[i]);
+        if (!var_is_name(argv[i], length)) {
+            sink_error("%s: `%s': not a valid identifier\n", argv[0], argv[i]);
+            res = 1;
+            continue;
+        }
+
+        char *const name = strndup(argv[i], length);
+        if (!name) return 1;
+
+        // The value is set before the flag, so readonly NAME=value works
+        if (equal && var_set(name, equal + 1) == -1) res = 1;
+        else if (var_add_flags(name, flag) == -1) res = 1;
+        free(name);
+    }
+
+    return res;
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _export_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] [name[=value] ...]\n", program_name);
+    sink_printf("Give the variables to the environment of the commands run by the shell\n");
+    sink_printf("Without name, print every exported variable\n");
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -p             Print every exported variable\n");
+}
+
+
+/**
+ * @see strcmp, _export_print_usage, _var_print, sink_error, _var_set_flag_command
+ */
+int our_export(const int argc, const char *const *const argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        _export_print_usage(argv[0]);
+        return 0;
+    }
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "-p") == 0)) {
+        _var_print("export", VAR_EXPORTED);
+        return 0;
+    }
+    if (argv[1][0] == '-') {
+        sink_error("%s: unknown option %s\n", argv[0], argv[1]);
+        _export_print_usage(argv[0]);
+        return 1;
+    }
+
+    return _var_set_flag_command(argc, argv, VAR_EXPORTED);
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _readonly_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] [name[=value] ...]\n", program_name);
+    sink_printf("Forbid any change of the variables, until the end of the shell\n");
+    sink_printf("Without name, print every readonly variable\n");
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -p             Print every readonly variable\n");
+}
+
+
+/**
+ * @see strcmp, _readonly_print_usage, _var_print, sink_error, _var_set_flag_command
+ */
+int our_readonly(const int argc, const char *const *const argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        _readonly_print_usage(argv[0]);
+        return 0;
+    }
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "-p") == 0)) {
+        _var_print("readonly", VAR_READONLY);
+        return 0;
+    }
+    if (argv[1][0] == '-') {
+        sink_error("%s: unknown option %s\n", argv[0], argv[1]);
+        _readonly_print_usage(argv[0]);
+        return 1;
+    }
+
+    return _var_set_flag_command(argc, argv, VAR_READONLY);
+}
+
+
+/**
+ * @see sink_printf
+ */
+void _unset_print_usage(const char *const program_name) {
+    sink_printf("Usage: %s [Options] name...\n", program_name);
+    sink_printf("Remove the variables from the shell and from the environment of the commands\n");
+    sink_printf("Options:\n");
+    sink_printf("    -h | --help    Print this help message\n");
+    sink_printf("    -v             Names are variables (default)\n");
+}
+
+
+/**
+ * @see strcmp, _unset_print_usage, sink_error, strlen, var_is_name, var_unset
+ */
+int our_unset(const int argc, const char *const *const argv) {
+    int first_name = 1;
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        _unset_print_usage(argv[0]);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "-v") == 0) first_name = 2;
+    else if (argc > 1 && argv[1][0] == '-') {
+        sink_error("%s: unknown option %s\n", argv[0], argv[1]);
+        _unset_print_usage(argv[0]);
+        return 1;
+    }
+
+    int res = 0;
+    for (int i = first_name; i < argc; i++) {
+        if (!var_is_name(argv[i], strlen(argv[i]))) {
+            sink_error("%s: `%s': not a valid identifier\n", argv[0], argv[i]);
+            res = 1;
+        }
+        else if (var_unset(argv[i]) == -1) res = 1;
+    }
+
+    return res;
+}
+
+
+REGISTER_BUILTIN("export", our_export, 0);
+REGISTER_BUILTIN("readonly", our_readonly, 0);
+REGISTER_BUILTIN("unset", our_unset, 0);